@@ -0,0 +1,198 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Checks ActivationBus's filtering, ordering and unsubscribing (including from inside a handler), then stresses it:
+// four threads publish while two more subscribe and unsubscribe as fast as they can, and every publish has to reach
+// the permanent subscribers exactly once and never reach a handler whose Unsubscribe returned before it started.
+// Then times publishing to 1 and 8 subscribers, with and without a thread churning subscriptions, and churning.
+
+#include "ActivationBus.h"
+#include "Benchmark.h"
+#include "ToastArguments.h"
+#include <atomic>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const int PublisherCount = 4;
+    const int PublishesPerPublisher = 50000;
+    const int ChurnerCount = 2;
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+
+    // Each churner's subscriptions, one at a time. Cutoff is the last sequence number that could have started before
+    // the latest Unsubscribe returned, published before Retired so a handler that sees Retired sees it too.
+    struct ChurnSlot
+    {
+        std::atomic<std::uint64_t> Retired{ 0 };
+        std::atomic<std::uint64_t> Cutoff{ 0 };
+    };
+}
+
+int main()
+{
+    int failures = 0;
+
+    {
+        ActivationBus bus;
+        std::wstring calls;
+        ActivationSubscription all = bus.Subscribe([&](const ActivationEventArgs&) { calls += L'a'; });
+        ActivationSubscription like = bus.Subscribe([&](const ActivationEventArgs&) { calls += L'l'; }, L"like");
+        bus.Subscribe([&](const ActivationEventArgs& e) { calls += e.UserInput(L"tbReply") == L"hi" ? L'r' : L'?'; }, L"reply");
+
+        ActivationUserInput reply[] = { { L"tbReply", L"hi" } };
+        Check(bus.Publish(ActivationEventArgs(L"action=like&conversationId=9813")) == 2, "a like reached the wrong handlers", failures);
+        Check(bus.Publish(ActivationEventArgs(L"action=reply", reply, 1)) == 2, "a reply reached the wrong handlers", failures);
+        Check(bus.Publish(ActivationEventArgs(L"conversationId=9813")) == 1, "an activation without an action reached a filtered handler", failures);
+        Check(calls == L"alara", "handlers weren't called in the order they subscribed", failures);
+
+        Check(bus.Unsubscribe(like) && !bus.Unsubscribe(like) && bus.SubscriberCount() == 2, "Unsubscribe didn't remove the handler once", failures);
+        Check(bus.Publish(ActivationEventArgs(L"action=like")) == 1, "an unsubscribed handler was called", failures);
+
+        // A handler can take itself off and put another on; the new one waits for the next activation
+        ActivationSubscription once = 0;
+        int onceCalls = 0, laterCalls = 0;
+        once = bus.Subscribe([&](const ActivationEventArgs&) {
+            onceCalls++;
+            bus.Unsubscribe(once);
+            bus.Subscribe([&](const ActivationEventArgs&) { laterCalls++; });
+        });
+        bus.Publish(ActivationEventArgs(L"action=like"));
+        bus.Publish(ActivationEventArgs(L"action=like"));
+        Check(onceCalls == 1 && laterCalls == 1, "subscribing from inside a handler went wrong", failures);
+        bus.Unsubscribe(all);
+
+        // A subscriber that throws is counted, and the ones after it are still called
+        {
+            ActivationBus throwing;
+            int secondCalls = 0;
+            throwing.Subscribe([](const ActivationEventArgs&) { throw std::runtime_error("no window"); });
+            throwing.Subscribe([&](const ActivationEventArgs&) { secondCalls++; });
+            std::size_t failed = 0;
+            Check(throwing.Publish(ActivationEventArgs(L"action=like"), failed) == 2 && failed == 1 && secondCalls == 1,
+                "a throwing subscriber kept the activation from the next one", failures);
+        }
+
+        // A clone is a block of its own with the same contents
+        ActivationEventArgs original(L"action=reply", reply, 1);
+        ActivationEventArgs clone = original.Clone();
+        Check(clone.Argument() == L"action=reply" && clone.UserInput(L"tbReply") == L"hi" && clone.Argument().data() != original.Argument().data(),
+            "Clone didn't copy the args", failures);
+        Check(ActivationEventArgs().Clone().Argument().empty(), "cloning empty args went wrong", failures);
+    }
+
+    // Stress: publishers and churners at once
+    {
+        ActivationBus bus;
+        std::atomic<std::uint64_t> sequence{ 0 };
+        std::atomic<std::uint64_t> allCalls{ 0 }, likeCalls{ 0 }, churnCalls{ 0 }, lateCalls{ 0 };
+        bus.Subscribe([&](const ActivationEventArgs&) { allCalls.fetch_add(1, std::memory_order_relaxed); });
+        bus.Subscribe([&](const ActivationEventArgs&) { likeCalls.fetch_add(1, std::memory_order_relaxed); }, L"like");
+
+        std::atomic<int> publishersLeft{ PublisherCount };
+        ChurnSlot slots[ChurnerCount];
+        std::vector<std::thread> threads;
+        for (int c = 0; c < ChurnerCount; c++)
+        {
+            threads.emplace_back([&, slot = &slots[c]] {
+                for (std::uint64_t generation = 1; publishersLeft != 0; generation++)
+                {
+                    ActivationSubscription subscription = bus.Subscribe([&, slot, generation](const ActivationEventArgs& e) {
+                        churnCalls.fetch_add(1, std::memory_order_relaxed);
+                        std::uint64_t published = std::stoull(std::wstring(ToastArguments(e.Argument()).Get(L"seq")));
+                        if (slot->Retired.load() >= generation && published > slot->Cutoff.load())
+                        {
+                            lateCalls++;
+                        }
+                    });
+                    std::this_thread::yield();
+                    bus.Unsubscribe(subscription);
+                    slot->Cutoff.store(sequence.load());
+                    slot->Retired.store(generation);
+                }
+            });
+        }
+
+        for (int p = 0; p < PublisherCount; p++)
+        {
+            threads.emplace_back([&] {
+                for (int i = 0; i < PublishesPerPublisher; i++)
+                {
+                    std::uint64_t published = ++sequence;
+                    bus.Publish(ActivationEventArgs((published % 4 == 0 ? L"action=like&seq=" : L"action=view&seq=") + std::to_wstring(published)));
+                }
+                publishersLeft--;
+            });
+        }
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        std::uint64_t total = std::uint64_t(PublisherCount) * PublishesPerPublisher;
+        Check(allCalls == total, "a publish was lost or delivered twice while subscriptions churned", failures);
+        Check(likeCalls == total / 4, "the filtered subscriber missed or got extra activations", failures);
+        Check(lateCalls == 0, "a handler was called by a publish that started after it unsubscribed", failures);
+        Check(bus.SubscriberCount() == 2, "churned subscriptions were left behind", failures);
+        std::printf("%llu publishes, %llu reached a churning subscriber\n", static_cast<unsigned long long>(total), static_cast<unsigned long long>(churnCalls.load()));
+    }
+
+    ActivationEventArgs args(L"action=like&conversationId=9813");
+    for (int subscriberCount : { 1, 8 })
+    {
+        ActivationBus bus;
+        std::atomic<std::uint64_t> calls{ 0 };
+        for (int i = 0; i < subscriberCount; i++)
+        {
+            bus.Subscribe([&](const ActivationEventArgs&) { calls.fetch_add(1, std::memory_order_relaxed); });
+        }
+
+        std::string name = "Publish, " + std::to_string(subscriberCount) + " subscribers";
+        RunBenchmark(name.c_str(), [&] { DoNotOptimize(bus.Publish(args)); });
+
+        // Publishing never waits on a writer, however often the list changes
+        std::atomic<bool> stop{ false };
+        std::thread churner([&] {
+            while (!stop)
+            {
+                bus.Unsubscribe(bus.Subscribe([](const ActivationEventArgs&) {}));
+            }
+        });
+        name += ", churning";
+        RunBenchmark(name.c_str(), [&] { DoNotOptimize(bus.Publish(args)); });
+        stop = true;
+        churner.join();
+    }
+
+    {
+        ActivationBus bus;
+        for (int i = 0; i < 8; i++)
+        {
+            bus.Subscribe([](const ActivationEventArgs&) {});
+        }
+        RunBenchmark("Subscribe + Unsubscribe, 8 subscribers", [&] { bus.Unsubscribe(bus.Subscribe([](const ActivationEventArgs&) {})); });
+    }
+
+    return failures == 0 ? 0 : 1;
+}
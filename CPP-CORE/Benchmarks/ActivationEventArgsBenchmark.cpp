@@ -0,0 +1,105 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Compares building flat ActivationEventArgs from synthetic NOTIFICATION_USER_INPUT_DATA-shaped arrays
+// against the string-plus-map event args they replaced, including the hand-off to a handler.
+
+#include "ActivationEventArgs.h"
+#include "Benchmark.h"
+#include <functional>
+#include <iterator>
+#include <map>
+#include <string>
+
+namespace
+{
+    // Same layout as NOTIFICATION_USER_INPUT_DATA
+    struct UserInputData
+    {
+        const wchar_t* Key;
+        const wchar_t* Value;
+    };
+
+    // The old shape: an owned argument string and a map filled one input at a time, copied by value
+    class MapEventArgs
+    {
+    public:
+        MapEventArgs(std::wstring argument, std::map<std::wstring, std::wstring> userInput) :
+            m_argument(std::move(argument)),
+            m_userInput(std::move(userInput))
+        {
+        }
+
+        std::wstring Argument() const { return m_argument; }
+        const std::map<std::wstring, std::wstring>& UserInput() const { return m_userInput; }
+
+    private:
+        std::wstring m_argument;
+        std::map<std::wstring, std::wstring> m_userInput;
+    };
+
+    const wchar_t* const QuickReplyArgument = L"action=reply&conversationId=9813&tag=conversation-9813";
+
+    const UserInputData QuickReply[] = {
+        { L"tbReply", L"Sounds good, see you at the trailhead around nine tomorrow morning" },
+    };
+
+    const UserInputData Survey[] = {
+        { L"tbReply", L"Sounds good, see you at the trailhead around nine tomorrow morning" },
+        { L"selDay", L"saturday" },
+        { L"selTime", L"morning" },
+        { L"selDuration", L"half-day" },
+        { L"tbNotes", L"Bringing the dog" },
+    };
+
+    template <std::size_t N>
+    void RunPair(const char* mapName, const char* flatName, const UserInputData (&data)[N])
+    {
+        std::function<void(MapEventArgs)> mapHandler = [](MapEventArgs args) {
+            DoNotOptimize(args.UserInput().find(L"tbReply")->second.size());
+        };
+
+        RunBenchmark(mapName, [&] {
+            std::wstring argument(QuickReplyArgument);
+            std::map<std::wstring, std::wstring> userInput;
+            for (std::size_t i = 0; i < N; i++)
+            {
+                userInput.emplace(data[i].Key, data[i].Value);
+            }
+
+            MapEventArgs args(argument, userInput);
+            mapHandler(args);
+        });
+
+        std::function<void(ActivationEventArgs)> flatHandler = [](ActivationEventArgs args) {
+            DoNotOptimize(args.UserInput(L"tbReply").size());
+        };
+
+        RunBenchmark(flatName, [&] {
+            ActivationEventArgs args(QuickReplyArgument, data, N);
+            flatHandler(std::move(args));
+        });
+    }
+}
+
+int main()
+{
+    RunPair("1 input, string + map, copied", "1 input, flat arena, moved", QuickReply);
+    RunPair("5 inputs, string + map, copied", "5 inputs, flat arena, moved", Survey);
+
+    ActivationEventArgs survey(QuickReplyArgument, Survey, std::size(Survey));
+    RunBenchmark("flat arena, UserInput lookup", [&] {
+        DoNotOptimize(survey.UserInput(L"tbNotes"));
+    });
+
+    return 0;
+}
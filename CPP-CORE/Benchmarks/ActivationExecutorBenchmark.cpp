@@ -0,0 +1,176 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Checks that ActivationExecutor runs handlers with the same ordering key one at a time and in order,
+// that a throwing WorkerStarted doesn't end the process, and that handlers can call Flush and Shutdown
+// without deadlocking or leaving a worker behind, then times a handler's trip through the pool.
+
+#include "ActivationExecutor.h"
+#include "Benchmark.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+}
+
+int main()
+{
+    int failures = 0;
+
+    // Handlers for one key run in order and never overlap; the keys run alongside each other
+    {
+        constexpr int Keys = 8;
+        constexpr int PerKey = 500;
+
+        ActivationExecutorOptions options;
+        options.WorkerCount = 4;
+        ActivationExecutor executor(options);
+
+        std::vector<int> next(Keys, 0);
+        std::vector<std::unique_ptr<std::atomic<int>>> running;
+        for (int key = 0; key < Keys; key++)
+        {
+            running.push_back(std::make_unique<std::atomic<int>>(0));
+        }
+        std::atomic<bool> ordered{ true };
+
+        for (int i = 0; i < PerKey; i++)
+        {
+            for (int key = 0; key < Keys; key++)
+            {
+                executor.Submit(std::to_wstring(key), [&, key, i]
+                {
+                    if (running[key]->fetch_add(1) != 0 || next[key] != i)
+                    {
+                        ordered = false;
+                    }
+                    next[key] = i + 1;
+                    running[key]->fetch_sub(1);
+                });
+            }
+        }
+        executor.Flush();
+
+        ActivationExecutorStats stats = executor.GetStats();
+        Check(ordered, "handlers for one key overlapped or ran out of order", failures);
+        Check(stats.Completed == Keys * PerKey && stats.Failed == 0, "not every handler ran", failures);
+    }
+
+    // A WorkerStarted that throws leaves the worker running handlers
+    {
+        ActivationExecutorOptions options;
+        options.WorkerCount = 2;
+        options.WorkerStarted = [] { throw std::runtime_error("CoInitializeEx failed"); };
+        ActivationExecutor executor(options);
+
+        std::atomic<int> handled{ 0 };
+        for (int i = 0; i < 10; i++)
+        {
+            executor.Submit(L"", [&handled] { handled++; });
+        }
+        executor.Flush();
+        Check(handled == 10, "a worker whose WorkerStarted threw didn't run handlers", failures);
+    }
+
+    // A handler can call Flush, and Shutdown without joining its own worker
+    {
+        auto executor = std::make_unique<ActivationExecutor>(ActivationExecutorOptions());
+        ActivationExecutor* self = executor.get();
+
+        std::atomic<int> handled{ 0 };
+        for (int i = 0; i < 20; i++)
+        {
+            executor->Submit(L"conversation", [self, &handled, i]
+            {
+                self->Flush();
+                if (i == 5)
+                {
+                    self->Shutdown(false);
+                }
+                handled++;
+            });
+        }
+        executor->Flush();
+
+        Check(handled == 6, "handlers kept running after one shut the executor down without draining", failures);
+        Check(executor->Submit(L"", [] {}) == ActivationSubmitResult::ShutDown, "the executor took a handler after being shut down", failures);
+        executor.reset();
+    }
+
+    // Handlers on several workers shutting down while the owner does too
+    {
+        ActivationExecutorOptions options;
+        options.WorkerCount = 4;
+        auto executor = std::make_unique<ActivationExecutor>(options);
+        ActivationExecutor* self = executor.get();
+
+        std::atomic<int> started{ 0 };
+        for (int i = 0; i < 4; i++)
+        {
+            executor->Submit(std::to_wstring(i), [self, &started]
+            {
+                started++;
+                while (started < 4)
+                {
+                    std::this_thread::yield();
+                }
+                self->Shutdown(true);
+            });
+        }
+        while (started < 4)
+        {
+            std::this_thread::yield();
+        }
+        executor->Shutdown(true);
+        executor.reset();
+        Check(started == 4, "a handler didn't run", failures);
+    }
+
+    // Timing
+    {
+        ActivationExecutorOptions options;
+        options.WorkerCount = 2;
+        ActivationExecutor executor(options);
+
+        std::atomic<std::uint64_t> handled{ 0 };
+        std::uint64_t submitted = 0;
+        RunBenchmark("Submit + run, no ordering key", [&] {
+            executor.Submit(L"", [&handled] { handled++; });
+            submitted++;
+        });
+        executor.Flush();
+        Check(handled == submitted, "a timed handler didn't run", failures);
+
+        RunBenchmark("Submit + run, one ordering key", [&] {
+            executor.Submit(L"conversation", [&handled] { handled++; });
+        });
+        executor.Flush();
+    }
+
+    return failures == 0 ? 0 : 1;
+}
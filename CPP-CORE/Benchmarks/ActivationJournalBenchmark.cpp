@@ -0,0 +1,384 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Times what an ActivationJournal adds to each activation: copying it into the mapping, and waiting for the disk
+// with activations from several threads sharing each flush. Then checks, on the real filesystem, that unfinished
+// activations and their user input come back after a reopen, that one whose handler keeps failing is given up on,
+// that a torn or corrupt record is dropped along with nothing before it, that rewinding keeps the file small without
+// old records coming back, and (outside Windows) that a process killed part way through a handler has that
+// activation replayed through a DesktopNotificationManager on the next start.
+
+#include "ActivationJournal.h"
+#include "Benchmark.h"
+#include "DesktopNotificationManager.h"
+#include "InMemoryNotificationPlatform.h"
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    using SteadyClock = std::chrono::steady_clock;
+
+    const std::wstring Aumid = L"Contoso.Mail";
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+
+    ActivationEventArgs MakeReply(int index)
+    {
+        static const std::wstring key = L"tbReply";
+        std::wstring value = L"Reply " + std::to_wstring(index);
+        ActivationUserInput input{ key, value };
+        return ActivationEventArgs(L"action=reply&tag=" + std::to_wstring(index), &input, 1);
+    }
+
+    bool IsReply(const ActivationEventArgs& args, int index)
+    {
+        return args.Argument() == L"action=reply&tag=" + std::to_wstring(index) && args.UserInputCount() == 1 &&
+            args.UserInput(L"tbReply") == L"Reply " + std::to_wstring(index);
+    }
+
+    std::vector<char> ReadFile(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void WriteFile(const std::filesystem::path& path, const std::vector<char>& contents)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+
+    std::vector<ActivationJournalEntry> Reopen(const std::filesystem::path& path, ActivationJournal& journal, ActivationJournalOptions options = {})
+    {
+        std::vector<ActivationJournalEntry> entries;
+        journal.Close();
+        journal.Open(path, options);
+        journal.Unfinished(entries);
+        return entries;
+    }
+
+    void CheckRoundTrip(const std::filesystem::path& directory, int& failures)
+    {
+        std::filesystem::path path = directory / "roundtrip.journal";
+        ActivationJournal journal;
+        journal.Open(path);
+
+        std::uint64_t sequences[4];
+        for (int i = 0; i < 4; i++)
+        {
+            journal.Begin(MakeReply(i), sequences[i]);
+        }
+        journal.Complete(sequences[1]);
+        journal.Complete(sequences[3]);
+        Check(journal.Complete(sequences[3]) == ToastResultNotFound, "an activation was completed twice", failures);
+
+        std::vector<ActivationJournalEntry> running;
+        journal.Unfinished(running);
+        Check(running.empty(), "Unfinished handed out activations this process is still handling", failures);
+
+        std::vector<ActivationJournalEntry> entries = Reopen(path, journal);
+        Check(entries.size() == 2 && IsReply(entries[0].Args, 0) && IsReply(entries[1].Args, 2) && entries[0].Attempts == 1 &&
+            !journal.GetStats().Recovered, "the unfinished activations didn't come back", failures);
+
+        // Each start that retries and then dies uses up an attempt, and the third is the last
+        ActivationJournalOptions options;
+        options.MaxAttempts = 3;
+        for (const ActivationJournalEntry& entry : entries)
+        {
+            journal.Retry(entry.Sequence);
+        }
+        entries = Reopen(path, journal, options);
+        if (entries.size() != 2 || entries[0].Attempts != 2 || entries[1].Attempts != 2)
+        {
+            Check(false, "retries weren't counted", failures);
+            return;
+        }
+
+        journal.Retry(entries[0].Sequence);
+        journal.Retry(entries[1].Sequence);
+        journal.Complete(entries[1].Sequence);
+        entries = Reopen(path, journal, options);
+        Check(entries.empty() && journal.GetStats().Abandoned == 1 && Reopen(path, journal, options).empty(), "an activation that kept failing wasn't given up on", failures);
+    }
+
+    // Copies of a journal cut off, or with a byte flipped, part way through its last record
+    void CheckTornRecords(const std::filesystem::path& directory, int& failures)
+    {
+        std::filesystem::path path = directory / "torn.journal";
+        std::uint64_t lastRecord;
+        {
+            ActivationJournal journal;
+            journal.Open(path);
+            std::uint64_t sequence;
+            for (int i = 0; i < 10; i++)
+            {
+                journal.Begin(MakeReply(i), sequence);
+            }
+            lastRecord = journal.GetStats().Bytes;
+            journal.Begin(MakeReply(10), sequence);
+        }
+
+        std::vector<char> contents = ReadFile(path);
+        std::filesystem::path copy = directory / "torn-copy.journal";
+        for (int corruption = 0; corruption < 2; corruption++)
+        {
+            std::vector<char> damaged = contents;
+            if (corruption == 0)
+            {
+                damaged.resize(static_cast<std::size_t>(lastRecord + 20));
+            }
+            else
+            {
+                damaged[static_cast<std::size_t>(lastRecord + 30)] ^= 0x40;
+            }
+            WriteFile(copy, damaged);
+
+            ActivationJournal journal;
+            std::vector<ActivationJournalEntry> entries = Reopen(copy, journal);
+            Check(entries.size() == 10 && IsReply(entries[9].Args, 9) && journal.GetStats().Recovered,
+                corruption == 0 ? "a torn record wasn't dropped cleanly" : "a corrupt record wasn't dropped cleanly", failures);
+
+            // And writing carries on over it
+            std::uint64_t sequence;
+            journal.Begin(MakeReply(11), sequence);
+            entries = Reopen(copy, journal);
+            Check(entries.size() == 11 && IsReply(entries[10].Args, 11), "a record written over a torn one was lost", failures);
+        }
+    }
+
+    void CheckRewind(const std::filesystem::path& directory, int& failures)
+    {
+        std::filesystem::path path = directory / "rewind.journal";
+        ActivationJournalOptions options;
+        options.InitialSize = 16 << 10;
+        options.RewindAfterBytes = 4 << 10;
+
+        ActivationJournal journal;
+        journal.Open(path, options);
+        std::uint64_t sequence;
+        for (int i = 0; i < 10000; i++)
+        {
+            journal.Begin(MakeReply(i), sequence);
+            journal.Complete(sequence);
+        }
+        ActivationJournalStats stats = journal.GetStats();
+        Check(stats.Rewinds > 100 && std::filesystem::file_size(path) == options.InitialSize, "the journal didn't rewind", failures);
+
+        // Old records are still in the file past the new ones, and must not come back
+        journal.Begin(MakeReply(10000), sequence);
+        std::vector<ActivationJournalEntry> entries = Reopen(path, journal, options);
+        Check(entries.size() == 1 && IsReply(entries[0].Args, 10000) && !journal.GetStats().Recovered, "records from before a rewind came back", failures);
+        std::printf("rewinds over 10,000 activations: %llu\n", static_cast<unsigned long long>(stats.Rewinds));
+    }
+
+    // A handler that throws, with or without an executor, fails its activation without the exception getting out,
+    // completes it for a waiting startup, and leaves it in the journal for the next start
+    void CheckThrowingHandler(const std::filesystem::path& directory, int& failures)
+    {
+        std::filesystem::path path = directory / "throwing.journal";
+        InMemoryNotificationPlatform platform;
+        ActivationJournal journal;
+        journal.Open(path);
+        ActivationStartup startup;
+
+        auto throwing = [](const ActivationEventArgs&) -> ToastResult { throw std::runtime_error("no network"); };
+        auto succeeding = [](const ActivationEventArgs&) { return ToastResultOk; };
+        {
+            DesktopNotificationManager manager(platform, Aumid);
+            manager.JournalActivations(&journal);
+            manager.TrackActivations(&startup);
+            manager.OnActivated([](const ActivationEventArgs&) { throw std::runtime_error("no window"); });
+
+            Check(manager.Dispatch(MakeReply(1), throwing) == ToastResultFail, "a throwing handler didn't fail its activation", failures);
+            Check(manager.Activate(MakeReply(2)) == ToastResultFail, "a throwing subscriber didn't fail its activation", failures);
+            manager.Dispatch(MakeReply(3), succeeding);
+
+            manager.UseActivationExecutor(ActivationExecutorOptions(), L"");
+            Check(manager.Dispatch(MakeReply(4), throwing) == ToastResultOk, "a throwing handler on the executor wasn't queued", failures);
+            manager.Dispatch(MakeReply(5), succeeding);
+        }
+
+        ActivationStartupOptions options;
+        options.ActivationTimeout = std::chrono::milliseconds(0);
+        options.HandlerTimeout = std::chrono::milliseconds(0);
+        Check(startup.Drain(options) == ToastResultOk, "a throwing handler's activation was never completed", failures);
+
+        // A throwing subscriber is caught by the bus, so its activation is finished rather than replayed to the others
+        std::vector<ActivationJournalEntry> entries = Reopen(path, journal);
+        Check(entries.size() == 2 && IsReply(entries[0].Args, 1) && IsReply(entries[1].Args, 4),
+            "a throwing handler's activation wasn't kept", failures);
+    }
+
+#if !defined(_WIN32)
+    // Kills a child process part way through a reply's handler, with no chance to flush or close, after a like has
+    // been handled, then replays the journal it leaves through a manager's Activations() the way a new start would
+    void CheckKilledHandler(const std::filesystem::path& directory, int& failures)
+    {
+        std::filesystem::path path = directory / "killed.journal";
+        int pipeFds[2];
+        if (pipe(pipeFds) != 0)
+        {
+            return;
+        }
+
+        pid_t child = fork();
+        if (child == 0)
+        {
+            InMemoryNotificationPlatform platform;
+            ActivationJournal journal;
+            journal.Open(path);
+
+            DesktopNotificationManager manager(platform, Aumid);
+            manager.JournalActivations(&journal);
+            manager.OnActivated([&](const ActivationEventArgs& e) {
+                manager.Show(ToastPayload{ L"<toast><visual><binding template=\"ToastGeneric\"><text>Sent</text></binding></visual></toast>", L"", L"", {} });
+                if (e.UserInputCount() != 0)
+                {
+                    char ready = 1;
+                    (void)write(pipeFds[1], &ready, 1);
+                    for (;;)
+                    {
+                        pause();
+                    }
+                }
+            });
+
+            manager.Activate(ActivationEventArgs(L"action=like&tag=1"));
+            manager.Activate(MakeReply(2));
+            _exit(0);
+        }
+
+        char ready = 0;
+        (void)read(pipeFds[0], &ready, 1);
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+
+        InMemoryNotificationPlatform platform;
+        ActivationJournal journal;
+        journal.Open(path);
+
+        DesktopNotificationManager manager(platform, Aumid);
+        manager.JournalActivations(&journal);
+        std::vector<std::wstring> replayed;
+        manager.OnActivated([&](const ActivationEventArgs& e) {
+            Check(IsReply(e, 2), "the replayed activation lost its user input", failures);
+            replayed.push_back(std::wstring(e.Argument()));
+        });
+
+        ToastResult result = manager.ReplayActivations();
+        Check(ToastSucceeded(result) && replayed.size() == 1 && journal.GetStats().UnfinishedCount == 0, "the killed handler's activation wasn't replayed", failures);
+        Check(manager.ReplayActivations() == ToastResultOk && replayed.size() == 1, "a replayed activation was replayed again", failures);
+    }
+#endif
+
+    // Threads each handling activations, with every Begin waiting for the disk
+    void BenchmarkGroupCommit(const std::filesystem::path& directory, int threadCount, int perThread)
+    {
+        ActivationJournalOptions options;
+        options.WaitForDisk = true;
+
+        ActivationJournal journal;
+        journal.Open(directory / ("group" + std::to_string(threadCount) + ".journal"), options);
+
+        SteadyClock::time_point start = SteadyClock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back([&journal, t, perThread] {
+                for (int i = 0; i < perThread; i++)
+                {
+                    std::uint64_t sequence;
+                    journal.Begin(MakeReply(t * perThread + i), sequence);
+                    journal.Complete(sequence);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        int activations = threadCount * perThread;
+        double nanoseconds = std::chrono::duration<double, std::nano>(SteadyClock::now() - start).count();
+        std::string name = "Begin waiting for the disk, " + std::to_string(threadCount) + (threadCount == 1 ? " thread" : " threads");
+        ReportBenchmark(name.c_str(), nanoseconds / activations, static_cast<std::uint64_t>(activations));
+        std::printf("  %d activations, %llu flushes\n", activations, static_cast<unsigned long long>(journal.GetStats().Flushes));
+    }
+}
+
+int main()
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "ActivationJournalBenchmark";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    int failures = 0;
+
+    CheckRoundTrip(directory, failures);
+    CheckTornRecords(directory, failures);
+    CheckRewind(directory, failures);
+    CheckThrowingHandler(directory, failures);
+#if !defined(_WIN32)
+    CheckKilledHandler(directory, failures);
+#endif
+
+    {
+        ActivationJournal journal;
+        journal.Open(directory / "mapped.journal");
+        ActivationEventArgs args = MakeReply(1);
+        RunBenchmark("Begin and Complete", [&] {
+            std::uint64_t sequence;
+            journal.Begin(args, sequence);
+            journal.Complete(sequence);
+        });
+    }
+
+    {
+        InMemoryNotificationPlatform platform;
+        DesktopNotificationManager manager(platform, Aumid);
+        manager.OnActivated([](const ActivationEventArgs& e) { DoNotOptimize(e.Argument()); });
+        RunBenchmark("Activate, not journaled", [&] { manager.Activate(MakeReply(1)); });
+
+        ActivationJournal journal;
+        journal.Open(directory / "manager.journal");
+        manager.JournalActivations(&journal);
+        RunBenchmark("Activate, journaled", [&] { manager.Activate(MakeReply(1)); });
+    }
+
+    BenchmarkGroupCommit(directory, 1, 200);
+    BenchmarkGroupCommit(directory, 8, 200);
+
+    std::filesystem::remove_all(directory);
+    return failures == 0 ? 0 : 1;
+}
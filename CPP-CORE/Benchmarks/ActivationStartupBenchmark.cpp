@@ -0,0 +1,249 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Runs the activation-only start against the in-memory platform with real, short timeouts. Checks that it gives up
+// when no activation comes, that a burst of background activations queued on an executor is all handled before it
+// returns, that a handler calling KeepRunning ends the wait at once, that Drain waits for a straggler, and that a
+// handler that throws or never returns can't hold the wait up past its timeouts. The
+// phases have to add up to the total and each has to cover the delays put into it. Then prints the phase breakdown
+// of the burst and times the registration an activation-only start skips.
+
+#include "ActivationStartup.h"
+#include "Benchmark.h"
+#include "DesktopNotificationManager.h"
+#include "InMemoryNotificationPlatform.h"
+#include <atomic>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace
+{
+    using Milliseconds = std::chrono::milliseconds;
+
+    const std::wstring Aumid = L"Contoso.Mail";
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+
+    Milliseconds Phase(const ActivationStartupTimings& timings, ActivationStartupPhase phase)
+    {
+        return std::chrono::duration_cast<Milliseconds>(timings.Phases[static_cast<std::size_t>(phase)]);
+    }
+
+    bool PhasesAddUp(const ActivationStartupTimings& timings)
+    {
+        std::chrono::nanoseconds sum{ 0 };
+        for (std::chrono::nanoseconds phase : timings.Phases)
+        {
+            sum += phase;
+        }
+        return sum == timings.Total;
+    }
+}
+
+int main()
+{
+    int failures = 0;
+
+    // Nothing arrives
+    {
+        ActivationStartup startup;
+        ActivationStartupOptions options;
+        options.ActivationTimeout = Milliseconds(20);
+        Check(startup.WaitForActivations(options) == ToastResultTimeout, "waiting with nothing arriving didn't time out", failures);
+
+        ActivationStartupTimings timings = startup.Timings();
+        Check(timings.TimedOut && timings.Activations == 0 && Phase(timings, ActivationStartupPhase::WaitForActivation) >= Milliseconds(20),
+            "the timeout wasn't recorded", failures);
+    }
+
+    // A burst of background activations, queued on an executor, all handled before the wait returns
+    ActivationStartupTimings burst;
+    {
+        InMemoryNotificationPlatform platform;
+        ActivationStartup startup;
+        startup.EndPhase(ActivationStartupPhase::Launch);
+
+        // COM started the process through the registration, so an activation-only start doesn't touch it
+        DesktopNotificationManager manager(platform, Aumid);
+        manager.TrackActivations(&startup);
+
+        ActivationExecutorOptions executorOptions;
+        executorOptions.WorkerCount = 2;
+        manager.UseActivationExecutor(executorOptions, L"");
+
+        std::atomic<int> handled{ 0 };
+        manager.OnActivated([&](const ActivationEventArgs&) {
+            std::this_thread::sleep_for(Milliseconds(5));
+            manager.Show(ToastPayload{ L"<toast><visual><binding template=\"ToastGeneric\"><text>Sent</text></binding></visual></toast>", L"", L"", {} });
+            handled++;
+        });
+        startup.EndPhase(ActivationStartupPhase::Register);
+
+        std::thread com([&] {
+            std::this_thread::sleep_for(Milliseconds(10));
+            manager.Activate(ActivationEventArgs(L"action=like&tag=1"));
+            manager.Activate(ActivationEventArgs(L"action=reply&tag=2"));
+            manager.Activate(ActivationEventArgs(L"action=like&tag=1"));
+        });
+
+        ActivationStartupOptions options;
+        options.IdleTimeout = Milliseconds(30);
+        ToastResult result = startup.WaitForActivations(options);
+        Check(result == ToastResultOk && handled == 3, "the wait returned before the burst was handled", failures);
+        startup.Drain(options);
+        com.join();
+
+        burst = startup.Timings();
+        Check(burst.Activations == 3 && !burst.TimedOut && !burst.KeptRunning, "the burst was miscounted", failures);
+        Check(platform.CallCount(InMemoryPlatformOperation::Registry) == 0 && platform.ShowCount() == 3, "the activation-only start touched the registry", failures);
+        Check(Phase(burst, ActivationStartupPhase::WaitForActivation) >= Milliseconds(10) && Phase(burst, ActivationStartupPhase::Handle) >= Milliseconds(5) &&
+            Phase(burst, ActivationStartupPhase::Idle) >= Milliseconds(30), "a phase was shorter than the delays put into it", failures);
+        Check(PhasesAddUp(burst), "the phases don't add up to the total", failures);
+    }
+
+    // A foreground activation hands over to the rest of the app
+    {
+        InMemoryNotificationPlatform platform;
+        ActivationStartup startup;
+        DesktopNotificationManager manager(platform, Aumid);
+        manager.TrackActivations(&startup);
+
+        ActivationExecutorOptions executorOptions;
+        executorOptions.WorkerCount = 1;
+        manager.UseActivationExecutor(executorOptions, L"");
+
+        std::atomic<bool> release{ false };
+        manager.OnActivated([&](const ActivationEventArgs&) {
+            startup.KeepRunning();
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+        });
+        manager.Activate(ActivationEventArgs(L"action=viewConversation"));
+
+        ActivationStartupOptions options;
+        options.ActivationTimeout = Milliseconds(5000);
+        Check(startup.WaitForActivations(options) == ToastResultOk, "the wait failed when a handler kept the app running", failures);
+        startup.Drain(options);
+
+        ActivationStartupTimings timings = startup.Timings();
+        Check(timings.KeptRunning && Phase(timings, ActivationStartupPhase::Idle) == Milliseconds(0), "KeepRunning didn't end the wait", failures);
+        Check(!release, "the wait waited for the foreground handler", failures);
+        release = true;
+    }
+
+    // An activation that slips in as the activator is revoked is still handled
+    {
+        InMemoryNotificationPlatform platform;
+        ActivationStartup startup;
+        DesktopNotificationManager manager(platform, Aumid);
+        manager.TrackActivations(&startup);
+
+        ActivationExecutorOptions executorOptions;
+        executorOptions.WorkerCount = 1;
+        manager.UseActivationExecutor(executorOptions, L"");
+
+        std::atomic<int> handled{ 0 };
+        manager.OnActivated([&](const ActivationEventArgs&) {
+            std::this_thread::sleep_for(Milliseconds(10));
+            handled++;
+        });
+
+        manager.Activate(ActivationEventArgs(L"action=like"));
+        ActivationStartupOptions options;
+        options.IdleTimeout = Milliseconds(5);
+        startup.WaitForActivations(options);
+
+        manager.Activate(ActivationEventArgs(L"action=like"));
+        startup.Drain(options);
+        Check(handled == 2 && Phase(startup.Timings(), ActivationStartupPhase::Drain) >= Milliseconds(10), "Drain didn't wait for the straggler", failures);
+    }
+
+    // A handler that throws on the executor still counts as handled
+    {
+        InMemoryNotificationPlatform platform;
+        ActivationStartup startup;
+        DesktopNotificationManager manager(platform, Aumid);
+        manager.TrackActivations(&startup);
+        manager.UseActivationExecutor(ActivationExecutorOptions(), L"");
+        manager.OnActivated([](const ActivationEventArgs&) { throw std::runtime_error("handler failed"); });
+
+        manager.Activate(ActivationEventArgs(L"action=like"));
+        ActivationStartupOptions options;
+        options.IdleTimeout = Milliseconds(5);
+        options.HandlerTimeout = Milliseconds(5000);
+        Check(startup.WaitForActivations(options) == ToastResultOk && startup.Drain(options) == ToastResultOk && startup.Timings().Abandoned == 0,
+            "a handler that threw kept the wait going", failures);
+        Check(manager.Metrics().Snapshot().Activations == 1, "a handler that threw wasn't recorded", failures);
+    }
+
+    // A handler that never returns is given up on after HandlerTimeout, by the wait and by Drain
+    {
+        InMemoryNotificationPlatform platform;
+        ActivationStartup startup;
+        DesktopNotificationManager manager(platform, Aumid);
+        manager.TrackActivations(&startup);
+        manager.UseActivationExecutor(ActivationExecutorOptions(), L"");
+
+        std::atomic<bool> release{ false };
+        manager.OnActivated([&release](const ActivationEventArgs&) {
+            while (!release)
+            {
+                std::this_thread::sleep_for(Milliseconds(1));
+            }
+        });
+
+        manager.Activate(ActivationEventArgs(L"action=sync"));
+        ActivationStartupOptions options;
+        options.HandlerTimeout = Milliseconds(20);
+        Check(startup.WaitForActivations(options) == ToastResultTimeout && startup.Drain(options) == ToastResultTimeout &&
+            startup.Timings().Abandoned == 1, "a handler that never returned held the wait up", failures);
+        release = true;
+    }
+
+    const char* phaseNames[] = { "launch", "register", "wait for activation", "handle", "idle", "drain" };
+    for (std::size_t i = 0; i < ActivationStartupPhaseCount; i++)
+    {
+        std::string name = std::string("Activation-only start, ") + phaseNames[i];
+        ReportMilliseconds(name.c_str(), std::chrono::duration<double, std::milli>(burst.Phases[i]).count());
+    }
+
+    // What an activation-only start skips: even with nothing to write, Register reads the fingerprint
+    {
+        InMemoryNotificationPlatform platform;
+        DesktopNotificationRegistration registration;
+        registration.DisplayName = L"Contoso Mail";
+        registration.LaunchCommand = L"\"C:\\Program Files\\Contoso\\Mail.exe\" -ToastActivated";
+
+        RunBenchmark("Register, first run", [&] {
+            platform.Reset();
+            DesktopNotificationManager manager(platform, Aumid);
+            DoNotOptimize(manager.Register(registration));
+        });
+
+        DesktopNotificationManager manager(platform, Aumid);
+        manager.Register(registration);
+        RunBenchmark("Register, already registered", [&] { DoNotOptimize(manager.Register(registration)); });
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Set by the CMake build to the name of the benchmark executable, which is what results are grouped under
+#ifndef BENCHMARK_SUITE
+#define BENCHMARK_SUITE "Benchmarks"
+#endif
+
+inline const void* volatile g_benchmarkSink = nullptr;
+
+/// <summary>
+/// Keeps the compiler from discarding a value whose computation is being measured.
+/// </summary>
+template <typename T>
+inline void DoNotOptimize(const T& value)
+{
+    g_benchmarkSink = &value;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+struct BenchmarkResult
+{
+    std::string Name;
+    double Nanoseconds;
+    std::uint64_t Iterations;
+};
+
+/// <summary>
+/// Every result this process reports. If the TOAST_BENCHMARK_JSON environment variable names a file, they're
+/// written to it as JSON when the process exits, for BenchmarkCompare to read:
+/// { "suite": "...", "benchmarks": [ { "name": "...", "ns_per_op": 12.5, "iterations": 1024 } ] }
+/// </summary>
+class BenchmarkResults
+{
+public:
+    ~BenchmarkResults()
+    {
+        const char* path = std::getenv("TOAST_BENCHMARK_JSON");
+        if (path == nullptr || *path == '\0')
+        {
+            return;
+        }
+
+        std::FILE* file = std::fopen(path, "w");
+        if (file == nullptr)
+        {
+            std::fprintf(stderr, "couldn't write benchmark results to %s\n", path);
+            return;
+        }
+
+        std::fprintf(file, "{\n  \"suite\": \"%s\",\n  \"benchmarks\": [", Escape(BENCHMARK_SUITE).c_str());
+        for (std::size_t i = 0; i < m_results.size(); i++)
+        {
+            std::fprintf(file, "%s\n    { \"name\": \"%s\", \"ns_per_op\": %.3f, \"iterations\": %llu }", i == 0 ? "" : ",",
+                Escape(m_results[i].Name).c_str(), m_results[i].Nanoseconds, static_cast<unsigned long long>(m_results[i].Iterations));
+        }
+        std::fprintf(file, "\n  ]\n}\n");
+        std::fclose(file);
+    }
+
+    void Add(BenchmarkResult result)
+    {
+        m_results.push_back(std::move(result));
+    }
+
+private:
+    static std::string Escape(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    std::vector<BenchmarkResult> m_results;
+};
+
+inline BenchmarkResults g_benchmarkResults;
+
+/// <summary>
+/// Prints a time per operation measured some other way than RunBenchmark, and records it with the rest.
+/// </summary>
+inline void ReportBenchmark(const char* name, double nanoseconds, std::uint64_t iterations)
+{
+    std::printf("%-48s %12.2f ns/op %14llu iterations\n", name, nanoseconds, static_cast<unsigned long long>(iterations));
+    g_benchmarkResults.Add({ name, nanoseconds, iterations });
+}
+
+/// <summary>
+/// Prints the time a one-off operation took, and records it as a single iteration.
+/// </summary>
+inline void ReportMilliseconds(const char* name, double milliseconds)
+{
+    std::printf("%-48s %12.2f ms\n", name, milliseconds);
+    g_benchmarkResults.Add({ name, milliseconds * 1e6, 1 });
+}
+
+/// <summary>
+/// Runs body in a loop, doubling the iteration count until a run takes at least minimumTime, then prints
+/// and returns the time per iteration in nanoseconds. The TOAST_BENCHMARK_MIN_TIME_MS environment variable
+/// overrides minimumTime, so a test run can check the results without waiting on the timings.
+/// </summary>
+template <typename TBody>
+double RunBenchmark(const char* name, TBody&& body, std::chrono::milliseconds minimumTime = std::chrono::milliseconds(200))
+{
+    using Clock = std::chrono::steady_clock;
+
+    const char* minimumTimeOverride = std::getenv("TOAST_BENCHMARK_MIN_TIME_MS");
+    if (minimumTimeOverride != nullptr && *minimumTimeOverride != '\0')
+    {
+        minimumTime = std::chrono::milliseconds(std::strtoll(minimumTimeOverride, nullptr, 10));
+    }
+
+    for (std::uint64_t iterations = 1;; iterations *= 2)
+    {
+        Clock::time_point start = Clock::now();
+        for (std::uint64_t i = 0; i < iterations; i++)
+        {
+            body();
+        }
+        Clock::duration elapsed = Clock::now() - start;
+
+        if (elapsed >= minimumTime || iterations >= (1ull << 40))
+        {
+            double nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+            ReportBenchmark(name, nanoseconds, iterations);
+            return nanoseconds;
+        }
+    }
+}
@@ -0,0 +1,266 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Runs several DesktopNotificationManager instances against the in-memory platform. Checks that each identity's
+// registration, history, metrics and activations stay its own, and that uninstalling one leaves the others alone.
+// Then times 1 to 8 identities sending from a thread each, first with a platform per identity and then all sharing one.
+
+#include "Benchmark.h"
+#include "DesktopNotificationManager.h"
+#include "InMemoryNotificationPlatform.h"
+#include "ToastRegistration.h"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const int SendsPerTimedSender = 20000;
+
+    // Tags cycle, so each identity's history stays the same size however long the run
+    const int TagCount = 256;
+
+    std::wstring MakeAumid(int index)
+    {
+        return L"Contoso.Mail.Account" + std::to_wstring(index);
+    }
+
+    ToastPayload MakeToast(int index)
+    {
+        std::wstring id = std::to_wstring(index % TagCount);
+        return ToastPayload{ L"<toast launch=\"action=viewMessage&amp;tag=" + id + L"\"><visual><binding template=\"ToastGeneric\"><text>New mail</text></binding></visual></toast>", id, L"inbox", {} };
+    }
+
+    std::uint64_t FailureCount(const ToastMetricsSnapshot& snapshot)
+    {
+        std::uint64_t failures = 0;
+        for (const auto& failure : snapshot.FailuresByResult)
+        {
+            failures += failure.second;
+        }
+        return failures;
+    }
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+
+    // Each manager sends SendsPerTimedSender toasts from its own thread; returns the time per toast across all of them
+    double TimeSenders(std::vector<std::unique_ptr<DesktopNotificationManager>>& managers)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        std::atomic<int> ready{ 0 };
+        std::atomic<bool> go{ false };
+        std::vector<std::thread> senders;
+        for (auto& manager : managers)
+        {
+            senders.emplace_back([&, target = manager.get()] {
+                std::vector<ToastPayload> toasts;
+                for (int i = 0; i < TagCount; i++)
+                {
+                    toasts.push_back(MakeToast(i));
+                }
+
+                ready++;
+                while (!go)
+                {
+                    std::this_thread::yield();
+                }
+
+                for (int i = 0; i < SendsPerTimedSender; i++)
+                {
+                    target->Show(toasts[i % TagCount]);
+                }
+            });
+        }
+
+        while (ready != static_cast<int>(managers.size()))
+        {
+            std::this_thread::yield();
+        }
+
+        Clock::time_point start = Clock::now();
+        go = true;
+        for (std::thread& sender : senders)
+        {
+            sender.join();
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (managers.size() * SendsPerTimedSender);
+    }
+}
+
+int main()
+{
+    int failures = 0;
+
+    // Two identities sharing one platform, as a multi-account app in one process would
+    {
+        InMemoryNotificationPlatform platform;
+        DesktopNotificationManager work(platform, MakeAumid(0));
+        DesktopNotificationManager home(platform, MakeAumid(1));
+
+        DesktopNotificationRegistration registration;
+        registration.DisplayName = L"Contoso Mail";
+        registration.LaunchCommand = L"\"C:\\Program Files\\Contoso\\Mail.exe\" -ToastActivated";
+        Check(work.Register(registration) == ToastResultOk && home.Register(registration) == ToastResultOk, "Register failed", failures);
+        Check(!work.ActivatorClsid().empty() && work.ActivatorClsid() != home.ActivatorClsid(), "the identities share an activator", failures);
+
+        std::wstring activator;
+        Check(platform.ReadRegistryValue(LR"(SOFTWARE\Classes\AppUserModelId\)" + MakeAumid(1), L"CustomActivator", activator) == ToastResultOk &&
+            activator == home.ActivatorClsid(), "an identity's AUMID key points at the wrong activator", failures);
+
+        std::uint64_t writes = platform.CallCount(InMemoryPlatformOperation::Registry);
+        work.Register(registration);
+        Check(platform.CallCount(InMemoryPlatformOperation::Registry) == writes + 1, "registering again did more than read the fingerprint", failures);
+
+        for (int i = 0; i < 10; i++)
+        {
+            work.Show(MakeToast(i));
+        }
+        home.Show(MakeToast(0));
+
+        Check(work.HistoryIndex().Size() == 10 && home.HistoryIndex().Size() == 1, "the history indexes aren't kept apart", failures);
+        Check(platform.HistoryCount(MakeAumid(0)) == 10 && platform.HistoryCount(MakeAumid(1)) == 1, "toasts went to the wrong AUMID", failures);
+        Check(work.Metrics().Snapshot().Sends == 10 && home.Metrics().Snapshot().Sends == 1, "the metrics aren't kept apart", failures);
+
+        // Activations go to the handler of the instance they came in through
+        std::wstring workArgument, homeArgument;
+        work.OnActivated([&](const ActivationEventArgs& e) { workArgument = std::wstring(e.Argument()); });
+        home.OnActivated([&](const ActivationEventArgs& e) { homeArgument = std::wstring(e.Argument()); });
+        work.Activate(ActivationEventArgs(L"action=viewMessage&tag=3"));
+        Check(workArgument == L"action=viewMessage&tag=3" && homeArgument.empty(), "an activation went to the wrong handler", failures);
+        Check(work.Metrics().Snapshot().Activations == 1 && home.Metrics().Snapshot().Activations == 0, "an activation was counted against the wrong identity", failures);
+
+        // An executor on one identity leaves the other's activations inline
+        ActivationExecutorOptions executorOptions;
+        executorOptions.WorkerCount = 1;
+        home.UseActivationExecutor(executorOptions, L"tag");
+        std::atomic<bool> handledOnWorker{ false };
+        std::thread::id caller = std::this_thread::get_id();
+        home.OnActivated([&](const ActivationEventArgs&) { handledOnWorker = std::this_thread::get_id() != caller; });
+        Check(home.Activate(ActivationEventArgs(L"action=viewMessage&tag=0")) == ToastResultOk, "the executor didn't take the activation", failures);
+        while (home.Metrics().Snapshot().Activations == 0)
+        {
+            std::this_thread::yield();
+        }
+        Check(handledOnWorker, "the executor's handler ran on the calling thread", failures);
+
+        work.Activate(ActivationEventArgs(L"action=viewMessage&tag=4"));
+        Check(workArgument == L"action=viewMessage&tag=4", "the other identity's activation didn't run inline", failures);
+
+        // Uninstalling one identity leaves the other registered, with its toasts still up
+        Check(work.Uninstall() == ToastResultOk, "Uninstall failed", failures);
+        std::wstring displayName;
+        Check(platform.ReadRegistryValue(LR"(SOFTWARE\Classes\AppUserModelId\)" + MakeAumid(0), L"DisplayName", displayName) == ToastResultNotFound, "Uninstall left the AUMID key", failures);
+        Check(platform.ReadRegistryValue(LR"(SOFTWARE\Classes\AppUserModelId\)" + MakeAumid(1), L"DisplayName", displayName) == ToastResultOk &&
+            displayName == L"Contoso Mail", "Uninstall deleted another identity's key", failures);
+        Check(work.HistoryIndex().Size() == 0 && platform.HistoryCount(MakeAumid(0)) == 0, "Uninstall left toasts in history", failures);
+        Check(home.HistoryIndex().Size() == 1 && platform.HistoryCount(MakeAumid(1)) == 1, "Uninstall cleared another identity's toasts", failures);
+
+        // A failure is counted against the identity it happened to
+        platform.SetFailure(InMemoryPlatformOperation::Show, ToastResultFail);
+        home.Show(MakeToast(1));
+        platform.SetFailure(InMemoryPlatformOperation::Show, ToastResultOk);
+        Check(FailureCount(home.Metrics().Snapshot()) == 1 && FailureCount(work.Metrics().Snapshot()) == 0, "a failure was counted against the wrong identity", failures);
+    }
+
+    // Registering after Uninstall writes the registration again, whether or not it has an AUMID key
+    {
+        InMemoryNotificationPlatform platform;
+        DesktopNotificationManager named(platform, MakeAumid(0));
+        DesktopNotificationManager comOnly(platform, MakeAumid(1));
+
+        DesktopNotificationRegistration namedRegistration;
+        namedRegistration.DisplayName = L"Contoso Mail";
+        namedRegistration.LaunchCommand = L"\"C:\\Program Files\\Contoso\\Mail.exe\" -ToastActivated";
+        DesktopNotificationRegistration comOnlyRegistration;
+        comOnlyRegistration.LaunchCommand = namedRegistration.LaunchCommand;
+
+        for (int round = 0; round < 2; round++)
+        {
+            Check(named.Register(namedRegistration) == ToastResultOk && comOnly.Register(comOnlyRegistration) == ToastResultOk, "Register failed", failures);
+
+            std::wstring value;
+            Check(platform.ReadRegistryValue(LR"(SOFTWARE\Classes\AppUserModelId\)" + MakeAumid(0), L"DisplayName", value) == ToastResultOk,
+                "registering after Uninstall didn't write the AUMID key", failures);
+            std::wstring comOnlyServerKey = LR"(SOFTWARE\Classes\CLSID\)" + comOnly.ActivatorClsid() + LR"(\LocalServer32)";
+            Check(platform.ReadRegistryValue(comOnlyServerKey, ToastRegistration::FingerprintValueName, value) == ToastResultOk,
+                "registering after Uninstall didn't write the COM-only fingerprint", failures);
+
+            Check(named.Uninstall() == ToastResultOk && comOnly.Uninstall() == ToastResultOk, "Uninstall failed", failures);
+            Check(platform.ReadRegistryValue(comOnlyServerKey, ToastRegistration::FingerprintValueName, value) == ToastResultNotFound,
+                "Uninstall left the COM-only fingerprint", failures);
+        }
+    }
+
+    // Many identities sending at once each see exactly their own toasts
+    {
+        InMemoryNotificationPlatform platform;
+        platform.SetRecordShows(false);
+
+        std::vector<std::unique_ptr<DesktopNotificationManager>> managers;
+        for (int i = 0; i < 8; i++)
+        {
+            managers.push_back(std::make_unique<DesktopNotificationManager>(platform, MakeAumid(i)));
+        }
+        TimeSenders(managers);
+
+        bool isolated = true;
+        for (int i = 0; i < 8; i++)
+        {
+            ToastMetricsSnapshot snapshot = managers[i]->Metrics().Snapshot();
+            isolated = isolated && snapshot.Sends == SendsPerTimedSender && FailureCount(snapshot) == 0 &&
+                managers[i]->HistoryIndex().Size() == TagCount && platform.HistoryCount(MakeAumid(i)) == TagCount;
+        }
+        Check(isolated, "concurrent senders lost or mixed up toasts", failures);
+    }
+
+    for (int managerCount : { 1, 2, 4, 8 })
+    {
+        std::vector<std::unique_ptr<InMemoryNotificationPlatform>> platforms;
+        std::vector<std::unique_ptr<DesktopNotificationManager>> managers;
+        for (int i = 0; i < managerCount; i++)
+        {
+            platforms.push_back(std::make_unique<InMemoryNotificationPlatform>());
+            platforms.back()->SetRecordShows(false);
+            managers.push_back(std::make_unique<DesktopNotificationManager>(*platforms.back(), MakeAumid(i)));
+        }
+
+        std::string name = "Show, " + std::to_string(managerCount) + " identities, platform each";
+        ReportBenchmark(name.c_str(), TimeSenders(managers), std::uint64_t(managerCount) * SendsPerTimedSender);
+    }
+
+    for (int managerCount : { 1, 2, 4, 8 })
+    {
+        InMemoryNotificationPlatform platform;
+        platform.SetRecordShows(false);
+        std::vector<std::unique_ptr<DesktopNotificationManager>> managers;
+        for (int i = 0; i < managerCount; i++)
+        {
+            managers.push_back(std::make_unique<DesktopNotificationManager>(platform, MakeAumid(i)));
+        }
+
+        std::string name = "Show, " + std::to_string(managerCount) + " identities, shared platform";
+        ReportBenchmark(name.c_str(), TimeSenders(managers), std::uint64_t(managerCount) * SendsPerTimedSender);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
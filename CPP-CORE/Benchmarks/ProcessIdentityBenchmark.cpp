@@ -0,0 +1,82 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Starts many threads that all ask for the process identity at once, against the in-memory platform with
+// slow identity calls, checks that the platform was asked exactly once, then times reads of the snapshot.
+
+#include "Benchmark.h"
+#include "InMemoryNotificationPlatform.h"
+#include "ProcessIdentity.h"
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+int main()
+{
+    const int threadCount = 64;
+    const int rounds = 200;
+    int failures = 0;
+
+    InMemoryNotificationPlatform platform;
+    platform.SetPackageIdentity(L"Contoso.Sample_8wekyb3d8bbwe", LR"(C:\Program Files\WindowsApps\Contoso.Sample)");
+    platform.SetModulePath(LR"(C:\Program Files\WindowsApps\Contoso.Sample\Sample.exe)");
+    platform.SetLatency(InMemoryPlatformOperation::Identity, std::chrono::microseconds(200));
+
+    for (int round = 0; round < rounds; round++)
+    {
+        platform.Reset();
+        ProcessIdentity identity(platform, L"-ToastActivated");
+
+        std::atomic<int> waiting{ threadCount };
+        std::atomic<int> wrong{ 0 };
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; i++)
+        {
+            threads.emplace_back([&] {
+                // Line everyone up so the first calls really do overlap
+                waiting.fetch_sub(1);
+                while (waiting.load() != 0)
+                {
+                    std::this_thread::yield();
+                }
+
+                const ProcessIdentitySnapshot& snapshot = identity.Get();
+                if (!snapshot.HasIdentity || !snapshot.IsContainerized ||
+                    snapshot.LaunchCommand != LR"("C:\Program Files\WindowsApps\Contoso.Sample\Sample.exe" -ToastActivated)")
+                {
+                    wrong.fetch_add(1);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        // Family name, module path and installed location
+        std::uint64_t calls = platform.CallCount(InMemoryPlatformOperation::Identity);
+        if (calls != 3 || wrong.load() != 0)
+        {
+            std::printf("round %d: %llu identity calls, %d wrong snapshots\n", round, static_cast<unsigned long long>(calls), wrong.load());
+            failures++;
+        }
+    }
+    std::printf("%d rounds of %d threads, %d failed\n", rounds, threadCount, failures);
+
+    ProcessIdentity identity(platform, L"-ToastActivated");
+    identity.Get();
+    RunBenchmark("ProcessIdentity::IsContainerized, after first call", [&] {
+        DoNotOptimize(identity.IsContainerized());
+    });
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Measures app startup registration against the in-memory registry, with a simulated per-call
+// registry latency: writing every value on every start, as registration used to, against a
+// fingerprinted ToastRegistration on its first run and once it's in place.
+
+#include "Benchmark.h"
+#include "InMemoryNotificationPlatform.h"
+#include "ToastRegistration.h"
+#include <cstdio>
+
+namespace
+{
+    const std::wstring AumidKey = LR"(SOFTWARE\Classes\AppUserModelId\Microsoft.SampleCppWinRtApp)";
+    const std::wstring LocalServerKey = LR"(SOFTWARE\Classes\CLSID\{23A5B06E-20BB-4E7E-A0AC-6982ED6A6041}\LocalServer32)";
+    const std::wstring LaunchCommand = LR"("C:\Program Files\Sample\DesktopToastsCppWinRtApp.exe" -ToastActivated)";
+
+    // One write per value, each opening and closing its key
+    void RegisterEveryValue(InMemoryNotificationPlatform& platform)
+    {
+        platform.WriteRegistryValues(AumidKey, { { L"DisplayName", L"Sample C++ WinRT App" } });
+        platform.DeleteRegistryValue(AumidKey, L"IconUri");
+        platform.WriteRegistryValues(AumidKey, { { L"IconBackgroundColor", L"" } });
+        platform.WriteRegistryValues(AumidKey, { { L"CustomActivator", L"{23A5B06E-20BB-4E7E-A0AC-6982ED6A6041}" } });
+        platform.WriteRegistryValues(LocalServerKey, { { L"", LaunchCommand } });
+    }
+
+    ToastRegistration MakeRegistration()
+    {
+        ToastRegistration registration(AumidKey);
+        registration.SetValue(AumidKey, L"DisplayName", L"Sample C++ WinRT App");
+        registration.DeleteValue(AumidKey, L"IconUri");
+        registration.SetValue(AumidKey, L"IconBackgroundColor", L"");
+        registration.SetValue(AumidKey, L"CustomActivator", L"{23A5B06E-20BB-4E7E-A0AC-6982ED6A6041}");
+        registration.SetValue(LocalServerKey, L"", LaunchCommand);
+        return registration;
+    }
+
+    // Runs a startup registration repeatedly, then reports its time and how many registry calls it made
+    template <typename TStart>
+    void RunStartup(const char* name, InMemoryNotificationPlatform& platform, TStart&& start)
+    {
+        std::uint64_t starts = 0;
+        std::uint64_t callsBefore = platform.CallCount(InMemoryPlatformOperation::Registry);
+        RunBenchmark(name, [&] {
+            start();
+            starts++;
+        });
+
+        double calls = static_cast<double>(platform.CallCount(InMemoryPlatformOperation::Registry) - callsBefore) / starts;
+        std::printf("%-48s %12.2f registry calls/start\n", "", calls);
+    }
+}
+
+int main()
+{
+    // Roughly what a registry call that opens a key costs on a desktop machine
+    const std::chrono::microseconds registryLatency(15);
+
+    InMemoryNotificationPlatform platform;
+    platform.SetLatency(InMemoryPlatformOperation::Registry, registryLatency);
+
+    RunStartup("write every value", platform, [&] {
+        RegisterEveryValue(platform);
+    });
+
+    // Deleting the key each time makes every start a first run; the delete is one of the calls counted
+    RunStartup("fingerprinted, first run", platform, [&] {
+        platform.DeleteRegistryKey(AumidKey);
+        MakeRegistration().Apply(platform);
+    });
+
+    MakeRegistration().Apply(platform);
+    RunStartup("fingerprinted, steady state", platform, [&] {
+        MakeRegistration().Apply(platform);
+    });
+
+    return 0;
+}
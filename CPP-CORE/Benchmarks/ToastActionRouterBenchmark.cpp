@@ -0,0 +1,187 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Compares ToastActionRouter against the prefix checks it replaced, for a sample-sized set of actions
+// and a larger one, and measures the argument parser on its own.
+
+#include "Benchmark.h"
+#include "ToastActionRouter.h"
+#include "ToastArguments.h"
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+    enum class Action
+    {
+        None,
+        Like,
+        Reply,
+        ViewConversation,
+        ViewImage,
+        Archive,
+        Delete,
+        Flag,
+        MarkRead,
+        MarkUnread,
+        Snooze,
+        Dismiss,
+        Forward,
+        Call,
+        Video,
+        Block,
+        Mute,
+    };
+
+    constexpr auto SampleRouter = MakeToastActionRouter<Action>({
+        { L"like", Action::Like },
+        { L"reply", Action::Reply },
+        { L"viewConversation", Action::ViewConversation },
+        { L"viewImage", Action::ViewImage },
+    });
+
+    constexpr auto LargeRouter = MakeToastActionRouter<Action>({
+        { L"like", Action::Like },
+        { L"reply", Action::Reply },
+        { L"viewConversation", Action::ViewConversation },
+        { L"viewImage", Action::ViewImage },
+        { L"archive", Action::Archive },
+        { L"delete", Action::Delete },
+        { L"flag", Action::Flag },
+        { L"markRead", Action::MarkRead },
+        { L"markUnread", Action::MarkUnread },
+        { L"snooze", Action::Snooze },
+        { L"dismiss", Action::Dismiss },
+        { L"forward", Action::Forward },
+        { L"call", Action::Call },
+        { L"video", Action::Video },
+        { L"block", Action::Block },
+        { L"mute", Action::Mute },
+    });
+
+    // The old way: compare the whole argument string against "action=..." prefixes in turn
+    template <std::size_t N>
+    Action PrefixScan(const std::wstring& arguments, const std::pair<const wchar_t*, Action> (&prefixes)[N])
+    {
+        for (const auto& prefix : prefixes)
+        {
+            if (arguments.compare(0, std::char_traits<wchar_t>::length(prefix.first), prefix.first) == 0)
+            {
+                return prefix.second;
+            }
+        }
+        return Action::None;
+    }
+
+    const std::pair<const wchar_t*, Action> SamplePrefixes[] = {
+        { L"action=like", Action::Like },
+        { L"action=reply", Action::Reply },
+        { L"action=viewConversation", Action::ViewConversation },
+        { L"action=viewImage", Action::ViewImage },
+    };
+
+    const std::pair<const wchar_t*, Action> LargePrefixes[] = {
+        { L"action=like", Action::Like },
+        { L"action=reply", Action::Reply },
+        { L"action=viewConversation", Action::ViewConversation },
+        { L"action=viewImage", Action::ViewImage },
+        { L"action=archive", Action::Archive },
+        { L"action=delete", Action::Delete },
+        { L"action=flag", Action::Flag },
+        { L"action=markRead", Action::MarkRead },
+        { L"action=markUnread", Action::MarkUnread },
+        { L"action=snooze", Action::Snooze },
+        { L"action=dismiss", Action::Dismiss },
+        { L"action=forward", Action::Forward },
+        { L"action=call", Action::Call },
+        { L"action=video", Action::Video },
+        { L"action=block", Action::Block },
+        { L"action=mute", Action::Mute },
+    };
+
+    // Cycles through a set of argument strings so the branch predictor can't learn a single answer
+    class Inputs
+    {
+    public:
+        explicit Inputs(std::vector<std::wstring> values) :
+            m_values(std::move(values))
+        {
+        }
+
+        const std::wstring& Next()
+        {
+            const std::wstring& value = m_values[m_next];
+            m_next = (m_next + 1) % m_values.size();
+            return value;
+        }
+
+    private:
+        std::vector<std::wstring> m_values;
+        std::size_t m_next = 0;
+    };
+}
+
+int main()
+{
+    Inputs sampleInputs({
+        L"action=reply&conversationId=9813",
+        L"action=like&conversationId=9813",
+        L"action=viewImage&imageUrl=https%3A%2F%2Fpicsum.photos%2F364%2F202%3Fimage%3D883",
+        L"action=viewConversation&conversationId=9813",
+    });
+
+    Inputs largeInputs({
+        L"action=mute&conversationId=9813",
+        L"action=block&conversationId=9813",
+        L"action=reply&conversationId=9813",
+        L"action=snooze&conversationId=9813",
+        L"action=markUnread&conversationId=9813",
+        L"action=video&conversationId=9813",
+    });
+
+    RunBenchmark("sample actions, prefix scan", [&] {
+        DoNotOptimize(PrefixScan(sampleInputs.Next(), SamplePrefixes));
+    });
+
+    RunBenchmark("sample actions, parse + router", [&] {
+        DoNotOptimize(SampleRouter.Lookup(ToastArguments(sampleInputs.Next()).Action(), Action::None));
+    });
+
+    RunBenchmark("16 actions, prefix scan", [&] {
+        DoNotOptimize(PrefixScan(largeInputs.Next(), LargePrefixes));
+    });
+
+    RunBenchmark("16 actions, parse + router", [&] {
+        DoNotOptimize(LargeRouter.Lookup(ToastArguments(largeInputs.Next()).Action(), Action::None));
+    });
+
+    const std::wstring_view actions[] = { L"mute", L"block", L"reply", L"snooze", L"markUnread", L"video" };
+    std::size_t nextAction = 0;
+    RunBenchmark("16 actions, router only", [&] {
+        DoNotOptimize(LargeRouter.Lookup(actions[nextAction], Action::None));
+        nextAction = (nextAction + 1) % std::size(actions);
+    });
+
+    const std::wstring imageArguments = L"action=viewImage&imageUrl=https%3A%2F%2Fpicsum.photos%2F364%2F202%3Fimage%3D883";
+    RunBenchmark("ToastArguments::Get, encoded value", [&] {
+        DoNotOptimize(ToastArguments(imageArguments).Get(L"imageUrl"));
+    });
+
+    std::wstring decoded;
+    RunBenchmark("ToastArguments::TryGetDecoded", [&] {
+        ToastArguments(imageArguments).TryGetDecoded(L"imageUrl", decoded);
+        DoNotOptimize(decoded);
+    });
+
+    return 0;
+}
@@ -0,0 +1,266 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Pushes toasts from several producers through ToastDispatcher under each backpressure policy against
+// the counting fake platform, checks that every toast is accounted for, that failed results and
+// exceptions count as failures, and that the sender can call Flush and Shutdown, then times throughput
+// and enqueue-to-send latency.
+
+#include "Benchmark.h"
+#include "CountingToastPlatform.h"
+#include "ToastDispatcher.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int Producers = 4;
+    constexpr int ToastsPerProducer = 20000;
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+
+    ToastPayload MakePayload(int index)
+    {
+        ToastPayload payload;
+        payload.Xml = L"<toast><visual><binding template=\"ToastGeneric\"><text>Hi</text></binding></visual></toast>";
+        payload.Tag = std::to_wstring(index);
+        return payload;
+    }
+
+    /// <summary>
+    /// Sends ToastsPerProducer toasts from each of Producers threads and returns the total time taken, including the final Flush.
+    /// </summary>
+    Clock::duration Produce(ToastDispatcher& dispatcher)
+    {
+        Clock::time_point start = Clock::now();
+        std::vector<std::thread> producers;
+        for (int producer = 0; producer < Producers; producer++)
+        {
+            producers.emplace_back([&dispatcher, producer]
+            {
+                for (int i = 0; i < ToastsPerProducer; i++)
+                {
+                    dispatcher.Enqueue(MakePayload(producer * ToastsPerProducer + i));
+                }
+            });
+        }
+        for (std::thread& producer : producers)
+        {
+            producer.join();
+        }
+        dispatcher.Flush();
+        return Clock::now() - start;
+    }
+
+    double Percentile(std::vector<double>& values, double percentile)
+    {
+        std::size_t index = static_cast<std::size_t>(percentile * (values.size() - 1));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+}
+
+int main()
+{
+    int failures = 0;
+    const std::uint64_t total = static_cast<std::uint64_t>(Producers) * ToastsPerProducer;
+
+    CountingToastPlatform platform;
+    std::shared_ptr<CountingToastPlatform::Notifier> notifier = platform.GetManagerStatics()->CreateToastNotifier(L"Microsoft.SampleCppWinRtApp");
+    auto send = [&notifier](const ToastPayload& payload)
+    {
+        notifier->Show(payload.Xml);
+        return ToastResultOk;
+    };
+
+    struct PolicyCase
+    {
+        const char* Name;
+        ToastBackpressurePolicy Policy;
+    };
+    const PolicyCase policies[] = {
+        { "Block", ToastBackpressurePolicy::Block },
+        { "DropOldest", ToastBackpressurePolicy::DropOldest },
+        { "DropNewest", ToastBackpressurePolicy::DropNewest },
+    };
+
+    for (const PolicyCase& policy : policies)
+    {
+        platform.ResetCounters();
+
+        ToastDispatcherOptions options;
+        options.Capacity = 256;
+        options.WorkerCount = 2;
+        options.Backpressure = policy.Policy;
+        ToastDispatcher dispatcher(options, send);
+
+        Clock::duration elapsed = Produce(dispatcher);
+        ToastDispatcherStats stats = dispatcher.GetStats();
+        std::printf("%-10s sent %llu, dropped %llu\n", policy.Name,
+            static_cast<unsigned long long>(stats.Sent), static_cast<unsigned long long>(stats.Dropped));
+
+        Check(stats.Sent + stats.Dropped == total, "a toast was neither sent nor dropped", failures);
+        Check(stats.Sent == platform.Shows(), "the sent count doesn't match what reached the platform", failures);
+        Check(stats.Failed == 0, "a toast failed against a backend that can't fail", failures);
+        if (policy.Policy == ToastBackpressurePolicy::Block)
+        {
+            Check(stats.Sent == total && stats.Dropped == 0, "the blocking policy dropped a toast", failures);
+        }
+
+        std::string name = std::string("Enqueue + send, 4 producers, ") + policy.Name;
+        ReportBenchmark(name.c_str(), std::chrono::duration<double, std::nano>(elapsed).count() / total, total);
+    }
+
+    // A failed result and an exception both count as failures
+    {
+        std::atomic<int> calls{ 0 };
+        ToastDispatcher dispatcher(ToastDispatcherOptions(), [&calls](const ToastPayload& payload)
+        {
+            calls++;
+            if (payload.Tag == L"1")
+            {
+                return ToastResultFail;
+            }
+            if (payload.Tag == L"2")
+            {
+                throw std::runtime_error("Show failed");
+            }
+            return ToastResultOk;
+        });
+        for (int i = 0; i < 4; i++)
+        {
+            dispatcher.Enqueue(MakePayload(i));
+        }
+        dispatcher.Flush();
+
+        ToastDispatcherStats stats = dispatcher.GetStats();
+        Check(calls == 4, "the sender wasn't called once per toast", failures);
+        Check(stats.Sent == 2 && stats.Failed == 2, "a failed result or an exception wasn't counted as a failure", failures);
+    }
+
+    // A worker whose WorkerStarted throws still drains the queue, counting its toasts as failed without sending them
+    {
+        ToastDispatcherOptions options;
+        options.Capacity = 4;
+        options.WorkerStarted = [] { throw std::runtime_error("CoInitializeEx failed"); };
+        std::atomic<int> calls{ 0 };
+        ToastDispatcher dispatcher(options, [&calls](const ToastPayload&)
+        {
+            calls++;
+            return ToastResultOk;
+        });
+        for (int i = 0; i < 16; i++)
+        {
+            dispatcher.Enqueue(MakePayload(i));
+        }
+        dispatcher.Flush();
+
+        ToastDispatcherStats stats = dispatcher.GetStats();
+        Check(calls == 0, "a worker whose setup failed called the sender", failures);
+        Check(stats.Sent == 0 && stats.Failed == 16, "the toasts of a worker whose setup failed weren't counted as failed", failures);
+    }
+
+    // The sender can call Flush, and Shutdown without joining its own thread
+    {
+        ToastDispatcher* self = nullptr;
+        std::atomic<int> calls{ 0 };
+        std::unique_ptr<ToastDispatcher> dispatcher = std::make_unique<ToastDispatcher>(ToastDispatcherOptions(), [&self, &calls](const ToastPayload& payload)
+        {
+            calls++;
+            self->Flush();
+            if (payload.Tag == L"10")
+            {
+                self->Shutdown(false);
+            }
+            return ToastResultOk;
+        });
+        self = dispatcher.get();
+        for (int i = 0; i < 100; i++)
+        {
+            dispatcher->Enqueue(MakePayload(i));
+        }
+        dispatcher->Flush();
+
+        ToastDispatcherStats stats = dispatcher->GetStats();
+        Check(dispatcher->Enqueue(MakePayload(100)) == ToastEnqueueResult::ShutDown, "the dispatcher accepted a toast after the sender shut it down", failures);
+        Check(stats.Sent + stats.Dropped == stats.Enqueued, "a toast was lost when the sender shut the dispatcher down", failures);
+        Check(calls >= 11 && calls < 100, "the dispatcher kept sending after the sender shut it down", failures);
+        dispatcher.reset();
+    }
+
+    // The sender calling Shutdown while its owner is already inside Shutdown, joining that sender's worker
+    {
+        ToastDispatcher* self = nullptr;
+        std::atomic<bool> sending{ false };
+        std::atomic<bool> ownerStopping{ false };
+        ToastDispatcher dispatcher(ToastDispatcherOptions(), [&self, &sending, &ownerStopping](const ToastPayload&)
+        {
+            sending = true;
+            while (!ownerStopping)
+            {
+                std::this_thread::yield();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            self->Shutdown(false);
+            return ToastResultOk;
+        });
+        self = &dispatcher;
+        dispatcher.Enqueue(MakePayload(0));
+        while (!sending)
+        {
+            std::this_thread::yield();
+        }
+        ownerStopping = true;
+        dispatcher.Shutdown(true);
+        Check(dispatcher.GetStats().Sent == 1, "the toast whose sender shut the dispatcher down wasn't counted", failures);
+    }
+
+    // Latency from Enqueue to the sender for toasts trickling in to an idle worker
+    {
+        constexpr int Samples = 2000;
+        std::vector<Clock::time_point> enqueued(Samples);
+        std::vector<double> latencies(Samples);
+        ToastDispatcher dispatcher(ToastDispatcherOptions(), [&enqueued, &latencies](const ToastPayload& payload)
+        {
+            int index = std::stoi(payload.Tag);
+            latencies[index] = std::chrono::duration<double, std::nano>(Clock::now() - enqueued[index]).count();
+            return ToastResultOk;
+        });
+        for (int i = 0; i < Samples; i++)
+        {
+            enqueued[i] = Clock::now();
+            dispatcher.Enqueue(MakePayload(i));
+            dispatcher.Flush();
+        }
+
+        ReportBenchmark("Enqueue to send latency, idle worker, p50", Percentile(latencies, 0.5), Samples);
+        ReportBenchmark("Enqueue to send latency, idle worker, p99", Percentile(latencies, 0.99), Samples);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
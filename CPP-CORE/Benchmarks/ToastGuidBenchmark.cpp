@@ -0,0 +1,122 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Checks MakeNameBasedGuid against published version 5 UUIDs, checks a corpus of generated AUMIDs for
+// collisions, and times the runtime path against the hash-and-pad GUIDs it replaced.
+
+#include "Benchmark.h"
+#include "ToastGuid.h"
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    constexpr ToastGuid DnsGuidNamespace{ { {
+        0x6b, 0xa7, 0xb8, 0x10, 0x9d, 0xad, 0x11, 0xd1, 0x80, 0xb4, 0x00, 0xc0, 0x4f, 0xd4, 0x30, 0xc8 } } };
+
+    // uuid5(NAMESPACE_DNS, "python.org") from the Python documentation
+    constexpr ToastGuid PythonOrg{ { {
+        0x88, 0x63, 0x13, 0xe1, 0x3b, 0x8a, 0x53, 0x72, 0x9b, 0x90, 0x0c, 0x9a, 0xee, 0x19, 0x9e, 0x5d } } };
+
+    static_assert(MakeNameBasedGuid(DnsGuidNamespace, L"python.org") == PythonOrg, "SHA-1 UUID doesn't match RFC 4122");
+
+    struct KnownGuid
+    {
+        const ToastGuid* NameSpace;
+        const wchar_t* Name;
+        const wchar_t* Expected;
+    };
+
+    const KnownGuid KnownGuids[] = {
+        { &DnsGuidNamespace, L"python.org", L"886313e1-3b8a-5372-9b90-0c9aee199e5d" },
+        { &UrlGuidNamespace, L"http://python.org/", L"4c565f0d-3f5a-5890-b41b-20cf47701c5e" },
+        { &DnsGuidNamespace, L"h\u00E9llo\U0001F600", L"607758b4-c848-5ebe-b369-3d3cafb3d8b9" },
+        { &UrlGuidNamespace, L"https://github.com/WindowsNotifications/desktop-toasts/aumid", L"fbaeeac7-8037-52b9-b101-f9d2ba8facac" },
+        { &AumidGuidNamespace, L"Microsoft.SampleCppWinRtApp", L"58903118-750d-54b8-a33e-9f1474991496" },
+    };
+
+    // The GUID the Compat library used to derive for AUMIDs longer than 16 characters
+    std::wstring HashAndPadGuid(const std::wstring& name)
+    {
+        std::wstring hash = std::to_wstring(std::hash<std::wstring>{}(name));
+        std::wstring guid;
+        for (std::size_t i = 0, position = 0; i < 36; i++)
+        {
+            if (i == 8 || i == 13 || i == 18 || i == 23)
+            {
+                guid += L'-';
+            }
+            else
+            {
+                guid += position < hash.size() ? hash[position] : L'0';
+                position++;
+            }
+        }
+        return guid;
+    }
+}
+
+int main()
+{
+    int failures = 0;
+    for (const KnownGuid& known : KnownGuids)
+    {
+        std::wstring actual = MakeNameBasedGuid(*known.NameSpace, known.Name).ToString();
+        if (actual != known.Expected)
+        {
+            std::printf("MISMATCH for %ls: %ls, expected %ls\n", known.Name, actual.c_str(), known.Expected);
+            failures++;
+        }
+    }
+
+    // AUMIDs shaped like ours: a shared company prefix and many similar product names
+    std::vector<std::wstring> aumids;
+    for (int product = 0; product < 1000; product++)
+    {
+        for (int channel = 0; channel < 100; channel++)
+        {
+            aumids.push_back(L"Contoso.Product" + std::to_wstring(product) + L".Channel" + std::to_wstring(channel));
+        }
+    }
+
+    std::unordered_set<std::wstring> guids;
+    for (const std::wstring& aumid : aumids)
+    {
+        guids.insert(MakeAumidClsid(aumid).ToString());
+    }
+    std::printf("%zu AUMIDs, %zu collisions\n", aumids.size(), aumids.size() - guids.size());
+    if (guids.size() != aumids.size())
+    {
+        failures++;
+    }
+
+    std::size_t next = 0;
+    RunBenchmark("MakeAumidClsid", [&] {
+        DoNotOptimize(MakeAumidClsid(aumids[next]));
+        next = (next + 1) % aumids.size();
+    });
+
+    RunBenchmark("MakeAumidClsid + ToString", [&] {
+        DoNotOptimize(MakeAumidClsid(aumids[next]).ToString());
+        next = (next + 1) % aumids.size();
+    });
+
+    RunBenchmark("hash-and-pad GUID (old)", [&] {
+        DoNotOptimize(HashAndPadGuid(aumids[next]));
+        next = (next + 1) % aumids.size();
+    });
+
+    return failures == 0 ? 0 : 1;
+}
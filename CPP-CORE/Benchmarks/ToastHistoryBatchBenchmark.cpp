@@ -0,0 +1,223 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Retracts a 500-message conversation from the in-memory platform, with each history call given the
+// latency of a cross-process round trip, and compares removing the toasts one at a time against
+// RemoveManyFromHistory with batching and worker threads, and RemoveFromHistoryWhere collapsing the
+// conversation into one group removal. Also checks deduplication, per-toast failure reporting, and that
+// worker callbacks and a throwing platform don't end the process.
+
+#include "Benchmark.h"
+#include "InMemoryNotificationPlatform.h"
+#include "ToastHistoryBatch.h"
+#include <atomic>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const std::wstring Aumid = L"Contoso.Chat";
+    const int MessageCount = 500;
+    // Long enough for the platform to sleep rather than spin, so worker threads overlap even on a single core
+    const std::chrono::milliseconds RoundTrip(1);
+
+    std::vector<ToastHistoryEntry> ShowConversation(InMemoryNotificationPlatform& platform)
+    {
+        std::vector<ToastHistoryEntry> toasts;
+        for (int message = 0; message < MessageCount; message++)
+        {
+            ToastPayload payload;
+            payload.Xml = L"<toast launch=\"conversationId=42&amp;messageId=" + std::to_wstring(message) + L"\"/>";
+            payload.Tag = L"message" + std::to_wstring(message);
+            payload.Group = L"conversation42";
+            platform.Show(Aumid, payload);
+            toasts.push_back(ToastHistoryEntry{ payload.Tag, payload.Group, {} });
+        }
+
+        // Another conversation that has to survive
+        ToastPayload other;
+        other.Xml = L"<toast launch=\"conversationId=7\"/>";
+        other.Tag = L"message0";
+        other.Group = L"conversation7";
+        platform.Show(Aumid, other);
+        return toasts;
+    }
+
+    bool Retracted(InMemoryNotificationPlatform& platform)
+    {
+        return platform.HistoryCount(Aumid) == 1 && platform.HistoryContains(Aumid, L"message0", L"conversation7");
+    }
+
+    struct ThrowingPlatform : InMemoryNotificationPlatform
+    {
+        void RemoveBatchFromHistory(const std::wstring&, const std::vector<ToastHistoryEntry>&, std::vector<ToastResult>&) override
+        {
+            throw std::runtime_error("platform threw");
+        }
+    };
+}
+
+int main()
+{
+    InMemoryNotificationPlatform platform;
+    platform.SetRecordShows(false);
+    platform.SetLatency(InMemoryPlatformOperation::History, RoundTrip);
+
+    int failures = 0;
+    std::vector<ToastHistoryEntry> toasts = ShowConversation(platform);
+
+    // Every toast twice, plus a group nobody has shown anything into
+    std::vector<ToastHistoryEntry> duplicated = toasts;
+    duplicated.insert(duplicated.end(), toasts.begin(), toasts.end());
+    ToastHistoryBatchOptions options;
+    options.WorkerCount = 1;
+    ToastHistoryBatchResults results;
+    ToastResult result = RemoveManyFromHistory(platform, Aumid, duplicated, { L"empty" }, options, results);
+    std::size_t expectedCalls = 1 + (MessageCount + options.BatchSize - 1) / options.BatchSize;
+    if (result != ToastResultOk || results.Toasts.size() != duplicated.size() || results.PlatformCalls != expectedCalls || !Retracted(platform))
+    {
+        std::printf("RemoveManyFromHistory made %zu calls, expected %zu\n", results.PlatformCalls, expectedCalls);
+        failures++;
+    }
+
+    // An untagged toast can't be removed on its own, and neither can an unnamed group
+    result = RemoveManyFromHistory(platform, Aumid, { ToastHistoryEntry{ L"", L"conversation7", {} } }, { L"" }, options, results);
+    if (result != ToastResultInvalidArgument || results.Toasts[0] != ToastResultInvalidArgument || results.Groups[0] != ToastResultInvalidArgument || results.PlatformCalls != 0)
+    {
+        std::printf("untagged toast or unnamed group wasn't rejected\n");
+        failures++;
+    }
+
+    // Failures are reported for every toast they affect
+    platform.SetFailure(InMemoryPlatformOperation::History, ToastResultFail);
+    result = RemoveManyFromHistory(platform, Aumid, toasts, {}, options, results);
+    platform.SetFailure(InMemoryPlatformOperation::History, ToastResultOk);
+    for (ToastResult toastResult : results.Toasts)
+    {
+        if (toastResult != ToastResultFail)
+        {
+            result = ToastResultOk;
+        }
+    }
+    if (result != ToastResultFail)
+    {
+        std::printf("failures weren't reported per toast\n");
+        failures++;
+    }
+
+    // Workers whose WorkerStarted throws still remove their share, and only the others get WorkerStopped
+    {
+        ToastHistoryBatchOptions workerOptions;
+        workerOptions.WorkerCount = 4;
+        workerOptions.BatchSize = 8;
+        std::atomic<int> startCalls{ 0 };
+        std::atomic<int> started{ 0 };
+        std::atomic<int> stopped{ 0 };
+        workerOptions.WorkerStarted = [&]
+        {
+            if (startCalls.fetch_add(1) % 2 == 0)
+            {
+                throw std::runtime_error("CoInitializeEx failed");
+            }
+            started++;
+        };
+        workerOptions.WorkerStopped = [&] { stopped++; };
+
+        ShowConversation(platform);
+        result = RemoveManyFromHistory(platform, Aumid, toasts, {}, workerOptions, results);
+        if (result != ToastResultOk || !Retracted(platform) || startCalls != 3 || stopped != started)
+        {
+            std::printf("workers ran WorkerStarted %d times and WorkerStopped %d times for %d successful starts\n", startCalls.load(), stopped.load(), started.load());
+            failures++;
+        }
+    }
+
+    // A platform that throws on a worker thread fails the toasts instead of ending the process
+    {
+        ThrowingPlatform throwing;
+        ToastHistoryBatchOptions workerOptions;
+        workerOptions.WorkerCount = 4;
+        workerOptions.BatchSize = 8;
+        result = RemoveManyFromHistory(throwing, Aumid, toasts, {}, workerOptions, results);
+        bool allFailed = result == ToastResultFail;
+        for (ToastResult toastResult : results.Toasts)
+        {
+            allFailed = allFailed && toastResult == ToastResultFail;
+        }
+        if (!allFailed)
+        {
+            std::printf("a throwing platform didn't fail every toast\n");
+            failures++;
+        }
+    }
+
+    std::vector<ToastHistoryEntry> matched;
+    std::vector<std::wstring> groups;
+    auto inConversation = [](const ToastHistoryEntry& entry) { return entry.Group == L"conversation42"; };
+
+    ShowConversation(platform);
+    result = RemoveFromHistoryWhere(platform, Aumid, inConversation, options, matched, groups, results);
+    if (result != ToastResultOk || matched.size() != MessageCount || results.PlatformCalls != 2 || !Retracted(platform))
+    {
+        std::printf("RemoveFromHistoryWhere made %zu calls for %zu toasts, expected 2 for %d\n", results.PlatformCalls, matched.size(), MessageCount);
+        failures++;
+    }
+    if (groups.size() != 1 || groups[0] != L"conversation42" || results.Groups.size() != 1 || results.Groups[0] != ToastResultOk)
+    {
+        std::printf("RemoveFromHistoryWhere didn't report the conversation as removed whole\n");
+        failures++;
+    }
+
+    // Showing the conversation again is part of every run, so time it on its own too
+    RunBenchmark("Show 500 toasts (baseline)", [&] {
+        ShowConversation(platform);
+    });
+
+    RunBenchmark("RemoveFromHistory x 500", [&] {
+        ShowConversation(platform);
+        for (const ToastHistoryEntry& toast : toasts)
+        {
+            platform.RemoveFromHistory(Aumid, toast.Tag, toast.Group);
+        }
+    });
+
+    for (std::size_t batchSize : { 1, 32 })
+    {
+        for (std::size_t workerCount : { 1, 4 })
+        {
+            options.BatchSize = batchSize;
+            options.WorkerCount = workerCount;
+
+            char name[64];
+            std::snprintf(name, sizeof(name), "RemoveManyFromHistory, batch %zu, %zu workers", batchSize, workerCount);
+            RunBenchmark(name, [&] {
+                ShowConversation(platform);
+                RemoveManyFromHistory(platform, Aumid, toasts, {}, options, results);
+            });
+
+            if (!Retracted(platform))
+            {
+                std::printf("%s left %zu toasts\n", name, platform.HistoryCount(Aumid) - 1);
+                failures++;
+            }
+        }
+    }
+
+    RunBenchmark("RemoveFromHistoryWhere, whole conversation", [&] {
+        ShowConversation(platform);
+        RemoveFromHistoryWhere(platform, Aumid, inConversation, options, matched, groups, results);
+    });
+
+    return failures == 0 ? 0 : 1;
+}
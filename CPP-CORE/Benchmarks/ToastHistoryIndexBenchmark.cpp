@@ -0,0 +1,120 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Fills the in-memory platform with 100,000 toasts and compares answering "is there a toast for this
+// conversation?" by fetching and scanning the platform's history against asking ToastHistoryIndex,
+// then times reconciling the index after the user dismisses some toasts.
+
+#include "Benchmark.h"
+#include "InMemoryNotificationPlatform.h"
+#include "ToastArguments.h"
+#include "ToastHistoryIndex.h"
+#include <cstdio>
+#include <string>
+
+namespace
+{
+    const std::wstring Aumid = L"Contoso.Chat";
+    const int ToastCount = 100000;
+    const int ConversationCount = 1000;
+
+    ToastPayload MakeToast(int message)
+    {
+        std::wstring conversation = std::to_wstring(message % ConversationCount);
+        ToastPayload payload;
+        payload.Xml = L"<toast launch=\"action=viewConversation&amp;conversationId=" + conversation +
+            L"&amp;messageId=" + std::to_wstring(message) + L"\"><visual><binding template=\"ToastGeneric\"><text>New message</text></binding></visual></toast>";
+        payload.Tag = L"message" + std::to_wstring(message);
+        payload.Group = L"conversation" + conversation;
+        return payload;
+    }
+}
+
+int main()
+{
+    InMemoryNotificationPlatform platform;
+    ToastHistoryIndex index;
+    for (int message = 0; message < ToastCount; message++)
+    {
+        ToastPayload payload = MakeToast(message);
+        platform.Show(Aumid, payload);
+        index.OnShown(payload);
+    }
+
+    int failures = 0;
+    if (index.Size() != ToastCount || index.CountWithArgument(L"conversationId", L"7") != ToastCount / ConversationCount)
+    {
+        std::printf("index doesn't match what was shown\n");
+        failures++;
+    }
+
+    int conversation = 0;
+    RunBenchmark("GetHistory + scan for a conversation", [&] {
+        std::wstring wanted = std::to_wstring(conversation++ % ConversationCount);
+        std::vector<ToastHistoryEntry> entries;
+        platform.GetHistory(Aumid, entries);
+
+        std::size_t count = 0;
+        for (const ToastHistoryEntry& entry : entries)
+        {
+            if (ToastArguments(entry.Launch).Get(L"conversationId") == wanted)
+            {
+                count++;
+            }
+        }
+        DoNotOptimize(count);
+    });
+
+    std::wstring wanted;
+    RunBenchmark("ToastHistoryIndex::CountWithArgument", [&] {
+        wanted = std::to_wstring(conversation++ % ConversationCount);
+        DoNotOptimize(index.CountWithArgument(L"conversationId", wanted));
+    });
+
+    std::wstring tag;
+    std::wstring group;
+    RunBenchmark("ToastHistoryIndex::Contains (tag and group)", [&] {
+        int message = conversation++ % ToastCount;
+        tag = L"message" + std::to_wstring(message);
+        group = L"conversation" + std::to_wstring(message % ConversationCount);
+        DoNotOptimize(index.Contains(tag, group));
+    });
+
+    RunBenchmark("ToastHistoryIndex::CountInGroup", [&] {
+        group = L"conversation" + std::to_wstring(conversation++ % ConversationCount);
+        DoNotOptimize(index.CountInGroup(group));
+    });
+
+    // The user dismisses one toast in a hundred from Action Center
+    for (int message = 0; message < ToastCount; message += 100)
+    {
+        ToastPayload payload = MakeToast(message);
+        platform.RemoveFromHistory(Aumid, payload.Tag, payload.Group);
+    }
+
+    std::vector<ToastHistoryEntry> platformHistory;
+    platform.GetHistory(Aumid, platformHistory);
+    ToastHistoryReconcileResult result{};
+    RunBenchmark("ToastHistoryIndex::Reconcile, 100k entries", [&] {
+        result = index.Reconcile(platformHistory);
+    }, std::chrono::milliseconds(500));
+
+    // Only the first pass finds anything to change, however few passes the benchmark ran
+    result = index.Reconcile(platformHistory);
+    if (index.Size() != platformHistory.size() || result.Added != 0 || result.Removed != 0)
+    {
+        std::printf("reconcile left %zu entries, expected %zu\n", index.Size(), platformHistory.size());
+        failures++;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,313 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Runs ToastImageCache against a local directory standing in for the network, with a stand-in scaler that writes
+// a PNG header of the requested size. Checks that images are scaled to their placement, stored once however many
+// sources serve them, rewritten into toast payloads, evicted least recently used first, and picked up again when
+// the cache is reopened, including by several threads at once. Then times lookups that hit the in-memory index.
+
+#include "Benchmark.h"
+#include "ToastImageCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    void AppendBigEndian(std::vector<std::uint8_t>& bytes, std::uint32_t value, int length)
+    {
+        for (int i = length - 1; i >= 0; i--)
+        {
+            bytes.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    // Just enough of each format for ReadToastImageInfo, padded out with bytes that depend on seed
+    std::vector<std::uint8_t> MakePng(std::uint32_t width, std::uint32_t height, std::uint32_t seed, std::size_t size)
+    {
+        std::vector<std::uint8_t> bytes = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A, 0, 0, 0, 13, 'I', 'H', 'D', 'R' };
+        AppendBigEndian(bytes, width, 4);
+        AppendBigEndian(bytes, height, 4);
+        while (bytes.size() < size)
+        {
+            seed = seed * 1664525 + 1013904223;
+            bytes.push_back(static_cast<std::uint8_t>(seed >> 24));
+        }
+        return bytes;
+    }
+
+    std::vector<std::uint8_t> MakeJpeg(std::uint32_t width, std::uint32_t height, std::size_t size)
+    {
+        std::vector<std::uint8_t> bytes = { 0xFF, 0xD8, 0xFF, 0xE0, 0, 16, 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+        bytes.insert(bytes.end(), { 0xFF, 0xC0, 0, 17, 8 });
+        AppendBigEndian(bytes, height, 2);
+        AppendBigEndian(bytes, width, 2);
+        bytes.resize(size, 0x5A);
+        return bytes;
+    }
+
+    std::vector<std::uint8_t> MakeGif(std::uint32_t width, std::uint32_t height)
+    {
+        std::vector<std::uint8_t> bytes = { 'G', 'I', 'F', '8', '9', 'a' };
+        bytes.insert(bytes.end(), { static_cast<std::uint8_t>(width), static_cast<std::uint8_t>(width >> 8), static_cast<std::uint8_t>(height), static_cast<std::uint8_t>(height >> 8) });
+        bytes.resize(64, 0);
+        return bytes;
+    }
+
+    ToastResult StandInScaler(const std::vector<std::uint8_t>& image, ToastImageSize size, std::vector<std::uint8_t>& scaled)
+    {
+        scaled = MakePng(size.Width, size.Height, static_cast<std::uint32_t>(image.size()), 64 + size.Width * size.Height / 64);
+        return ToastResultOk;
+    }
+
+    void WriteFile(const std::filesystem::path& path, const std::vector<std::uint8_t>& bytes)
+    {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+}
+
+int main()
+{
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "ToastImageCacheBenchmark";
+    std::filesystem::remove_all(root);
+    std::filesystem::path remote = root / "remote";
+    std::filesystem::path cacheDirectory = root / "cache";
+
+    ToastDirectoryImageFetcher fetcher(remote);
+    std::vector<std::uint8_t> logo = MakePng(64, 64, 1, 4096);
+    WriteFile(fetcher.PathFor(L"https://unsplash.it/64?image=1005"), logo);
+    WriteFile(fetcher.PathFor(L"https://mirror.example/logo.png"), logo);
+    WriteFile(fetcher.PathFor(L"https://picsum.photos/364/202?image=883"), MakeJpeg(1456, 808, 200000));
+    WriteFile(fetcher.PathFor(L"https://picsum.photos/364/202?image=883&blur=1"), MakeJpeg(1456, 808, 150000));
+    WriteFile(fetcher.PathFor(L"https://picsum.photos/2000/500"), MakeJpeg(2000, 500, 300000));
+    WriteFile(fetcher.PathFor(L"https://example.com/not-an-image.png"), { 'h', 'e', 'l', 'l', 'o' });
+    WriteFile(root / "local" / "small logo.gif", MakeGif(40, 40));
+    WriteFile(root / "local" / "big logo.png", MakePng(512, 512, 2, 50000));
+
+    int failures = 0;
+    ToastImageCacheOptions options;
+    options.Scaler = StandInScaler;
+    ToastImageCache cache(fetcher, options);
+    Check(cache.Open(cacheDirectory) == ToastResultOk, "the cache didn't open", failures);
+
+    // Images are scaled until they just cover the size their placement renders at, at 200%
+    std::wstring inlineUri;
+    Check(cache.Resolve(L"https://picsum.photos/364/202?image=883", ToastImagePlacement::Inline, inlineUri) == ToastResultOk &&
+        inlineUri.compare(0, 8, L"file:///") == 0 && std::filesystem::exists(ToastFileUriPath(inlineUri)) &&
+        ToastFileUriPath(inlineUri).filename().wstring().find(L"-728x404.png") != std::wstring::npos, "an inline image wasn't scaled to 728 wide", failures);
+
+    std::wstring heroUri;
+    Check(cache.Resolve(L"https://picsum.photos/2000/500", ToastImagePlacement::Hero, heroUri) == ToastResultOk &&
+        ToastFileUriPath(heroUri).filename().wstring().find(L"-1440x360.png") != std::wstring::npos, "a hero image wasn't scaled to cover 728x360", failures);
+
+    // A logo that's small enough is kept as it is, and stored once however many sources serve it
+    std::wstring logoUri, mirrorUri;
+    Check(cache.Resolve(L"https://unsplash.it/64?image=1005", ToastImagePlacement::AppLogo, logoUri) == ToastResultOk &&
+        ToastFileUriPath(logoUri).filename().wstring().size() == 32 + 4, "a small logo wasn't stored as it was", failures);
+    Check(cache.Resolve(L"https://mirror.example/logo.png", ToastImagePlacement::AppLogo, mirrorUri) == ToastResultOk && mirrorUri == logoUri,
+        "the same image from two sources was stored twice", failures);
+
+    ToastImageCacheStats stats = cache.GetStats();
+    Check(stats.Stored == 3 && stats.Scaled == 2 && stats.Deduplicated == 1 && stats.Files == 3, "the cache stored the wrong images", failures);
+
+    // Lookups after the first are served from memory
+    std::uint64_t fetches = fetcher.FetchCount();
+    std::wstring again;
+    Check(cache.Resolve(L"https://unsplash.it/64?image=1005", ToastImagePlacement::AppLogo, again) == ToastResultOk && again == logoUri &&
+        fetcher.FetchCount() == fetches && cache.GetStats().Hits == 1, "a cached image was fetched again", failures);
+
+    // Local images are used where they are unless they need scaling
+    std::wstring smallUri, bigUri;
+    Check(cache.Resolve(ToastFileUri(root / "local" / "small logo.gif"), ToastImagePlacement::AppLogo, smallUri) == ToastResultOk &&
+        smallUri == ToastFileUri(root / "local" / "small logo.gif") && smallUri.find(L"small%20logo.gif") != std::wstring::npos, "a small local image was copied", failures);
+    Check(cache.Resolve(ToastFileUri(root / "local" / "big logo.png"), ToastImagePlacement::AppLogo, bigUri) == ToastResultOk &&
+        ToastFileUriPath(bigUri).parent_path() == cacheDirectory && ToastFileUriPath(bigUri).filename().wstring().find(L"-96x96.png") != std::wstring::npos,
+        "a big local image wasn't scaled into the cache", failures);
+
+    std::wstring unused;
+    Check(cache.Resolve(L"https://example.com/not-an-image.png", ToastImagePlacement::Inline, unused) == ToastResultInvalidArgument &&
+        cache.Resolve(L"https://example.com/missing.png", ToastImagePlacement::Inline, unused) == ToastResultNotFound &&
+        cache.Resolve(L"ms-appx:///Assets/Logo.png", ToastImagePlacement::Inline, unused) == ToastResultInvalidArgument, "a bad source resolved", failures);
+
+    // Rewriting a payload points its remote images at their local copies and leaves everything else alone
+    ToastPayload payload;
+    payload.Xml = L"<toast><visual><binding template=\"ToastGeneric\"><text>Hi</text>"
+        L"<image placement=\"appLogoOverride\" hint-crop=\"circle\" src=\"https://unsplash.it/64?image=1005\"/>"
+        L"<image src='https://picsum.photos/364/202?image=883&amp;blur=1'/>"
+        L"<image src=\"ms-appx:///Assets/Logo.png\"/>"
+        L"<image src=\"https://example.com/missing.png\"/></binding></visual></toast>";
+    Check(cache.Rewrite(payload) == ToastResultNotFound, "a missing image didn't fail the rewrite", failures);
+    std::wstring blurUri;
+    cache.Resolve(L"https://picsum.photos/364/202?image=883&blur=1", ToastImagePlacement::Inline, blurUri);
+    std::wstring expected = L"<toast><visual><binding template=\"ToastGeneric\"><text>Hi</text>"
+        L"<image placement=\"appLogoOverride\" hint-crop=\"circle\" src=\"" + logoUri + L"\"/>"
+        L"<image src='" + blurUri + L"'/>"
+        L"<image src=\"ms-appx:///Assets/Logo.png\"/>"
+        L"<image src=\"https://example.com/missing.png\"/></binding></visual></toast>";
+    Check(payload.Xml == expected, "the payload wasn't rewritten to the local images", failures);
+
+    // Reopening picks up the images on disk, and deletes only its own half-written files; sources are fetched again
+    // but the images aren't stored again
+    WriteFile(cacheDirectory / "toastimage-leftover.png.7.tmp", { 1, 2, 3 });
+    WriteFile(cacheDirectory / "download.tmp", { 1, 2, 3 });
+    {
+        ToastImageCache reopened(fetcher, options);
+        Check(reopened.Open(cacheDirectory) == ToastResultOk && reopened.GetStats().Files == cache.GetStats().Files &&
+            !std::filesystem::exists(cacheDirectory / "toastimage-leftover.png.7.tmp"), "reopening didn't index the images on disk", failures);
+        Check(std::filesystem::exists(cacheDirectory / "download.tmp"), "reopening deleted a file the cache didn't write", failures);
+        std::wstring reopenedUri;
+        Check(reopened.Resolve(L"https://picsum.photos/364/202?image=883", ToastImagePlacement::Inline, reopenedUri) == ToastResultOk &&
+            reopenedUri == inlineUri && reopened.GetStats().Stored == 0 && reopened.GetStats().Deduplicated == 1, "a reopened cache stored an image again", failures);
+    }
+
+    // Under a byte budget the least recently used image goes first, file and all
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            WriteFile(fetcher.PathFor(L"https://lru.example/" + std::to_wstring(i) + L".png"), MakePng(32, 32, 100 + i, 10000));
+        }
+        ToastImageCacheOptions small = options;
+        small.MaxBytes = 25000;
+        ToastImageCache lru(fetcher, small);
+        lru.Open(root / "lru");
+
+        std::wstring uris[4];
+        lru.Resolve(L"https://lru.example/0.png", ToastImagePlacement::Inline, uris[0]);
+        lru.Resolve(L"https://lru.example/1.png", ToastImagePlacement::Inline, uris[1]);
+        lru.Resolve(L"https://lru.example/0.png", ToastImagePlacement::Inline, uris[0]);
+        lru.Resolve(L"https://lru.example/2.png", ToastImagePlacement::Inline, uris[2]);
+        Check(std::filesystem::exists(ToastFileUriPath(uris[0])) && !std::filesystem::exists(ToastFileUriPath(uris[1])) &&
+            lru.GetStats().Evicted == 1 && lru.GetStats().Bytes <= small.MaxBytes, "the least recently used image wasn't evicted", failures);
+
+        std::uint64_t before = fetcher.FetchCount();
+        lru.Resolve(L"https://lru.example/1.png", ToastImagePlacement::Inline, uris[1]);
+        Check(fetcher.FetchCount() == before + 1 && std::filesystem::exists(ToastFileUriPath(uris[1])), "an evicted image wasn't fetched again", failures);
+    }
+
+    // Images in a toast that's still up aren't evicted, even over budget, until the toast has gone
+    {
+        ToastImageCacheOptions pinning = options;
+        pinning.MaxBytes = 25000;
+        std::vector<std::wstring> live = { L"chat" };
+        pinning.IsToastLive = [&](const std::wstring& tag, const std::wstring&) { return std::find(live.begin(), live.end(), tag) != live.end(); };
+        ToastImageCache pinned(fetcher, pinning);
+        pinned.Open(root / "pinned");
+
+        std::wstring shownUri, uri;
+        pinned.Resolve(L"https://lru.example/0.png", ToastImagePlacement::Inline, shownUri);
+        std::filesystem::path shownPath = ToastFileUriPath(shownUri);
+        ToastPayload toast{ L"<toast><visual><binding template=\"ToastGeneric\"><image src=\"https://lru.example/0.png\"/></binding></visual></toast>", L"chat", L"", {} };
+        pinned.Rewrite(toast);
+        pinned.Resolve(L"https://lru.example/1.png", ToastImagePlacement::Inline, uri);
+        pinned.Resolve(L"https://lru.example/2.png", ToastImagePlacement::Inline, uri);
+        Check(std::filesystem::exists(shownPath) && pinned.GetStats().Evicted == 1 && pinned.GetStats().PinnedToasts == 1,
+            "an image in a live toast was evicted", failures);
+
+        live.clear();
+        pinned.Resolve(L"https://lru.example/3.png", ToastImagePlacement::Inline, uri);
+        Check(!std::filesystem::exists(shownPath) && pinned.GetStats().PinnedToasts == 0, "an image outlived its toast", failures);
+    }
+
+    // Sources past MaxSources are forgotten, but their images are found by content rather than stored again
+    {
+        ToastImageCacheOptions few = options;
+        few.MaxSources = 2;
+        ToastImageCache bounded(fetcher, few);
+        bounded.Open(root / "bounded");
+
+        std::wstring first, uri;
+        bounded.Resolve(L"https://lru.example/0.png", ToastImagePlacement::Inline, first);
+        bounded.Resolve(L"https://lru.example/1.png", ToastImagePlacement::Inline, uri);
+        bounded.Resolve(L"https://lru.example/2.png", ToastImagePlacement::Inline, uri);
+        std::uint64_t misses = bounded.GetStats().Misses;
+        Check(bounded.Resolve(L"https://lru.example/0.png", ToastImagePlacement::Inline, uri) == ToastResultOk && uri == first &&
+            bounded.GetStats().Misses == misses + 1 && bounded.GetStats().Stored == 3 && bounded.GetStats().Deduplicated == 1,
+            "a forgotten source wasn't found by its content", failures);
+    }
+
+    // Uninstalling deletes the images it stored and nothing else, and the directory only once that empties it
+    {
+        std::filesystem::path shared = root / "uninstall";
+        WriteFile(shared / "settings.json", { '{', '}' });
+        ToastImageCache uninstalled(fetcher, options);
+        uninstalled.Open(shared);
+        std::wstring uri;
+        uninstalled.Resolve(L"https://lru.example/0.png", ToastImagePlacement::Inline, uri);
+        Check(uninstalled.Uninstall() == ToastResultOk && !std::filesystem::exists(ToastFileUriPath(uri)) &&
+            std::filesystem::exists(shared / "settings.json"), "uninstalling deleted the wrong files", failures);
+        Check(uninstalled.Resolve(L"https://lru.example/1.png", ToastImagePlacement::Inline, uri) == ToastResultFail, "an uninstalled cache stored an image", failures);
+
+        std::filesystem::remove(shared / "settings.json");
+        uninstalled.Open(shared);
+        uninstalled.Resolve(L"https://lru.example/0.png", ToastImagePlacement::Inline, uri);
+        Check(uninstalled.Uninstall() == ToastResultOk && !std::filesystem::exists(shared), "uninstalling left an empty directory", failures);
+    }
+
+    // Threads resolving the same sources at once end up with one file per image
+    {
+        const int imageCount = 10;
+        for (int i = 0; i < imageCount; i++)
+        {
+            WriteFile(fetcher.PathFor(L"https://threads.example/" + std::to_wstring(i) + L".png"), MakePng(300, 300, 1000 + i, 2000));
+        }
+        ToastImageCache shared(fetcher, options);
+        shared.Open(root / "threads");
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([&, t] {
+                std::wstring uri;
+                for (int i = 0; i < 200; i++)
+                {
+                    shared.Resolve(L"https://threads.example/" + std::to_wstring((i + t) % imageCount) + L".png", ToastImagePlacement::Inline, uri);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        Check(shared.GetStats().Files == imageCount, "threads stored an image more than once", failures);
+    }
+
+    RunBenchmark("Resolve a cached image", [&] {
+        cache.Resolve(L"https://picsum.photos/364/202?image=883", ToastImagePlacement::Inline, again);
+        DoNotOptimize(again);
+    });
+
+    std::wstring original = L"<toast><visual><binding template=\"ToastGeneric\"><text>Andrew sent you a picture</text>"
+        L"<image placement=\"appLogoOverride\" hint-crop=\"circle\" src=\"https://unsplash.it/64?image=1005\"/>"
+        L"<image src=\"https://picsum.photos/364/202?image=883\"/></binding></visual></toast>";
+    RunBenchmark("Rewrite a toast with two cached images", [&] {
+        payload.Xml = original;
+        cache.Rewrite(payload);
+        DoNotOptimize(payload);
+    });
+
+    std::filesystem::remove_all(root);
+    return failures == 0 ? 0 : 1;
+}
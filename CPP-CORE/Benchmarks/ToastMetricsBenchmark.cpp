@@ -0,0 +1,193 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Checks the histogram's buckets and percentiles against known values, failure and activation counts by key,
+// and that snapshots taken while eight threads write never lose or double-count a send. Then times recording a
+// send from 1 to 16 threads at once, spread over 64 shards and piled onto one, and taking a snapshot.
+
+#include "Benchmark.h"
+#include "ToastMetrics.h"
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const ToastResult AccessDenied = static_cast<ToastResult>(0x80070005);
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+
+    bool Near(std::uint64_t value, double expected)
+    {
+        return std::abs(value - expected) <= expected / ToastHistogram::SubBucketCount;
+    }
+
+    // Every writer records the same number of sends. Returns the wall time over the sends each writer made, which
+    // stays flat as writers are added until they contend with each other or run out of cores
+    double TimeWriters(ToastMetrics& metrics, int writerCount, int sendsPerWriter)
+    {
+        using Clock = std::chrono::steady_clock;
+        std::atomic<int> ready{ 0 };
+        std::atomic<bool> go{ false };
+        std::vector<std::thread> writers;
+        for (int w = 0; w < writerCount; w++)
+        {
+            writers.emplace_back([&] {
+                ready.fetch_add(1);
+                while (!go.load())
+                {
+                    std::this_thread::yield();
+                }
+                for (int i = 0; i < sendsPerWriter; i++)
+                {
+                    metrics.RecordSend(ToastResultOk, std::chrono::nanoseconds(1000 + i % 4096));
+                }
+            });
+        }
+        while (ready.load() < writerCount)
+        {
+            std::this_thread::yield();
+        }
+
+        Clock::time_point start = Clock::now();
+        go.store(true);
+        for (std::thread& writer : writers)
+        {
+            writer.join();
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / sendsPerWriter;
+    }
+}
+
+int main()
+{
+    int failures = 0;
+
+    bool bucketsHold = ToastHistogram::BucketIndex(0) == 0 && ToastHistogram::BucketIndex(31) == 31 &&
+        ToastHistogram::BucketIndex(std::uint64_t(1) << 50) == ToastHistogram::BucketCount - 1;
+    std::size_t previous = 0;
+    for (std::uint64_t value = 1; value < (std::uint64_t(1) << 42); value = value * 5 / 4 + 1)
+    {
+        std::size_t index = ToastHistogram::BucketIndex(value);
+        std::uint64_t lowest = ToastHistogram::BucketLowestValue(index);
+        std::uint64_t highest = ToastHistogram::BucketHighestValue(index);
+        bucketsHold = bucketsHold && index >= previous && lowest <= value && value <= highest && highest - lowest <= lowest / ToastHistogram::SubBucketCount;
+        previous = index;
+    }
+    Check(bucketsHold, "a value fell outside its bucket, or a bucket was wider than 1/32 of its values", failures);
+
+    ToastMetrics metrics;
+    for (int i = 1; i <= 100000; i++)
+    {
+        metrics.RecordSend(ToastResultOk, std::chrono::nanoseconds(i));
+    }
+    metrics.RecordSend(ToastResultFail, std::chrono::nanoseconds(0));
+    metrics.RecordSend(AccessDenied, std::chrono::nanoseconds(0));
+    metrics.RecordSend(AccessDenied, std::chrono::nanoseconds(0));
+    metrics.RecordFailure(AccessDenied);
+    metrics.RecordActivation(L"reply", std::chrono::microseconds(5));
+    metrics.RecordActivation(L"like", std::chrono::microseconds(5));
+    metrics.RecordActivation(metrics.ActionKey(L"like"), std::chrono::microseconds(5));
+    metrics.RecordCoalesced(3);
+    metrics.RecordQueueDepth(ToastMetricsQueue::Activation, 7);
+
+    ToastMetricsSnapshot snapshot = metrics.Snapshot();
+    ToastHistogram& sendLatency = snapshot.SendLatency;
+    Check(snapshot.Sends == 100003 && snapshot.SendFailures == 3 && snapshot.Coalesced == 3 && snapshot.Activations == 3, "the counters are wrong", failures);
+    Check(Near(sendLatency.ValueAtPercentile(50), 50000) && Near(sendLatency.ValueAtPercentile(99), 99000) &&
+        sendLatency.ValueAtPercentile(100) == 100000 && sendLatency.Max == 100000, "the latency percentiles are wrong", failures);
+    Check(snapshot.FailuresByResult.size() == 2 && snapshot.FailuresByResult[0] == std::make_pair(AccessDenied, std::uint64_t(3)) &&
+        snapshot.FailuresByResult[1] == std::make_pair(ToastResultFail, std::uint64_t(1)), "the failures by result are wrong", failures);
+    Check(snapshot.ActivationsByAction.size() == 2 && snapshot.ActivationsByAction[0].first == L"like" && snapshot.ActivationsByAction[0].second == 2,
+        "the activations by action are wrong", failures);
+    Check(snapshot.QueueDepth[static_cast<std::size_t>(ToastMetricsQueue::Activation)].Max == 7, "the queue depth is wrong", failures);
+
+    // Snapshots taken while writers are busy only ever go up, and the last one has everything
+    ToastMetricsOptions sharded;
+    sharded.ShardCount = 64;
+    ToastMetrics busy(sharded);
+    const int WriterCount = 8;
+    const int SendsPerWriter = 100000;
+    std::atomic<bool> writing{ true };
+    std::vector<std::thread> writers;
+    for (int w = 0; w < WriterCount; w++)
+    {
+        writers.emplace_back([&busy, w] {
+            for (int i = 0; i < SendsPerWriter; i++)
+            {
+                busy.RecordSend(i % 100 == 0 ? ToastResultFail : ToastResultOk, std::chrono::nanoseconds(i));
+                if (i % 1000 == 0)
+                {
+                    busy.RecordActivation(w % 2 == 0 ? L"reply" : L"like", std::chrono::nanoseconds(i));
+                }
+            }
+        });
+    }
+    std::thread reader([&] {
+        std::uint64_t last = 0;
+        while (writing.load())
+        {
+            ToastMetricsSnapshot during = busy.Snapshot();
+            if (during.Sends < last)
+            {
+                std::printf("a snapshot went backwards\n");
+                failures++;
+                break;
+            }
+            last = during.Sends;
+        }
+    });
+    for (std::thread& writer : writers)
+    {
+        writer.join();
+    }
+    writing.store(false);
+    reader.join();
+
+    snapshot = busy.Snapshot();
+    Check(snapshot.Sends == std::uint64_t(WriterCount) * SendsPerWriter && snapshot.SendLatency.Count == snapshot.Sends &&
+        snapshot.SendFailures == std::uint64_t(WriterCount) * SendsPerWriter / 100 && snapshot.Activations == std::uint64_t(WriterCount) * SendsPerWriter / 1000,
+        "sends were lost or double-counted under concurrent writers", failures);
+
+    // Writers on separate shards shouldn't slow each other down the way writers on one shard do
+    const int SendsPerTimedWriter = 200000;
+    for (int writerCount : { 1, 2, 4, 8, 16 })
+    {
+        ToastMetrics spread(sharded);
+        std::string name = "RecordSend, " + std::to_string(writerCount) + " writers, 64 shards";
+        ReportBenchmark(name.c_str(), TimeWriters(spread, writerCount, SendsPerTimedWriter), std::uint64_t(writerCount) * SendsPerTimedWriter);
+
+        ToastMetricsOptions single;
+        single.ShardCount = 1;
+        ToastMetrics piled(single);
+        name = "RecordSend, " + std::to_string(writerCount) + " writers, 1 shard";
+        ReportBenchmark(name.c_str(), TimeWriters(piled, writerCount, SendsPerTimedWriter), std::uint64_t(writerCount) * SendsPerTimedWriter);
+    }
+
+    ToastMetrics populated(sharded);
+    TimeWriters(populated, 16, 1000);
+    RunBenchmark("Snapshot, 16 shards in use", [&] {
+        ToastMetricsSnapshot taken = populated.Snapshot();
+        DoNotOptimize(taken.Sends);
+    });
+
+    return failures == 0 ? 0 : 1;
+}
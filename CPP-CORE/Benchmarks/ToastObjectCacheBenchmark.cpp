@@ -0,0 +1,133 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Drives ToastObjectCache with the counting fake platform the way the compat layer does (activation
+// factory cached by class name, notifiers and history created from it and cached by AUMID), checks
+// that a burst of 10,000 sends from several threads costs a single factory lookup, and times the
+// cached lookups against going to the platform on every send.
+
+#include "Benchmark.h"
+#include "CountingToastPlatform.h"
+#include "ToastObjectCache.h"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const std::wstring ManagerClass = L"Windows.UI.Notifications.ToastNotificationManager";
+    const std::wstring Aumid = L"Microsoft.SampleCppWinRtApp";
+    const std::wstring_view Xml = L"<toast><visual><binding template=\"ToastGeneric\"><text>Hi</text></binding></visual></toast>";
+
+    constexpr int Senders = 4;
+    constexpr int SendsPerSender = 2500;
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+
+    /// <summary>
+    /// The caches the compat platforms keep, in the same shape.
+    /// </summary>
+    struct CachedPlatform
+    {
+        explicit CachedPlatform(CountingToastPlatform& platform) :
+            Platform(platform)
+        {
+        }
+
+        std::shared_ptr<CountingToastPlatform::ManagerStatics> GetStatics()
+        {
+            return StaticsCache.GetOrCreate(ManagerClass, [this] { return Platform.GetManagerStatics(); });
+        }
+
+        std::shared_ptr<CountingToastPlatform::Notifier> GetNotifier(const std::wstring& aumid)
+        {
+            return NotifierCache.GetOrCreate(aumid, [this, &aumid] { return GetStatics()->CreateToastNotifier(aumid); });
+        }
+
+        std::shared_ptr<CountingToastPlatform::History> GetHistory()
+        {
+            return HistoryCache.GetOrCreate(L"", [this] { return GetStatics()->GetHistory(); });
+        }
+
+        CountingToastPlatform& Platform;
+        ToastObjectCache<std::shared_ptr<CountingToastPlatform::ManagerStatics>> StaticsCache;
+        ToastObjectCache<std::shared_ptr<CountingToastPlatform::Notifier>> NotifierCache;
+        ToastObjectCache<std::shared_ptr<CountingToastPlatform::History>> HistoryCache;
+    };
+}
+
+int main()
+{
+    int failures = 0;
+
+    CountingToastPlatform platform;
+    CachedPlatform cached(platform);
+
+    std::vector<std::thread> senders;
+    for (int sender = 0; sender < Senders; sender++)
+    {
+        senders.emplace_back([&cached]
+        {
+            for (int i = 0; i < SendsPerSender; i++)
+            {
+                cached.GetNotifier(Aumid)->Show(Xml);
+            }
+        });
+    }
+    for (std::thread& sender : senders)
+    {
+        sender.join();
+    }
+    cached.GetHistory()->Clear(Aumid);
+
+    std::printf("%llu sends: %llu factory lookups, %llu notifier creations, %llu history lookups\n",
+        static_cast<unsigned long long>(platform.Shows()),
+        static_cast<unsigned long long>(platform.FactoryLookups()),
+        static_cast<unsigned long long>(platform.NotifierCreations()),
+        static_cast<unsigned long long>(platform.HistoryLookups()));
+    Check(platform.Shows() == Senders * SendsPerSender, "not every send reached the platform", failures);
+    Check(platform.FactoryLookups() == 1, "the activation factory was looked up more than once", failures);
+    Check(platform.NotifierCreations() == 1, "the notifier was created more than once", failures);
+    Check(platform.HistoryLookups() == 1 && platform.HistoryCalls() == 1, "the history object wasn't created once and reused", failures);
+
+    // After ClearCaches the next send goes back to the platform exactly once
+    cached.StaticsCache.Clear();
+    cached.NotifierCache.Clear();
+    platform.ResetCounters();
+    cached.GetNotifier(Aumid)->Show(Xml);
+    cached.GetNotifier(Aumid)->Show(Xml);
+    Check(platform.FactoryLookups() == 1 && platform.NotifierCreations() == 1, "a cleared cache didn't recreate its objects exactly once", failures);
+
+    // A second AUMID gets its own notifier but reuses the cached factory
+    cached.GetNotifier(L"Contoso.OtherApp")->Show(Xml);
+    Check(platform.FactoryLookups() == 1 && platform.NotifierCreations() == 2, "a second AUMID looked the factory up again", failures);
+    Check(cached.NotifierCache.Size() == 2, "the notifier cache doesn't hold one entry per AUMID", failures);
+
+    RunBenchmark("cached notifier + Show", [&] {
+        cached.GetNotifier(Aumid)->Show(Xml);
+    });
+
+    RunBenchmark("uncached factory + notifier + Show", [&] {
+        platform.GetManagerStatics()->CreateToastNotifier(Aumid)->Show(Xml);
+    });
+
+    return failures == 0 ? 0 : 1;
+}
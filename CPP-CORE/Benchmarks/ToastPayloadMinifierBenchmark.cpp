@@ -0,0 +1,161 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Minifies the samples' conversation toast and checks the result byte for byte, checks that the element
+// carrying the image URL is reported as the largest, and checks warning and failing budgets, malformed input
+// and UTF-16 sizing of characters beyond the BMP. Then times minifying the toast with and without a report.
+
+#include "Benchmark.h"
+#include "ToastPayloadMinifier.h"
+#include "ToastTemplate.h"
+#include <cstdio>
+#include <string>
+
+namespace
+{
+    // The template from the samples' sendToast(), indentation and all
+    const wchar_t ConversationTemplate[] = LR"(<?xml version="1.0" encoding="utf-8"?>
+<toast launch="action=viewConversation&amp;conversationId={conversationId}">
+    <!-- Shown when someone sends a picture -->
+    <visual>
+        <binding template="ToastGeneric">
+            <text>{title}</text>
+            <text>{body}</text>
+            <image placement="appLogoOverride" hint-crop="circle" src="{logoSrc}"/>
+            <image src="{imageSrc}"/>
+        </binding>
+    </visual>
+    <actions>
+        <input
+            id="tbReply"
+            type="text"
+            placeHolderContent="Type a reply"/>
+        <action
+            content="Reply"
+            activationType="background"
+            arguments="action=reply&amp;conversationId={conversationId}"/>
+        <action
+            content="Like"
+            activationType="background"
+            arguments="action=like&amp;conversationId={conversationId}"/>
+        <action
+            content="View"
+            activationType="background"
+            arguments="action=viewImage&amp;imageUrl={imageSrc}"/>
+    </actions>
+</toast>)";
+
+    const wchar_t ExpectedConversation[] =
+        L"<toast launch=\"action=viewConversation&amp;conversationId=9813\"><visual><binding template=\"ToastGeneric\">"
+        L"<text>Andrew sent you a picture</text><text>Check this out, Happy Canyon in Utah!</text>"
+        L"<image placement=\"appLogoOverride\" hint-crop=\"circle\" src=\"https://unsplash.it/64?image=1005\"/>"
+        L"<image src=\"https://picsum.photos/364/202?image=883\"/></binding></visual><actions>"
+        L"<input id=\"tbReply\" type=\"text\" placeHolderContent=\"Type a reply\"/>"
+        L"<action content=\"Reply\" activationType=\"background\" arguments=\"action=reply&amp;conversationId=9813\"/>"
+        L"<action content=\"Like\" activationType=\"background\" arguments=\"action=like&amp;conversationId=9813\"/>"
+        L"<action content=\"View\" activationType=\"background\" arguments=\"action=viewImage&amp;imageUrl=https://picsum.photos/364/202?image=883\"/>"
+        L"</actions></toast>";
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+}
+
+int main()
+{
+    ToastTemplate conversationTemplate(ConversationTemplate);
+    ToastTemplateValues values = conversationTemplate.CreateValues();
+    values.Set(L"conversationId", L"9813");
+    values.Set(L"title", L"Andrew sent you a picture");
+    values.Set(L"body", L"Check this out, Happy Canyon in Utah!");
+    values.Set(L"logoSrc", L"https://unsplash.it/64?image=1005");
+    values.Set(L"imageSrc", L"https://picsum.photos/364/202?image=883");
+    std::wstring xml = conversationTemplate.Render(values);
+
+    int failures = 0;
+    ToastPayloadMinifier minifier;
+    std::wstring minified;
+    ToastPayloadReport report;
+    Check(minifier.Minify(xml, minified, &report) == ToastResultOk, "the conversation toast didn't minify", failures);
+    Check(minified == ExpectedConversation, "the minified conversation toast isn't what was expected", failures);
+    Check(report.InputBytes == xml.size() * 2 && report.OutputBytes == minified.size() * 2, "the conversation toast was sized wrong", failures);
+    Check(report.LargestElements.size() == 5 && report.LargestElements[0].Path == L"toast/actions/action[3]" &&
+        report.LargestElements[0].LargestAttribute == L"arguments", "the image URL action wasn't reported as the largest element", failures);
+    std::printf("conversation toast: %zu bytes, %zu minified\n", report.InputBytes, report.OutputBytes);
+    for (const ToastPayloadElementSize& element : report.LargestElements)
+    {
+        std::printf("  %-32ls %5zu bytes, %ls=%zu\n", element.Path.c_str(), element.Bytes, element.LargestAttribute.c_str(), element.LargestAttributeBytes);
+    }
+
+    // Each element's own bytes add up to the whole payload
+    ToastPayloadBudget everything;
+    everything.ReportedElements = 100;
+    ToastPayloadReport full;
+    ToastPayloadMinifier(everything).Minify(xml, minified, &full);
+    std::size_t total = 0;
+    for (const ToastPayloadElementSize& element : full.LargestElements)
+    {
+        total += element.Bytes;
+    }
+    Check(full.LargestElements.size() == 12 && total == full.OutputBytes, "the element sizes don't add up to the payload", failures);
+
+    // A failing budget stops the toast, a warning one only reports it
+    int overruns = 0;
+    ToastPayloadBudget tight;
+    tight.MaxBytes = 512;
+    tight.OverBudget = [&](const ToastPayloadReport& overrun) { overruns += overrun.OutputBytes > overrun.MaxBytes ? 1 : 0; };
+    ToastPayload payload;
+    payload.Xml = xml;
+    Check(ToastPayloadMinifier(tight).Minify(payload) == ToastResultTooLarge && payload.Xml == xml && overruns == 1, "a failing budget let the toast through", failures);
+    tight.Action = ToastPayloadBudgetAction::Warn;
+    Check(ToastPayloadMinifier(tight).Minify(payload) == ToastResultOk && payload.Xml == ExpectedConversation && overruns == 2, "a warning budget didn't minify and report", failures);
+
+    // Whitespace that is an element's whole text is kept, and so is everything inside values
+    Check(minifier.Minify(L"<toast>\n  <text>  </text>\n  <text a = 'x  y' >a  b</text > </toast>", minified) == ToastResultOk &&
+        minified == L"<toast><text>  </text><text a='x  y'>a  b</text></toast>", "whitespace that matters was dropped", failures);
+
+    const wchar_t* malformed[] = { L"<toast><text>", L"<toast></text>", L"<toast a=\"1></toast>", L"<toast a></toast>", L"<toast><!-- </toast>", L"<>" };
+    for (const wchar_t* bad : malformed)
+    {
+        Check(minifier.Minify(bad, minified) == ToastResultInvalidArgument, "malformed XML was accepted", failures);
+    }
+
+    // Characters beyond the BMP are a surrogate pair, four bytes, whatever the width of wchar_t
+    std::wstring emoji = L"<text>";
+    if constexpr (sizeof(wchar_t) == 2)
+    {
+        emoji += L"\xD83D\xDE00";
+    }
+    else
+    {
+        emoji += static_cast<wchar_t>(0x1F600);
+    }
+    emoji += L"</text>";
+    Check(minifier.Minify(emoji, minified, &report) == ToastResultOk && report.OutputBytes == 30 && ToastUtf16Bytes(emoji) == 30, "a character beyond the BMP was sized wrong", failures);
+
+    RunBenchmark("Minify the conversation toast", [&] {
+        minifier.Minify(xml, minified);
+        DoNotOptimize(minified);
+    });
+
+    RunBenchmark("Minify the conversation toast with a report", [&] {
+        minifier.Minify(xml, minified, &report);
+        DoNotOptimize(report);
+    });
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Drives ToastProgress with a virtual clock against the in-memory platform: an export job reports 10,000
+// ticks a second for ten seconds, and the check is that the platform sees a handful of updates a second
+// and ends up showing the final values. Also checks that updates arriving out of order lose nothing, that
+// held values are retried after a failed update, that a dismissed toast is forgotten, and that the
+// background pump sleeps on a virtual clock. Then times a report that's held and one that goes straight to
+// the platform.
+
+#include "Benchmark.h"
+#include "InMemoryNotificationPlatform.h"
+#include "ToastProgress.h"
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = ToastProgress::Clock;
+
+    const std::wstring Aumid = L"Contoso.Exporter";
+    const int TicksPerSecond = 10000;
+    const int Seconds = 10;
+    const int Total = TicksPerSecond * Seconds;
+
+    ToastPayload MakeProgressToast(const std::wstring& tag)
+    {
+        ToastPayload payload;
+        payload.Xml = L"<toast><visual><binding template=\"ToastGeneric\"><text>Exporting photos</text>"
+            L"<progress title=\"{title}\" value=\"{value}\" valueStringOverride=\"{count}\" status=\"{status}\"/></binding></visual></toast>";
+        payload.Tag = tag;
+        payload.Group = L"exports";
+        payload.Data.Values = {
+            { L"title", L"Vacation album" },
+            { L"value", L"0" },
+            { L"count", L"0/" + std::to_wstring(Total) },
+            { L"status", L"Exporting..." } };
+        return payload;
+    }
+
+    std::vector<ToastDataValue> Tick(int done)
+    {
+        return {
+            { L"title", L"Vacation album" },
+            { L"value", std::to_wstring(done * 100 / Total) },
+            { L"count", std::to_wstring(done) + L"/" + std::to_wstring(Total) },
+            { L"status", L"Exporting..." } };
+    }
+
+    std::wstring ValueOf(const ToastData& data, const std::wstring& key)
+    {
+        for (const ToastDataValue& value : data.Values)
+        {
+            if (value.Key == key)
+            {
+                return value.Value;
+            }
+        }
+        return std::wstring();
+    }
+
+    // Keeps every update it's sent, so a test can replay them in another order
+    struct RecordingPlatform : InMemoryNotificationPlatform
+    {
+        std::vector<ToastData> Updates;
+
+        ToastResult Update(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group, const ToastData& data) override
+        {
+            Updates.push_back(data);
+            return InMemoryNotificationPlatform::Update(aumid, tag, group, data);
+        }
+    };
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+}
+
+int main()
+{
+    Clock::time_point now = Clock::time_point(std::chrono::hours(1));
+
+    InMemoryNotificationPlatform platform;
+    platform.SetRecordShows(false);
+
+    ToastProgressOptions options;
+    options.MaxUpdatesPerSecond = 4.0;
+    options.BackgroundPump = false;
+    options.Now = [&] { return now; };
+    ToastProgress progress(platform, Aumid, options);
+
+    int failures = 0;
+    Check(progress.Show(ToastPayload{ L"<toast/>", L"", L"", {} }) == ToastResultInvalidArgument, "an untagged toast was tracked", failures);
+    Check(progress.Show(MakeProgressToast(L"album")) == ToastResultOk, "the progress toast wasn't shown", failures);
+
+    // Ten thousand ticks a second, with the pump running between them as the background thread would
+    for (int done = 1; done < Total; done++)
+    {
+        now += std::chrono::microseconds(1000000 / TicksPerSecond);
+        progress.Report(L"album", L"exports", Tick(done));
+        progress.Pump();
+    }
+    Check(progress.Complete(L"album", L"exports", { { L"value", L"100" }, { L"count", L"Done" }, { L"status", L"Complete" } }) == ToastResultOk,
+        "completing the toast failed", failures);
+
+    ToastProgressStats stats = progress.GetStats();
+    std::uint64_t updates = platform.CallCount(InMemoryPlatformOperation::Update);
+    std::printf("%d ticks over %d seconds: %llu platform updates\n", Total - 1, Seconds, static_cast<unsigned long long>(updates));
+    Check(updates == stats.Updates && updates <= Seconds * 4 + 2, "the updates weren't limited to four a second", failures);
+    Check(stats.Reported == static_cast<std::uint64_t>(Total) && stats.Coalesced + stats.Updates >= stats.Reported - 1, "ticks went missing", failures);
+    Check(platform.ShowCount() == 1, "the toast was re-rendered", failures);
+    Check(progress.TrackedCount() == 0, "a completed toast is still tracked", failures);
+
+    ToastData data;
+    Check(platform.GetHistoryData(Aumid, L"album", L"exports", data) && ValueOf(data, L"value") == L"100" && ValueOf(data, L"count") == L"Done" &&
+        ValueOf(data, L"status") == L"Complete" && ValueOf(data, L"title") == L"Vacation album", "the toast doesn't show the final values", failures);
+    Check(data.SequenceNumber == 1 + updates, "the sequence numbers didn't count up from the show", failures);
+
+    // A stale update is dropped by the platform, so racing updates can't step the bar backwards
+    platform.Update(Aumid, L"album", L"exports", ToastData{ { { L"value", L"50" } }, 2 });
+    platform.GetHistoryData(Aumid, L"album", L"exports", data);
+    Check(ValueOf(data, L"value") == L"100", "a stale update was applied", failures);
+
+    // Nothing is sent when nothing changed
+    progress.Show(MakeProgressToast(L"diff"));
+    now += std::chrono::seconds(1);
+    std::uint64_t before = platform.CallCount(InMemoryPlatformOperation::Update);
+    progress.Report(L"diff", L"exports", Tick(0));
+    Check(platform.CallCount(InMemoryPlatformOperation::Update) == before, "an unchanged report was sent", failures);
+    progress.Report(L"diff", L"exports", { { L"value", L"1" } });
+    now += std::chrono::milliseconds(10);
+    progress.Report(L"diff", L"exports", { { L"value", L"2" } });
+    progress.Report(L"diff", L"exports", { { L"value", L"1" } });
+    now += std::chrono::seconds(1);
+    progress.Pump();
+    Check(platform.CallCount(InMemoryPlatformOperation::Update) == before + 1, "a value set back before it was sent went out anyway", failures);
+
+    // A failed update keeps its values held until one gets through
+    platform.SetFailure(InMemoryPlatformOperation::Update, ToastResultFail);
+    Check(progress.Report(L"diff", L"exports", { { L"status", L"Compressing..." } }) == ToastResultFail, "the failure wasn't returned", failures);
+    platform.SetFailure(InMemoryPlatformOperation::Update, ToastResultOk);
+    now += std::chrono::seconds(1);
+    progress.Pump();
+    platform.GetHistoryData(Aumid, L"diff", L"exports", data);
+    Check(ValueOf(data, L"status") == L"Compressing..." && progress.GetStats().Failures == 1, "a failed update wasn't retried", failures);
+
+    // Once the user dismisses the toast, reporting on it stops at the first update that finds it gone
+    platform.RemoveFromHistory(Aumid, L"diff", L"exports");
+    now += std::chrono::seconds(1);
+    Check(progress.Report(L"diff", L"exports", Tick(10)) == ToastResultNotFound && progress.TrackedCount() == 0 &&
+        progress.Report(L"diff", L"exports", Tick(20)) == ToastResultNotFound, "a dismissed toast is still tracked", failures);
+
+    // Two updates that reach the platform newest first: the older is dropped as stale, and the newer still has both changes
+    {
+        RecordingPlatform recording;
+        ToastProgress racing(recording, Aumid, options);
+        racing.Show(MakeProgressToast(L"race"));
+        now += std::chrono::seconds(1);
+        racing.Report(L"race", L"exports", { { L"value", L"40" } });
+        now += std::chrono::seconds(1);
+        racing.Report(L"race", L"exports", { { L"status", L"Uploading..." } });
+
+        InMemoryNotificationPlatform reordered;
+        reordered.Show(Aumid, MakeProgressToast(L"race"));
+        for (auto it = recording.Updates.rbegin(); it != recording.Updates.rend(); ++it)
+        {
+            reordered.Update(Aumid, L"race", L"exports", *it);
+        }
+        reordered.GetHistoryData(Aumid, L"race", L"exports", data);
+        Check(recording.Updates.size() == 2 && ValueOf(data, L"value") == L"40" && ValueOf(data, L"status") == L"Uploading...",
+            "an update that lost the race to the platform took its values with it", failures);
+    }
+
+    // The background pump sleeps in real time for what's left on a virtual clock rather than spinning
+    {
+        std::atomic<int> clockReads{ 0 };
+        ToastProgressOptions pumpOptions;
+        pumpOptions.MaxUpdatesPerSecond = 1.0;
+        pumpOptions.Now = [&clockReads, now] { clockReads++; return now; };
+        ToastProgress pumped(platform, Aumid, pumpOptions);
+        pumped.Show(MakeProgressToast(L"pumped"));
+        pumped.Report(L"pumped", L"exports", Tick(1));
+
+        int readsBefore = clockReads;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        Check(clockReads - readsBefore < 100, "the background pump spun on a virtual clock", failures);
+    }
+
+    progress.Show(MakeProgressToast(L"timed"));
+    int done = 0;
+    RunBenchmark("Report, held", [&] {
+        progress.Report(L"timed", L"exports", Tick(++done % Total));
+    });
+
+    ToastProgressOptions unlimited;
+    unlimited.MaxUpdatesPerSecond = 0.0;
+    unlimited.BackgroundPump = false;
+    ToastProgress direct(platform, Aumid, unlimited);
+    direct.Show(MakeProgressToast(L"direct"));
+    RunBenchmark("Report, sent to the platform", [&] {
+        direct.Report(L"direct", L"exports", Tick(++done % Total));
+    });
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,285 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Checks ToastRateLimiter's token buckets and coalescing against a virtual clock, that a group's toasts
+// reach the downstream in order while several threads submit alongside the pump, that the pump sleeps
+// rather than spins on a virtual clock, that the number of tracked groups stays bounded, and that
+// DesktopNotificationManager::Show goes through the limiter, then times Submit.
+
+#include "Benchmark.h"
+#include "DesktopNotificationManager.h"
+#include "InMemoryNotificationPlatform.h"
+#include "ToastRateLimiter.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    using Clock = ToastRateLimiter::Clock;
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+
+    ToastPayload MakeToast(std::wstring group, std::wstring tag, std::wstring text = L"Hi")
+    {
+        ToastPayload payload;
+        payload.Xml = L"<toast><visual><binding template=\"ToastGeneric\"><text>" + text + L"</text></binding></visual></toast>";
+        payload.Tag = std::move(tag);
+        payload.Group = std::move(group);
+        return payload;
+    }
+
+    /// <summary>
+    /// A clock the test moves by hand.
+    /// </summary>
+    struct VirtualClock
+    {
+        Clock::time_point Time = Clock::time_point(std::chrono::hours(1));
+        std::atomic<std::uint64_t> Reads{ 0 };
+
+        std::function<Clock::time_point()> Function()
+        {
+            return [this]
+            {
+                Reads++;
+                return Time;
+            };
+        }
+    };
+}
+
+int main()
+{
+    int failures = 0;
+
+    // Burst, refill and coalescing, pumped by hand
+    {
+        VirtualClock clock;
+        ToastRateLimiterOptions options;
+        options.DefaultLimit = { 1.0, 3.0 };
+        options.BackgroundPump = false;
+        options.Now = clock.Function();
+
+        std::vector<std::wstring> forwarded;
+        ToastRateLimiter limiter(options, [&forwarded](ToastPayload&& payload)
+        {
+            forwarded.push_back(payload.Xml);
+            return ToastResultOk;
+        });
+
+        for (int i = 0; i < 3; i++)
+        {
+            limiter.Submit(MakeToast(L"mail", L"m" + std::to_wstring(i)));
+        }
+        limiter.Submit(MakeToast(L"mail", L"held"));
+        limiter.Submit(MakeToast(L"mail", L"next"));
+        limiter.Submit(MakeToast(L"mail", L"held", L"Replaced"));
+        Check(forwarded.size() == 3, "the burst wasn't forwarded right away", failures);
+        Check(limiter.PendingCount() == 2, "toasts over the limit weren't held back", failures);
+
+        Clock::time_point next = limiter.Pump();
+        Check(forwarded.size() == 3 && next > clock.Time && next <= clock.Time + std::chrono::seconds(1) + std::chrono::microseconds(1),
+            "Pump didn't report when the next token is due", failures);
+
+        clock.Time += std::chrono::seconds(1);
+        limiter.Pump();
+        Check(forwarded.size() == 4 && forwarded[3].find(L"Replaced") != std::wstring::npos,
+            "the held toast wasn't replaced in place by the one with its tag", failures);
+
+        clock.Time += std::chrono::seconds(1);
+        Check(limiter.Pump() == Clock::time_point::max() && forwarded.size() == 5, "the backlog didn't drain", failures);
+
+        ToastRateLimiterStats stats = limiter.GetStats();
+        Check(stats.Submitted == 6 && stats.Forwarded == 5 && stats.Coalesced == 1 && stats.Dropped == 0, "the stats don't add up", failures);
+    }
+
+    // A group's toasts stay in order while producers race the pump
+    {
+        constexpr int Producers = 4;
+        constexpr int ToastsPerProducer = 5000;
+
+        ToastRateLimiterOptions options;
+        options.DefaultLimit = { 200000.0, 1.0 };
+        options.MaxPendingPerGroup = Producers * ToastsPerProducer;
+
+        std::mutex receivedMutex;
+        std::vector<std::pair<int, int>> received;
+        ToastRateLimiter limiter(options, [&receivedMutex, &received](ToastPayload&& payload)
+        {
+            std::size_t separator = payload.Xml.find(L':');
+            std::lock_guard<std::mutex> lock(receivedMutex);
+            received.emplace_back(std::stoi(payload.Xml.substr(0, separator)), std::stoi(payload.Xml.substr(separator + 1)));
+            return ToastResultOk;
+        });
+
+        std::vector<std::thread> producers;
+        for (int producer = 0; producer < Producers; producer++)
+        {
+            producers.emplace_back([&limiter, producer]
+            {
+                for (int i = 0; i < ToastsPerProducer; i++)
+                {
+                    ToastPayload payload;
+                    payload.Xml = std::to_wstring(producer) + L":" + std::to_wstring(i);
+                    payload.Group = L"chat";
+                    limiter.Submit(std::move(payload));
+                }
+            });
+        }
+        for (std::thread& producer : producers)
+        {
+            producer.join();
+        }
+
+        auto deadline = Clock::now() + std::chrono::seconds(10);
+        while (limiter.PendingCount() > 0 && Clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        limiter.Pump();
+
+        std::lock_guard<std::mutex> lock(receivedMutex);
+        std::vector<int> last(Producers, -1);
+        bool ordered = true;
+        for (const auto& toast : received)
+        {
+            ordered = ordered && toast.second > last[toast.first];
+            last[toast.first] = toast.second;
+        }
+        Check(received.size() == Producers * ToastsPerProducer, "a held toast was never forwarded", failures);
+        Check(ordered, "a toast overtook one its producer submitted to the same group before it", failures);
+    }
+
+    // With a virtual clock the background pump sleeps until the token is due in real time instead of spinning
+    {
+        VirtualClock clock;
+        ToastRateLimiterOptions options;
+        options.DefaultLimit = { 1.0, 1.0 };
+        options.Now = clock.Function();
+
+        ToastRateLimiter limiter(options, [](ToastPayload&&) { return ToastResultOk; });
+        limiter.Submit(MakeToast(L"mail", L"a"));
+        limiter.Submit(MakeToast(L"mail", L"b"));
+
+        std::uint64_t before = clock.Reads;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::uint64_t reads = clock.Reads - before;
+        std::printf("virtual clock read %llu times in 100 ms by an idle pump\n", static_cast<unsigned long long>(reads));
+        Check(reads < 10, "the pump spun on a virtual clock that hadn't moved", failures);
+    }
+
+    // Idle groups are forgotten once there are MaxGroups of them; a group holding toasts back never is
+    {
+        VirtualClock clock;
+        ToastRateLimiterOptions options;
+        options.DefaultLimit = { 1.0, 1.0 };
+        options.BackgroundPump = false;
+        options.MaxGroups = 8;
+        options.Now = clock.Function();
+
+        ToastRateLimiter limiter(options, [](ToastPayload&&) { return ToastResultOk; });
+        for (int group = 0; group < 1000; group++)
+        {
+            limiter.Submit(MakeToast(L"g" + std::to_wstring(group), L""));
+        }
+        ToastRateLimiterStats stats = limiter.GetStats();
+        Check(stats.Forwarded == 1000 && stats.Dropped == 0, "a new group was refused while others were idle", failures);
+
+        // Fill every slot with a group that's holding a toast back
+        for (int group = 0; group < 8; group++)
+        {
+            std::wstring name = L"busy" + std::to_wstring(group);
+            limiter.Submit(MakeToast(name, L"first"));
+            limiter.Submit(MakeToast(name, L"held"));
+        }
+        Check(limiter.PendingCount() == 8, "a group holding toasts was forgotten", failures);
+        Check(limiter.Submit(MakeToast(L"late", L"")) == ToastResultBusy, "a group over MaxGroups wasn't refused", failures);
+
+        clock.Time += std::chrono::seconds(1);
+        limiter.Pump();
+        clock.Time += std::chrono::seconds(1);
+        Check(limiter.Submit(MakeToast(L"late", L"")) == ToastResultOk && limiter.GetStats().Dropped == 1,
+            "a group wasn't let in once the others had refilled", failures);
+    }
+
+    // DesktopNotificationManager::Show goes through the limiter
+    {
+        VirtualClock clock;
+        InMemoryNotificationPlatform platform;
+        DesktopNotificationManager manager(platform, L"Contoso.Mail");
+
+        ToastRateLimiterOptions options;
+        options.DefaultLimit = { 1.0, 2.0 };
+        options.BackgroundPump = false;
+        options.Now = clock.Function();
+        Check(manager.UseRateLimiter(options) == ToastResultOk, "UseRateLimiter failed", failures);
+
+        for (int i = 0; i < 5; i++)
+        {
+            Check(manager.Show(MakeToast(L"mail", std::to_wstring(i))) == ToastResultOk, "Show failed for a held toast", failures);
+        }
+        Check(platform.HistoryCount(L"Contoso.Mail") == 2, "Show didn't hold back toasts over the limit", failures);
+
+        clock.Time += std::chrono::seconds(2);
+        manager.PumpRateLimiter();
+        clock.Time += std::chrono::seconds(1);
+        Check(manager.PumpRateLimiter() == Clock::time_point::max(), "the manager's limiter still held toasts", failures);
+        Check(platform.HistoryCount(L"Contoso.Mail") == 5 && manager.HistoryIndex().Size() == 5, "held toasts weren't shown once released", failures);
+        Check(manager.Metrics().Snapshot().Sends == 5, "released toasts weren't counted as sends", failures);
+    }
+
+    // Timings
+    {
+        ToastRateLimiterOptions options;
+        options.DefaultLimit = { 1e12, 1e12 };
+        options.BackgroundPump = false;
+        ToastRateLimiter limiter(options, [](ToastPayload&& payload)
+        {
+            DoNotOptimize(payload);
+            return ToastResultOk;
+        });
+
+        ToastPayload toast = MakeToast(L"mail", L"tag");
+        RunBenchmark("Submit, forwarded", [&] {
+            limiter.Submit(toast);
+        });
+    }
+
+    {
+        VirtualClock clock;
+        ToastRateLimiterOptions options;
+        options.DefaultLimit = { 1.0, 1.0 };
+        options.BackgroundPump = false;
+        options.Now = clock.Function();
+        ToastRateLimiter limiter(options, [](ToastPayload&&) { return ToastResultOk; });
+
+        limiter.Submit(MakeToast(L"mail", L"first"));
+        ToastPayload toast = MakeToast(L"mail", L"progress");
+        RunBenchmark("Submit, coalesced into a held toast", [&] {
+            limiter.Submit(toast);
+        });
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,505 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Writes a million scheduled toasts to a ToastScheduleJournal and times reopening it and rebuilding a
+// ToastScheduler from it, the way the compat layer does at startup. That's linear in the live entries, seconds
+// rather than milliseconds for a million, so it's also timed for 10,000 entries rewritten many times, checking that
+// startup reads no more than compaction allows rather than the whole history. Then checks crash recovery on the real
+// filesystem: copies of a journal cut off or corrupted part way through a record, a journal missing a record
+// that the one after it outlived, and (outside Windows) a process killed while writing. Also checks compaction
+// and that a scheduler's journal restores the schedule it was written by.
+
+#include "Benchmark.h"
+#include "InMemoryNotificationPlatform.h"
+#include "ToastScheduleJournal.h"
+#include "ToastScheduler.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    using Clock = std::chrono::system_clock;
+    using SteadyClock = std::chrono::steady_clock;
+
+    const std::wstring Aumid = L"Contoso.Reminders";
+    const int EntryCount = 1000000;
+    const std::uint64_t HeaderSize = 64;
+    const Clock::time_point Start = Clock::time_point(std::chrono::hours(24 * 365 * 56));
+
+    ScheduledToast MakeReminder(int index)
+    {
+        std::wstring id = std::to_wstring(index);
+
+        ScheduledToast toast;
+        toast.Id = id;
+        toast.Payload.Xml = L"<toast launch=\"action=viewReminder&amp;id=" + id + L"\"><visual><binding template=\"ToastGeneric\"><text>Reminder</text></binding></visual></toast>";
+        toast.Payload.Tag = id;
+        toast.Payload.Group = L"list" + std::to_wstring(index % 100);
+        toast.DeliveryTime = Start + std::chrono::hours(1) + std::chrono::seconds(index);
+        return toast;
+    }
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+
+    double MillisecondsSince(SteadyClock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+    }
+
+    std::vector<char> ReadFile(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void WriteFile(const std::filesystem::path& path, const std::vector<char>& contents)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+
+    // Whether the journal holds exactly reminders [0, count), as MakeReminder made them
+    bool HoldsReminders(const ToastScheduleJournal& journal, int count)
+    {
+        std::vector<ToastJournalEntry> entries;
+        if (!ToastSucceeded(journal.Load(entries)) || entries.size() != static_cast<std::size_t>(count))
+        {
+            return false;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            ScheduledToast expected = MakeReminder(i);
+            const ScheduledToast& actual = entries[i].Toast;
+            if (actual.Id != expected.Id || actual.Payload.Xml != expected.Payload.Xml || actual.Payload.Tag != expected.Payload.Tag ||
+                actual.Payload.Group != expected.Payload.Group || actual.DeliveryTime != expected.DeliveryTime)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Records where each reminder's record starts, which in a journal that's only been added to follows from the live bytes
+    void WriteReminders(ToastScheduleJournal& journal, int first, int count, std::vector<std::uint64_t>* offsets = nullptr)
+    {
+        for (int i = first; i < first + count; i++)
+        {
+            if (offsets != nullptr)
+            {
+                offsets->push_back(HeaderSize + journal.GetStats().LiveBytes);
+            }
+            journal.Put(MakeReminder(i), Clock::duration::zero(), false);
+        }
+    }
+
+    // Opens the journal, loads it and restores a scheduler from it, as the compat layer does at startup, and reports the time taken
+    std::size_t TimeStartup(const char* name, const std::filesystem::path& path, const ToastScheduleJournalOptions& journalOptions,
+        ToastScheduleJournalStats& stats)
+    {
+        SteadyClock::time_point start = SteadyClock::now();
+        ToastScheduleJournal journal;
+        journal.Open(path, journalOptions);
+        stats = journal.GetStats();
+
+        std::vector<ToastJournalEntry> entries;
+        journal.Load(entries);
+
+        InMemoryNotificationPlatform platform;
+        ToastSchedulerOptions options;
+        options.BackgroundPump = false;
+        options.Now = [] { return Start; };
+        options.Journal = &journal;
+        ToastScheduler scheduler(platform, Aumid, options);
+        std::size_t restored = scheduler.Restore(std::move(entries));
+        ReportMilliseconds(name, MillisecondsSince(start));
+        return restored;
+    }
+
+    // A 10,000-toast schedule rewritten a hundred times over. Startup reads the live records and whatever dead ones
+    // compaction has let build up, which is never more than the live ones or CompactAfterDeadBytes
+    void CheckRewrittenStartup(const std::filesystem::path& directory, int& failures)
+    {
+        const int LiveCount = 10000;
+        std::filesystem::path fresh = directory / "fresh.journal";
+        std::filesystem::path rewritten = directory / "rewritten.journal";
+
+        ToastScheduleJournalOptions options;
+        options.CompactAfterDeadBytes = 4 << 20;
+        {
+            ToastScheduleJournal journal;
+            journal.Open(fresh, options);
+            WriteReminders(journal, 0, LiveCount);
+        }
+        {
+            ToastScheduleJournal journal;
+            journal.Open(rewritten, options);
+            for (int round = 0; round < 100; round++)
+            {
+                WriteReminders(journal, 0, LiveCount);
+            }
+        }
+
+        ToastScheduleJournalStats freshStats;
+        ToastScheduleJournalStats rewrittenStats;
+        std::size_t freshRestored = TimeStartup("Startup, 10,000 entries written once", fresh, options, freshStats);
+        std::size_t rewrittenRestored = TimeStartup("Startup, 10,000 entries written 100 times", rewritten, options, rewrittenStats);
+        Check(freshRestored == LiveCount && rewrittenRestored == LiveCount, "the 10,000-entry schedules weren't restored", failures);
+        Check(rewrittenStats.DeadBytes <= std::max<std::uint64_t>(rewrittenStats.LiveBytes, options.CompactAfterDeadBytes),
+            "startup read more of a rewritten journal's history than compaction allows", failures);
+    }
+
+    // Writes 100 reminders and flushes, then writes 100 more and copies the file while the journal is still open,
+    // since closing it would flush those too
+    std::vector<char> WriteCrashedJournal(const std::filesystem::path& path, std::vector<std::uint64_t>& offsets)
+    {
+        ToastScheduleJournal journal;
+        journal.Open(path);
+        WriteReminders(journal, 0, 100, &offsets);
+        journal.Flush();
+        WriteReminders(journal, 100, 100, &offsets);
+        offsets.push_back(HeaderSize + journal.GetStats().LiveBytes);
+        return ReadFile(path);
+    }
+
+    // Cuts the journal off at every point within its last few records, as if the writes after the cut never reached
+    // the disk, and checks that each copy opens with exactly the records that were complete before the cut
+    void CheckTornTail(const std::filesystem::path& directory, int& failures)
+    {
+        std::filesystem::path copy = directory / "torn-copy.journal";
+        std::vector<std::uint64_t> offsets;
+        std::vector<char> original = WriteCrashedJournal(directory / "torn.journal", offsets);
+
+        bool intact = true;
+        bool resurrected = false;
+        for (int last = 197; last < 200; last++)
+        {
+            for (std::uint64_t cut = offsets[last]; cut < offsets[last + 1]; cut++)
+            {
+                // Whatever was on the disk before stands in for the writes that didn't make it
+                std::vector<char> torn = original;
+                std::fill(torn.begin() + static_cast<std::ptrdiff_t>(cut), torn.end(), static_cast<char>(0xA5));
+                WriteFile(copy, torn);
+
+                ToastScheduleJournal journal;
+                if (!ToastSucceeded(journal.Open(copy)) || !HoldsReminders(journal, last))
+                {
+                    intact = false;
+                    continue;
+                }
+
+                // What the crash lost stays lost once new records are written where it was
+                journal.Put(MakeReminder(last), Clock::duration::zero(), false);
+                journal.Close();
+                journal.Open(copy);
+                resurrected |= !HoldsReminders(journal, last + 1);
+            }
+        }
+
+        Check(intact, "a torn journal didn't open with exactly its complete records", failures);
+        Check(!resurrected, "records from before a crash came back after it", failures);
+    }
+
+    void CheckCorruption(const std::filesystem::path& directory, int& failures)
+    {
+        std::filesystem::path copy = directory / "corrupt-copy.journal";
+        std::vector<std::uint64_t> offsets;
+        std::vector<char> original = WriteCrashedJournal(directory / "corrupt.journal", offsets);
+
+        // A flipped bit in a record written since the last flush ends the journal at that record
+        std::vector<char> corrupt = original;
+        corrupt[(offsets[150] + offsets[151]) / 2] ^= 0x10;
+        WriteFile(copy, corrupt);
+        {
+            ToastScheduleJournal journal;
+            Check(ToastSucceeded(journal.Open(copy)) && HoldsReminders(journal, 150) && journal.GetStats().Recovered,
+                "a corrupt record wasn't caught", failures);
+        }
+
+        // Records before the last flush are only checked if asked to
+        corrupt = original;
+        corrupt[(offsets[20] + offsets[21]) / 2] ^= 0x10;
+        WriteFile(copy, corrupt);
+        {
+            ToastScheduleJournalOptions options;
+            options.VerifyAll = true;
+            ToastScheduleJournal journal;
+            Check(ToastSucceeded(journal.Open(copy, options)) && HoldsReminders(journal, 20), "VerifyAll didn't catch a corrupt record", failures);
+        }
+
+        // Pages can reach the disk out of order, leaving a record missing with the one after it intact
+        corrupt = original;
+        std::fill(corrupt.begin() + static_cast<std::ptrdiff_t>(offsets[180]), corrupt.begin() + static_cast<std::ptrdiff_t>(offsets[181]), '\0');
+        WriteFile(copy, corrupt);
+        {
+            ToastScheduleJournal journal;
+            journal.Open(copy);
+            Check(HoldsReminders(journal, 180), "a journal missing a record didn't end there", failures);
+            journal.Put(MakeReminder(180), Clock::duration::zero(), false);
+            journal.Close();
+            journal.Open(copy);
+            Check(HoldsReminders(journal, 181), "a record after a missing one came back", failures);
+        }
+
+        // A file that isn't a journal is left alone
+        std::vector<char> notJournal(4096, 'x');
+        WriteFile(copy, notJournal);
+        {
+            ToastScheduleJournal journal;
+            Check(journal.Open(copy) == ToastResultFail && ReadFile(copy) == notJournal, "a file that isn't a journal was opened", failures);
+        }
+    }
+
+#if !defined(_WIN32)
+    // Kills a child process part way through writing, with no chance to flush or close, and checks the journal it leaves
+    void CheckKilledWriter(const std::filesystem::path& directory, int& failures)
+    {
+        std::filesystem::path path = directory / "killed.journal";
+        int pipeFds[2];
+        if (pipe(pipeFds) != 0)
+        {
+            return;
+        }
+
+        pid_t child = fork();
+        if (child == 0)
+        {
+            ToastScheduleJournal journal;
+            journal.Open(path);
+            WriteReminders(journal, 0, 1000);
+            journal.Flush();
+            WriteReminders(journal, 1000, 500);
+            char ready = 1;
+            (void)write(pipeFds[1], &ready, 1);
+            for (int i = 1500;; i++)
+            {
+                journal.Put(MakeReminder(i), Clock::duration::zero(), false);
+            }
+        }
+
+        char ready = 0;
+        (void)read(pipeFds[0], &ready, 1);
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+
+        ToastScheduleJournal journal;
+        std::vector<ToastJournalEntry> entries;
+        journal.Open(path);
+        journal.Load(entries);
+        int survived = static_cast<int>(entries.size());
+        Check(survived >= 1500 && HoldsReminders(journal, survived), "a killed writer's journal lost records or kept a torn one", failures);
+        std::printf("records surviving a killed writer: %d\n", survived);
+    }
+#endif
+
+    void CheckCompaction(const std::filesystem::path& directory, int& failures)
+    {
+        std::filesystem::path path = directory / "compact.journal";
+
+        ToastScheduleJournalOptions options;
+        options.InitialSize = 64 << 10;
+        options.CompactAfterDeadBytes = 256 << 10;
+
+        ToastScheduleJournal journal;
+        journal.Open(path, options);
+        for (int round = 0; round < 50; round++)
+        {
+            WriteReminders(journal, 0, 1000);
+        }
+        for (int i = 500; i < 1000; i++)
+        {
+            journal.Remove(std::to_wstring(i));
+        }
+
+        ToastScheduleJournalStats stats = journal.GetStats();
+        Check(stats.Compactions != 0 && stats.DeadBytes <= std::max<std::uint64_t>(stats.LiveBytes, options.CompactAfterDeadBytes),
+            "the journal didn't compact itself", failures);
+
+        journal.Compact();
+        Check(journal.GetStats().DeadBytes == 0 && HoldsReminders(journal, 500), "compaction lost or kept the wrong records", failures);
+        journal.Close();
+
+        journal.Open(path, options);
+        Check(HoldsReminders(journal, 500) && journal.Remove(L"500") == ToastResultNotFound, "a compacted journal didn't reopen", failures);
+        std::printf("file size after %llu compactions: %llu bytes\n", static_cast<unsigned long long>(stats.Compactions),
+            static_cast<unsigned long long>(std::filesystem::file_size(path)));
+    }
+
+    // A scheduler writing to a journal, then a new one restored from it after the first has handed some toasts off
+    void CheckSchedulerRestore(const std::filesystem::path& directory, int& failures)
+    {
+        std::filesystem::path path = directory / "scheduler.journal";
+        Clock::time_point now = Start;
+        InMemoryNotificationPlatform platform;
+
+        ToastScheduleJournal journal;
+        journal.Open(path);
+
+        ToastSchedulerOptions options;
+        options.BackgroundPump = false;
+        options.Now = [&] { return now; };
+        options.Journal = &journal;
+
+        {
+            ToastScheduler scheduler(platform, Aumid, options);
+            for (int i = 0; i < 100; i++)
+            {
+                ScheduledToast toast = MakeReminder(i);
+                toast.DeliveryTime = Start + std::chrono::minutes(i + 1);
+                scheduler.Schedule(toast);
+            }
+
+            ScheduledToast standup = MakeReminder(1000);
+            standup.DeliveryTime = Start + std::chrono::minutes(2);
+            scheduler.Schedule(standup, std::chrono::hours(1));
+            scheduler.Cancel(L"50");
+            scheduler.Pump();
+            Check(scheduler.HandedOffCount() == 6 && journal.GetStats().LiveCount == 100, "the journal didn't follow the scheduler", failures);
+        }
+
+        // The app is closed for three minutes, during which the platform delivers what it was handed
+        now += std::chrono::minutes(3);
+        platform.DeliverDue(now);
+        platform.ClearSchedule(Aumid);
+        journal.Close();
+
+        SteadyClock::time_point restoreStart = SteadyClock::now();
+        journal.Open(path);
+        std::vector<ToastJournalEntry> entries;
+        journal.Load(entries);
+        ToastScheduler scheduler(platform, Aumid, options);
+        std::size_t restored = scheduler.Restore(std::move(entries));
+
+        Check(restored == 97 && !scheduler.IsPending(L"0") && !scheduler.IsPending(L"2") && scheduler.IsPending(L"3") && scheduler.IsPending(L"1000"),
+            "the restored schedule didn't skip what the platform delivered", failures);
+        Check(journal.GetStats().LiveCount == 97, "the journal wasn't updated by the restore", failures);
+
+        now += std::chrono::hours(2);
+        scheduler.Pump();
+        platform.DeliverDue(now);
+        Check(platform.HistoryCount(Aumid) == 100 && scheduler.PendingCount() == 1, "the restored schedule wasn't delivered", failures);
+        ReportMilliseconds("Restore a 100-toast schedule", MillisecondsSince(restoreStart));
+    }
+}
+
+int main()
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "ToastScheduleJournalBenchmark";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::filesystem::path path = directory / "million.journal";
+    int failures = 0;
+
+    {
+        std::vector<ScheduledToast> toasts;
+        toasts.reserve(EntryCount);
+        for (int i = 0; i < EntryCount; i++)
+        {
+            toasts.push_back(MakeReminder(i));
+        }
+
+        ToastScheduleJournal journal;
+        journal.Open(path);
+        SteadyClock::time_point writeStart = SteadyClock::now();
+        for (const ScheduledToast& toast : toasts)
+        {
+            journal.Put(toast, Clock::duration::zero(), false);
+        }
+        journal.Flush();
+        double writeMilliseconds = MillisecondsSince(writeStart);
+        ReportBenchmark("Put, flushed at the end", writeMilliseconds * 1e6 / EntryCount, EntryCount);
+        std::printf("journal size: %llu bytes\n", static_cast<unsigned long long>(std::filesystem::file_size(path)));
+    }
+
+    // Startup: open the journal, load it and rebuild the schedule
+    {
+        SteadyClock::time_point openStart = SteadyClock::now();
+        ToastScheduleJournal journal;
+        journal.Open(path);
+        double openMilliseconds = MillisecondsSince(openStart);
+
+        SteadyClock::time_point loadStart = SteadyClock::now();
+        std::vector<ToastJournalEntry> entries;
+        journal.Load(entries);
+        double loadMilliseconds = MillisecondsSince(loadStart);
+
+        InMemoryNotificationPlatform platform;
+        ToastSchedulerOptions options;
+        options.BackgroundPump = false;
+        options.Now = [] { return Start; };
+        options.Journal = &journal;
+
+        SteadyClock::time_point restoreStart = SteadyClock::now();
+        ToastScheduler scheduler(platform, Aumid, options);
+        std::size_t restored = scheduler.Restore(std::move(entries));
+        double restoreMilliseconds = MillisecondsSince(restoreStart);
+
+        ReportMilliseconds("Open a million-entry journal", openMilliseconds);
+        ReportMilliseconds("Load a million entries", loadMilliseconds);
+        ReportMilliseconds("Restore a million entries into a scheduler", restoreMilliseconds);
+        ReportMilliseconds("Startup, a million entries", openMilliseconds + loadMilliseconds + restoreMilliseconds);
+        Check(restored == EntryCount && scheduler.PendingCount() == EntryCount && scheduler.IsPending(L"999999"), "the million-entry schedule wasn't restored", failures);
+    }
+
+    {
+        ToastScheduleJournalOptions options;
+        options.VerifyAll = true;
+        SteadyClock::time_point openStart = SteadyClock::now();
+        ToastScheduleJournal journal;
+        journal.Open(path, options);
+        ReportMilliseconds("Open a million-entry journal, checking every CRC", MillisecondsSince(openStart));
+        Check(journal.GetStats().LiveCount == EntryCount, "a full check of the million-entry journal failed", failures);
+    }
+
+    CheckRewrittenStartup(directory, failures);
+    CheckTornTail(directory, failures);
+    CheckCorruption(directory, failures);
+#if !defined(_WIN32)
+    CheckKilledWriter(directory, failures);
+#endif
+    CheckCompaction(directory, failures);
+    CheckSchedulerRestore(directory, failures);
+
+    {
+        ToastScheduleJournal journal;
+        journal.Open(directory / "churn.journal");
+        int next = 0;
+        ScheduledToast toast = MakeReminder(0);
+        RunBenchmark("Put replacing one of 1,000 entries", [&] {
+            toast.Id = std::to_wstring(next++ % 1000);
+            journal.Put(toast, Clock::duration::zero(), false);
+        });
+    }
+
+    std::filesystem::remove_all(directory);
+    return failures == 0 ? 0 : 1;
+}
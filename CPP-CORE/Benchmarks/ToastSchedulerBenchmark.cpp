@@ -0,0 +1,181 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Drives ToastScheduler with a virtual clock against the in-memory platform: schedules 100,000 reminders
+// over a week, runs the week a minute at a time, and checks that every reminder is delivered exactly once
+// while the platform's own schedule only ever holds the next few minutes. Also checks recurrence, group
+// cancellation, snoozing and falling back to local delivery, that Schedule and Cancel don't wait on a slow
+// hand-off, and that the background pump sleeps on a virtual clock, and times scheduling and cancelling.
+
+#include "Benchmark.h"
+#include "InMemoryNotificationPlatform.h"
+#include "ToastScheduler.h"
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+namespace
+{
+    using Clock = ToastScheduler::Clock;
+
+    const std::wstring Aumid = L"Contoso.Reminders";
+    const int ReminderCount = 100000;
+    const int ListCount = 100;
+    const std::chrono::seconds Week = std::chrono::hours(24 * 7);
+
+    // Reminders start an hour in, so none are already inside the platform window when the scheduler starts
+    const std::chrono::seconds Lead = std::chrono::hours(1);
+
+    ScheduledToast MakeReminder(const std::wstring& id, const std::wstring& group, Clock::time_point due)
+    {
+        ScheduledToast toast;
+        toast.Id = id;
+        toast.Payload.Xml = L"<toast launch=\"action=viewReminder&amp;id=" + id + L"\"><visual><binding template=\"ToastGeneric\"><text>Reminder</text></binding></visual></toast>";
+        toast.Payload.Tag = id;
+        toast.Payload.Group = group;
+        toast.DeliveryTime = due;
+        return toast;
+    }
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+}
+
+int main()
+{
+    Clock::time_point now = Clock::time_point(std::chrono::hours(24 * 365 * 56));
+    Clock::time_point start = now;
+
+    InMemoryNotificationPlatform platform;
+    platform.SetRecordShows(false);
+
+    ToastSchedulerOptions options;
+    options.BackgroundPump = false;
+    options.Now = [&] { return now; };
+    ToastScheduler scheduler(platform, Aumid, options);
+
+    int failures = 0;
+    for (int i = 0; i < ReminderCount; i++)
+    {
+        std::wstring id = std::to_wstring(i);
+        scheduler.Schedule(MakeReminder(id, L"list" + std::to_wstring(i % ListCount), start + Lead + Week * (i + 1) / (ReminderCount + 1)));
+    }
+    scheduler.Schedule(MakeReminder(L"standup", L"standup", start + std::chrono::minutes(30)), std::chrono::hours(1));
+
+    Check(scheduler.CancelGroup(L"list7") == ReminderCount / ListCount, "CancelGroup didn't cancel the whole list", failures);
+    Check(scheduler.Cancel(L"7") == ToastResultNotFound && scheduler.Cancel(L"8") == ToastResultOk, "Cancel got the wrong toasts", failures);
+
+    // Each minute, the scheduler hands off what's due in the next five and the platform delivers what's due now
+    std::size_t mostHandedOff = 0;
+    using SteadyClock = std::chrono::steady_clock;
+    SteadyClock::time_point simulationStart = SteadyClock::now();
+    while (now < start + Lead + Week)
+    {
+        now += std::chrono::minutes(1);
+        scheduler.Pump();
+        platform.DeliverDue(now);
+        mostHandedOff = std::max(mostHandedOff, platform.ScheduledCount(Aumid));
+    }
+    double simulationNanoseconds = std::chrono::duration<double, std::nano>(SteadyClock::now() - simulationStart).count();
+    ReportBenchmark("Pump a week of reminders, per reminder", simulationNanoseconds / ReminderCount, ReminderCount);
+
+    std::size_t expectedDelivered = ReminderCount - ReminderCount / ListCount - 1 + 1;
+    ToastSchedulerStats stats = scheduler.GetStats();
+    Check(platform.HistoryCount(Aumid) == expectedDelivered, "not every reminder was delivered once", failures);
+    Check(stats.HandedOff == expectedDelivered - 1 + 24 * 7 + 1, "the standup reminder didn't recur hourly", failures);
+    Check(stats.Shown == 0 && scheduler.PendingCount() == 1, "reminders were shown locally or left pending", failures);
+    Check(mostHandedOff <= 60, "the platform's schedule held more than the next few minutes", failures);
+    std::printf("most toasts in the platform's schedule at once: %zu\n", mostHandedOff);
+
+    // Snoozing a toast that's been handed off takes it back from the platform
+    scheduler.Schedule(MakeReminder(L"snooze", L"", now + std::chrono::minutes(2)));
+    scheduler.Pump();
+    Check(scheduler.HandedOffCount() == 1 && scheduler.Snooze(L"snooze", std::chrono::minutes(10)) == ToastResultOk &&
+        scheduler.HandedOffCount() == 0 && platform.ScheduledCount(Aumid) == 0, "snoozing didn't retract the hand-off", failures);
+    scheduler.Cancel(L"snooze");
+
+    // A failed hand-off falls back to showing the toast locally, on time
+    platform.SetFailure(InMemoryPlatformOperation::Schedule, ToastResultFail);
+    scheduler.Schedule(MakeReminder(L"local", L"", now + std::chrono::seconds(90)));
+    scheduler.Pump();
+    now += std::chrono::seconds(89);
+    scheduler.Pump();
+    Check(platform.ShowCount() == 0, "a toast was shown early", failures);
+    now += std::chrono::seconds(1);
+    scheduler.Pump();
+    Check(platform.ShowCount() == 1 && !scheduler.IsPending(L"local"), "a failed hand-off wasn't shown locally", failures);
+    platform.SetFailure(InMemoryPlatformOperation::Schedule, ToastResultOk);
+
+    // Schedule and Cancel don't wait for a slow hand-off, and a toast cancelled while it's being handed off is still
+    // taken back out of the platform's schedule afterwards
+    {
+        using SteadyClock = std::chrono::steady_clock;
+        InMemoryNotificationPlatform slowPlatform;
+        slowPlatform.SetLatency(InMemoryPlatformOperation::Schedule, std::chrono::milliseconds(300));
+        ToastScheduler slowScheduler(slowPlatform, Aumid, options);
+
+        slowScheduler.Schedule(MakeReminder(L"slow", L"", now + std::chrono::minutes(2)));
+        std::thread pump([&slowScheduler] { slowScheduler.Pump(); });
+        while (slowScheduler.HandedOffCount() == 0)
+        {
+            std::this_thread::yield();
+        }
+
+        SteadyClock::time_point calls = SteadyClock::now();
+        slowScheduler.Schedule(MakeReminder(L"other", L"", now + std::chrono::hours(2)));
+        Check(slowScheduler.Cancel(L"slow") == ToastResultOk, "a toast being handed off couldn't be cancelled", failures);
+        Check(SteadyClock::now() - calls < std::chrono::milliseconds(150), "Schedule and Cancel waited for a hand-off", failures);
+
+        pump.join();
+        Check(slowPlatform.ScheduledCount(Aumid) == 0 && slowScheduler.HandedOffCount() == 0, "a toast cancelled mid hand-off was left in the platform's schedule", failures);
+    }
+
+    // The background pump sleeps in real time for what's left on a virtual clock rather than spinning
+    {
+        InMemoryNotificationPlatform pumpPlatform;
+        std::atomic<int> clockReads{ 0 };
+        ToastSchedulerOptions pumpOptions;
+        pumpOptions.Now = [&clockReads, now] { clockReads++; return now; };
+        ToastScheduler pumpScheduler(pumpPlatform, Aumid, pumpOptions);
+
+        pumpScheduler.Schedule(MakeReminder(L"later", L"", now + std::chrono::hours(1)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        Check(clockReads < 100, "the background pump spun on a virtual clock", failures);
+    }
+
+    for (int i = 0; i < ReminderCount; i++)
+    {
+        scheduler.Schedule(MakeReminder(std::to_wstring(i), L"list", now + std::chrono::hours(1) + Week * i / ReminderCount));
+    }
+
+    int next = 0;
+    ScheduledToast toast = MakeReminder(L"churn", L"list", now + std::chrono::hours(3));
+    RunBenchmark("Schedule + Cancel, 100k pending", [&] {
+        toast.Id = std::to_wstring(ReminderCount + next++ % 1024);
+        scheduler.Schedule(toast);
+        scheduler.Cancel(toast.Id);
+    });
+
+    RunBenchmark("Schedule replacing a pending toast, 100k pending", [&] {
+        toast.Id = std::to_wstring(next++ % ReminderCount);
+        scheduler.Schedule(toast);
+    });
+
+    return failures == 0 ? 0 : 1;
+}
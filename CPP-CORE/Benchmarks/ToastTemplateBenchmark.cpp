@@ -0,0 +1,134 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Checks that ToastTemplate renders the samples' conversation toast with its values escaped for text and for
+// attributes, then times parsing the template, rendering it, and the find-and-replace over the whole XML that
+// filling text and attribute values one at a time amounts to.
+
+#include "Benchmark.h"
+#include "ToastTemplate.h"
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    const wchar_t ConversationTemplate[] = LR"(<toast launch="action=viewConversation&amp;conversationId={conversationId}">
+    <visual>
+        <binding template="ToastGeneric">
+            <text>{title}</text>
+            <text>{body}</text>
+            <image placement="appLogoOverride" hint-crop="circle" src="{logoSrc}"/>
+            <image src="{imageSrc}"/>
+        </binding>
+    </visual>
+    <actions>
+        <input id="tbReply" type="text" placeHolderContent="Type a reply"/>
+        <action content="Reply" activationType="background" arguments="action=reply&amp;conversationId={conversationId}"/>
+        <action content="Like" activationType="background" arguments="action=like&amp;conversationId={conversationId}"/>
+        <action content="View" activationType="background" arguments="action=viewImage&amp;imageUrl={imageSrc}"/>
+    </actions>
+</toast>)";
+
+    const std::pair<const wchar_t*, const wchar_t*> Values[] =
+    {
+        { L"conversationId", L"9813" },
+        { L"title", L"Andrew sent you a picture" },
+        { L"body", L"Check this out, Happy Canyon in Utah!" },
+        { L"logoSrc", L"https://unsplash.it/64?image=1005" },
+        { L"imageSrc", L"https://picsum.photos/364/202?image=883" }
+    };
+
+    // Searches the whole document for every placeholder each time, the way setting each value separately does
+    std::wstring FindAndReplace(std::wstring xml)
+    {
+        for (const auto& value : Values)
+        {
+            std::wstring placeholder = std::wstring(L"{") + value.first + L"}";
+            std::wstring escaped;
+            AppendEscapedXml(escaped, value.second, ToastTemplateSlotKind::Attribute);
+            for (std::size_t position = xml.find(placeholder); position != std::wstring::npos; position = xml.find(placeholder, position + escaped.size()))
+            {
+                xml.replace(position, placeholder.size(), escaped);
+            }
+        }
+        return xml;
+    }
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+}
+
+int main()
+{
+    int failures = 0;
+    ToastTemplate conversationTemplate(ConversationTemplate);
+    Check(conversationTemplate.FieldCount() == 5 && conversationTemplate.Slots().size() == 8, "the template's fields weren't all found", failures);
+
+    ToastTemplateValues values = conversationTemplate.CreateValues();
+    for (const auto& value : Values)
+    {
+        values.Set(value.first, value.second);
+    }
+    std::wstring rendered = conversationTemplate.Render(values);
+    Check(rendered == FindAndReplace(ConversationTemplate), "rendering doesn't match filling in each value", failures);
+
+    // Text escapes what would end it; attributes also escape quotes
+    ToastTemplate escaping(LR"(<toast launch="{value}"><text>{value}</text></toast>)");
+    Check(escaping.Render({ L"Tom & \"Jerry\" <3" }) == LR"(<toast launch="Tom &amp; &quot;Jerry&quot; &lt;3"><text>Tom &amp; "Jerry" &lt;3</text></toast>)",
+        "values weren't escaped for where they're spliced in", failures);
+
+    ToastTemplate braces(LR"(<toast launch="{{id}}={id}"><text>{{{{x}}}} {title}}</text></toast>)");
+    Check(braces.Render({ L"7", L"Hi" }) == LR"(<toast launch="{id}=7"><text>{{x}} Hi}</text></toast>)", "escaped braces weren't unescaped", failures);
+
+    bool rejected = false;
+    try
+    {
+        ToastTemplate malformed(L"<toast><text>{title}</toast>");
+    }
+    catch (const std::invalid_argument&)
+    {
+        rejected = true;
+    }
+    Check(rejected, "a malformed template was accepted", failures);
+
+    RunBenchmark("Parse the conversation template", [&] {
+        ToastTemplate parsed(ConversationTemplate);
+        DoNotOptimize(parsed);
+    });
+
+    RunBenchmark("Render the conversation template", [&] {
+        std::wstring xml = conversationTemplate.Render(values);
+        DoNotOptimize(xml);
+    });
+
+    std::wstring buffer;
+    RunBenchmark("RenderTo, reusing the buffer", [&] {
+        conversationTemplate.RenderTo(values.Data(), values.Size(), buffer);
+        DoNotOptimize(buffer);
+    });
+
+    RunBenchmark("Find and replace each value (old)", [&] {
+        std::wstring xml = FindAndReplace(ConversationTemplate);
+        DoNotOptimize(xml);
+    });
+
+    return failures == 0 ? 0 : 1;
+}
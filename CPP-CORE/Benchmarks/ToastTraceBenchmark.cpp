@@ -0,0 +1,160 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Checks that correlation IDs are stamped into the launch and app-activating action arguments of a toast and
+// taken back out of the activation arguments exactly, then records build, show and activate spans for 10,000
+// toasts from four threads and checks every span is collected, every toast's show is joined to its activation
+// and the Chrome trace holds one event per span. Then times recording a span, stamping and taking the ID.
+
+#include "Benchmark.h"
+#include "ToastTrace.h"
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const wchar_t Conversation[] =
+        L"<toast launch=\"action=viewConversation&amp;conversationId=9813\"><visual><binding template=\"ToastGeneric\">"
+        L"<text>Andrew sent you a picture</text></binding></visual><actions>"
+        L"<action content=\"Reply\" activationType=\"background\" arguments=\"action=reply&amp;conversationId=9813\"/>"
+        L"<action content=\"Open\" activationType=\"protocol\" arguments=\"https://contoso.com/9813\"/>"
+        L"<action content=\"\" activationType=\"system\" arguments=\"dismiss\"/>"
+        L"</actions></toast>";
+
+    const wchar_t StampedConversation[] =
+        L"<toast launch=\"action=viewConversation&amp;conversationId=9813&amp;toastTraceId=1f\"><visual><binding template=\"ToastGeneric\">"
+        L"<text>Andrew sent you a picture</text></binding></visual><actions>"
+        L"<action content=\"Reply\" activationType=\"background\" arguments=\"action=reply&amp;conversationId=9813&amp;toastTraceId=1f\"/>"
+        L"<action content=\"Open\" activationType=\"protocol\" arguments=\"https://contoso.com/9813\"/>"
+        L"<action content=\"\" activationType=\"system\" arguments=\"dismiss\"/>"
+        L"</actions></toast>";
+
+    const int ThreadCount = 4;
+    const int ToastsPerThread = 2500;
+
+    void Check(bool condition, const char* message, int& failures)
+    {
+        if (!condition)
+        {
+            std::printf("%s\n", message);
+            failures++;
+        }
+    }
+
+#if TOAST_TRACING
+    std::size_t CountOf(const std::string& text, const std::string& pattern)
+    {
+        std::size_t count = 0;
+        for (std::size_t position = text.find(pattern); position != std::string::npos; position = text.find(pattern, position + 1))
+        {
+            count++;
+        }
+        return count;
+    }
+#endif
+}
+
+int main()
+{
+    int failures = 0;
+
+    std::wstring xml = Conversation;
+    AddToastTraceId(xml, 0x1f);
+    Check(xml == StampedConversation, "the ID wasn't stamped into exactly the launch and app-activating actions", failures);
+
+    xml = L"<toast><visual/></toast>";
+    AddToastTraceId(xml, 0xabc);
+    Check(xml == L"<toast launch=\"toastTraceId=abc\"><visual/></toast>", "a toast without launch arguments wasn't given some", failures);
+
+    std::wstring_view arguments = L"action=reply&conversationId=9813&toastTraceId=1f";
+    Check(TakeToastTraceId(arguments) == 0x1f && arguments == L"action=reply&conversationId=9813", "the ID wasn't taken from the arguments", failures);
+    arguments = L"toastTraceId=ffffffffffffffff";
+    Check(TakeToastTraceId(arguments) == ~0ull && arguments.empty(), "the ID wasn't taken from arguments of its own", failures);
+    arguments = L"action=reply&toastTraceId=xyz";
+    Check(TakeToastTraceId(arguments) == 0 && arguments == L"action=reply&toastTraceId=xyz", "arguments without a valid ID were changed", failures);
+
+#if TOAST_TRACING
+    ToastTracerOptions options;
+    options.PerThreadCapacity = ToastsPerThread * 3;
+    ToastTracer tracer(options);
+
+    // Each thread builds, shows and activates its own toasts, a microsecond apart
+    std::vector<std::thread> threads;
+    for (int t = 0; t < ThreadCount; t++)
+    {
+        threads.emplace_back([&tracer] {
+            for (int i = 0; i < ToastsPerThread; i++)
+            {
+                std::int64_t start = ToastTracer::Now();
+                std::uint64_t correlationId = tracer.NewCorrelationId();
+                tracer.Record(ToastTraceBuild, correlationId, start, start + 1000);
+                tracer.Record(ToastTraceShow, correlationId, start + 1000, start + 3000);
+                tracer.Record(ToastTraceActivate, correlationId, start + 10000, start + 11000);
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    ToastTracerStats stats = tracer.GetStats();
+    Check(stats.Recorded == ThreadCount * ToastsPerThread * 3 && stats.Dropped == 0 && stats.Threads == ThreadCount, "not every span was recorded", failures);
+
+    std::vector<ToastTraceLatency> latencies = tracer.ShowToActivateLatencies();
+    bool joined = latencies.size() == ThreadCount * ToastsPerThread;
+    for (const ToastTraceLatency& latency : latencies)
+    {
+        joined = joined && latency.BuildNanoseconds == 1000 && latency.ShowNanoseconds == 2000 && latency.ShowToActivateNanoseconds == 7000;
+    }
+    Check(joined, "shows weren't joined to their activations", failures);
+
+    std::string trace = tracer.ExportChromeTrace();
+    Check(CountOf(trace, "\"ph\":\"X\"") == stats.Recorded && CountOf(trace, "\"ph\":\"s\"") == ThreadCount * ToastsPerThread &&
+        CountOf(trace, "\"ph\":\"f\"") == ThreadCount * ToastsPerThread, "the Chrome trace doesn't hold every span and flow", failures);
+    tracer.Clear();
+
+    // Collect as it goes, like an app exporting now and then, so the per-thread buffer never fills
+    int recorded = 0;
+    RunBenchmark("ToastTraceScope, recorded", [&] {
+        ToastTraceScope scope(&tracer, ToastTraceShow);
+        DoNotOptimize(scope.CorrelationId());
+        if (++recorded % 1024 == 0)
+        {
+            tracer.Clear();
+        }
+    });
+#else
+    std::printf("tracing is compiled out\n");
+#endif
+
+    RunBenchmark("ToastTraceScope, no tracer", [&] {
+        ToastTraceScope scope(nullptr, ToastTraceShow);
+        DoNotOptimize(scope.CorrelationId());
+    });
+
+    std::uint64_t correlationId = 0x5eed0000;
+    RunBenchmark("AddToastTraceId, conversation toast", [&] {
+        xml = Conversation;
+        AddToastTraceId(xml, correlationId++);
+        DoNotOptimize(xml.data());
+    });
+
+    RunBenchmark("TakeToastTraceId", [&] {
+        std::wstring_view stamped = L"action=reply&conversationId=9813&toastTraceId=5eed1234";
+        DoNotOptimize(TakeToastTraceId(stamped));
+    });
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ActivationBus.h"
+#include <thread>
+#include "ToastArguments.h"
+
+ActivationBus::ActivationBus()
+{
+    Replace(std::make_shared<Snapshot>());
+}
+
+ActivationSubscription ActivationBus::Subscribe(Handler handler, std::wstring action)
+{
+    auto subscriber = std::make_shared<Subscriber>();
+    subscriber->Action = std::move(action);
+    subscriber->OnActivated = std::move(handler);
+
+    std::lock_guard<std::mutex> lock(m_writerMutex);
+    subscriber->Id = m_nextId++;
+
+    auto next = std::make_shared<Snapshot>();
+    next->Subscribers = m_owned->Subscribers;
+    next->Subscribers.push_back(subscriber);
+
+    Replace(std::move(next));
+    return subscriber->Id;
+}
+
+bool ActivationBus::Unsubscribe(ActivationSubscription subscription)
+{
+    std::lock_guard<std::mutex> lock(m_writerMutex);
+
+    auto next = std::make_shared<Snapshot>();
+    next->Subscribers.reserve(m_owned->Subscribers.size());
+    for (const auto& subscriber : m_owned->Subscribers)
+    {
+        if (subscriber->Id != subscription)
+        {
+            next->Subscribers.push_back(subscriber);
+        }
+    }
+
+    if (next->Subscribers.size() == m_owned->Subscribers.size())
+    {
+        return false;
+    }
+
+    Replace(std::move(next));
+    return true;
+}
+
+std::size_t ActivationBus::Publish(const ActivationEventArgs& args) const
+{
+    std::size_t failed = 0;
+    return Publish(args, failed);
+}
+
+std::size_t ActivationBus::Publish(const ActivationEventArgs& args, std::size_t& failed) const
+{
+    failed = 0;
+    std::shared_ptr<const Snapshot> snapshot = Acquire();
+    if (snapshot->Subscribers.empty())
+    {
+        return 0;
+    }
+
+    std::wstring_view action = ToastArguments(args.Argument()).Action();
+
+    std::size_t called = 0;
+    for (const auto& subscriber : snapshot->Subscribers)
+    {
+        if (subscriber->Action.empty() || subscriber->Action == action)
+        {
+            // One subscriber failing mustn't keep the activation from the others
+            try
+            {
+                subscriber->OnActivated(args);
+            }
+            catch (...)
+            {
+                failed++;
+            }
+            called++;
+        }
+    }
+    return called;
+}
+
+std::size_t ActivationBus::SubscriberCount() const
+{
+    return Acquire()->Subscribers.size();
+}
+
+std::shared_ptr<const ActivationBus::Snapshot> ActivationBus::Acquire() const
+{
+    for (;;)
+    {
+        std::uint64_t epoch = m_epoch.load();
+        ReaderCount& readers = m_readers[epoch & 1];
+        readers.Count.fetch_add(1);
+
+        // If a writer moved the epoch on in between, it may not have seen this count; start again in the new one
+        if (m_epoch.load() == epoch)
+        {
+            std::shared_ptr<const Snapshot> snapshot = m_current.load()->shared_from_this();
+            readers.Count.fetch_sub(1, std::memory_order_release);
+            return snapshot;
+        }
+        readers.Count.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void ActivationBus::Replace(std::shared_ptr<Snapshot> next)
+{
+    std::shared_ptr<const Snapshot> previous = std::move(m_owned);
+    m_owned = std::move(next);
+    m_current.store(m_owned.get());
+
+    // Publishers that start from here on see the new snapshot. Those counted under the old epoch may have loaded the
+    // previous pointer, so it's kept until each has taken its own reference or moved on.
+    std::uint64_t epoch = m_epoch.fetch_add(1);
+    while (m_readers[epoch & 1].Count.load(std::memory_order_acquire) != 0)
+    {
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,99 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ActivationEventArgs.h"
+
+/// <summary>
+/// Identifies a subscription to an ActivationBus. Zero is never a subscription.
+/// </summary>
+using ActivationSubscription = std::uint64_t;
+
+/// <summary>
+/// Hands each activation to every subscriber, or to those filtered on its "action" argument. Publish reads an
+/// immutable snapshot of the subscribers and never takes a lock, so the COM threads that deliver activations
+/// don't wait on each other or on Subscribe. Subscribe and Unsubscribe copy the list, publish the copy, and
+/// wait for publishers still reading the old pointer to take their reference to it (a few instructions, never
+/// a handler call) before letting it go.
+///
+/// Handlers run on the publishing thread, and may subscribe and unsubscribe, including themselves. Once Unsubscribe
+/// returns, no Publish that starts afterwards calls the handler, but one already under way still may.
+/// </summary>
+class ActivationBus
+{
+public:
+    using Handler = std::function<void(const ActivationEventArgs&)>;
+
+    ActivationBus();
+
+    ActivationBus(const ActivationBus&) = delete;
+    ActivationBus& operator=(const ActivationBus&) = delete;
+
+    /// <summary>
+    /// Adds a handler for every activation, or only for those whose "action" argument is action when it isn't empty.
+    /// </summary>
+    ActivationSubscription Subscribe(Handler handler, std::wstring action = std::wstring());
+
+    /// <summary>
+    /// Returns false if the subscription had already been removed.
+    /// </summary>
+    bool Unsubscribe(ActivationSubscription subscription);
+
+    /// <summary>
+    /// Calls the matching handlers, in the order they subscribed, and returns how many were called. A handler that
+    /// throws is counted in failed, and the rest are still called.
+    /// </summary>
+    std::size_t Publish(const ActivationEventArgs& args, std::size_t& failed) const;
+    std::size_t Publish(const ActivationEventArgs& args) const;
+
+    std::size_t SubscriberCount() const;
+
+private:
+    struct Subscriber
+    {
+        ActivationSubscription Id;
+        std::wstring Action;
+        Handler OnActivated;
+    };
+
+    struct Snapshot : std::enable_shared_from_this<Snapshot>
+    {
+        std::vector<std::shared_ptr<const Subscriber>> Subscribers;
+    };
+
+    // Publishers count themselves in the slot for the epoch they started in, so a writer only waits for the ones
+    // that might have seen the snapshot it replaced
+    struct alignas(64) ReaderCount
+    {
+        std::atomic<std::uint64_t> Count{ 0 };
+    };
+
+    std::shared_ptr<const Snapshot> Acquire() const;
+    void Replace(std::shared_ptr<Snapshot> next);
+
+    std::atomic<const Snapshot*> m_current{ nullptr };
+    std::atomic<std::uint64_t> m_epoch{ 0 };
+    mutable ReaderCount m_readers[2];
+
+    // Writers only: the owning reference to the current snapshot, and the next subscription's ID
+    std::mutex m_writerMutex;
+    std::shared_ptr<const Snapshot> m_owned;
+    ActivationSubscription m_nextId = 1;
+};
@@ -0,0 +1,190 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ActivationEventArgs.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    // The index stores entry positions plus one in 16 bits, zero meaning an empty slot
+    constexpr std::size_t MaxUserInputCount = 0xFFFF;
+
+    std::uint32_t HashKey(std::wstring_view key)
+    {
+        std::uint32_t hash = 2166136261u;
+        for (wchar_t c : key)
+        {
+            hash ^= static_cast<std::uint16_t>(c);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    std::size_t AlignUp(std::size_t size, std::size_t alignment)
+    {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+}
+
+ActivationEventArgs::ActivationEventArgs(ActivationEventArgs&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+ActivationEventArgs& ActivationEventArgs::operator=(ActivationEventArgs&& other) noexcept
+{
+    if (this != &other)
+    {
+        m_arena = std::move(other.m_arena);
+        m_entries = std::exchange(other.m_entries, nullptr);
+        m_characters = std::exchange(other.m_characters, nullptr);
+        m_index = std::exchange(other.m_index, nullptr);
+        m_argumentLength = std::exchange(other.m_argumentLength, 0);
+        m_userInputCount = std::exchange(other.m_userInputCount, 0);
+        m_characterCount = std::exchange(other.m_characterCount, 0);
+        m_indexMask = std::exchange(other.m_indexMask, 0);
+    }
+    return *this;
+}
+
+ActivationEventArgs ActivationEventArgs::Clone() const
+{
+    ActivationEventArgs copy;
+    copy.Allocate(Argument(), m_userInputCount, m_characterCount);
+
+    // The counts are the same, so the layout is too, and the entries, characters and index come across as they are
+    if (m_userInputCount > 0)
+    {
+        std::copy(m_entries, m_entries + m_userInputCount, copy.m_entries);
+        std::copy(m_characters, m_characters + m_characterCount, copy.m_characters);
+        std::copy(m_index, m_index + m_indexMask + 1, copy.m_index);
+        copy.m_userInputCount = m_userInputCount;
+        copy.m_characterCount = m_characterCount;
+    }
+    return copy;
+}
+
+void ActivationEventArgs::Allocate(std::wstring_view argument, std::size_t userInputCount, std::size_t characterCount)
+{
+    if (userInputCount > MaxUserInputCount || characterCount > UINT32_MAX)
+    {
+        throw std::length_error("Activation has too much user input");
+    }
+
+    if (characterCount == 0 && userInputCount == 0)
+    {
+        return;
+    }
+
+    // Twice as many slots as entries keeps probe sequences to a slot or two
+    std::size_t indexSize = 0;
+    if (userInputCount > 0)
+    {
+        indexSize = 1;
+        while (indexSize < userInputCount * 2)
+        {
+            indexSize <<= 1;
+        }
+    }
+
+    std::size_t charactersStart = AlignUp(sizeof(Entry) * userInputCount, alignof(wchar_t));
+    std::size_t indexStart = AlignUp(charactersStart + sizeof(wchar_t) * characterCount, alignof(std::uint16_t));
+    std::size_t arenaSize = indexStart + sizeof(std::uint16_t) * indexSize;
+
+    m_arena.reset(new unsigned char[arenaSize]);
+    m_entries = reinterpret_cast<Entry*>(m_arena.get());
+    m_characters = reinterpret_cast<wchar_t*>(m_arena.get() + charactersStart);
+    m_index = reinterpret_cast<std::uint16_t*>(m_arena.get() + indexStart);
+    m_indexMask = indexSize - 1;
+
+    argument.copy(m_characters, argument.size());
+    m_argumentLength = argument.size();
+    m_characterCount = argument.size();
+}
+
+void ActivationEventArgs::Append(std::wstring_view key, std::wstring_view value)
+{
+    Entry& entry = m_entries[m_userInputCount++];
+
+    entry.KeyOffset = static_cast<std::uint32_t>(m_characterCount);
+    entry.KeyLength = static_cast<std::uint32_t>(key.size());
+    key.copy(m_characters + m_characterCount, key.size());
+    m_characterCount += key.size();
+
+    entry.ValueOffset = static_cast<std::uint32_t>(m_characterCount);
+    entry.ValueLength = static_cast<std::uint32_t>(value.size());
+    value.copy(m_characters + m_characterCount, value.size());
+    m_characterCount += value.size();
+}
+
+void ActivationEventArgs::BuildIndex()
+{
+    if (m_userInputCount == 0)
+    {
+        return;
+    }
+
+    for (std::size_t slot = 0; slot <= m_indexMask; slot++)
+    {
+        m_index[slot] = 0;
+    }
+
+    for (std::size_t i = 0; i < m_userInputCount; i++)
+    {
+        std::wstring_view key = UserInputAt(i).Key;
+        std::size_t slot = HashKey(key) & m_indexMask;
+        while (m_index[slot] != 0)
+        {
+            // If the platform ever repeats a key, the first one wins, as it does for lookups in a scan
+            if (UserInputAt(m_index[slot] - 1).Key == key)
+            {
+                break;
+            }
+            slot = (slot + 1) & m_indexMask;
+        }
+
+        if (m_index[slot] == 0)
+        {
+            m_index[slot] = static_cast<std::uint16_t>(i + 1);
+        }
+    }
+}
+
+ActivationUserInput ActivationEventArgs::UserInputAt(std::size_t index) const
+{
+    const Entry& entry = m_entries[index];
+    return {
+        std::wstring_view(m_characters + entry.KeyOffset, entry.KeyLength),
+        std::wstring_view(m_characters + entry.ValueOffset, entry.ValueLength)
+    };
+}
+
+bool ActivationEventArgs::TryGetUserInput(std::wstring_view key, std::wstring_view& value) const
+{
+    if (m_userInputCount == 0)
+    {
+        return false;
+    }
+
+    for (std::size_t slot = HashKey(key) & m_indexMask; m_index[slot] != 0; slot = (slot + 1) & m_indexMask)
+    {
+        ActivationUserInput input = UserInputAt(m_index[slot] - 1);
+        if (input.Key == key)
+        {
+            value = input.Value;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,130 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+/// <summary>
+/// One of the user inputs (text box or selection) that came with an activation.
+/// </summary>
+struct ActivationUserInput
+{
+    std::wstring_view Key;
+    std::wstring_view Value;
+};
+
+/// <summary>
+/// The arguments and user input of a toast activation, copied into a single allocation. Keys and values
+/// are exposed as views into that allocation, user input is found through a small hash index built in
+/// the same block, and the object is moved rather than copied, so handing it to a handler never touches
+/// the heap again. Views stay valid for as long as the object (or whatever it's moved into) lives.
+/// </summary>
+class ActivationEventArgs
+{
+public:
+    ActivationEventArgs() = default;
+
+    /// <summary>
+    /// Copies the argument and user input. TUserInput is anything with Key and Value members that convert to
+    /// a wstring_view or are null-terminated strings, such as NOTIFICATION_USER_INPUT_DATA or ActivationUserInput.
+    /// </summary>
+    template <typename TUserInput>
+    ActivationEventArgs(std::wstring_view argument, const TUserInput* userInput, std::size_t userInputCount)
+    {
+        std::size_t characterCount = argument.size();
+        for (std::size_t i = 0; i < userInputCount; i++)
+        {
+            characterCount += ToView(userInput[i].Key).size() + ToView(userInput[i].Value).size();
+        }
+
+        Allocate(argument, userInputCount, characterCount);
+        for (std::size_t i = 0; i < userInputCount; i++)
+        {
+            Append(ToView(userInput[i].Key), ToView(userInput[i].Value));
+        }
+        BuildIndex();
+    }
+
+    explicit ActivationEventArgs(std::wstring_view argument) :
+        ActivationEventArgs(argument, static_cast<const ActivationUserInput*>(nullptr), 0)
+    {
+    }
+
+    ActivationEventArgs(ActivationEventArgs&& other) noexcept;
+    ActivationEventArgs& operator=(ActivationEventArgs&& other) noexcept;
+
+    ActivationEventArgs(const ActivationEventArgs&) = delete;
+    ActivationEventArgs& operator=(const ActivationEventArgs&) = delete;
+
+    /// <summary>
+    /// Copies the whole block in one allocation, for a handler that needs args of its own to keep or move on.
+    /// </summary>
+    ActivationEventArgs Clone() const;
+
+    std::wstring_view Argument() const
+    {
+        return std::wstring_view(m_characters, m_argumentLength);
+    }
+
+    std::size_t UserInputCount() const { return m_userInputCount; }
+
+    /// <summary>
+    /// User input in the order the platform supplied it.
+    /// </summary>
+    ActivationUserInput UserInputAt(std::size_t index) const;
+
+    /// <summary>
+    /// Finds the value of the user input with this key (the id of its input element). Returns false if there isn't one.
+    /// </summary>
+    bool TryGetUserInput(std::wstring_view key, std::wstring_view& value) const;
+
+    /// <summary>
+    /// The value of the user input with this key, or an empty view if there isn't one.
+    /// </summary>
+    std::wstring_view UserInput(std::wstring_view key) const
+    {
+        std::wstring_view value;
+        TryGetUserInput(key, value);
+        return value;
+    }
+
+private:
+    // Offsets and lengths are in characters from the start of the character block
+    struct Entry
+    {
+        std::uint32_t KeyOffset;
+        std::uint32_t KeyLength;
+        std::uint32_t ValueOffset;
+        std::uint32_t ValueLength;
+    };
+
+    static std::wstring_view ToView(std::wstring_view value) { return value; }
+    static std::wstring_view ToView(const wchar_t* value) { return value != nullptr ? std::wstring_view(value) : std::wstring_view(); }
+
+    void Allocate(std::wstring_view argument, std::size_t userInputCount, std::size_t characterCount);
+    void Append(std::wstring_view key, std::wstring_view value);
+    void BuildIndex();
+
+    // The arena holds the entries, then the characters of the argument, keys and values, then the index
+    std::unique_ptr<unsigned char[]> m_arena;
+    Entry* m_entries = nullptr;
+    wchar_t* m_characters = nullptr;
+    std::uint16_t* m_index = nullptr;
+
+    std::size_t m_argumentLength = 0;
+    std::size_t m_userInputCount = 0;
+    std::size_t m_characterCount = 0;
+    std::size_t m_indexMask = 0;
+};
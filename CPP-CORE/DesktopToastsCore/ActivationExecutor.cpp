@@ -0,0 +1,255 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ActivationExecutor.h"
+#include "ToastMetrics.h"
+
+namespace
+{
+    // The executor whose worker is running on this thread, so that calls from a handler can tell
+    thread_local const ActivationExecutor* t_workerOf = nullptr;
+}
+
+ActivationExecutor::ActivationExecutor(ActivationExecutorOptions options) :
+    m_options(std::move(options))
+{
+    if (m_options.WorkerCount == 0)
+    {
+        m_options.WorkerCount = 1;
+    }
+    if (m_options.Capacity == 0)
+    {
+        m_options.Capacity = 1;
+    }
+
+    m_workers.reserve(m_options.WorkerCount);
+    for (std::size_t i = 0; i < m_options.WorkerCount; i++)
+    {
+        m_workers.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+ActivationExecutor::~ActivationExecutor()
+{
+    Shutdown(true);
+
+    // Only reached from a handler when it ends the process (say, by calling exit), which nothing can wait for
+    for (std::thread& worker : m_workers)
+    {
+        worker.detach();
+    }
+}
+
+ActivationSubmitResult ActivationExecutor::Submit(std::wstring orderingKey, Handler handler)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (m_accepting && m_queued >= m_options.Capacity)
+    {
+        if (m_options.Overflow == ActivationOverflowPolicy::Reject)
+        {
+            m_rejected++;
+            return ActivationSubmitResult::Rejected;
+        }
+
+        m_spaceAvailable.wait(lock);
+    }
+
+    if (!m_accepting)
+    {
+        return ActivationSubmitResult::ShutDown;
+    }
+
+    m_submitted++;
+    m_queued++;
+
+    if (m_options.Metrics != nullptr)
+    {
+        m_options.Metrics->RecordQueueDepth(ToastMetricsQueue::Activation, m_queued);
+    }
+
+    if (orderingKey.empty())
+    {
+        m_ready.push_back({ std::move(handler), nullptr });
+    }
+    else
+    {
+        auto inserted = m_strands.try_emplace(std::move(orderingKey));
+        if (!inserted.second)
+        {
+            // Something with this key is already ready or running; it hands over to us when it's done
+            inserted.first->second.push_back(std::move(handler));
+            return ActivationSubmitResult::Queued;
+        }
+
+        m_ready.push_back({ std::move(handler), &*inserted.first });
+    }
+
+    lock.unlock();
+    m_workAvailable.notify_one();
+    return ActivationSubmitResult::Queued;
+}
+
+void ActivationExecutor::WorkerLoop()
+{
+    t_workerOf = this;
+    if (m_options.WorkerStarted)
+    {
+        try
+        {
+            m_options.WorkerStarted();
+        }
+        catch (...)
+        {
+            // Handlers that needed it fail on their own, and are counted as failed
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_workAvailable.wait(lock, [this] { return !m_ready.empty() || m_stopping; });
+        if (m_ready.empty())
+        {
+            return;
+        }
+
+        ReadyHandler next = std::move(m_ready.front());
+        m_ready.pop_front();
+        m_queued--;
+        m_spaceAvailable.notify_one();
+
+        lock.unlock();
+        bool succeeded = true;
+        try
+        {
+            next.Run();
+        }
+        catch (...)
+        {
+            succeeded = false;
+        }
+        next.Run = nullptr;
+        lock.lock();
+
+        if (succeeded)
+        {
+            m_completed++;
+        }
+        else
+        {
+            m_failed++;
+        }
+        Finish(next.Strand);
+    }
+}
+
+void ActivationExecutor::Finish(StrandMap::value_type* strand)
+{
+    m_finished++;
+
+    if (strand != nullptr)
+    {
+        std::deque<Handler>& pending = strand->second;
+        if (pending.empty())
+        {
+            m_strands.erase(strand->first);
+        }
+        else
+        {
+            // Go to the back of the ready queue rather than running the next one straight away, so a
+            // busy key can't starve the others
+            m_ready.push_back({ std::move(pending.front()), strand });
+            pending.pop_front();
+            m_workAvailable.notify_one();
+        }
+    }
+
+    m_progress.notify_all();
+}
+
+void ActivationExecutor::Flush()
+{
+    if (OnWorkerThread())
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::uint64_t target = m_submitted;
+    m_progress.wait(lock, [this, target] { return m_finished >= target; });
+}
+
+void ActivationExecutor::Shutdown(bool drain)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_stopping)
+        {
+            m_accepting = false;
+            if (!drain)
+            {
+                std::uint64_t dropped = m_queued;
+                for (auto& strand : m_strands)
+                {
+                    strand.second.clear();
+                }
+                for (const ReadyHandler& ready : m_ready)
+                {
+                    if (ready.Strand != nullptr)
+                    {
+                        m_strands.erase(ready.Strand->first);
+                    }
+                }
+                m_ready.clear();
+                m_queued = 0;
+                m_finished += dropped;
+                m_progress.notify_all();
+            }
+
+            m_stopping = true;
+        }
+    }
+
+    m_spaceAvailable.notify_all();
+    m_workAvailable.notify_all();
+
+    // A handler can't wait for its own worker, nor take the shutdown lock from a caller that's joining it
+    if (OnWorkerThread())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> shutdownLock(m_shutdownMutex);
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+bool ActivationExecutor::OnWorkerThread() const
+{
+    return t_workerOf == this;
+}
+
+std::size_t ActivationExecutor::QueueDepth() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queued;
+}
+
+ActivationExecutorStats ActivationExecutor::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return { m_submitted, m_completed, m_failed, m_rejected };
+}
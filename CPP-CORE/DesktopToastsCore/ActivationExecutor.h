@@ -0,0 +1,173 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class ToastMetrics;
+
+/// <summary>
+/// What Submit does when the queue is full.
+/// </summary>
+enum class ActivationOverflowPolicy
+{
+    /// <summary>
+    /// Wait until a worker takes an activation off the queue.
+    /// </summary>
+    Block,
+
+    /// <summary>
+    /// Reject the new activation.
+    /// </summary>
+    Reject
+};
+
+enum class ActivationSubmitResult
+{
+    Queued,
+    Rejected,
+    ShutDown
+};
+
+struct ActivationExecutorOptions
+{
+    /// <summary>
+    /// Number of worker threads running handlers.
+    /// </summary>
+    std::size_t WorkerCount = 2;
+
+    /// <summary>
+    /// Maximum number of activations waiting to run, not counting the ones already running.
+    /// </summary>
+    std::size_t Capacity = 256;
+
+    ActivationOverflowPolicy Overflow = ActivationOverflowPolicy::Block;
+
+    /// <summary>
+    /// Optional callback run at the start of each worker thread, for example to initialize COM. If it throws, the
+    /// worker runs handlers anyway, and those that needed what it set up fail and are counted as failed.
+    /// </summary>
+    std::function<void()> WorkerStarted;
+
+    /// <summary>
+    /// Optional metrics told the queue depth each time an activation is queued. Must outlive the executor.
+    /// </summary>
+    ToastMetrics* Metrics = nullptr;
+};
+
+struct ActivationExecutorStats
+{
+    std::uint64_t Submitted;
+    std::uint64_t Completed;
+    std::uint64_t Failed;
+    std::uint64_t Rejected;
+};
+
+/// <summary>
+/// Runs activation handlers on a pool of worker threads, so the COM call that delivered an activation
+/// can return as soon as its arguments are copied. Handlers submitted with the same ordering key (a
+/// toast's tag, say) run one at a time in submission order; handlers with different keys, or with an
+/// empty key, run in parallel. An exception thrown by a handler counts it as failed and is otherwise ignored.
+/// </summary>
+class ActivationExecutor
+{
+public:
+    using Handler = std::function<void()>;
+
+    explicit ActivationExecutor(ActivationExecutorOptions options);
+
+    /// <summary>
+    /// Shuts down, running everything that's still queued. Destroyed from a handler, which only happens as that
+    /// handler ends the process, it leaves the workers to the process's exit.
+    /// </summary>
+    ~ActivationExecutor();
+
+    ActivationExecutor(const ActivationExecutor&) = delete;
+    ActivationExecutor& operator=(const ActivationExecutor&) = delete;
+
+    /// <summary>
+    /// Queues a handler behind any earlier ones with the same ordering key. Depending on the overflow
+    /// policy, this blocks or rejects the handler when the queue is full.
+    /// </summary>
+    ActivationSubmitResult Submit(std::wstring orderingKey, Handler handler);
+
+    /// <summary>
+    /// Blocks until every handler submitted before this call has run or been dropped. Called from a handler, this
+    /// returns straight away, since the handler (and any queued behind it on its key) can't finish while it waits.
+    /// </summary>
+    void Flush();
+
+    /// <summary>
+    /// Stops the workers. If drain is true, queued handlers run first; otherwise they're dropped.
+    /// Later calls to Submit return ShutDown. Called from a handler, this returns once the workers have been
+    /// told to stop, and the destructor (or a later call from another thread) joins them.
+    /// </summary>
+    void Shutdown(bool drain = true);
+
+    /// <summary>
+    /// Number of handlers waiting to run.
+    /// </summary>
+    std::size_t QueueDepth() const;
+
+    ActivationExecutorStats GetStats() const;
+
+private:
+    // Handlers queued behind the one that's ready or running for the same key
+    using StrandMap = std::unordered_map<std::wstring, std::deque<Handler>>;
+
+    struct ReadyHandler
+    {
+        Handler Run;
+
+        // The strand this handler belongs to, or nullptr if it has no ordering key. Elements of an
+        // unordered_map keep their address across rehashing, so this stays valid until it's erased.
+        StrandMap::value_type* Strand;
+    };
+
+    void WorkerLoop();
+    bool OnWorkerThread() const;
+
+    // Called with m_mutex held once a handler has run; hands its strand over to the next handler in line
+    void Finish(StrandMap::value_type* strand);
+
+    ActivationExecutorOptions m_options;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_spaceAvailable;
+    std::condition_variable m_progress;
+
+    std::deque<ReadyHandler> m_ready;
+    StrandMap m_strands;
+    std::size_t m_queued = 0;
+
+    bool m_accepting = true;
+    bool m_stopping = false;
+
+    std::uint64_t m_submitted = 0;
+    std::uint64_t m_finished = 0;
+    std::uint64_t m_completed = 0;
+    std::uint64_t m_failed = 0;
+    std::uint64_t m_rejected = 0;
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_shutdownMutex;
+};
@@ -0,0 +1,570 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ActivationJournal.h"
+#include "ToastCrc32.h"
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+
+namespace
+{
+    // Journal layout, all in native byte order:
+    //   Header: Magic, Version, CharSize, padding (u32 each), FirstSequence (u64)
+    //   Records, back to back: BodySize (u32, a multiple of 8), Crc (u32, over the body), Body
+    //   Body: Sequence (u64), Type (u8), three bytes padding, UserInputCount (u32), then
+    //     Begin: the argument and each user input's key and value, each a u32 length in characters followed by the
+    //            characters, then padding
+    //     Retry, Complete: the sequence of the Begin they refer to (u64)
+    // Each record's sequence is one more than the last, starting from FirstSequence. A zero BodySize, written after
+    // each record, marks the end. Rewinding sets FirstSequence past every record already in the file, so an old
+    // record is never read back even where a crash cut off the marker.
+    constexpr std::uint32_t Magic = 0x4A415454; // "TTAJ"
+    constexpr std::uint32_t Version = 1;
+    constexpr std::uint64_t HeaderSize = 64;
+    constexpr std::uint64_t FirstSequenceOffset = 16;
+    constexpr std::uint64_t RecordHeaderSize = 8;
+    constexpr std::uint64_t RecordAlignment = 8;
+    constexpr std::uint64_t TypeOffset = 8;
+    constexpr std::uint64_t UserInputCountOffset = 12;
+    constexpr std::uint64_t PayloadOffset = 16;
+    constexpr std::uint64_t MarkerBodySize = PayloadOffset + sizeof(std::uint64_t);
+
+    template <typename T>
+    T Read(const std::uint8_t* data)
+    {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    std::uint8_t* Write(std::uint8_t* data, T value)
+    {
+        std::memcpy(data, &value, sizeof(T));
+        return data + sizeof(T);
+    }
+
+    std::uint8_t* WriteString(std::uint8_t* data, std::wstring_view value)
+    {
+        data = Write(data, static_cast<std::uint32_t>(value.size()));
+        std::memcpy(data, value.data(), value.size() * sizeof(wchar_t));
+        return data + value.size() * sizeof(wchar_t);
+    }
+
+    std::uint64_t StringSize(std::wstring_view value)
+    {
+        return sizeof(std::uint32_t) + value.size() * sizeof(wchar_t);
+    }
+
+    // Reads a string out of a record body, advancing position. Returns false if it would run past the end.
+    bool ReadString(const std::uint8_t* body, std::uint64_t bodySize, std::uint64_t& position, std::wstring_view& value)
+    {
+        if (bodySize - position < sizeof(std::uint32_t))
+        {
+            return false;
+        }
+
+        std::uint64_t length = Read<std::uint32_t>(body + position);
+        position += sizeof(std::uint32_t);
+        if ((bodySize - position) / sizeof(wchar_t) < length)
+        {
+            return false;
+        }
+
+        // Records start 8-byte aligned and every field is a multiple of sizeof(wchar_t) long, so the characters are aligned
+        value = std::wstring_view(reinterpret_cast<const wchar_t*>(body + position), static_cast<std::size_t>(length));
+        position += length * sizeof(wchar_t);
+        return true;
+    }
+}
+
+ActivationJournal::~ActivationJournal()
+{
+    Close();
+}
+
+ToastResult ActivationJournal::Open(const std::filesystem::path& path, ActivationJournalOptions options)
+{
+    Close();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_options = options;
+
+    ToastResult result = OpenFile(path);
+    if (ToastSucceeded(result) && m_options.WaitForDisk)
+    {
+        // Records the last process wrote may only have made it as far as the page cache
+        result = m_file.Flush(0, m_end);
+    }
+
+    if (!ToastSucceeded(result))
+    {
+        // Without flushing, which would write to a file that may not be a journal
+        m_file.Close();
+        m_pending.clear();
+        return result;
+    }
+
+    // Otherwise nothing is known to be on disk, so the first flush takes in the whole file
+    m_durableSequence = m_options.WaitForDisk ? m_nextSequence - 1 : 0;
+    RewindIfIdle(0);
+    return ToastResultOk;
+}
+
+void ActivationJournal::Close()
+{
+    Flush();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_file.Close();
+    m_end = 0;
+    m_nextSequence = 0;
+    m_dirtyFrom = 0;
+    m_durableSequence = 0;
+    m_pending.clear();
+    m_recovered = false;
+    m_begins = 0;
+    m_flushes = 0;
+    m_rewinds = 0;
+    m_abandoned = 0;
+}
+
+bool ActivationJournal::IsOpen() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_file.IsOpen();
+}
+
+ToastResult ActivationJournal::Begin(const ActivationEventArgs& args, std::uint64_t& sequence)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    std::uint64_t offset;
+    ToastResult result = Append(RecordType::Begin, &args, 0, lock, sequence, offset);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    m_pending.emplace(sequence, Pending{ offset, 1, true });
+    m_begins++;
+    return m_options.WaitForDisk ? WaitForDisk(sequence, lock) : ToastResultOk;
+}
+
+ToastResult ActivationJournal::Complete(std::uint64_t sequence)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_pending.find(sequence) == m_pending.end())
+    {
+        return ToastResultNotFound;
+    }
+
+    // A Complete that doesn't reach the disk only means handling the activation again, so it isn't waited for
+    std::uint64_t markerSequence, offset;
+    ToastResult result = Append(RecordType::Complete, nullptr, sequence, lock, markerSequence, offset);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    m_pending.erase(sequence);
+    RewindIfIdle(m_options.RewindAfterBytes);
+    return ToastResultOk;
+}
+
+ToastResult ActivationJournal::Retry(std::uint64_t sequence)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_pending.find(sequence) == m_pending.end())
+    {
+        return ToastResultNotFound;
+    }
+
+    std::uint64_t markerSequence, offset;
+    ToastResult result = Append(RecordType::Retry, nullptr, sequence, lock, markerSequence, offset);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    // Looked up again, since Append may have waited for the lock
+    auto pending = m_pending.find(sequence);
+    if (pending != m_pending.end())
+    {
+        pending->second.Attempts++;
+        pending->second.Running = true;
+    }
+
+    // Counted before the handler runs, so a handler that crashes the process still uses up its attempts
+    return m_options.WaitForDisk ? WaitForDisk(markerSequence, lock) : ToastResultOk;
+}
+
+ToastResult ActivationJournal::Unfinished(std::vector<ActivationJournalEntry>& entries)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_file.IsOpen())
+    {
+        return ToastResultFail;
+    }
+
+    std::vector<std::uint64_t> abandoned;
+    for (const auto& pending : m_pending)
+    {
+        if (pending.second.Running)
+        {
+            continue;
+        }
+
+        if (pending.second.Attempts >= m_options.MaxAttempts)
+        {
+            abandoned.push_back(pending.first);
+            continue;
+        }
+
+        entries.push_back(ActivationJournalEntry{ pending.first, pending.second.Attempts, ReadArgs(pending.second.Offset) });
+    }
+
+    for (std::uint64_t sequence : abandoned)
+    {
+        std::uint64_t markerSequence, offset;
+        ToastResult result = Append(RecordType::Complete, nullptr, sequence, lock, markerSequence, offset);
+        if (!ToastSucceeded(result))
+        {
+            return result;
+        }
+
+        m_pending.erase(sequence);
+        m_abandoned++;
+    }
+
+    RewindIfIdle(m_options.RewindAfterBytes);
+    return ToastResultOk;
+}
+
+ToastResult ActivationJournal::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_file.IsOpen())
+    {
+        return ToastResultFail;
+    }
+    return WaitForDisk(m_nextSequence - 1, lock);
+}
+
+ActivationJournalStats ActivationJournal::GetStats() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    ActivationJournalStats stats;
+    stats.UnfinishedCount = m_pending.size();
+    stats.Bytes = m_end;
+    stats.Recovered = m_recovered;
+    stats.Begins = m_begins;
+    stats.Flushes = m_flushes;
+    stats.Rewinds = m_rewinds;
+    stats.Abandoned = m_abandoned;
+    return stats;
+}
+
+ToastResult ActivationJournal::OpenFile(const std::filesystem::path& path)
+{
+    // Anything too small for a header can't be a journal, unless it's empty and about to become one
+    std::error_code error;
+    std::uint64_t existingSize = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+    if (error || (existingSize != 0 && existingSize < HeaderSize))
+    {
+        return ToastResultFail;
+    }
+
+    ToastResult result = m_file.Open(path, existingSize == 0 ? std::max(m_options.InitialSize, HeaderSize) : HeaderSize);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::uint8_t* data = m_file.Data();
+    if (Read<std::uint32_t>(data) == 0)
+    {
+        // A new file, or one that was created but never written to. Anything other than zeros means it isn't ours after all.
+        if (std::any_of(data, data + m_file.Size(), [](std::uint8_t byte) { return byte != 0; }))
+        {
+            return ToastResultFail;
+        }
+
+        Write(data, Magic);
+        Write(data + 4, Version);
+        Write(data + 8, static_cast<std::uint32_t>(sizeof(wchar_t)));
+        Write(data + FirstSequenceOffset, std::uint64_t{ 1 });
+        m_end = HeaderSize;
+        m_nextSequence = 1;
+        return ToastResultOk;
+    }
+
+    if (Read<std::uint32_t>(data) != Magic || Read<std::uint32_t>(data + 4) != Version || Read<std::uint32_t>(data + 8) != sizeof(wchar_t))
+    {
+        return ToastResultFail;
+    }
+
+    Scan();
+    return ToastResultOk;
+}
+
+// Finds the unfinished activations, and leaves m_end and m_nextSequence after the last intact record. Stops at the
+// first record that's torn or corrupt, which sets m_recovered, or from before the last rewind, which is the end.
+void ActivationJournal::Scan()
+{
+    const std::uint8_t* data = m_file.Data();
+    std::uint64_t size = m_file.Size();
+    std::uint64_t offset = HeaderSize;
+    std::uint64_t expected = Read<std::uint64_t>(data + FirstSequenceOffset);
+    m_recovered = true;
+
+    while (size - offset >= RecordHeaderSize)
+    {
+        std::uint64_t bodySize = Read<std::uint32_t>(data + offset);
+        if (bodySize == 0)
+        {
+            m_recovered = false;
+            break;
+        }
+
+        if (bodySize % RecordAlignment != 0 || bodySize < PayloadOffset || size - offset - RecordHeaderSize < bodySize)
+        {
+            break;
+        }
+
+        const std::uint8_t* body = data + offset + RecordHeaderSize;
+        if (ComputeToastCrc32(body, static_cast<std::size_t>(bodySize)) != Read<std::uint32_t>(data + offset + 4))
+        {
+            break;
+        }
+
+        std::uint64_t sequence = Read<std::uint64_t>(body);
+        if (sequence != expected)
+        {
+            m_recovered = sequence > expected;
+            break;
+        }
+
+        std::uint8_t type = body[TypeOffset];
+        if (type == static_cast<std::uint8_t>(RecordType::Begin))
+        {
+            std::uint64_t position = PayloadOffset;
+            std::uint64_t stringCount = 1 + 2 * static_cast<std::uint64_t>(Read<std::uint32_t>(body + UserInputCountOffset));
+            std::wstring_view value;
+            while (stringCount > 0 && ReadString(body, bodySize, position, value))
+            {
+                stringCount--;
+            }
+            if (stringCount != 0)
+            {
+                break;
+            }
+
+            m_pending.emplace(sequence, Pending{ offset, 1, false });
+        }
+        else if (type == static_cast<std::uint8_t>(RecordType::Retry) || type == static_cast<std::uint8_t>(RecordType::Complete))
+        {
+            if (bodySize < MarkerBodySize)
+            {
+                break;
+            }
+
+            auto pending = m_pending.find(Read<std::uint64_t>(body + PayloadOffset));
+            if (pending != m_pending.end())
+            {
+                if (type == static_cast<std::uint8_t>(RecordType::Retry))
+                {
+                    pending->second.Attempts++;
+                }
+                else
+                {
+                    m_pending.erase(pending);
+                }
+            }
+        }
+        else
+        {
+            break;
+        }
+
+        expected++;
+        offset += RecordHeaderSize + bodySize;
+    }
+
+    m_end = offset;
+    m_nextSequence = expected;
+}
+
+ToastResult ActivationJournal::Append(RecordType type, const ActivationEventArgs* args, std::uint64_t target, std::unique_lock<std::mutex>& lock, std::uint64_t& sequence, std::uint64_t& offset)
+{
+    if (!m_file.IsOpen())
+    {
+        return ToastResultFail;
+    }
+
+    std::uint64_t bodySize = MarkerBodySize;
+    if (type == RecordType::Begin)
+    {
+        bodySize = PayloadOffset + StringSize(args->Argument());
+        for (std::size_t i = 0; i < args->UserInputCount(); i++)
+        {
+            ActivationUserInput input = args->UserInputAt(i);
+            bodySize += StringSize(input.Key) + StringSize(input.Value);
+        }
+    }
+    bodySize = (bodySize + RecordAlignment - 1) / RecordAlignment * RecordAlignment;
+    if (bodySize > UINT32_MAX)
+    {
+        return ToastResultInvalidArgument;
+    }
+
+    std::uint64_t recordSize = RecordHeaderSize + bodySize;
+    ToastResult result = Reserve(recordSize, lock);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    // The end marker goes in first, since after a rewind what follows is the middle of an old record; then the body
+    // and its CRC, and the size last, though a torn record fails its CRC check either way
+    offset = m_end;
+    sequence = m_nextSequence;
+    Write(m_file.Data() + offset + recordSize, std::uint32_t{ 0 });
+    std::uint8_t* body = m_file.Data() + offset + RecordHeaderSize;
+    std::memset(body, 0, static_cast<std::size_t>(bodySize));
+    Write(body, sequence);
+    body[TypeOffset] = static_cast<std::uint8_t>(type);
+
+    if (type == RecordType::Begin)
+    {
+        Write(body + UserInputCountOffset, static_cast<std::uint32_t>(args->UserInputCount()));
+        std::uint8_t* position = WriteString(body + PayloadOffset, args->Argument());
+        for (std::size_t i = 0; i < args->UserInputCount(); i++)
+        {
+            ActivationUserInput input = args->UserInputAt(i);
+            position = WriteString(position, input.Key);
+            position = WriteString(position, input.Value);
+        }
+    }
+    else
+    {
+        Write(body + PayloadOffset, target);
+    }
+
+    Write(m_file.Data() + offset + 4, ComputeToastCrc32(body, static_cast<std::size_t>(bodySize)));
+    Write(m_file.Data() + offset, static_cast<std::uint32_t>(bodySize));
+
+    m_end += recordSize;
+    m_nextSequence++;
+    return ToastResultOk;
+}
+
+// Makes room for a record and the zero BodySize that marks the end after it
+ToastResult ActivationJournal::Reserve(std::uint64_t bytes, std::unique_lock<std::mutex>& lock)
+{
+    if (m_file.Size() - m_end >= bytes + RecordHeaderSize)
+    {
+        return ToastResultOk;
+    }
+
+    // Growing moves the mapping, so it has to wait out a flush
+    m_flushed.wait(lock, [this] { return !m_flushing; });
+    if (m_file.Size() - m_end >= bytes + RecordHeaderSize)
+    {
+        return ToastResultOk;
+    }
+
+    std::uint64_t size = std::max(m_file.Size(), HeaderSize);
+    while (size - m_end < bytes + RecordHeaderSize)
+    {
+        size *= 2;
+    }
+    return m_file.Resize(size);
+}
+
+// Flushes until the record with this sequence is on disk. A thread that finds no flush under way flushes everything
+// appended so far, for itself and whoever else is waiting; the rest wait for it and then, if their record came too
+// late for that flush, for the next one.
+ToastResult ActivationJournal::WaitForDisk(std::uint64_t sequence, std::unique_lock<std::mutex>& lock)
+{
+    while (m_durableSequence < sequence)
+    {
+        if (m_flushing)
+        {
+            m_flushed.wait(lock);
+            continue;
+        }
+
+        std::uint64_t from = m_dirtyFrom;
+        std::uint64_t to = m_end;
+        std::uint64_t through = m_nextSequence - 1;
+        m_flushing = true;
+        m_dirtyFrom = to;
+
+        lock.unlock();
+        ToastResult result = m_file.Flush(from, to - from);
+        lock.lock();
+
+        m_flushing = false;
+        m_flushed.notify_all();
+        if (!ToastSucceeded(result))
+        {
+            m_dirtyFrom = std::min(m_dirtyFrom, from);
+            return result;
+        }
+
+        m_flushes++;
+        m_durableSequence = std::max(m_durableSequence, through);
+    }
+    return ToastResultOk;
+}
+
+// Starts the records again from the beginning of the file once there's nothing left unfinished to keep
+void ActivationJournal::RewindIfIdle(std::uint64_t threshold)
+{
+    if (!m_pending.empty() || m_flushing || m_end == HeaderSize || m_end - HeaderSize < threshold)
+    {
+        return;
+    }
+
+    // One aligned store, so a crash leaves either the old records or none
+    Write(m_file.Data() + FirstSequenceOffset, m_nextSequence);
+    m_end = HeaderSize;
+    m_dirtyFrom = 0;
+    m_rewinds++;
+}
+
+ActivationEventArgs ActivationJournal::ReadArgs(std::uint64_t offset) const
+{
+    const std::uint8_t* data = m_file.Data();
+    const std::uint8_t* body = data + offset + RecordHeaderSize;
+    std::uint64_t bodySize = Read<std::uint32_t>(data + offset);
+    std::uint32_t userInputCount = Read<std::uint32_t>(body + UserInputCountOffset);
+
+    // Scan and Append have already checked that every string is in bounds
+    std::uint64_t position = PayloadOffset;
+    std::wstring_view argument;
+    ReadString(body, bodySize, position, argument);
+
+    std::vector<ActivationUserInput> userInput(userInputCount);
+    for (ActivationUserInput& input : userInput)
+    {
+        ReadString(body, bodySize, position, input.Key);
+        ReadString(body, bodySize, position, input.Value);
+    }
+    return ActivationEventArgs(argument, userInput.data(), userInput.size());
+}
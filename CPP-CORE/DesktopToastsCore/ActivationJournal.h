@@ -0,0 +1,193 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "ActivationEventArgs.h"
+#include "INotificationPlatform.h"
+#include "ToastMappedFile.h"
+
+struct ActivationJournalOptions
+{
+    /// <summary>
+    /// Size the file is created with. It doubles whenever it fills up.
+    /// </summary>
+    std::uint64_t InitialSize = 256 << 10;
+
+    /// <summary>
+    /// Once every activation has been handled and the records take up this many bytes, new records start again from
+    /// the beginning of the file.
+    /// </summary>
+    std::uint64_t RewindAfterBytes = 64 << 10;
+
+    /// <summary>
+    /// If true, Begin returns only once its record is on disk, so activations survive the OS crashing or losing power
+    /// too. Activations that arrive while a flush is under way wait for the next one together, so a burst shares one
+    /// flush. Otherwise records survive the process crashing, which costs no more than copying them into the mapping.
+    /// </summary>
+    bool WaitForDisk = false;
+
+    /// <summary>
+    /// How many times an activation is started, counting the first, before Unfinished gives up on it. Keeps an
+    /// activation whose handler crashes the process from doing so on every start.
+    /// </summary>
+    std::uint32_t MaxAttempts = 3;
+};
+
+/// <summary>
+/// An activation that was started but never finished.
+/// </summary>
+struct ActivationJournalEntry
+{
+    std::uint64_t Sequence;
+
+    /// <summary>
+    /// How many times it has been started.
+    /// </summary>
+    std::uint32_t Attempts;
+    ActivationEventArgs Args;
+};
+
+struct ActivationJournalStats
+{
+    std::size_t UnfinishedCount;
+    std::uint64_t Bytes;
+
+    /// <summary>
+    /// Whether Open found a torn or corrupt record, and so discarded it and everything after it.
+    /// </summary>
+    bool Recovered;
+    std::uint64_t Begins;
+    std::uint64_t Flushes;
+    std::uint64_t Rewinds;
+
+    /// <summary>
+    /// Activations dropped by Unfinished after MaxAttempts.
+    /// </summary>
+    std::uint64_t Abandoned;
+};
+
+/// <summary>
+/// A write-ahead log of activations in a memory-mapped file, so those a handler didn't finish, because it threw or the
+/// process died, can be handled again on the next start. Begin appends the argument and user input before the handler
+/// runs, and Complete appends a marker once it has. Each record carries a CRC32 and a sequence number one past the
+/// record before it, and Open stops at the first record that's torn, corrupt or out of sequence, so a crash part way
+/// through a write loses only that record. Replay is at least once: an activation whose handler finished but whose
+/// Complete didn't reach the file is handled again, so handlers should tolerate repeats. Files are only readable on
+/// the architecture that wrote them. Thread-safe.
+/// </summary>
+class ActivationJournal
+{
+public:
+    ActivationJournal() = default;
+    ~ActivationJournal();
+
+    ActivationJournal(const ActivationJournal&) = delete;
+    ActivationJournal& operator=(const ActivationJournal&) = delete;
+
+    /// <summary>
+    /// Opens the journal, creating it if it doesn't exist, and finds the activations the last process didn't finish.
+    /// Returns ToastResultFail if the file isn't an activation journal or was written with a different wchar_t size.
+    /// </summary>
+    ToastResult Open(const std::filesystem::path& path, ActivationJournalOptions options = {});
+
+    /// <summary>
+    /// Flushes and closes the journal. Activations begun and not completed stay unfinished for the next Open.
+    /// </summary>
+    void Close();
+
+    bool IsOpen() const;
+
+    /// <summary>
+    /// Records an activation about to be handled, setting sequence to the number to pass to Complete.
+    /// </summary>
+    ToastResult Begin(const ActivationEventArgs& args, std::uint64_t& sequence);
+
+    /// <summary>
+    /// Records that the activation has been handled. Returns ToastResultNotFound if it isn't unfinished.
+    /// </summary>
+    ToastResult Complete(std::uint64_t sequence);
+
+    /// <summary>
+    /// Records that an unfinished activation is being handled again. Returns ToastResultNotFound if it isn't unfinished.
+    /// </summary>
+    ToastResult Retry(std::uint64_t sequence);
+
+    /// <summary>
+    /// Appends the unfinished activations, oldest first, leaving out those still being handled by this process. Any that
+    /// have been started MaxAttempts times are completed instead and counted in Abandoned.
+    /// </summary>
+    ToastResult Unfinished(std::vector<ActivationJournalEntry>& entries);
+
+    /// <summary>
+    /// Makes every record so far durable.
+    /// </summary>
+    ToastResult Flush();
+
+    ActivationJournalStats GetStats() const;
+
+private:
+    enum class RecordType : std::uint8_t
+    {
+        Begin = 1,
+        Retry = 2,
+        Complete = 3
+    };
+
+    struct Pending
+    {
+        std::uint64_t Offset;
+        std::uint32_t Attempts;
+
+        // Begun or retried by this process, so not for Unfinished to hand out again
+        bool Running;
+    };
+
+    ToastResult OpenFile(const std::filesystem::path& path);
+    void Scan();
+    ToastResult Append(RecordType type, const ActivationEventArgs* args, std::uint64_t target, std::unique_lock<std::mutex>& lock, std::uint64_t& sequence, std::uint64_t& offset);
+    ToastResult Reserve(std::uint64_t bytes, std::unique_lock<std::mutex>& lock);
+    ToastResult WaitForDisk(std::uint64_t sequence, std::unique_lock<std::mutex>& lock);
+    void RewindIfIdle(std::uint64_t threshold);
+    ActivationEventArgs ReadArgs(std::uint64_t offset) const;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_flushed;
+
+    ActivationJournalOptions m_options;
+    ToastMappedFile m_file;
+
+    // Where the next record goes, and the sequence number it gets
+    std::uint64_t m_end = 0;
+    std::uint64_t m_nextSequence = 0;
+
+    // Set while a thread flushes outside the lock. The mapping can't be moved then, and other writers wait for
+    // durableSequence to pass their own rather than flushing themselves.
+    bool m_flushing = false;
+    std::uint64_t m_dirtyFrom = 0;
+    std::uint64_t m_durableSequence = 0;
+
+    // Begin records not yet completed, by sequence
+    std::map<std::uint64_t, Pending> m_pending;
+
+    bool m_recovered = false;
+    std::uint64_t m_begins = 0;
+    std::uint64_t m_flushes = 0;
+    std::uint64_t m_rewinds = 0;
+    std::uint64_t m_abandoned = 0;
+};
@@ -0,0 +1,117 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ActivationStartup.h"
+
+ActivationStartup::ActivationStartup() :
+    m_phaseStart(Clock::now())
+{
+}
+
+void ActivationStartup::EndPhase(ActivationStartupPhase phase)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    EndPhaseLocked(phase, Clock::now());
+}
+
+void ActivationStartup::OnReceived()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timings.Activations++;
+    m_inFlight++;
+    m_changed.notify_all();
+}
+
+void ActivationStartup::OnCompleted()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_inFlight--;
+    m_lastCompleted = Clock::now();
+    m_changed.notify_all();
+}
+
+void ActivationStartup::KeepRunning()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timings.KeptRunning = true;
+    m_changed.notify_all();
+}
+
+ToastResult ActivationStartup::WaitForActivations(const ActivationStartupOptions& options)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    bool arrived = m_changed.wait_until(lock, Clock::now() + options.ActivationTimeout, [this] { return m_timings.Activations > 0 || m_timings.KeptRunning; });
+    EndPhaseLocked(ActivationStartupPhase::WaitForActivation, Clock::now());
+    if (!arrived)
+    {
+        m_timings.TimedOut = true;
+        return ToastResultTimeout;
+    }
+
+    while (!m_timings.KeptRunning)
+    {
+        if (!m_changed.wait_until(lock, Clock::now() + options.HandlerTimeout, [this] { return m_inFlight == 0 || m_timings.KeptRunning; }))
+        {
+            // The rest are left to run, or not, while the process exits
+            m_timings.Abandoned = m_inFlight;
+            EndPhaseLocked(ActivationStartupPhase::Handle, Clock::now());
+            return ToastResultTimeout;
+        }
+
+        std::uint64_t received = m_timings.Activations;
+        if (!m_changed.wait_until(lock, Clock::now() + options.IdleTimeout, [this, received] { return m_timings.Activations != received || m_timings.KeptRunning; }))
+        {
+            // Handling ran until the last activation finished, and the rest was spent idle
+            EndPhaseLocked(ActivationStartupPhase::Handle, m_lastCompleted);
+            EndPhaseLocked(ActivationStartupPhase::Idle, Clock::now());
+            return ToastResultOk;
+        }
+    }
+
+    // Whatever is still being handled carries on as part of the app's normal run
+    EndPhaseLocked(ActivationStartupPhase::Handle, Clock::now());
+    return ToastResultOk;
+}
+
+ToastResult ActivationStartup::Drain(const ActivationStartupOptions& options)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool drained = m_changed.wait_until(lock, Clock::now() + options.HandlerTimeout, [this] { return m_inFlight == 0 || m_timings.KeptRunning; });
+    EndPhaseLocked(ActivationStartupPhase::Drain, Clock::now());
+    if (!drained)
+    {
+        m_timings.Abandoned = m_inFlight;
+        return ToastResultTimeout;
+    }
+    return ToastResultOk;
+}
+
+ActivationStartupTimings ActivationStartup::Timings() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_timings;
+}
+
+void ActivationStartup::EndPhaseLocked(ActivationStartupPhase phase, Clock::time_point at)
+{
+    // A phase can't end before the previous one, even if an activation completed while an earlier one was being recorded
+    if (at < m_phaseStart)
+    {
+        at = m_phaseStart;
+    }
+
+    std::chrono::nanoseconds duration = at - m_phaseStart;
+    m_timings.Phases[static_cast<std::size_t>(phase)] += duration;
+    m_timings.Total += duration;
+    m_phaseStart = at;
+}
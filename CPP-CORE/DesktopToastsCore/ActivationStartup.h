@@ -0,0 +1,165 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "INotificationPlatform.h"
+
+/// <summary>
+/// The phases of a process COM started to deliver activations, in order.
+/// </summary>
+enum class ActivationStartupPhase
+{
+    /// <summary>
+    /// From the ActivationStartup being constructed (with the process, for a global) until registration begins.
+    /// </summary>
+    Launch,
+
+    /// <summary>
+    /// Creating the manager, subscribing handlers and registering the activator.
+    /// </summary>
+    Register,
+
+    /// <summary>
+    /// From the activator being registered until the first activation arrives.
+    /// </summary>
+    WaitForActivation,
+
+    /// <summary>
+    /// From the first activation arriving until the last one in a burst has been handled.
+    /// </summary>
+    Handle,
+
+    /// <summary>
+    /// Waiting to see whether more activations follow before giving up the activator.
+    /// </summary>
+    Idle,
+
+    /// <summary>
+    /// After the activator is revoked, until activations that slipped in before then have been handled.
+    /// </summary>
+    Drain
+};
+
+constexpr std::size_t ActivationStartupPhaseCount = 6;
+
+struct ActivationStartupOptions
+{
+    /// <summary>
+    /// How long to wait for the first activation before giving up.
+    /// </summary>
+    std::chrono::milliseconds ActivationTimeout = std::chrono::seconds(10);
+
+    /// <summary>
+    /// Once everything that has arrived is handled, how long to wait for another before giving up the activator.
+    /// </summary>
+    std::chrono::milliseconds IdleTimeout = std::chrono::milliseconds(250);
+
+    /// <summary>
+    /// How long WaitForActivations and Drain each wait for handlers still running before giving up on them, so a handler
+    /// that never returns can't keep the process alive.
+    /// </summary>
+    std::chrono::milliseconds HandlerTimeout = std::chrono::seconds(30);
+};
+
+/// <summary>
+/// How long each phase took, indexed by ActivationStartupPhase. Phases that haven't happened are zero.
+/// </summary>
+struct ActivationStartupTimings
+{
+    std::array<std::chrono::nanoseconds, ActivationStartupPhaseCount> Phases{};
+    std::chrono::nanoseconds Total{ 0 };
+
+    std::uint64_t Activations = 0;
+
+    /// <summary>
+    /// No activation arrived within ActivationTimeout.
+    /// </summary>
+    bool TimedOut = false;
+
+    /// <summary>
+    /// A handler called KeepRunning, so the process is carrying on as a normal launch.
+    /// </summary>
+    bool KeptRunning = false;
+
+    /// <summary>
+    /// Activations still being handled when WaitForActivations or Drain gave up on them after HandlerTimeout.
+    /// </summary>
+    std::uint64_t Abandoned = 0;
+};
+
+/// <summary>
+/// Runs the activation-only start of a process COM launched to deliver a toast activation, which for a background
+/// action has nothing else to do: wait a bounded time for the activation, handle it and any that follow closely,
+/// and return so the process can exit normally. DesktopNotificationManager::TrackActivations reports activations
+/// here as they arrive and are handled, on whatever thread that happens.
+/// </summary>
+class ActivationStartup
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    ActivationStartup();
+
+    ActivationStartup(const ActivationStartup&) = delete;
+    ActivationStartup& operator=(const ActivationStartup&) = delete;
+
+    /// <summary>
+    /// Records the phase as having taken the time since the previous one ended.
+    /// </summary>
+    void EndPhase(ActivationStartupPhase phase);
+
+    /// <summary>
+    /// Called as an activation arrives, and once it has been dealt with, however that went. Every OnReceived must be
+    /// matched by an OnCompleted, including when the handler throws.
+    /// </summary>
+    void OnReceived();
+    void OnCompleted();
+
+    /// <summary>
+    /// Called by a handler that needs the rest of the app, such as a foreground activation that opens a window.
+    /// WaitForActivations returns right away, without waiting for handlers, and Drain does nothing.
+    /// </summary>
+    void KeepRunning();
+
+    /// <summary>
+    /// Waits up to options.ActivationTimeout for the first activation, then until everything that has arrived is handled
+    /// and nothing more has arrived for options.IdleTimeout. Returns ToastResultTimeout if nothing arrived, or if handlers
+    /// were still running after options.HandlerTimeout. Ends the WaitForActivation, Handle and Idle phases.
+    /// </summary>
+    ToastResult WaitForActivations(const ActivationStartupOptions& options);
+
+    /// <summary>
+    /// Waits up to options.HandlerTimeout for activations that arrived after WaitForActivations returned, once nothing
+    /// more can arrive. Returns ToastResultTimeout if some were still being handled. Ends the Drain phase.
+    /// </summary>
+    ToastResult Drain(const ActivationStartupOptions& options);
+
+    ActivationStartupTimings Timings() const;
+
+private:
+    void EndPhaseLocked(ActivationStartupPhase phase, Clock::time_point at);
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+
+    Clock::time_point m_phaseStart;
+    Clock::time_point m_lastCompleted;
+    ActivationStartupTimings m_timings;
+
+    std::uint64_t m_inFlight = 0;
+};
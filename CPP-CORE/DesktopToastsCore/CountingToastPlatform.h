@@ -0,0 +1,124 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/// <summary>
+/// A fake stand-in for the Windows notification platform that counts every call instead of reaching
+/// the OS. It mirrors the shape the compat layer talks to (activation factories, then notifiers and
+/// history created from them), so a ToastObjectCache can be driven with it off Windows to verify how
+/// many platform lookups a burst of sends really costs.
+/// </summary>
+class CountingToastPlatform
+{
+public:
+    class Notifier
+    {
+    public:
+        Notifier(CountingToastPlatform& platform, std::wstring aumid) :
+            m_platform(&platform),
+            m_aumid(std::move(aumid))
+        {
+        }
+
+        const std::wstring& Aumid() const { return m_aumid; }
+
+        void Show(std::wstring_view) const
+        {
+            m_platform->m_shows.fetch_add(1, std::memory_order_relaxed);
+        }
+
+    private:
+        CountingToastPlatform* m_platform;
+        std::wstring m_aumid;
+    };
+
+    class History
+    {
+    public:
+        explicit History(CountingToastPlatform& platform) :
+            m_platform(&platform)
+        {
+        }
+
+        void Clear(const std::wstring&) const
+        {
+            m_platform->m_historyCalls.fetch_add(1, std::memory_order_relaxed);
+        }
+
+    private:
+        CountingToastPlatform* m_platform;
+    };
+
+    /// <summary>
+    /// Equivalent of IToastNotificationManagerStatics.
+    /// </summary>
+    class ManagerStatics
+    {
+    public:
+        explicit ManagerStatics(CountingToastPlatform& platform) :
+            m_platform(&platform)
+        {
+        }
+
+        std::shared_ptr<Notifier> CreateToastNotifier(const std::wstring& aumid) const
+        {
+            m_platform->m_notifierCreations.fetch_add(1, std::memory_order_relaxed);
+            return std::make_shared<Notifier>(*m_platform, aumid);
+        }
+
+        std::shared_ptr<History> GetHistory() const
+        {
+            m_platform->m_historyLookups.fetch_add(1, std::memory_order_relaxed);
+            return std::make_shared<History>(*m_platform);
+        }
+
+    private:
+        CountingToastPlatform* m_platform;
+    };
+
+    /// <summary>
+    /// Equivalent of GetActivationFactory for the ToastNotificationManager class.
+    /// </summary>
+    std::shared_ptr<ManagerStatics> GetManagerStatics()
+    {
+        m_factoryLookups.fetch_add(1, std::memory_order_relaxed);
+        return std::make_shared<ManagerStatics>(*this);
+    }
+
+    std::uint64_t FactoryLookups() const { return m_factoryLookups.load(std::memory_order_relaxed); }
+    std::uint64_t NotifierCreations() const { return m_notifierCreations.load(std::memory_order_relaxed); }
+    std::uint64_t HistoryLookups() const { return m_historyLookups.load(std::memory_order_relaxed); }
+    std::uint64_t HistoryCalls() const { return m_historyCalls.load(std::memory_order_relaxed); }
+    std::uint64_t Shows() const { return m_shows.load(std::memory_order_relaxed); }
+
+    void ResetCounters()
+    {
+        m_factoryLookups = 0;
+        m_notifierCreations = 0;
+        m_historyLookups = 0;
+        m_historyCalls = 0;
+        m_shows = 0;
+    }
+
+private:
+    std::atomic<std::uint64_t> m_factoryLookups{ 0 };
+    std::atomic<std::uint64_t> m_notifierCreations{ 0 };
+    std::atomic<std::uint64_t> m_historyLookups{ 0 };
+    std::atomic<std::uint64_t> m_historyCalls{ 0 };
+    std::atomic<std::uint64_t> m_shows{ 0 };
+};
@@ -0,0 +1,403 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "DesktopNotificationManager.h"
+#include "ToastArguments.h"
+#include "ToastGuid.h"
+#include "ToastRegistration.h"
+
+DesktopNotificationManager::DesktopNotificationManager(INotificationPlatform& platform, std::wstring aumid) :
+    m_platform(platform),
+    m_aumid(std::move(aumid))
+{
+}
+
+ToastResult DesktopNotificationManager::Register(const DesktopNotificationRegistration& registration)
+{
+    if (m_aumid.empty())
+    {
+        return ToastResultOk;
+    }
+
+    std::wstring clsid = registration.ActivatorClsid.empty() ? DefaultActivatorClsid() : registration.ActivatorClsid;
+    std::wstring serverKey = ServerKey(clsid);
+
+    // The fingerprint goes in the AUMID key when there is one, so when nothing has changed since the last start
+    // this is a single registry read
+    std::wstring aumidKey = AumidKey();
+    bool registersAumid = !registration.DisplayName.empty();
+    ToastRegistration values(registersAumid ? aumidKey : serverKey);
+
+    if (registersAumid)
+    {
+        values.SetValue(aumidKey, L"DisplayName", registration.DisplayName);
+
+        if (!registration.IconPath.empty())
+        {
+            values.SetValue(aumidKey, L"IconUri", registration.IconPath);
+        }
+        else
+        {
+            values.DeleteValue(aumidKey, L"IconUri");
+        }
+
+        if (!registration.IconBackgroundColor.empty())
+        {
+            values.SetValue(aumidKey, L"IconBackgroundColor", registration.IconBackgroundColor);
+        }
+        else
+        {
+            values.DeleteValue(aumidKey, L"IconBackgroundColor");
+        }
+
+        values.SetValue(aumidKey, L"CustomActivator", clsid);
+    }
+
+    values.SetValue(serverKey, L"", registration.LaunchCommand);
+
+    ToastResult result = values.Apply(m_platform);
+    if (ToastSucceeded(result))
+    {
+        m_activatorClsid = std::move(clsid);
+    }
+    return result;
+}
+
+void DesktopNotificationManager::OnActivated(ActivatedHandler handler)
+{
+    std::lock_guard<std::mutex> lock(m_handlerMutex);
+    if (m_onActivated != 0)
+    {
+        m_activations.Unsubscribe(m_onActivated);
+    }
+    m_onActivated = handler ? m_activations.Subscribe(std::move(handler)) : 0;
+}
+
+ToastResult DesktopNotificationManager::UseActivationExecutor(ActivationExecutorOptions options, std::wstring orderingArgument)
+{
+    if (options.Metrics == nullptr)
+    {
+        options.Metrics = &m_metrics;
+    }
+
+    m_activationExecutor = std::make_unique<ActivationExecutor>(std::move(options));
+    m_activationOrderingArgument = std::move(orderingArgument);
+    return ToastResultOk;
+}
+
+ToastResult DesktopNotificationManager::UseRateLimiter(ToastRateLimiterOptions options)
+{
+    if (options.Metrics == nullptr)
+    {
+        options.Metrics = &m_metrics;
+    }
+
+    m_rateLimiter = std::make_unique<ToastRateLimiter>(std::move(options), [this](ToastPayload&& payload)
+    {
+        return ShowNow(payload);
+    });
+    return ToastResultOk;
+}
+
+ToastRateLimiter::Clock::time_point DesktopNotificationManager::PumpRateLimiter()
+{
+    return m_rateLimiter ? m_rateLimiter->Pump() : ToastRateLimiter::Clock::time_point::max();
+}
+
+ToastResult DesktopNotificationManager::Show(const ToastPayload& payload)
+{
+    if (m_rateLimiter)
+    {
+        return m_rateLimiter->Submit(payload);
+    }
+    return ShowNow(payload);
+}
+
+ToastResult DesktopNotificationManager::ShowNow(const ToastPayload& payload)
+{
+    Clock::time_point start = Clock::now();
+    ToastResult result = m_platform.Show(m_aumid, payload);
+    m_metrics.RecordSend(result, Clock::now() - start);
+
+    if (ToastSucceeded(result))
+    {
+        m_historyIndex.OnShown(payload);
+    }
+    return result;
+}
+
+ToastResult DesktopNotificationManager::Activate(ActivationEventArgs args)
+{
+    if (m_activations.SubscriberCount() == 0)
+    {
+        // Nothing to hand it to, but it still counts as having arrived and been dealt with
+        if (m_startup != nullptr)
+        {
+            m_startup->OnReceived();
+            m_startup->OnCompleted();
+        }
+        return ToastResultOk;
+    }
+
+    return Dispatch(std::move(args), [this](const ActivationEventArgs& published)
+    {
+        return PublishActivation(published);
+    });
+}
+
+ToastResult DesktopNotificationManager::Dispatch(std::wstring_view arguments, std::function<ToastResult()> handler)
+{
+    // Activation latency runs from here until the handler returns, including any wait for a worker
+    Clock::time_point received = Clock::now();
+    std::uint32_t actionKey = m_metrics.ActionKey(ToastArguments(arguments).Action());
+    if (m_startup != nullptr)
+    {
+        m_startup->OnReceived();
+    }
+
+    if (m_activationExecutor == nullptr)
+    {
+        try
+        {
+            return RunHandler(handler, actionKey, received);
+        }
+        catch (...)
+        {
+            // Already recorded as failed. It goes no further, as the caller is typically a COM callback that can't let it through.
+            return ToastResultFail;
+        }
+    }
+
+    ToastResult result;
+    ActivationSubmitResult submitted;
+    try
+    {
+        std::wstring orderingKey(ToastArguments(arguments).Get(m_activationOrderingArgument));
+        submitted = m_activationExecutor->Submit(std::move(orderingKey), [this, handler = std::move(handler), actionKey, received] { RunHandler(handler, actionKey, received); });
+    }
+    catch (...)
+    {
+        RecordActivation(ToastResultFail, actionKey, received);
+        throw;
+    }
+
+    switch (submitted)
+    {
+    case ActivationSubmitResult::Queued:
+        return ToastResultOk;
+
+    case ActivationSubmitResult::Rejected:
+        result = ToastResultBusy;
+        break;
+
+    default:
+        result = ToastResultIllegalMethodCall;
+        break;
+    }
+
+    m_metrics.RecordFailure(result);
+    if (m_startup != nullptr)
+    {
+        m_startup->OnCompleted();
+    }
+    return result;
+}
+
+ToastResult DesktopNotificationManager::Dispatch(ActivationEventArgs args, DispatchHandler handler)
+{
+    // Sequences start at one, so zero means not journaled
+    std::uint64_t sequence = 0;
+    if (m_journal != nullptr && !ToastSucceeded(RecordIfFailed(m_journal->Begin(args, sequence))))
+    {
+        sequence = 0;
+    }
+
+    // An executor needs a copyable handler, so the args are moved into a shared block rather than copied
+    return DispatchJournaled(std::make_shared<ActivationEventArgs>(std::move(args)), sequence, std::move(handler));
+}
+
+ToastResult DesktopNotificationManager::ReplayActivations(DispatchHandler handler)
+{
+    if (m_journal == nullptr)
+    {
+        return ToastResultIllegalMethodCall;
+    }
+
+    if (!handler)
+    {
+        handler = [this](const ActivationEventArgs& published)
+        {
+            return PublishActivation(published);
+        };
+    }
+
+    std::vector<ActivationJournalEntry> entries;
+    ToastResult first = RecordIfFailed(m_journal->Unfinished(entries));
+    for (ActivationJournalEntry& entry : entries)
+    {
+        // Retry counts the attempt before the handler runs, so one that keeps crashing the process is given up on
+        ToastResult result = RecordIfFailed(m_journal->Retry(entry.Sequence));
+        if (ToastSucceeded(result))
+        {
+            result = DispatchJournaled(std::make_shared<ActivationEventArgs>(std::move(entry.Args)), entry.Sequence, handler);
+        }
+        first = ToastSucceeded(first) ? result : first;
+    }
+    return first;
+}
+
+ToastResult DesktopNotificationManager::RemoveFromHistory(const std::wstring& tag, const std::wstring& group)
+{
+    ToastResult result = m_platform.RemoveFromHistory(m_aumid, tag, group);
+    if (ToastSucceeded(result))
+    {
+        m_historyIndex.OnRemoved(tag, group);
+    }
+    return result;
+}
+
+ToastResult DesktopNotificationManager::RemoveGroupFromHistory(const std::wstring& group)
+{
+    ToastResult result = m_platform.RemoveGroupFromHistory(m_aumid, group);
+    if (ToastSucceeded(result))
+    {
+        m_historyIndex.OnGroupRemoved(group);
+    }
+    return result;
+}
+
+ToastResult DesktopNotificationManager::ClearHistory()
+{
+    ToastResult result = m_platform.ClearHistory(m_aumid);
+    if (ToastSucceeded(result))
+    {
+        m_historyIndex.OnCleared();
+    }
+    return result;
+}
+
+ToastResult DesktopNotificationManager::ReconcileHistory(ToastHistoryReconcileResult& result)
+{
+    std::vector<ToastHistoryEntry> entries;
+    ToastResult status = m_platform.GetHistory(m_aumid, entries);
+    if (ToastSucceeded(status))
+    {
+        result = m_historyIndex.Reconcile(entries);
+    }
+    return status;
+}
+
+ToastResult DesktopNotificationManager::Uninstall()
+{
+    ToastResult first = ToastResultOk;
+    if (!m_aumid.empty())
+    {
+        first = RecordIfFailed(m_platform.ClearSchedule(m_aumid));
+
+        ToastResult result = RecordIfFailed(m_platform.ClearHistory(m_aumid));
+        first = ToastSucceeded(first) ? result : first;
+    }
+
+    m_historyIndex.OnCleared();
+
+    if (!m_aumid.empty())
+    {
+        // A COM-only registration has no AUMID key, and keeps its fingerprint in the server key, which stays
+        ToastResult result = m_platform.DeleteRegistryKey(AumidKey());
+        result = RecordIfFailed(result == ToastResultNotFound ? ToastResultOk : result);
+        first = ToastSucceeded(first) ? result : first;
+
+        std::wstring clsid = m_activatorClsid.empty() ? DefaultActivatorClsid() : m_activatorClsid;
+        result = RecordIfFailed(m_platform.DeleteRegistryValues(ServerKey(clsid), { ToastRegistration::FingerprintValueName }));
+        first = ToastSucceeded(first) ? result : first;
+        m_activatorClsid.clear();
+    }
+    return first;
+}
+
+ToastResult DesktopNotificationManager::DispatchJournaled(std::shared_ptr<ActivationEventArgs> args, std::uint64_t sequence, DispatchHandler handler)
+{
+    std::wstring_view arguments = args->Argument();
+    return Dispatch(arguments, [this, args = std::move(args), sequence, handler = std::move(handler)]
+    {
+        ToastResult result = handler(*args);
+
+        // Not reached if the handler throws, which leaves the activation unfinished; ReplayActivations on the next start retries it
+        if (sequence != 0)
+        {
+            RecordIfFailed(m_journal->Complete(sequence));
+        }
+        return result;
+    });
+}
+
+// Records the activation however the handler finishes, so a startup waiting on it always sees it complete
+ToastResult DesktopNotificationManager::RunHandler(const std::function<ToastResult()>& handler, std::uint32_t actionKey, Clock::time_point received)
+{
+    ToastResult result;
+    try
+    {
+        result = handler();
+    }
+    catch (...)
+    {
+        RecordActivation(ToastResultFail, actionKey, received);
+        throw;
+    }
+
+    RecordActivation(result, actionKey, received);
+    return result;
+}
+
+// Subscribers that throw fail the activation, but it's still finished: the journal isn't left to replay it to the
+// subscribers that handled it
+ToastResult DesktopNotificationManager::PublishActivation(const ActivationEventArgs& args)
+{
+    std::size_t failed = 0;
+    m_activations.Publish(args, failed);
+    return failed == 0 ? ToastResultOk : ToastResultFail;
+}
+
+void DesktopNotificationManager::RecordActivation(ToastResult result, std::uint32_t actionKey, Clock::time_point received)
+{
+    m_metrics.RecordActivation(actionKey, Clock::now() - received);
+    RecordIfFailed(result);
+
+    if (m_startup != nullptr)
+    {
+        m_startup->OnCompleted();
+    }
+}
+
+ToastResult DesktopNotificationManager::RecordIfFailed(ToastResult result)
+{
+    if (!ToastSucceeded(result))
+    {
+        m_metrics.RecordFailure(result);
+    }
+    return result;
+}
+
+std::wstring DesktopNotificationManager::AumidKey() const
+{
+    return LR"(SOFTWARE\Classes\AppUserModelId\)" + m_aumid;
+}
+
+std::wstring DesktopNotificationManager::DefaultActivatorClsid() const
+{
+    return L"{" + MakeAumidClsid(m_aumid).ToString() + L"}";
+}
+
+std::wstring DesktopNotificationManager::ServerKey(const std::wstring& clsid)
+{
+    return LR"(SOFTWARE\Classes\CLSID\)" + clsid + LR"(\LocalServer32)";
+}
@@ -0,0 +1,239 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "ActivationBus.h"
+#include "ActivationEventArgs.h"
+#include "ActivationExecutor.h"
+#include "ActivationJournal.h"
+#include "ActivationStartup.h"
+#include "INotificationPlatform.h"
+#include "ToastHistoryIndex.h"
+#include "ToastMetrics.h"
+#include "ToastPayload.h"
+#include "ToastRateLimiter.h"
+
+/// <summary>
+/// What an unpackaged app writes to the registry so the platform can show its toasts and start it for activations.
+/// </summary>
+struct DesktopNotificationRegistration
+{
+    /// <summary>
+    /// Shown in Action Center and Settings. Leave empty to register only the COM server, for apps whose Start menu
+    /// shortcut carries the AUMID and the activator's CLSID.
+    /// </summary>
+    std::wstring DisplayName;
+    std::wstring IconPath;
+
+    /// <summary>
+    /// Only appears in the Settings page. Hex without a leading #, like "FFDDDDDD".
+    /// </summary>
+    std::wstring IconBackgroundColor;
+
+    /// <summary>
+    /// The activator's CLSID in braces. Defaults to MakeAumidClsid(aumid), which is the same on every start and every machine.
+    /// </summary>
+    std::wstring ActivatorClsid;
+
+    /// <summary>
+    /// The command COM runs to start the app for an activation, such as ProcessIdentitySnapshot::LaunchCommand.
+    /// </summary>
+    std::wstring LaunchCommand;
+};
+
+/// <summary>
+/// Everything that belongs to one app identity: its AUMID and registration, its activation bus and executor,
+/// the index of the toasts it has shown, and its metrics. Instances share nothing but the platform they're given,
+/// so a process that fronts several identities can send and handle activations for each of them on separate threads
+/// without them contending with each other; give each its own platform object to keep the platform's caches apart
+/// too. The static DesktopNotificationManagerCompat API is a facade over a default instance.
+///
+/// An empty AUMID stands for the process's package identity. Set up the executor before activations can arrive; handlers
+/// can subscribe at any time.
+/// </summary>
+class DesktopNotificationManager
+{
+public:
+    using ActivatedHandler = ActivationBus::Handler;
+    using DispatchHandler = std::function<ToastResult(const ActivationEventArgs&)>;
+
+    /// <summary>
+    /// The platform must be safe to call from multiple threads and outlive the manager.
+    /// </summary>
+    DesktopNotificationManager(INotificationPlatform& platform, std::wstring aumid);
+
+    DesktopNotificationManager(const DesktopNotificationManager&) = delete;
+    DesktopNotificationManager& operator=(const DesktopNotificationManager&) = delete;
+
+    const std::wstring& Aumid() const { return m_aumid; }
+    INotificationPlatform& Platform() const { return m_platform; }
+
+    /// <summary>
+    /// Counts and times this identity's sends and activations, and counts its failures by result.
+    /// </summary>
+    ToastMetrics& Metrics() { return m_metrics; }
+
+    /// <summary>
+    /// What this identity has shown through Show, so history queries don't need a call to the platform.
+    /// </summary>
+    ToastHistoryIndex& HistoryIndex() { return m_historyIndex; }
+
+    /// <summary>
+    /// Writes the registration under this AUMID, skipping the writes if it's already there. Does nothing for the
+    /// package identity, which is registered through its manifest.
+    /// </summary>
+    ToastResult Register(const DesktopNotificationRegistration& registration);
+
+    /// <summary>
+    /// The CLSID, in braces, that Register pointed the platform at. Empty until Register succeeds.
+    /// </summary>
+    const std::wstring& ActivatorClsid() const { return m_activatorClsid; }
+
+    /// <summary>
+    /// The subscribers Activate delivers to. They run inline, or on the executor if UseActivationExecutor was called.
+    /// </summary>
+    ActivationBus& Activations() { return m_activations; }
+
+    /// <summary>
+    /// Replaces the handler set by the last call, leaving other subscribers to Activations() alone. Null removes it.
+    /// </summary>
+    void OnActivated(ActivatedHandler handler);
+
+    /// <summary>
+    /// Runs handlers on worker threads, so the COM call that delivers an activation returns immediately. Activations
+    /// whose arguments have the same value for orderingArgument, a key your toasts put in their launch arguments such
+    /// as L"conversationId", are handled one at a time, in order. Those without it, or every activation if it's empty,
+    /// are handled in parallel.
+    /// </summary>
+    ToastResult UseActivationExecutor(ActivationExecutorOptions options, std::wstring orderingArgument);
+
+    /// <summary>
+    /// Reports each activation to startup as it arrives and once it's been handled, so an activation-only start knows
+    /// when it's done. Call before activations can arrive; startup must outlive them.
+    /// </summary>
+    void TrackActivations(ActivationStartup* startup) { m_startup = startup; }
+
+    /// <summary>
+    /// Writes each activation that comes through Activate, or Dispatch with its args, to the journal before its handler
+    /// runs, and completes it once the handler returns. Those whose handler threw, or never finished because the process
+    /// died, are handled again by ReplayActivations, which is called at startup, so they're retried on the next start of
+    /// the process rather than in this one. Call before activations can arrive; journal must outlive them.
+    /// </summary>
+    void JournalActivations(ActivationJournal* journal) { m_journal = journal; }
+
+    /// <summary>
+    /// Rate-limits Show per group from now on. Show then returns ToastResultOk for a toast that's held back (or that
+    /// replaces a held one with the same tag and group) and ToastResultBusy for one dropped for lack of room; held
+    /// toasts are shown by the limiter's pump, or by PumpRateLimiter if options.BackgroundPump is false, and counted
+    /// in Metrics like the rest. Call before the first Show.
+    /// </summary>
+    ToastResult UseRateLimiter(ToastRateLimiterOptions options);
+
+    /// <summary>
+    /// Shows held toasts whose groups have tokens again, for a limiter without a background pump. Returns when the
+    /// next one can go, or ToastRateLimiter::Clock::time_point::max() if nothing is held or there's no limiter.
+    /// </summary>
+    ToastRateLimiter::Clock::time_point PumpRateLimiter();
+
+    /// <summary>
+    /// Shows the toast under this AUMID, counting it in Metrics and adding it to HistoryIndex once it's shown. Goes
+    /// through the rate limiter if UseRateLimiter was called.
+    /// </summary>
+    ToastResult Show(const ToastPayload& payload);
+
+    /// <summary>
+    /// Publishes an activation to Activations() through Dispatch. Does nothing if there are no subscribers. A subscriber
+    /// that throws fails the activation without keeping it from the others, and it's still marked done in the journal, so
+    /// the subscribers that handled it don't see it again on the next start.
+    /// </summary>
+    ToastResult Activate(ActivationEventArgs args);
+
+    /// <summary>
+    /// Runs the handler for an activation with these arguments: on the executor if there is one, otherwise right away,
+    /// returning its result. Returns ToastResultBusy if the executor rejects it because its queue is full. A handler that
+    /// throws fails the activation, which is recorded like any other failure; the exception is caught here, or by the
+    /// executor, and never reaches the caller, so this can be called from a COM callback.
+    /// </summary>
+    ToastResult Dispatch(std::wstring_view arguments, std::function<ToastResult()> handler);
+
+    /// <summary>
+    /// Dispatches the activation to the handler, journaling it first if JournalActivations was called. A failure to
+    /// write the journal is counted in Metrics, and the activation is handled anyway. If the handler throws, the
+    /// activation is left unfinished in the journal for the next start.
+    /// </summary>
+    ToastResult Dispatch(ActivationEventArgs args, DispatchHandler handler);
+
+    /// <summary>
+    /// Dispatches the activations the journal holds as unfinished from an earlier run, oldest first, to the handler,
+    /// or if it's null to Activations(). Call once the handlers are in place. Returns ToastResultIllegalMethodCall if
+    /// JournalActivations wasn't called, otherwise the first failure.
+    /// </summary>
+    ToastResult ReplayActivations(DispatchHandler handler = nullptr);
+
+    // History, kept in step with HistoryIndex
+
+    ToastResult RemoveFromHistory(const std::wstring& tag, const std::wstring& group);
+    ToastResult RemoveGroupFromHistory(const std::wstring& group);
+    ToastResult ClearHistory();
+    ToastResult ReconcileHistory(ToastHistoryReconcileResult& result);
+
+    /// <summary>
+    /// Clears this AUMID's scheduled toasts (first, so none are delivered after) and history, and deletes its registry key
+    /// and the registration fingerprint, so that registering again writes everything. Carries on past failures, which are
+    /// counted in Metrics, and returns the first.
+    /// </summary>
+    ToastResult Uninstall();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    ToastResult ShowNow(const ToastPayload& payload);
+    ToastResult DispatchJournaled(std::shared_ptr<ActivationEventArgs> args, std::uint64_t sequence, DispatchHandler handler);
+    ToastResult RunHandler(const std::function<ToastResult()>& handler, std::uint32_t actionKey, Clock::time_point received);
+    ToastResult PublishActivation(const ActivationEventArgs& args);
+    void RecordActivation(ToastResult result, std::uint32_t actionKey, Clock::time_point received);
+    ToastResult RecordIfFailed(ToastResult result);
+    std::wstring AumidKey() const;
+    std::wstring DefaultActivatorClsid() const;
+    static std::wstring ServerKey(const std::wstring& clsid);
+
+    INotificationPlatform& m_platform;
+    const std::wstring m_aumid;
+    std::wstring m_activatorClsid;
+
+    ToastHistoryIndex m_historyIndex;
+
+    // Declared before the executor, so it outlives the handlers that record into it
+    ToastMetrics m_metrics;
+
+    ActivationBus m_activations;
+
+    // Only OnActivated takes this, so replacing its handler is one step; Activate never does
+    std::mutex m_handlerMutex;
+    ActivationSubscription m_onActivated = 0;
+
+    std::unique_ptr<ActivationExecutor> m_activationExecutor;
+    std::wstring m_activationOrderingArgument;
+
+    ActivationStartup* m_startup = nullptr;
+    ActivationJournal* m_journal = nullptr;
+
+    // Declared last, so its pump has stopped before the metrics and index it shows into go
+    std::unique_ptr<ToastRateLimiter> m_rateLimiter;
+};
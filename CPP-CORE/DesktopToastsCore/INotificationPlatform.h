@@ -0,0 +1,167 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ToastPayload.h"
+
+/// <summary>
+/// Status returned by INotificationPlatform calls. Values are HRESULT-compatible so the Windows
+/// implementations can pass platform errors through unchanged: zero or positive is success, negative is failure.
+/// </summary>
+using ToastResult = std::int32_t;
+
+constexpr ToastResult ToastResultOk = 0;
+constexpr ToastResult ToastResultFail = static_cast<ToastResult>(0x80004005);              // E_FAIL
+constexpr ToastResult ToastResultInvalidArgument = static_cast<ToastResult>(0x80070057);   // E_INVALIDARG
+constexpr ToastResult ToastResultNotFound = static_cast<ToastResult>(0x80070002);          // HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND)
+constexpr ToastResult ToastResultTooLarge = static_cast<ToastResult>(0x8000000B);          // E_BOUNDS
+constexpr ToastResult ToastResultIllegalMethodCall = static_cast<ToastResult>(0x8000000E); // E_ILLEGAL_METHOD_CALL
+constexpr ToastResult ToastResultBusy = static_cast<ToastResult>(0x800700AA);              // HRESULT_FROM_WIN32(ERROR_BUSY)
+constexpr ToastResult ToastResultTimeout = static_cast<ToastResult>(0x800705B4);           // HRESULT_FROM_WIN32(ERROR_TIMEOUT)
+
+inline bool ToastSucceeded(ToastResult result)
+{
+    return result >= 0;
+}
+
+/// <summary>
+/// A toast currently in Action Center.
+/// </summary>
+struct ToastHistoryEntry
+{
+    std::wstring Tag;
+    std::wstring Group;
+
+    /// <summary>
+    /// The launch attribute of the toast's root element.
+    /// </summary>
+    std::wstring Launch;
+};
+
+/// <summary>
+/// A toast waiting in the platform's schedule.
+/// </summary>
+struct ScheduledToast
+{
+    std::wstring Id;
+    ToastPayload Payload;
+    std::chrono::system_clock::time_point DeliveryTime;
+};
+
+/// <summary>
+/// A named string value under a registry key. An empty name refers to the key's default value.
+/// </summary>
+struct RegistryValue
+{
+    std::wstring Name;
+    std::wstring Value;
+};
+
+/// <summary>
+/// Everything the notification library needs from the OS: showing toasts, Action Center history,
+/// scheduled toasts, the registry and the process's package identity. The Windows implementations
+/// call ToastNotificationManager and the Win32 APIs; InMemoryNotificationPlatform stands in for them
+/// on machines without a notification platform.
+///
+/// An empty aumid refers to the calling app's own package identity. Registry keys are relative to
+/// HKEY_CURRENT_USER. Implementations must be safe to call from multiple threads.
+/// </summary>
+class INotificationPlatform
+{
+public:
+    virtual ~INotificationPlatform() = default;
+
+    // Notifier
+
+    virtual ToastResult Show(const std::wstring& aumid, const ToastPayload& payload) = 0;
+
+    /// <summary>
+    /// Changes the bound values of a toast that's already showing, without re-rendering it. Values not in the update
+    /// keep their current value. Returns ToastResultNotFound if the toast is no longer in Action Center.
+    /// </summary>
+    virtual ToastResult Update(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group, const ToastData& data) = 0;
+
+    // History
+
+    virtual ToastResult GetHistory(const std::wstring& aumid, std::vector<ToastHistoryEntry>& entries) = 0;
+    virtual ToastResult RemoveFromHistory(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group) = 0;
+    virtual ToastResult RemoveGroupFromHistory(const std::wstring& aumid, const std::wstring& group) = 0;
+
+    /// <summary>
+    /// Removes several toasts by tag and group, with one result per toast. The default calls RemoveFromHistory
+    /// for each; implementations that can remove a batch in fewer round trips should override it.
+    /// </summary>
+    virtual void RemoveBatchFromHistory(const std::wstring& aumid, const std::vector<ToastHistoryEntry>& toasts, std::vector<ToastResult>& results)
+    {
+        results.clear();
+        results.reserve(toasts.size());
+        for (const ToastHistoryEntry& toast : toasts)
+        {
+            results.push_back(RemoveFromHistory(aumid, toast.Tag, toast.Group));
+        }
+    }
+
+    virtual ToastResult ClearHistory(const std::wstring& aumid) = 0;
+
+    // Scheduling
+
+    virtual ToastResult AddToSchedule(const std::wstring& aumid, const ScheduledToast& toast) = 0;
+    virtual ToastResult GetScheduled(const std::wstring& aumid, std::vector<ScheduledToast>& toasts) = 0;
+
+    /// <summary>
+    /// Removes every scheduled toast with the given id. Returns ToastResultNotFound if there were none.
+    /// </summary>
+    virtual ToastResult RemoveFromSchedule(const std::wstring& aumid, const std::wstring& id) = 0;
+    virtual ToastResult ClearSchedule(const std::wstring& aumid) = 0;
+
+    // Registry
+
+    /// <summary>
+    /// Reads a string value. Returns ToastResultNotFound if the key or value doesn't exist.
+    /// </summary>
+    virtual ToastResult ReadRegistryValue(const std::wstring& subKey, const std::wstring& valueName, std::wstring& value) = 0;
+
+    /// <summary>
+    /// Creates the key if needed and writes all the values through a single open key.
+    /// </summary>
+    virtual ToastResult WriteRegistryValues(const std::wstring& subKey, const std::vector<RegistryValue>& values) = 0;
+    virtual ToastResult DeleteRegistryValue(const std::wstring& subKey, const std::wstring& valueName) = 0;
+
+    /// <summary>
+    /// Deletes the values through a single open key. Values that don't exist, or a key that doesn't, aren't an error.
+    /// </summary>
+    virtual ToastResult DeleteRegistryValues(const std::wstring& subKey, const std::vector<std::wstring>& valueNames) = 0;
+    virtual ToastResult DeleteRegistryKey(const std::wstring& subKey) = 0;
+
+    // Identity
+
+    /// <summary>
+    /// Returns ToastResultNotFound if the process has no package identity.
+    /// </summary>
+    virtual ToastResult GetPackageFamilyName(std::wstring& familyName) = 0;
+    virtual ToastResult GetPackageInstalledLocation(std::wstring& path) = 0;
+    virtual ToastResult GetModulePath(std::wstring& path) = 0;
+
+    // Caches
+
+    /// <summary>
+    /// Drops the objects the implementation keeps from the OS, such as notifiers and history objects, so later calls
+    /// look them up again. Called once the app's registration has been removed. The default does nothing.
+    /// </summary>
+    virtual void ClearCaches()
+    {
+    }
+};
@@ -0,0 +1,667 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "InMemoryNotificationPlatform.h"
+#include <algorithm>
+#include <cwctype>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    std::size_t Index(InMemoryPlatformOperation operation)
+    {
+        return static_cast<std::size_t>(operation);
+    }
+
+    void Wait(std::chrono::nanoseconds latency)
+    {
+        if (latency >= std::chrono::milliseconds(1))
+        {
+            std::this_thread::sleep_for(latency);
+            return;
+        }
+
+        auto until = std::chrono::steady_clock::now() + latency;
+        while (std::chrono::steady_clock::now() < until)
+        {
+        }
+    }
+}
+
+void InMemoryNotificationPlatform::SetLatency(InMemoryPlatformOperation operation, std::chrono::nanoseconds latency)
+{
+    m_operations[Index(operation)].LatencyNanoseconds.store(latency.count());
+}
+
+void InMemoryNotificationPlatform::SetFailure(InMemoryPlatformOperation operation, ToastResult result)
+{
+    m_operations[Index(operation)].Failure.store(result);
+}
+
+void InMemoryNotificationPlatform::SetPackageIdentity(std::wstring familyName, std::wstring installedLocation)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_packageFamilyName = std::move(familyName);
+    m_packageInstalledLocation = std::move(installedLocation);
+}
+
+void InMemoryNotificationPlatform::SetModulePath(std::wstring path)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_modulePath = std::move(path);
+}
+
+void InMemoryNotificationPlatform::SetRecordShows(bool record)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_recordShows = record;
+}
+
+std::size_t InMemoryNotificationPlatform::DeliverDue(std::chrono::system_clock::time_point now)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+    std::size_t delivered = 0;
+    for (auto& aumid : m_aumids)
+    {
+        AumidState& state = aumid.second;
+        auto due = state.Scheduled.upper_bound(now);
+        for (auto it = state.Scheduled.begin(); it != due;)
+        {
+            auto range = state.ScheduledById.equal_range(it->second.Id);
+            for (auto byId = range.first; byId != range.second; ++byId)
+            {
+                if (byId->second == it)
+                {
+                    state.ScheduledById.erase(byId);
+                    break;
+                }
+            }
+
+            AddToHistory(state, it->second.Payload);
+            it = state.Scheduled.erase(it);
+            delivered++;
+        }
+    }
+
+    return delivered;
+}
+
+void InMemoryNotificationPlatform::Reset()
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_aumids.clear();
+    m_shown.clear();
+    m_showCount = 0;
+    m_registry.clear();
+
+    for (OperationState& operation : m_operations)
+    {
+        operation.Calls.store(0);
+    }
+}
+
+std::uint64_t InMemoryNotificationPlatform::CallCount(InMemoryPlatformOperation operation) const
+{
+    return m_operations[Index(operation)].Calls.load(std::memory_order_relaxed);
+}
+
+std::uint64_t InMemoryNotificationPlatform::ShowCount() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_showCount;
+}
+
+std::vector<InMemoryShownToast> InMemoryNotificationPlatform::Shown() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_shown;
+}
+
+std::size_t InMemoryNotificationPlatform::HistoryCount(const std::wstring& aumid) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    const AumidState* state = FindAumid(aumid);
+    return state ? state->History.size() : 0;
+}
+
+bool InMemoryNotificationPlatform::HistoryContains(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    const AumidState* state = FindAumid(aumid);
+    return state && state->HistoryByKey.count(HistoryKey(tag, group)) != 0;
+}
+
+bool InMemoryNotificationPlatform::GetHistoryData(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group, ToastData& data) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    const AumidState* state = FindAumid(aumid);
+    if (!state)
+    {
+        return false;
+    }
+
+    auto it = state->DataByKey.find(HistoryKey(tag, group));
+    if (it == state->DataByKey.end())
+    {
+        return false;
+    }
+
+    data = it->second;
+    return true;
+}
+
+std::size_t InMemoryNotificationPlatform::ScheduledCount(const std::wstring& aumid) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    const AumidState* state = FindAumid(aumid);
+    return state ? state->Scheduled.size() : 0;
+}
+
+ToastResult InMemoryNotificationPlatform::Show(const std::wstring& aumid, const ToastPayload& payload)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Show);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_showCount++;
+    if (m_recordShows)
+    {
+        m_shown.push_back(InMemoryShownToast{ aumid, payload, m_showCount });
+    }
+
+    AddToHistory(m_aumids[aumid], payload);
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::Update(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group, const ToastData& data)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Update);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    AumidState* state = FindAumid(aumid);
+    if (!state || tag.empty())
+    {
+        return ToastResultNotFound;
+    }
+
+    auto it = state->DataByKey.find(HistoryKey(tag, group));
+    if (it == state->DataByKey.end())
+    {
+        return ToastResultNotFound;
+    }
+
+    // Like the platform, a stale update is dropped but still succeeds
+    ToastData& current = it->second;
+    if (data.SequenceNumber != 0 && data.SequenceNumber <= current.SequenceNumber)
+    {
+        return ToastResultOk;
+    }
+
+    for (const ToastDataValue& value : data.Values)
+    {
+        auto existing = std::find_if(current.Values.begin(), current.Values.end(), [&value](const ToastDataValue& v) { return v.Key == value.Key; });
+        if (existing != current.Values.end())
+        {
+            existing->Value = value.Value;
+        }
+        else
+        {
+            current.Values.push_back(value);
+        }
+    }
+    if (data.SequenceNumber != 0)
+    {
+        current.SequenceNumber = data.SequenceNumber;
+    }
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::GetHistory(const std::wstring& aumid, std::vector<ToastHistoryEntry>& entries)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::History);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    entries.clear();
+
+    const AumidState* state = FindAumid(aumid);
+    if (state)
+    {
+        entries.assign(state->History.begin(), state->History.end());
+    }
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::RemoveFromHistory(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::History);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    AumidState* state = FindAumid(aumid);
+    if (state)
+    {
+        auto it = state->HistoryByKey.find(HistoryKey(tag, group));
+        if (it != state->HistoryByKey.end())
+        {
+            RemoveHistoryEntry(*state, it->second);
+        }
+    }
+
+    // Like the platform, removing a toast that isn't there succeeds
+    return ToastResultOk;
+}
+
+void InMemoryNotificationPlatform::RemoveBatchFromHistory(const std::wstring& aumid, const std::vector<ToastHistoryEntry>& toasts, std::vector<ToastResult>& results)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::History);
+    results.assign(toasts.size(), result);
+    if (!ToastSucceeded(result))
+    {
+        return;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    AumidState* state = FindAumid(aumid);
+    if (state)
+    {
+        for (const ToastHistoryEntry& toast : toasts)
+        {
+            auto it = state->HistoryByKey.find(HistoryKey(toast.Tag, toast.Group));
+            if (it != state->HistoryByKey.end())
+            {
+                RemoveHistoryEntry(*state, it->second);
+            }
+        }
+    }
+}
+
+ToastResult InMemoryNotificationPlatform::RemoveGroupFromHistory(const std::wstring& aumid, const std::wstring& group)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::History);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    AumidState* state = FindAumid(aumid);
+    if (state)
+    {
+        auto it = state->HistoryByGroup.find(group);
+        if (it != state->HistoryByGroup.end())
+        {
+            std::vector<const ToastHistoryEntry*> entries(it->second.begin(), it->second.end());
+            for (const ToastHistoryEntry* entry : entries)
+            {
+                RemoveHistoryEntry(*state, entry);
+            }
+        }
+    }
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::ClearHistory(const std::wstring& aumid)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::History);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    AumidState* state = FindAumid(aumid);
+    if (state)
+    {
+        state->History.clear();
+        state->HistoryNodes.clear();
+        state->HistoryByKey.clear();
+        state->HistoryByGroup.clear();
+        state->DataByKey.clear();
+    }
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::AddToSchedule(const std::wstring& aumid, const ScheduledToast& toast)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Schedule);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    AumidState& state = m_aumids[aumid];
+    auto it = state.Scheduled.emplace(toast.DeliveryTime, toast);
+    state.ScheduledById.emplace(toast.Id, it);
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::GetScheduled(const std::wstring& aumid, std::vector<ScheduledToast>& toasts)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Schedule);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    toasts.clear();
+
+    const AumidState* state = FindAumid(aumid);
+    if (state)
+    {
+        toasts.reserve(state->Scheduled.size());
+        for (const auto& scheduled : state->Scheduled)
+        {
+            toasts.push_back(scheduled.second);
+        }
+    }
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::RemoveFromSchedule(const std::wstring& aumid, const std::wstring& id)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Schedule);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    AumidState* state = FindAumid(aumid);
+    if (!state)
+    {
+        return ToastResultNotFound;
+    }
+
+    auto range = state->ScheduledById.equal_range(id);
+    if (range.first == range.second)
+    {
+        return ToastResultNotFound;
+    }
+
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        state->Scheduled.erase(it->second);
+    }
+    state->ScheduledById.erase(range.first, range.second);
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::ClearSchedule(const std::wstring& aumid)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Schedule);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    AumidState* state = FindAumid(aumid);
+    if (state)
+    {
+        state->Scheduled.clear();
+        state->ScheduledById.clear();
+    }
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::ReadRegistryValue(const std::wstring& subKey, const std::wstring& valueName, std::wstring& value)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Registry);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto key = m_registry.find(RegistryKey(subKey));
+    if (key == m_registry.end())
+    {
+        return ToastResultNotFound;
+    }
+
+    auto found = key->second.find(RegistryKey(valueName));
+    if (found == key->second.end())
+    {
+        return ToastResultNotFound;
+    }
+
+    value = found->second;
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::WriteRegistryValues(const std::wstring& subKey, const std::vector<RegistryValue>& values)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Registry);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto& key = m_registry[RegistryKey(subKey)];
+    for (const RegistryValue& value : values)
+    {
+        key[RegistryKey(value.Name)] = value.Value;
+    }
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::DeleteRegistryValue(const std::wstring& subKey, const std::wstring& valueName)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Registry);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto key = m_registry.find(RegistryKey(subKey));
+    if (key == m_registry.end() || key->second.erase(RegistryKey(valueName)) == 0)
+    {
+        return ToastResultNotFound;
+    }
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::DeleteRegistryValues(const std::wstring& subKey, const std::vector<std::wstring>& valueNames)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Registry);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto key = m_registry.find(RegistryKey(subKey));
+    if (key != m_registry.end())
+    {
+        for (const std::wstring& valueName : valueNames)
+        {
+            key->second.erase(RegistryKey(valueName));
+        }
+    }
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::DeleteRegistryKey(const std::wstring& subKey)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Registry);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    return m_registry.erase(RegistryKey(subKey)) != 0 ? ToastResultOk : ToastResultNotFound;
+}
+
+ToastResult InMemoryNotificationPlatform::GetPackageFamilyName(std::wstring& familyName)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Identity);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    if (m_packageFamilyName.empty())
+    {
+        return ToastResultNotFound;
+    }
+
+    familyName = m_packageFamilyName;
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::GetPackageInstalledLocation(std::wstring& path)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Identity);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    if (m_packageFamilyName.empty())
+    {
+        return ToastResultNotFound;
+    }
+
+    path = m_packageInstalledLocation;
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::GetModulePath(std::wstring& path)
+{
+    ToastResult result = BeginCall(InMemoryPlatformOperation::Identity);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    path = m_modulePath;
+    return ToastResultOk;
+}
+
+ToastResult InMemoryNotificationPlatform::BeginCall(InMemoryPlatformOperation operation)
+{
+    OperationState& state = m_operations[Index(operation)];
+    state.Calls.fetch_add(1, std::memory_order_relaxed);
+
+    std::int64_t latency = state.LatencyNanoseconds.load(std::memory_order_relaxed);
+    if (latency > 0)
+    {
+        Wait(std::chrono::nanoseconds(latency));
+    }
+
+    return state.Failure.load(std::memory_order_relaxed);
+}
+
+InMemoryNotificationPlatform::AumidState* InMemoryNotificationPlatform::FindAumid(const std::wstring& aumid)
+{
+    auto it = m_aumids.find(aumid);
+    return it != m_aumids.end() ? &it->second : nullptr;
+}
+
+const InMemoryNotificationPlatform::AumidState* InMemoryNotificationPlatform::FindAumid(const std::wstring& aumid) const
+{
+    auto it = m_aumids.find(aumid);
+    return it != m_aumids.end() ? &it->second : nullptr;
+}
+
+void InMemoryNotificationPlatform::AddToHistory(AumidState& state, const ToastPayload& payload)
+{
+    std::wstring key;
+    if (!payload.Tag.empty())
+    {
+        key = HistoryKey(payload.Tag, payload.Group);
+
+        // The replacement goes to the end, as the newest toast
+        auto existing = state.HistoryByKey.find(key);
+        if (existing != state.HistoryByKey.end())
+        {
+            RemoveHistoryEntry(state, existing->second);
+        }
+    }
+
+    state.History.push_back(ToastHistoryEntry{ payload.Tag, payload.Group, ReadToastLaunch(payload.Xml) });
+    auto node = std::prev(state.History.end());
+    const ToastHistoryEntry* entry = &*node;
+
+    state.HistoryNodes.emplace(entry, node);
+    state.HistoryByGroup[payload.Group].insert(entry);
+    if (!payload.Tag.empty())
+    {
+        state.DataByKey[key] = payload.Data;
+        state.HistoryByKey.emplace(std::move(key), entry);
+    }
+}
+
+void InMemoryNotificationPlatform::RemoveHistoryEntry(AumidState& state, const ToastHistoryEntry* entry)
+{
+    if (!entry->Tag.empty())
+    {
+        std::wstring key = HistoryKey(entry->Tag, entry->Group);
+        state.HistoryByKey.erase(key);
+        state.DataByKey.erase(key);
+    }
+
+    auto group = state.HistoryByGroup.find(entry->Group);
+    group->second.erase(entry);
+    if (group->second.empty())
+    {
+        state.HistoryByGroup.erase(group);
+    }
+
+    auto node = state.HistoryNodes.find(entry);
+    state.History.erase(node->second);
+    state.HistoryNodes.erase(node);
+}
+
+std::wstring InMemoryNotificationPlatform::HistoryKey(const std::wstring& tag, const std::wstring& group)
+{
+    std::wstring key;
+    key.reserve(group.size() + 1 + tag.size());
+    key += group;
+    key += L'\0';
+    key += tag;
+    return key;
+}
+
+std::wstring InMemoryNotificationPlatform::RegistryKey(const std::wstring& name)
+{
+    std::wstring key(name);
+    for (wchar_t& c : key)
+    {
+        c = static_cast<wchar_t>(std::towlower(c));
+    }
+    return key;
+}
@@ -0,0 +1,198 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "INotificationPlatform.h"
+
+/// <summary>
+/// The groups of INotificationPlatform calls that latency and failures can be injected into.
+/// </summary>
+enum class InMemoryPlatformOperation
+{
+    Show,
+    Update,
+    History,
+    Schedule,
+    Registry,
+    Identity
+};
+
+constexpr std::size_t InMemoryPlatformOperationCount = 6;
+
+struct InMemoryShownToast
+{
+    std::wstring Aumid;
+    ToastPayload Payload;
+
+    /// <summary>
+    /// Position of this show among all shows since the last Reset, starting at 1.
+    /// </summary>
+    std::uint64_t Sequence;
+};
+
+/// <summary>
+/// An INotificationPlatform that keeps everything in memory, for load tests and profiling on machines
+/// without a notification platform. Shows land in Action Center history the way they do on Windows:
+/// a toast with the same tag and group replaces the earlier one. History is indexed by tag and group
+/// and the schedule by id and delivery time, so every call stays O(1) or O(log n) however much has
+/// been shown. A tagged toast keeps its bound data, which Update merges into and which sequence
+/// numbers protect from going backwards, as on Windows. Each call can be given an artificial latency, which is spent outside the lock so
+/// concurrent callers overlap like they would against the real cross-process platform.
+/// </summary>
+class InMemoryNotificationPlatform : public INotificationPlatform
+{
+public:
+    InMemoryNotificationPlatform() = default;
+
+    InMemoryNotificationPlatform(const InMemoryNotificationPlatform&) = delete;
+    InMemoryNotificationPlatform& operator=(const InMemoryNotificationPlatform&) = delete;
+
+    /// <summary>
+    /// Adds a delay to every call in the group. Delays under a millisecond are spun rather than slept for accuracy.
+    /// </summary>
+    void SetLatency(InMemoryPlatformOperation operation, std::chrono::nanoseconds latency);
+
+    /// <summary>
+    /// Makes every call in the group fail with the given result, without changing any state. Pass ToastResultOk to stop.
+    /// </summary>
+    void SetFailure(InMemoryPlatformOperation operation, ToastResult result);
+
+    /// <summary>
+    /// Gives the process a package identity. Pass an empty family name to run as an unpackaged Win32 app (the default).
+    /// </summary>
+    void SetPackageIdentity(std::wstring familyName, std::wstring installedLocation);
+
+    void SetModulePath(std::wstring path);
+
+    /// <summary>
+    /// Whether every show is kept for Shown(). On by default; turn it off for long-running load tests.
+    /// </summary>
+    void SetRecordShows(bool record);
+
+    /// <summary>
+    /// Moves every scheduled toast due at or before the given time into history, as the platform would
+    /// when it delivers them. Returns the number delivered.
+    /// </summary>
+    std::size_t DeliverDue(std::chrono::system_clock::time_point now);
+
+    /// <summary>
+    /// Forgets all shows, history, scheduled toasts, registry values and call counts. Latency, failures and identity are kept.
+    /// </summary>
+    void Reset();
+
+    std::uint64_t CallCount(InMemoryPlatformOperation operation) const;
+    std::uint64_t ShowCount() const;
+    std::vector<InMemoryShownToast> Shown() const;
+    std::size_t HistoryCount(const std::wstring& aumid) const;
+    bool HistoryContains(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group) const;
+
+    /// <summary>
+    /// The current bound data of a toast in history. Returns false if there's no toast with that tag and group.
+    /// </summary>
+    bool GetHistoryData(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group, ToastData& data) const;
+    std::size_t ScheduledCount(const std::wstring& aumid) const;
+
+    // INotificationPlatform
+
+    ToastResult Show(const std::wstring& aumid, const ToastPayload& payload) override;
+    ToastResult Update(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group, const ToastData& data) override;
+
+    ToastResult GetHistory(const std::wstring& aumid, std::vector<ToastHistoryEntry>& entries) override;
+    ToastResult RemoveFromHistory(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group) override;
+    ToastResult RemoveGroupFromHistory(const std::wstring& aumid, const std::wstring& group) override;
+
+    /// <summary>
+    /// Counts as a single History call, with a single latency, however many toasts are in the batch.
+    /// </summary>
+    void RemoveBatchFromHistory(const std::wstring& aumid, const std::vector<ToastHistoryEntry>& toasts, std::vector<ToastResult>& results) override;
+    ToastResult ClearHistory(const std::wstring& aumid) override;
+
+    ToastResult AddToSchedule(const std::wstring& aumid, const ScheduledToast& toast) override;
+    ToastResult GetScheduled(const std::wstring& aumid, std::vector<ScheduledToast>& toasts) override;
+    ToastResult RemoveFromSchedule(const std::wstring& aumid, const std::wstring& id) override;
+    ToastResult ClearSchedule(const std::wstring& aumid) override;
+
+    ToastResult ReadRegistryValue(const std::wstring& subKey, const std::wstring& valueName, std::wstring& value) override;
+    ToastResult WriteRegistryValues(const std::wstring& subKey, const std::vector<RegistryValue>& values) override;
+    ToastResult DeleteRegistryValue(const std::wstring& subKey, const std::wstring& valueName) override;
+
+    /// <summary>
+    /// Counts as a single Registry call, with a single latency, however many values there are.
+    /// </summary>
+    ToastResult DeleteRegistryValues(const std::wstring& subKey, const std::vector<std::wstring>& valueNames) override;
+    ToastResult DeleteRegistryKey(const std::wstring& subKey) override;
+
+    ToastResult GetPackageFamilyName(std::wstring& familyName) override;
+    ToastResult GetPackageInstalledLocation(std::wstring& path) override;
+    ToastResult GetModulePath(std::wstring& path) override;
+
+private:
+    using HistoryList = std::list<ToastHistoryEntry>;
+    using ScheduleByTime = std::multimap<std::chrono::system_clock::time_point, ScheduledToast>;
+
+    struct AumidState
+    {
+        // Oldest first, like Action Center
+        HistoryList History;
+        std::unordered_map<const ToastHistoryEntry*, HistoryList::iterator> HistoryNodes;
+
+        // Keyed by group and tag; only tagged toasts can be addressed individually
+        std::unordered_map<std::wstring, const ToastHistoryEntry*> HistoryByKey;
+        std::unordered_map<std::wstring, std::unordered_set<const ToastHistoryEntry*>> HistoryByGroup;
+        std::unordered_map<std::wstring, ToastData> DataByKey;
+
+        ScheduleByTime Scheduled;
+        std::unordered_multimap<std::wstring, ScheduleByTime::iterator> ScheduledById;
+    };
+
+    struct OperationState
+    {
+        std::atomic<std::int64_t> LatencyNanoseconds{ 0 };
+        std::atomic<ToastResult> Failure{ ToastResultOk };
+        std::atomic<std::uint64_t> Calls{ 0 };
+    };
+
+    ToastResult BeginCall(InMemoryPlatformOperation operation);
+    AumidState* FindAumid(const std::wstring& aumid);
+    const AumidState* FindAumid(const std::wstring& aumid) const;
+    void AddToHistory(AumidState& state, const ToastPayload& payload);
+    static void RemoveHistoryEntry(AumidState& state, const ToastHistoryEntry* entry);
+    static std::wstring HistoryKey(const std::wstring& tag, const std::wstring& group);
+    static std::wstring RegistryKey(const std::wstring& name);
+
+    std::array<OperationState, InMemoryPlatformOperationCount> m_operations;
+
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<std::wstring, AumidState> m_aumids;
+    std::vector<InMemoryShownToast> m_shown;
+    std::uint64_t m_showCount = 0;
+    bool m_recordShows = true;
+
+    // Registry keys and value names are case-insensitive, so both are stored lowercased
+    std::unordered_map<std::wstring, std::unordered_map<std::wstring, std::wstring>> m_registry;
+
+    std::wstring m_packageFamilyName;
+    std::wstring m_packageInstalledLocation;
+    std::wstring m_modulePath;
+};
@@ -0,0 +1,143 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+/// <summary>
+/// A bounded multi-producer, single-consumer ring buffer. Producers claim a cell with a single
+/// compare-and-swap and never block each other; each cell carries a sequence number that tells the
+/// consumer when the producer has finished writing it. The capacity is rounded up to a power of two.
+/// TryPop must only be called by one thread at a time.
+/// </summary>
+template <typename T>
+class MpscRing
+{
+public:
+    explicit MpscRing(std::size_t capacity)
+    {
+        if (capacity < 2)
+        {
+            capacity = 2;
+        }
+
+        std::size_t size = 1;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+
+        m_mask = size - 1;
+        m_cells.reset(new Cell[size]);
+        for (std::size_t i = 0; i < size; i++)
+        {
+            m_cells[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MpscRing()
+    {
+        T discarded;
+        while (TryPop(discarded))
+        {
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    std::size_t Capacity() const { return m_mask + 1; }
+
+    /// <summary>
+    /// Adds an item. Returns false (leaving item untouched) if the ring is full.
+    /// </summary>
+    bool TryPush(T& item)
+    {
+        std::size_t position = m_tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true)
+        {
+            cell = &m_cells[position & m_mask];
+            std::size_t sequence = cell->Sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+            if (difference == 0)
+            {
+                if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (&cell->Storage) T(std::move(item));
+        cell->Sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// <summary>
+    /// Removes the oldest item. Returns false if the ring is empty or the oldest item is still being written.
+    /// </summary>
+    bool TryPop(T& item)
+    {
+        std::size_t position = m_head.load(std::memory_order_relaxed);
+        Cell& cell = m_cells[position & m_mask];
+        std::size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+        if (sequence != position + 1)
+        {
+            return false;
+        }
+
+        T* stored = reinterpret_cast<T*>(&cell.Storage);
+        item = std::move(*stored);
+        stored->~T();
+
+        cell.Sequence.store(position + m_mask + 1, std::memory_order_release);
+        m_head.store(position + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// <summary>
+    /// Approximate number of items in the ring; exact only when no producer or consumer is active.
+    /// </summary>
+    std::size_t SizeApprox() const
+    {
+        std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        std::size_t head = m_head.load(std::memory_order_relaxed);
+        return tail >= head ? tail - head : 0;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> Sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+    };
+
+    // Keep the producer and consumer indices on separate cache lines
+    alignas(64) std::atomic<std::size_t> m_tail{ 0 };
+    alignas(64) std::atomic<std::size_t> m_head{ 0 };
+    alignas(64) std::size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+};
@@ -0,0 +1,66 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ProcessIdentity.h"
+
+ProcessIdentity::ProcessIdentity(INotificationPlatform& platform, std::wstring launchArgument) :
+    m_platform(platform),
+    m_launchArgument(std::move(launchArgument))
+{
+}
+
+const ProcessIdentitySnapshot& ProcessIdentity::Get()
+{
+    if (!m_ready.load(std::memory_order_acquire))
+    {
+        std::call_once(m_once, [this] { TakeSnapshot(); });
+    }
+    return m_snapshot;
+}
+
+void ProcessIdentity::TakeSnapshot()
+{
+    ProcessIdentitySnapshot snapshot;
+
+    snapshot.HasIdentity = ToastSucceeded(m_platform.GetPackageFamilyName(snapshot.PackageFamilyName));
+    if (!snapshot.HasIdentity)
+    {
+        snapshot.PackageFamilyName.clear();
+    }
+
+    snapshot.Result = m_platform.GetModulePath(snapshot.ModulePath);
+    if (ToastSucceeded(snapshot.Result))
+    {
+        snapshot.LaunchCommand = L"\"" + snapshot.ModulePath + L"\" " + m_launchArgument;
+    }
+    else
+    {
+        snapshot.ModulePath.clear();
+    }
+
+    if (snapshot.HasIdentity && ToastSucceeded(snapshot.Result))
+    {
+        snapshot.Result = m_platform.GetPackageInstalledLocation(snapshot.PackageInstalledLocation);
+        if (ToastSucceeded(snapshot.Result))
+        {
+            // Sparse packages run from outside their installed location; MSIX apps run from inside it
+            snapshot.IsContainerized = snapshot.ModulePath.find(snapshot.PackageInstalledLocation) == 0;
+        }
+        else
+        {
+            snapshot.PackageInstalledLocation.clear();
+        }
+    }
+
+    m_snapshot = std::move(snapshot);
+    m_ready.store(true, std::memory_order_release);
+}
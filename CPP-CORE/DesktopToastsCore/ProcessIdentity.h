@@ -0,0 +1,79 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+#include "INotificationPlatform.h"
+
+/// <summary>
+/// What the process knows about its own packaging, read once.
+/// </summary>
+struct ProcessIdentitySnapshot
+{
+    /// <summary>
+    /// Whether the process has package identity (MSIX or sparse package).
+    /// </summary>
+    bool HasIdentity = false;
+
+    /// <summary>
+    /// Whether the process runs from inside its package's installed location, rather than being a Win32 app with sparse identity.
+    /// </summary>
+    bool IsContainerized = false;
+
+    std::wstring PackageFamilyName;
+    std::wstring PackageInstalledLocation;
+    std::wstring ModulePath;
+
+    /// <summary>
+    /// The quoted module path followed by the launch argument: what COM runs to start the process for an activation.
+    /// </summary>
+    std::wstring LaunchCommand;
+
+    /// <summary>
+    /// The first failure reading the module path or installed location. The fields that depend on it are left empty or false.
+    /// </summary>
+    ToastResult Result = ToastResultOk;
+};
+
+/// <summary>
+/// Takes a ProcessIdentitySnapshot through the platform the first time it's asked for, exactly once however
+/// many threads ask at the same time, and after that hands out the same snapshot without locking.
+/// </summary>
+class ProcessIdentity
+{
+public:
+    /// <summary>
+    /// launchArgument is appended to the module path in LaunchCommand, for example "-ToastActivated".
+    /// </summary>
+    ProcessIdentity(INotificationPlatform& platform, std::wstring launchArgument);
+
+    ProcessIdentity(const ProcessIdentity&) = delete;
+    ProcessIdentity& operator=(const ProcessIdentity&) = delete;
+
+    const ProcessIdentitySnapshot& Get();
+
+    bool HasIdentity() { return Get().HasIdentity; }
+    bool IsContainerized() { return Get().IsContainerized; }
+
+private:
+    void TakeSnapshot();
+
+    INotificationPlatform& m_platform;
+    std::wstring m_launchArgument;
+
+    // m_ready is checked first so that once the snapshot exists, readers don't even touch the once_flag
+    std::atomic<bool> m_ready{ false };
+    std::once_flag m_once;
+    ProcessIdentitySnapshot m_snapshot;
+};
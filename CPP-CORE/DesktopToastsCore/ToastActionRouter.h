@@ -0,0 +1,208 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace ToastActionRouterDetail
+{
+    constexpr std::size_t PowerOfTwoAtLeast(std::size_t count)
+    {
+        std::size_t size = 1;
+        while (size < count)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    // FNV-1a over the UTF-16 code units; the string is only hashed once per lookup
+    constexpr std::uint64_t Hash(std::wstring_view action)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (wchar_t c : action)
+        {
+            hash ^= static_cast<std::uint16_t>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Derives an independent hash per seed from the string hash (the splitmix64 finalizer)
+    constexpr std::uint64_t Mix(std::uint64_t hash, std::uint32_t seed)
+    {
+        std::uint64_t value = hash + (seed + 1) * 0x9E3779B97F4A7C15ull;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+}
+
+/// <summary>
+/// Maps the "action" value of toast arguments to a handler through a perfect hash table, so a lookup
+/// is one pass over the string and one compare however many actions an app has. The table uses hash
+/// and displace: actions are spread over buckets, and each bucket gets its own seed that places all of
+/// its actions in free slots. It's built by the constructor, which is constexpr: declare the router
+/// constexpr and the seed search happens at compile time, with duplicate actions a compile error.
+/// THandler can be anything copyable: an enum to switch on, a function pointer, or (in a non-constexpr
+/// router) a std::function.
+/// </summary>
+template <typename THandler, std::size_t N>
+class ToastActionRouter
+{
+public:
+    using Route = std::pair<std::wstring_view, THandler>;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    constexpr ToastActionRouter(const Route (&routes)[N]) :
+        ToastActionRouter(routes, std::make_index_sequence<N>())
+    {
+    }
+
+    /// <summary>
+    /// Position of the action in the routes the router was built from, or npos if it isn't one of them.
+    /// </summary>
+    constexpr std::size_t IndexOf(std::wstring_view action) const
+    {
+        std::uint64_t hash = ToastActionRouterDetail::Hash(action);
+        std::uint32_t seed = m_bucketSeeds[hash & (BucketCount - 1)];
+        std::size_t slot = m_slots[ToastActionRouterDetail::Mix(hash, seed) & (TableSize - 1)];
+        return slot != EmptySlot && m_routes[slot].first == action ? slot : npos;
+    }
+
+    /// <summary>
+    /// The handler for an action, or nullptr if no route matches.
+    /// </summary>
+    constexpr const THandler* Find(std::wstring_view action) const
+    {
+        std::size_t index = IndexOf(action);
+        return index != npos ? &m_routes[index].second : nullptr;
+    }
+
+    /// <summary>
+    /// The handler for an action, or fallback if no route matches.
+    /// </summary>
+    constexpr THandler Lookup(std::wstring_view action, THandler fallback) const
+    {
+        std::size_t index = IndexOf(action);
+        return index != npos ? m_routes[index].second : fallback;
+    }
+
+    static constexpr std::size_t Size() { return N; }
+
+private:
+    // Routes are copied in the member initializer, since std::pair assignment isn't constexpr before C++20
+    template <std::size_t... Indices>
+    constexpr ToastActionRouter(const Route (&routes)[N], std::index_sequence<Indices...>) :
+        m_routes{ { routes[Indices]... } },
+        m_slots(),
+        m_bucketSeeds()
+    {
+        std::array<std::uint64_t, N> hashes{};
+        std::array<std::size_t, BucketCount> bucketSizes{};
+        for (std::size_t i = 0; i < N; i++)
+        {
+            for (std::size_t j = 0; j < i; j++)
+            {
+                if (routes[i].first == routes[j].first)
+                {
+                    throw std::invalid_argument("ToastActionRouter routes must have distinct actions");
+                }
+            }
+
+            hashes[i] = ToastActionRouterDetail::Hash(routes[i].first);
+            bucketSizes[hashes[i] & (BucketCount - 1)]++;
+        }
+
+        for (std::size_t& slot : m_slots)
+        {
+            slot = EmptySlot;
+        }
+
+        // Place the fullest buckets first, while most slots are still free
+        for (std::size_t size = N; size > 0; size--)
+        {
+            for (std::size_t bucket = 0; bucket < BucketCount; bucket++)
+            {
+                if (bucketSizes[bucket] == size)
+                {
+                    m_bucketSeeds[bucket] = PlaceBucket(bucket, hashes);
+                }
+            }
+        }
+    }
+
+    static constexpr std::size_t BucketCount = ToastActionRouterDetail::PowerOfTwoAtLeast(N);
+    static constexpr std::size_t TableSize = ToastActionRouterDetail::PowerOfTwoAtLeast(N * 2);
+    static constexpr std::size_t EmptySlot = static_cast<std::size_t>(-1);
+    static constexpr std::uint32_t MaxSeed = 1u << 16;
+
+    constexpr std::uint32_t PlaceBucket(std::size_t bucket, const std::array<std::uint64_t, N>& hashes)
+    {
+        for (std::uint32_t seed = 0; seed < MaxSeed; seed++)
+        {
+            std::array<std::size_t, N> placed{};
+            std::size_t placedCount = 0;
+            bool fits = true;
+
+            for (std::size_t i = 0; i < N && fits; i++)
+            {
+                if ((hashes[i] & (BucketCount - 1)) != bucket)
+                {
+                    continue;
+                }
+
+                std::size_t slot = ToastActionRouterDetail::Mix(hashes[i], seed) & (TableSize - 1);
+                if (m_slots[slot] != EmptySlot)
+                {
+                    fits = false;
+                    break;
+                }
+
+                m_slots[slot] = i;
+                placed[placedCount++] = slot;
+            }
+
+            if (fits)
+            {
+                return seed;
+            }
+
+            for (std::size_t n = 0; n < placedCount; n++)
+            {
+                m_slots[placed[n]] = EmptySlot;
+            }
+        }
+
+        throw std::invalid_argument("ToastActionRouter could not find a perfect hash for these actions");
+    }
+
+    std::array<Route, N> m_routes;
+    std::array<std::size_t, TableSize> m_slots;
+    std::array<std::uint32_t, BucketCount> m_bucketSeeds;
+};
+
+/// <summary>
+/// Builds a router from a braced list of { action, handler } pairs, deducing the number of routes:
+/// constexpr auto router = MakeToastActionRouter&lt;Action&gt;({ { L"reply", Action::Reply }, { L"like", Action::Like } });
+/// </summary>
+template <typename THandler, std::size_t N>
+constexpr ToastActionRouter<THandler, N> MakeToastActionRouter(const std::pair<std::wstring_view, THandler> (&routes)[N])
+{
+    return ToastActionRouter<THandler, N>(routes);
+}
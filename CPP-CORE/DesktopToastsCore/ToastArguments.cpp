@@ -0,0 +1,161 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastArguments.h"
+#include <cstdint>
+
+namespace
+{
+    int HexValue(wchar_t c)
+    {
+        if (c >= L'0' && c <= L'9')
+        {
+            return c - L'0';
+        }
+        if (c >= L'a' && c <= L'f')
+        {
+            return c - L'a' + 10;
+        }
+        if (c >= L'A' && c <= L'F')
+        {
+            return c - L'A' + 10;
+        }
+        return -1;
+    }
+
+    // Reads a %XX escape at position, returning the byte or -1 if there isn't a well-formed one
+    int ReadEscape(std::wstring_view value, std::size_t position)
+    {
+        if (position + 2 >= value.size() || value[position] != L'%')
+        {
+            return -1;
+        }
+
+        int high = HexValue(value[position + 1]);
+        int low = HexValue(value[position + 2]);
+        return high < 0 || low < 0 ? -1 : (high << 4) | low;
+    }
+
+    void AppendCodePoint(std::wstring& result, std::uint32_t codePoint)
+    {
+        if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+        {
+            codePoint -= 0x10000;
+            result += static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+            result += static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+        }
+        else
+        {
+            result += static_cast<wchar_t>(codePoint);
+        }
+    }
+
+    // Number of continuation bytes a UTF-8 lead byte announces, or -1 if it can't start a sequence
+    int ContinuationCount(int lead)
+    {
+        if (lead < 0x80)
+        {
+            return 0;
+        }
+        if (lead >= 0xC2 && lead <= 0xDF)
+        {
+            return 1;
+        }
+        if (lead >= 0xE0 && lead <= 0xEF)
+        {
+            return 2;
+        }
+        if (lead >= 0xF0 && lead <= 0xF4)
+        {
+            return 3;
+        }
+        return -1;
+    }
+}
+
+void AppendPercentDecoded(std::wstring& result, std::wstring_view value)
+{
+    constexpr wchar_t ReplacementCharacter = 0xFFFD;
+
+    std::size_t start = value.find(L'%');
+    if (start == std::wstring_view::npos)
+    {
+        result.append(value.data(), value.size());
+        return;
+    }
+
+    result.reserve(result.size() + value.size());
+    result.append(value.data(), start);
+
+    std::size_t i = start;
+    while (i < value.size())
+    {
+        int lead = ReadEscape(value, i);
+        if (lead < 0)
+        {
+            result += value[i];
+            i++;
+            continue;
+        }
+        i += 3;
+
+        int continuations = ContinuationCount(lead);
+        if (continuations < 0)
+        {
+            result += ReplacementCharacter;
+            continue;
+        }
+
+        std::uint32_t codePoint = continuations == 0 ? lead : lead & (0x3F >> continuations);
+        bool valid = true;
+        for (int n = 0; n < continuations; n++)
+        {
+            int next = ReadEscape(value, i);
+            if (next < 0 || (next & 0xC0) != 0x80)
+            {
+                valid = false;
+                break;
+            }
+            codePoint = (codePoint << 6) | (next & 0x3F);
+            i += 3;
+        }
+
+        // Reject overlong encodings, surrogates and anything past U+10FFFF
+        if (valid && continuations > 0)
+        {
+            static const std::uint32_t minimums[] = { 0, 0x80, 0x800, 0x10000 };
+            valid = codePoint >= minimums[continuations] && codePoint <= 0x10FFFF && (codePoint < 0xD800 || codePoint > 0xDFFF);
+        }
+
+        if (valid)
+        {
+            AppendCodePoint(result, codePoint);
+        }
+        else
+        {
+            result += ReplacementCharacter;
+        }
+    }
+}
+
+bool ToastArguments::TryGetDecoded(std::wstring_view key, std::wstring& value) const
+{
+    std::wstring_view encoded;
+    if (!TryGet(key, encoded))
+    {
+        return false;
+    }
+
+    value.clear();
+    AppendPercentDecoded(value, encoded);
+    return true;
+}
@@ -0,0 +1,186 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+/// <summary>
+/// Appends value to result with %XX escapes decoded. Consecutive escapes are read as UTF-8; malformed
+/// escapes are copied through unchanged and invalid UTF-8 becomes U+FFFD.
+/// </summary>
+void AppendPercentDecoded(std::wstring& result, std::wstring_view value);
+
+/// <summary>
+/// One key/value pair of a toast's launch or action arguments. Both point into the original string;
+/// the value is still percent-encoded until Decode is called.
+/// </summary>
+struct ToastArgument
+{
+    std::wstring_view Key;
+    std::wstring_view Value;
+
+    /// <summary>
+    /// Whether Value contains escapes, i.e. whether Decode would return something other than Value.
+    /// </summary>
+    bool IsEncoded() const
+    {
+        return Value.find(L'%') != std::wstring_view::npos;
+    }
+
+    std::wstring Decode() const
+    {
+        std::wstring decoded;
+        AppendPercentDecoded(decoded, Value);
+        return decoded;
+    }
+};
+
+/// <summary>
+/// A view over toast arguments in query string form, like "action=reply&amp;conversationId=9813". Nothing
+/// is copied or allocated: pairs are found by scanning the original string, which must outlive this object.
+/// Segments without an '=' are keys with an empty value, empty segments are skipped, and when a key
+/// appears more than once the first one wins. Keys are compared exactly, without decoding.
+/// </summary>
+class ToastArguments
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ToastArgument;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const ToastArgument*;
+        using reference = const ToastArgument&;
+
+        Iterator() = default;
+
+        explicit Iterator(std::wstring_view remaining) :
+            m_remaining(remaining)
+        {
+            Advance();
+        }
+
+        reference operator*() const { return m_current; }
+        pointer operator->() const { return &m_current; }
+
+        Iterator& operator++()
+        {
+            Advance();
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            Advance();
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const
+        {
+            return m_atEnd == other.m_atEnd && (m_atEnd || m_current.Key.data() == other.m_current.Key.data());
+        }
+
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    private:
+        void Advance()
+        {
+            while (!m_remaining.empty())
+            {
+                std::size_t separator = m_remaining.find(L'&');
+                std::wstring_view segment = m_remaining.substr(0, separator);
+                m_remaining = separator == std::wstring_view::npos ? std::wstring_view() : m_remaining.substr(separator + 1);
+
+                if (segment.empty())
+                {
+                    continue;
+                }
+
+                std::size_t equals = segment.find(L'=');
+                m_current.Key = segment.substr(0, equals);
+                m_current.Value = equals == std::wstring_view::npos ? std::wstring_view() : segment.substr(equals + 1);
+                return;
+            }
+
+            m_atEnd = true;
+        }
+
+        std::wstring_view m_remaining;
+        ToastArgument m_current;
+        bool m_atEnd = false;
+    };
+
+    ToastArguments() = default;
+
+    explicit ToastArguments(std::wstring_view arguments) :
+        m_arguments(arguments)
+    {
+    }
+
+    Iterator begin() const { return Iterator(m_arguments); }
+    Iterator end() const { return Iterator(std::wstring_view()); }
+
+    std::wstring_view Raw() const { return m_arguments; }
+
+    /// <summary>
+    /// Finds the still-encoded value of a key. Returns false if the key isn't present.
+    /// </summary>
+    bool TryGet(std::wstring_view key, std::wstring_view& value) const
+    {
+        for (const ToastArgument& argument : *this)
+        {
+            if (argument.Key == key)
+            {
+                value = argument.Value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// <summary>
+    /// Finds and decodes the value of a key. Returns false if the key isn't present.
+    /// </summary>
+    bool TryGetDecoded(std::wstring_view key, std::wstring& value) const;
+
+    /// <summary>
+    /// The still-encoded value of a key, or an empty view if the key isn't present.
+    /// </summary>
+    std::wstring_view Get(std::wstring_view key) const
+    {
+        std::wstring_view value;
+        TryGet(key, value);
+        return value;
+    }
+
+    bool Contains(std::wstring_view key) const
+    {
+        std::wstring_view value;
+        return TryGet(key, value);
+    }
+
+    /// <summary>
+    /// The value of the "action" key that ToastActionRouter dispatches on.
+    /// </summary>
+    std::wstring_view Action() const
+    {
+        return Get(L"action");
+    }
+
+private:
+    std::wstring_view m_arguments;
+};
@@ -0,0 +1,73 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastCrc32.h"
+#include <cstring>
+
+namespace
+{
+    struct Crc32Tables
+    {
+        std::uint32_t Values[8][256];
+    };
+
+    // Slicing-by-8: eight lookups per eight bytes instead of one per byte
+    constexpr Crc32Tables MakeCrc32Tables()
+    {
+        Crc32Tables tables{};
+        for (std::uint32_t i = 0; i < 256; i++)
+        {
+            std::uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+            }
+            tables.Values[0][i] = crc;
+        }
+        for (std::uint32_t i = 0; i < 256; i++)
+        {
+            for (int slice = 1; slice < 8; slice++)
+            {
+                std::uint32_t previous = tables.Values[slice - 1][i];
+                tables.Values[slice][i] = (previous >> 8) ^ tables.Values[0][previous & 0xFF];
+            }
+        }
+        return tables;
+    }
+
+    constexpr Crc32Tables Crc32 = MakeCrc32Tables();
+}
+
+std::uint32_t ComputeToastCrc32(const std::uint8_t* data, std::size_t size)
+{
+    const auto& t = Crc32.Values;
+    std::uint32_t crc = 0xFFFFFFFF;
+
+    while (size >= 8)
+    {
+        std::uint32_t low;
+        std::uint32_t high;
+        std::memcpy(&low, data, 4);
+        std::memcpy(&high, data + 4, 4);
+        low ^= crc;
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+            t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+        data += 8;
+        size -= 8;
+    }
+
+    while (size-- > 0)
+    {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    }
+    return ~crc;
+}
@@ -0,0 +1,355 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastDispatcher.h"
+#include "ToastMetrics.h"
+
+namespace
+{
+    // The dispatcher whose worker is running on this thread, so that calls from the sender can tell
+    thread_local const ToastDispatcher* t_workerOf = nullptr;
+}
+
+ToastDispatcher::ToastDispatcher(ToastDispatcherOptions options, Sender sender) :
+    m_options(std::move(options)),
+    m_sender(std::move(sender)),
+    m_queue(m_options.Capacity)
+{
+    if (m_options.BatchSize == 0)
+    {
+        m_options.BatchSize = 1;
+    }
+    if (m_options.WorkerCount == 0)
+    {
+        m_options.WorkerCount = 1;
+    }
+
+    m_workers.reserve(m_options.WorkerCount);
+    for (std::size_t i = 0; i < m_options.WorkerCount; i++)
+    {
+        m_workers.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+ToastDispatcher::~ToastDispatcher()
+{
+    Shutdown(true);
+}
+
+ToastEnqueueResult ToastDispatcher::Enqueue(ToastPayload payload)
+{
+    m_activeProducers.fetch_add(1);
+    ToastEnqueueResult result = EnqueueCore(payload);
+    m_activeProducers.fetch_sub(1);
+    return result;
+}
+
+ToastEnqueueResult ToastDispatcher::EnqueueCore(ToastPayload& payload)
+{
+    while (true)
+    {
+        if (!m_accepting.load())
+        {
+            return ToastEnqueueResult::ShutDown;
+        }
+
+        if (m_queue.TryPush(payload))
+        {
+            m_enqueued.fetch_add(1);
+            if (m_options.Metrics != nullptr)
+            {
+                m_options.Metrics->RecordQueueDepth(ToastMetricsQueue::Dispatch, m_queue.SizeApprox());
+            }
+            WakeWorkers();
+            return ToastEnqueueResult::Queued;
+        }
+
+        switch (m_options.Backpressure)
+        {
+        case ToastBackpressurePolicy::DropNewest:
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return ToastEnqueueResult::Dropped;
+
+        case ToastBackpressurePolicy::DropOldest:
+        {
+            ToastPayload oldest;
+            bool popped;
+            {
+                std::lock_guard<std::mutex> lock(m_consumerMutex);
+                popped = m_queue.TryPop(oldest);
+            }
+
+            if (popped)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                Complete(1);
+            }
+            break;
+        }
+
+        case ToastBackpressurePolicy::Block:
+        {
+            std::unique_lock<std::mutex> lock(m_waitMutex);
+            m_blockedProducers.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            m_spaceAvailable.wait(lock, [this]
+            {
+                return m_queue.SizeApprox() < m_queue.Capacity() || !m_accepting.load();
+            });
+            m_blockedProducers.fetch_sub(1);
+            break;
+        }
+        }
+    }
+}
+
+void ToastDispatcher::Flush()
+{
+    // The batch the calling worker is sending can't complete until the sender returns
+    if (OnWorkerThread())
+    {
+        return;
+    }
+
+    std::uint64_t target = m_enqueued.load();
+
+    std::unique_lock<std::mutex> lock(m_waitMutex);
+    m_flushers.fetch_add(1);
+    m_progress.wait(lock, [this, target] { return m_completed.load() >= target; });
+    m_flushers.fetch_sub(1);
+}
+
+void ToastDispatcher::Shutdown(bool drain)
+{
+    // The first caller signals the workers. No lock is held while doing so, because the sender may be the
+    // caller and another thread may be holding m_shutdownMutex while it joins that sender's worker.
+    if (!m_stopRequested.exchange(true))
+    {
+        // Stop accepting, release any blocked producers, and wait for in-flight Enqueue calls so that
+        // nothing lands in the queue after the workers have gone
+        m_accepting.store(false);
+        {
+            std::lock_guard<std::mutex> lock(m_waitMutex);
+            m_spaceAvailable.notify_all();
+        }
+        while (m_activeProducers.load() != 0)
+        {
+            std::this_thread::yield();
+        }
+
+        m_drainOnStop = drain;
+        m_stopping.store(true);
+        {
+            std::lock_guard<std::mutex> lock(m_waitMutex);
+            m_workAvailable.notify_all();
+        }
+    }
+
+    // A worker can't join itself; it exits once its batch is done and a later call from another thread joins it
+    if (OnWorkerThread())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> shutdownLock(m_shutdownMutex);
+    if (m_workers.empty())
+    {
+        return;
+    }
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+    DiscardQueued();
+}
+
+ToastDispatcherStats ToastDispatcher::GetStats() const
+{
+    ToastDispatcherStats stats;
+    stats.Enqueued = m_enqueued.load(std::memory_order_relaxed);
+    stats.Sent = m_sent.load(std::memory_order_relaxed);
+    stats.Failed = m_failed.load(std::memory_order_relaxed);
+    stats.Dropped = m_dropped.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ToastDispatcher::WorkerLoop()
+{
+    t_workerOf = this;
+    bool started = true;
+    if (m_options.WorkerStarted)
+    {
+        try
+        {
+            m_options.WorkerStarted();
+        }
+        catch (...)
+        {
+            started = false;
+        }
+    }
+
+    std::vector<ToastPayload> batch;
+    batch.reserve(m_options.BatchSize);
+
+    while (true)
+    {
+        std::size_t count = PopBatch(batch);
+        if (count == 0)
+        {
+            if (m_stopping.load())
+            {
+                if (!m_drainOnStop)
+                {
+                    DiscardQueued();
+                    return;
+                }
+                if (m_queue.SizeApprox() == 0)
+                {
+                    return;
+                }
+
+                // A producer is still finishing its write
+                std::this_thread::yield();
+                continue;
+            }
+
+            if (m_queue.SizeApprox() > 0)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_waitMutex);
+            m_idleWorkers.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            m_workAvailable.wait(lock, [this]
+            {
+                return m_queue.SizeApprox() > 0 || m_stopping.load();
+            });
+            m_idleWorkers.fetch_sub(1);
+            continue;
+        }
+
+        // Pairs with the fence a blocked producer issues after counting itself, so that either it sees
+        // the space this batch freed or this sees it waiting
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_blockedProducers.load() > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_waitMutex);
+            m_spaceAvailable.notify_all();
+        }
+
+        std::uint64_t sent = 0;
+        std::uint64_t failed = 0;
+        std::uint64_t dropped = 0;
+        for (ToastPayload& payload : batch)
+        {
+            if (m_stopping.load() && !m_drainOnStop)
+            {
+                dropped++;
+                continue;
+            }
+
+            // The sender can't be expected to work on a thread whose setup failed
+            if (!started)
+            {
+                failed++;
+                continue;
+            }
+
+            try
+            {
+                if (ToastSucceeded(m_sender(payload)))
+                {
+                    sent++;
+                }
+                else
+                {
+                    failed++;
+                }
+            }
+            catch (...)
+            {
+                failed++;
+            }
+        }
+        batch.clear();
+
+        m_sent.fetch_add(sent, std::memory_order_relaxed);
+        m_failed.fetch_add(failed, std::memory_order_relaxed);
+        m_dropped.fetch_add(dropped, std::memory_order_relaxed);
+        Complete(count);
+    }
+}
+
+std::size_t ToastDispatcher::PopBatch(std::vector<ToastPayload>& batch)
+{
+    std::lock_guard<std::mutex> lock(m_consumerMutex);
+
+    ToastPayload payload;
+    while (batch.size() < m_options.BatchSize && m_queue.TryPop(payload))
+    {
+        batch.push_back(std::move(payload));
+    }
+
+    return batch.size();
+}
+
+void ToastDispatcher::DiscardQueued()
+{
+    std::uint64_t discarded = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_consumerMutex);
+        ToastPayload payload;
+        while (m_queue.TryPop(payload))
+        {
+            discarded++;
+        }
+    }
+
+    if (discarded > 0)
+    {
+        m_dropped.fetch_add(discarded, std::memory_order_relaxed);
+        Complete(discarded);
+    }
+}
+
+void ToastDispatcher::Complete(std::uint64_t count)
+{
+    m_completed.fetch_add(count);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (m_flushers.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_waitMutex);
+        m_progress.notify_all();
+    }
+}
+
+bool ToastDispatcher::OnWorkerThread() const
+{
+    return t_workerOf == this;
+}
+
+void ToastDispatcher::WakeWorkers()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (m_idleWorkers.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_waitMutex);
+        m_workAvailable.notify_one();
+    }
+}
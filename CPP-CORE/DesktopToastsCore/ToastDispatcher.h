@@ -0,0 +1,182 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "INotificationPlatform.h"
+#include "MpscRing.h"
+#include "ToastPayload.h"
+
+class ToastMetrics;
+
+/// <summary>
+/// What Enqueue does when the queue is full.
+/// </summary>
+enum class ToastBackpressurePolicy
+{
+    /// <summary>
+    /// Wait until a worker frees up space.
+    /// </summary>
+    Block,
+
+    /// <summary>
+    /// Discard the oldest queued toast to make room for the new one.
+    /// </summary>
+    DropOldest,
+
+    /// <summary>
+    /// Reject the new toast.
+    /// </summary>
+    DropNewest
+};
+
+enum class ToastEnqueueResult
+{
+    Queued,
+    Dropped,
+    ShutDown
+};
+
+struct ToastDispatcherOptions
+{
+    /// <summary>
+    /// Maximum number of queued toasts, rounded up to a power of two.
+    /// </summary>
+    std::size_t Capacity = 1024;
+
+    /// <summary>
+    /// Maximum number of toasts a worker takes off the queue at a time.
+    /// </summary>
+    std::size_t BatchSize = 32;
+
+    /// <summary>
+    /// Number of worker threads. With more than one worker, toasts may be shown out of order.
+    /// </summary>
+    std::size_t WorkerCount = 1;
+
+    ToastBackpressurePolicy Backpressure = ToastBackpressurePolicy::Block;
+
+    /// <summary>
+    /// Optional callback run at the start of each worker thread, for example to initialize COM. If it throws, the worker
+    /// still takes its share of the queue, so producers aren't left blocked, but counts those toasts as failed without
+    /// sending them.
+    /// </summary>
+    std::function<void()> WorkerStarted;
+
+    /// <summary>
+    /// Optional metrics told the queue depth each time a toast is queued. Must outlive the dispatcher.
+    /// </summary>
+    ToastMetrics* Metrics = nullptr;
+};
+
+struct ToastDispatcherStats
+{
+    std::uint64_t Enqueued;
+    std::uint64_t Sent;
+    std::uint64_t Failed;
+    std::uint64_t Dropped;
+};
+
+/// <summary>
+/// Takes rendered toasts from any number of producer threads through a bounded lock-free queue and
+/// shows them on dedicated worker threads, so producers never wait on the cross-process Show call.
+/// The sender is called once per toast on a worker thread; a failed result or an exception counts that
+/// toast as failed and the worker moves on. The sender may call Shutdown, which then stops the workers
+/// without waiting for them; Flush called from the sender returns without waiting, since the worker
+/// can't wait on the batch it's sending.
+/// </summary>
+class ToastDispatcher
+{
+public:
+    using Sender = std::function<ToastResult(const ToastPayload&)>;
+
+    ToastDispatcher(ToastDispatcherOptions options, Sender sender);
+
+    /// <summary>
+    /// Shuts down, showing everything that's still queued.
+    /// </summary>
+    ~ToastDispatcher();
+
+    ToastDispatcher(const ToastDispatcher&) = delete;
+    ToastDispatcher& operator=(const ToastDispatcher&) = delete;
+
+    /// <summary>
+    /// Queues a toast. Depending on the backpressure policy, this may block or drop a toast when the queue is full.
+    /// </summary>
+    ToastEnqueueResult Enqueue(ToastPayload payload);
+
+    /// <summary>
+    /// Blocks until every toast queued before this call has been sent, failed or dropped.
+    /// </summary>
+    void Flush();
+
+    /// <summary>
+    /// Stops the workers. If drain is true, queued toasts are sent first; otherwise they're dropped.
+    /// Later calls to Enqueue return ShutDown. Called from the sender, this returns once the workers
+    /// have been told to stop, and the destructor joins them.
+    /// </summary>
+    void Shutdown(bool drain = true);
+
+    /// <summary>
+    /// Approximate number of queued toasts.
+    /// </summary>
+    std::size_t QueueDepth() const { return m_queue.SizeApprox(); }
+
+    ToastDispatcherStats GetStats() const;
+
+private:
+    ToastEnqueueResult EnqueueCore(ToastPayload& payload);
+    void WorkerLoop();
+    std::size_t PopBatch(std::vector<ToastPayload>& batch);
+    void DiscardQueued();
+    void Complete(std::uint64_t count);
+    void WakeWorkers();
+    bool OnWorkerThread() const;
+
+    ToastDispatcherOptions m_options;
+    Sender m_sender;
+    MpscRing<ToastPayload> m_queue;
+
+    // Serializes the consumer side of the ring between workers
+    std::mutex m_consumerMutex;
+
+    // Used to park idle workers, blocked producers and flushers
+    std::mutex m_waitMutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_spaceAvailable;
+    std::condition_variable m_progress;
+    std::atomic<std::size_t> m_idleWorkers{ 0 };
+    std::atomic<std::size_t> m_blockedProducers{ 0 };
+    std::atomic<std::size_t> m_activeProducers{ 0 };
+    std::atomic<std::size_t> m_flushers{ 0 };
+
+    std::atomic<bool> m_accepting{ true };
+    std::atomic<bool> m_stopRequested{ false };
+    std::atomic<bool> m_stopping{ false };
+    bool m_drainOnStop = true;
+
+    std::atomic<std::uint64_t> m_enqueued{ 0 };
+    std::atomic<std::uint64_t> m_completed{ 0 };
+    std::atomic<std::uint64_t> m_sent{ 0 };
+    std::atomic<std::uint64_t> m_failed{ 0 };
+    std::atomic<std::uint64_t> m_dropped{ 0 };
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_shutdownMutex;
+};
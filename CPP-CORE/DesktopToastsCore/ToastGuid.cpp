@@ -0,0 +1,31 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastGuid.h"
+
+std::wstring ToastGuid::ToString() const
+{
+    static const wchar_t digits[] = L"0123456789abcdef";
+
+    std::wstring result;
+    result.reserve(36);
+    for (std::size_t i = 0; i < Bytes.size(); i++)
+    {
+        if (i == 4 || i == 6 || i == 8 || i == 10)
+        {
+            result += L'-';
+        }
+        result += digits[Bytes[i] >> 4];
+        result += digits[Bytes[i] & 0xF];
+    }
+    return result;
+}
@@ -0,0 +1,246 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// <summary>
+/// A GUID as its 16 bytes in RFC 4122 order, which is the order they appear in the string form.
+/// </summary>
+struct ToastGuid
+{
+    std::array<std::uint8_t, 16> Bytes;
+
+    constexpr bool operator==(const ToastGuid& other) const
+    {
+        for (std::size_t i = 0; i < Bytes.size(); i++)
+        {
+            if (Bytes[i] != other.Bytes[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr bool operator!=(const ToastGuid& other) const { return !(*this == other); }
+
+    /// <summary>
+    /// Lowercase hex with dashes and no braces, like "6ba7b811-9dad-11d1-80b4-00c04fd430c8".
+    /// </summary>
+    std::wstring ToString() const;
+};
+
+namespace ToastGuidDetail
+{
+    constexpr std::uint32_t RotateLeft(std::uint32_t value, int bits)
+    {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    // SHA-1 (FIPS 180-4), written so it can run at compile time
+    class Sha1
+    {
+    public:
+        constexpr void Update(std::uint8_t byte)
+        {
+            m_block[m_blockLength++] = byte;
+            m_length++;
+            if (m_blockLength == m_block.size())
+            {
+                Transform();
+                m_blockLength = 0;
+            }
+        }
+
+        constexpr std::array<std::uint8_t, 20> Finish()
+        {
+            std::uint64_t bitLength = m_length * 8;
+            Update(0x80);
+            while (m_blockLength != 56)
+            {
+                Update(0);
+            }
+            for (int i = 7; i >= 0; i--)
+            {
+                Update(static_cast<std::uint8_t>(bitLength >> (i * 8)));
+            }
+
+            std::array<std::uint8_t, 20> digest{};
+            for (std::size_t i = 0; i < digest.size(); i++)
+            {
+                digest[i] = static_cast<std::uint8_t>(m_state[i / 4] >> (24 - (i % 4) * 8));
+            }
+            return digest;
+        }
+
+    private:
+        constexpr void Transform()
+        {
+            std::array<std::uint32_t, 80> w{};
+            for (std::size_t i = 0; i < 16; i++)
+            {
+                w[i] = (std::uint32_t(m_block[i * 4]) << 24) | (std::uint32_t(m_block[i * 4 + 1]) << 16) |
+                    (std::uint32_t(m_block[i * 4 + 2]) << 8) | std::uint32_t(m_block[i * 4 + 3]);
+            }
+            for (std::size_t i = 16; i < 80; i++)
+            {
+                w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            }
+
+            std::uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3], e = m_state[4];
+            for (std::size_t i = 0; i < 80; i++)
+            {
+                std::uint32_t f = 0;
+                std::uint32_t k = 0;
+                if (i < 20)
+                {
+                    f = (b & c) | (~b & d);
+                    k = 0x5A827999;
+                }
+                else if (i < 40)
+                {
+                    f = b ^ c ^ d;
+                    k = 0x6ED9EBA1;
+                }
+                else if (i < 60)
+                {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8F1BBCDC;
+                }
+                else
+                {
+                    f = b ^ c ^ d;
+                    k = 0xCA62C1D6;
+                }
+
+                std::uint32_t next = RotateLeft(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = RotateLeft(b, 30);
+                b = a;
+                a = next;
+            }
+
+            m_state[0] += a;
+            m_state[1] += b;
+            m_state[2] += c;
+            m_state[3] += d;
+            m_state[4] += e;
+        }
+
+        std::array<std::uint32_t, 5> m_state{ { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 } };
+        std::array<std::uint8_t, 64> m_block{};
+        std::size_t m_blockLength = 0;
+        std::uint64_t m_length = 0;
+    };
+
+    // Feeds the name to the hash as UTF-8, whatever the size of wchar_t. Unpaired surrogates become U+FFFD.
+    constexpr void UpdateUtf8(Sha1& sha1, std::wstring_view name)
+    {
+        for (std::size_t i = 0; i < name.size(); i++)
+        {
+            std::uint32_t codePoint = static_cast<std::uint32_t>(name[i]);
+            if (sizeof(wchar_t) == 2 && codePoint >= 0xD800 && codePoint <= 0xDFFF)
+            {
+                std::uint32_t low = i + 1 < name.size() ? static_cast<std::uint32_t>(name[i + 1]) : 0;
+                if (codePoint <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF)
+                {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    i++;
+                }
+                else
+                {
+                    codePoint = 0xFFFD;
+                }
+            }
+            else if (codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+            {
+                codePoint = 0xFFFD;
+            }
+
+            if (codePoint < 0x80)
+            {
+                sha1.Update(static_cast<std::uint8_t>(codePoint));
+            }
+            else if (codePoint < 0x800)
+            {
+                sha1.Update(static_cast<std::uint8_t>(0xC0 | (codePoint >> 6)));
+                sha1.Update(static_cast<std::uint8_t>(0x80 | (codePoint & 0x3F)));
+            }
+            else if (codePoint < 0x10000)
+            {
+                sha1.Update(static_cast<std::uint8_t>(0xE0 | (codePoint >> 12)));
+                sha1.Update(static_cast<std::uint8_t>(0x80 | ((codePoint >> 6) & 0x3F)));
+                sha1.Update(static_cast<std::uint8_t>(0x80 | (codePoint & 0x3F)));
+            }
+            else
+            {
+                sha1.Update(static_cast<std::uint8_t>(0xF0 | (codePoint >> 18)));
+                sha1.Update(static_cast<std::uint8_t>(0x80 | ((codePoint >> 12) & 0x3F)));
+                sha1.Update(static_cast<std::uint8_t>(0x80 | ((codePoint >> 6) & 0x3F)));
+                sha1.Update(static_cast<std::uint8_t>(0x80 | (codePoint & 0x3F)));
+            }
+        }
+    }
+}
+
+/// <summary>
+/// The name-based (version 5, SHA-1) UUID of a name within a namespace, per RFC 4122. The name is hashed as
+/// UTF-8. This is constexpr, so a GUID for a literal name can be computed at compile time.
+/// </summary>
+constexpr ToastGuid MakeNameBasedGuid(const ToastGuid& nameSpace, std::wstring_view name)
+{
+    ToastGuidDetail::Sha1 sha1;
+    for (std::uint8_t byte : nameSpace.Bytes)
+    {
+        sha1.Update(byte);
+    }
+    ToastGuidDetail::UpdateUtf8(sha1, name);
+
+    std::array<std::uint8_t, 20> digest = sha1.Finish();
+
+    ToastGuid guid{};
+    for (std::size_t i = 0; i < guid.Bytes.size(); i++)
+    {
+        guid.Bytes[i] = digest[i];
+    }
+
+    // Version 5 in the high nibble of time_hi, and the RFC 4122 variant
+    guid.Bytes[6] = static_cast<std::uint8_t>((guid.Bytes[6] & 0x0F) | 0x50);
+    guid.Bytes[8] = static_cast<std::uint8_t>((guid.Bytes[8] & 0x3F) | 0x80);
+    return guid;
+}
+
+/// <summary>
+/// The RFC 4122 namespace for URLs, 6ba7b811-9dad-11d1-80b4-00c04fd430c8.
+/// </summary>
+constexpr ToastGuid UrlGuidNamespace{ { {
+    0x6b, 0xa7, 0xb8, 0x11, 0x9d, 0xad, 0x11, 0xd1, 0x80, 0xb4, 0x00, 0xc0, 0x4f, 0xd4, 0x30, 0xc8 } } };
+
+/// <summary>
+/// The namespace AUMID activator CLSIDs are derived in: itself the version 5 UUID of this project's URL.
+/// </summary>
+constexpr ToastGuid AumidGuidNamespace = MakeNameBasedGuid(UrlGuidNamespace, L"https://github.com/WindowsNotifications/desktop-toasts/aumid");
+
+/// <summary>
+/// The CLSID the Compat library registers as the toast activator for an AUMID. Stable across builds, compilers and
+/// machines, and different for every AUMID.
+/// </summary>
+constexpr ToastGuid MakeAumidClsid(std::wstring_view aumid)
+{
+    return MakeNameBasedGuid(AumidGuidNamespace, aumid);
+}
@@ -0,0 +1,277 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastHistoryBatch.h"
+#include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace
+{
+    // One platform call: a whole group when Toasts is empty, otherwise a batch of tagged toasts
+    struct WorkItem
+    {
+        std::wstring Group;
+        std::vector<ToastHistoryEntry> Toasts;
+
+        // Index of this item's first result; a batch's results are contiguous
+        std::size_t FirstResult;
+    };
+
+    void RunItem(INotificationPlatform& platform, const std::wstring& aumid, const WorkItem& item, std::vector<ToastResult>& results)
+    {
+        if (item.Toasts.empty())
+        {
+            results[item.FirstResult] = platform.RemoveGroupFromHistory(aumid, item.Group);
+            return;
+        }
+
+        std::vector<ToastResult> batchResults;
+        platform.RemoveBatchFromHistory(aumid, item.Toasts, batchResults);
+        for (std::size_t i = 0; i < item.Toasts.size(); i++)
+        {
+            results[item.FirstResult + i] = i < batchResults.size() ? batchResults[i] : ToastResultFail;
+        }
+    }
+
+    void Run(INotificationPlatform& platform, const std::wstring& aumid, const WorkItem& item, std::vector<ToastResult>& results)
+    {
+        try
+        {
+            RunItem(platform, aumid, item, results);
+        }
+        catch (...)
+        {
+            // A platform that throws fails the item rather than ending the process from a worker thread
+            std::fill_n(results.begin() + item.FirstResult, std::max<std::size_t>(item.Toasts.size(), 1), ToastResultFail);
+        }
+    }
+
+    // Spreads the work over up to WorkerCount threads, the calling thread included. Each item writes its own
+    // range of results, so the only thing the threads share is the index of the next item.
+    void RunAll(INotificationPlatform& platform, const std::wstring& aumid, const std::vector<WorkItem>& work,
+        const ToastHistoryBatchOptions& options, std::vector<ToastResult>& results)
+    {
+        std::atomic<std::size_t> next{ 0 };
+        auto worker = [&]
+        {
+            for (std::size_t i = next.fetch_add(1, std::memory_order_relaxed); i < work.size(); i = next.fetch_add(1, std::memory_order_relaxed))
+            {
+                Run(platform, aumid, work[i], results);
+            }
+        };
+
+        std::size_t threadCount = std::min(std::max<std::size_t>(options.WorkerCount, 1), work.size());
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < threadCount; i++)
+        {
+            try
+            {
+                threads.emplace_back([&]
+                {
+                    bool started = true;
+                    if (options.WorkerStarted)
+                    {
+                        try
+                        {
+                            options.WorkerStarted();
+                        }
+                        catch (...)
+                        {
+                            started = false;
+                        }
+                    }
+
+                    worker();
+
+                    if (started && options.WorkerStopped)
+                    {
+                        try
+                        {
+                            options.WorkerStopped();
+                        }
+                        catch (...)
+                        {
+                        }
+                    }
+                });
+            }
+            catch (const std::system_error&)
+            {
+                // Out of threads; the ones already running will get through the work
+                break;
+            }
+        }
+
+        worker();
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    ToastResult FirstFailure(const ToastHistoryBatchResults& results)
+    {
+        for (const std::vector<ToastResult>* list : { &results.Toasts, &results.Groups })
+        {
+            for (ToastResult result : *list)
+            {
+                if (!ToastSucceeded(result))
+                {
+                    return result;
+                }
+            }
+        }
+        return ToastResultOk;
+    }
+
+    std::wstring Key(const std::wstring& tag, const std::wstring& group)
+    {
+        std::wstring key;
+        key.reserve(tag.size() + group.size() + 1);
+        key.append(tag).push_back(L'\0');
+        key.append(group);
+        return key;
+    }
+}
+
+ToastResult RemoveManyFromHistory(
+    INotificationPlatform& platform,
+    const std::wstring& aumid,
+    const std::vector<ToastHistoryEntry>& toasts,
+    const std::vector<std::wstring>& groups,
+    const ToastHistoryBatchOptions& options,
+    ToastHistoryBatchResults& results)
+{
+    constexpr std::size_t NoSlot = static_cast<std::size_t>(-1);
+
+    // Each distinct removal gets a slot in unique; every toast and group passed in points at one
+    std::vector<ToastResult> unique;
+    std::vector<WorkItem> work;
+    std::vector<std::size_t> groupSlots(groups.size(), NoSlot);
+    std::vector<std::size_t> toastSlots(toasts.size(), NoSlot);
+
+    std::unordered_map<std::wstring, std::size_t> slotByGroup;
+    for (std::size_t i = 0; i < groups.size(); i++)
+    {
+        if (groups[i].empty())
+        {
+            continue;
+        }
+
+        auto inserted = slotByGroup.emplace(groups[i], unique.size());
+        if (inserted.second)
+        {
+            unique.push_back(ToastResultOk);
+            work.push_back(WorkItem{ groups[i], {}, inserted.first->second });
+        }
+        groupSlots[i] = inserted.first->second;
+    }
+
+    std::size_t batchSize = std::max<std::size_t>(options.BatchSize, 1);
+    std::unordered_map<std::wstring, std::size_t> slotByToast;
+    for (std::size_t i = 0; i < toasts.size(); i++)
+    {
+        const ToastHistoryEntry& toast = toasts[i];
+        if (toast.Tag.empty())
+        {
+            continue;
+        }
+
+        auto group = slotByGroup.find(toast.Group);
+        if (group != slotByGroup.end())
+        {
+            toastSlots[i] = group->second;
+            continue;
+        }
+
+        auto inserted = slotByToast.emplace(Key(toast.Tag, toast.Group), unique.size());
+        if (inserted.second)
+        {
+            if (work.empty() || work.back().Toasts.empty() || work.back().Toasts.size() == batchSize)
+            {
+                work.push_back(WorkItem{ {}, {}, unique.size() });
+                work.back().Toasts.reserve(batchSize);
+            }
+            work.back().Toasts.push_back(ToastHistoryEntry{ toast.Tag, toast.Group, {} });
+            unique.push_back(ToastResultOk);
+        }
+        toastSlots[i] = inserted.first->second;
+    }
+
+    RunAll(platform, aumid, work, options, unique);
+
+    auto resultOf = [&](std::size_t slot) { return slot == NoSlot ? ToastResultInvalidArgument : unique[slot]; };
+    results.Toasts.resize(toasts.size());
+    std::transform(toastSlots.begin(), toastSlots.end(), results.Toasts.begin(), resultOf);
+    results.Groups.resize(groups.size());
+    std::transform(groupSlots.begin(), groupSlots.end(), results.Groups.begin(), resultOf);
+    results.PlatformCalls = work.size();
+
+    return FirstFailure(results);
+}
+
+ToastResult RemoveFromHistoryWhere(
+    INotificationPlatform& platform,
+    const std::wstring& aumid,
+    const std::function<bool(const ToastHistoryEntry&)>& predicate,
+    const ToastHistoryBatchOptions& options,
+    std::vector<ToastHistoryEntry>& matched,
+    std::vector<std::wstring>& groups,
+    ToastHistoryBatchResults& results)
+{
+    matched.clear();
+    groups.clear();
+    results = ToastHistoryBatchResults();
+
+    std::vector<ToastHistoryEntry> history;
+    ToastResult result = platform.GetHistory(aumid, history);
+    results.PlatformCalls = 1;
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    // Groups with at least one toast the predicate didn't pick have to be removed toast by toast
+    std::unordered_set<std::wstring> keptGroups;
+    for (ToastHistoryEntry& entry : history)
+    {
+        if (predicate(entry))
+        {
+            matched.push_back(std::move(entry));
+        }
+        else
+        {
+            keptGroups.insert(entry.Group);
+        }
+    }
+
+    std::unordered_set<std::wstring> seen;
+    for (const ToastHistoryEntry& entry : matched)
+    {
+        if (!entry.Group.empty() && keptGroups.count(entry.Group) == 0 && seen.insert(entry.Group).second)
+        {
+            groups.push_back(entry.Group);
+        }
+    }
+
+    ToastHistoryBatchResults removal;
+    result = RemoveManyFromHistory(platform, aumid, matched, groups, options, removal);
+    results.Toasts = std::move(removal.Toasts);
+    results.Groups = std::move(removal.Groups);
+    results.PlatformCalls += removal.PlatformCalls;
+    return result;
+}
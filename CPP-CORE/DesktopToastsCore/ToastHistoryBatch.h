@@ -0,0 +1,92 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "INotificationPlatform.h"
+
+struct ToastHistoryBatchOptions
+{
+    /// <summary>
+    /// Maximum number of threads issuing removals at once, counting the calling thread. One removes everything on the calling thread.
+    /// </summary>
+    std::size_t WorkerCount = 4;
+
+    /// <summary>
+    /// Number of toasts handed to INotificationPlatform::RemoveBatchFromHistory in one call.
+    /// </summary>
+    std::size_t BatchSize = 32;
+
+    /// <summary>
+    /// Optional callback run at the start of each extra worker thread, for example to initialize COM. If it throws,
+    /// the worker still takes its share of the removals, which then fail however the platform fails them.
+    /// </summary>
+    std::function<void()> WorkerStarted;
+
+    /// <summary>
+    /// Optional callback run at the end of each extra worker thread whose WorkerStarted returned normally, for
+    /// example to uninitialize COM.
+    /// </summary>
+    std::function<void()> WorkerStopped;
+};
+
+struct ToastHistoryBatchResults
+{
+    /// <summary>
+    /// One result per toast, in the order they were passed in. Duplicates, and toasts in a group that's also being
+    /// removed, share the result of the call that removed them.
+    /// </summary>
+    std::vector<ToastResult> Toasts;
+
+    /// <summary>
+    /// One result per group, in the order they were passed in.
+    /// </summary>
+    std::vector<ToastResult> Groups;
+
+    /// <summary>
+    /// Number of calls made to the platform, after duplicates were dropped and toasts were batched.
+    /// </summary>
+    std::size_t PlatformCalls = 0;
+};
+
+/// <summary>
+/// Removes a set of toasts and whole groups from an app's history. Duplicates are dropped, toasts whose group is
+/// also being removed are left to the group removal, and the remaining toasts are handed to the platform in
+/// batches, spread over a few worker threads. Only the tag and group of each toast are used; a toast without a
+/// tag can't be addressed on its own and fails with ToastResultInvalidArgument, as does an empty group name.
+/// Returns ToastResultOk if everything was removed, or the first failure otherwise; results has the rest.
+/// </summary>
+ToastResult RemoveManyFromHistory(
+    INotificationPlatform& platform,
+    const std::wstring& aumid,
+    const std::vector<ToastHistoryEntry>& toasts,
+    const std::vector<std::wstring>& groups,
+    const ToastHistoryBatchOptions& options,
+    ToastHistoryBatchResults& results);
+
+/// <summary>
+/// Reads the app's history once and removes every toast the predicate matches. A group whose toasts all match
+/// is removed with a single group removal, which also takes any toast shown into it after the history was read.
+/// On return, matched holds the toasts the predicate picked, and results.Toasts their results in the same order;
+/// groups holds the groups that were removed whole, and results.Groups their results in the same order.
+/// </summary>
+ToastResult RemoveFromHistoryWhere(
+    INotificationPlatform& platform,
+    const std::wstring& aumid,
+    const std::function<bool(const ToastHistoryEntry&)>& predicate,
+    const ToastHistoryBatchOptions& options,
+    std::vector<ToastHistoryEntry>& matched,
+    std::vector<std::wstring>& groups,
+    ToastHistoryBatchResults& results);
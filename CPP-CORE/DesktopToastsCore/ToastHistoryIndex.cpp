@@ -0,0 +1,297 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastHistoryIndex.h"
+#include <mutex>
+#include "ToastArguments.h"
+
+std::wstring ToastHistoryIndex::Key(std::wstring_view first, std::wstring_view second)
+{
+    std::wstring key;
+    key.reserve(first.size() + 1 + second.size());
+    key.append(first.data(), first.size());
+    key += L'\0';
+    key.append(second.data(), second.size());
+    return key;
+}
+
+ToastHistoryIndex::Node& ToastHistoryIndex::AddLocked(ToastHistoryEntry entry)
+{
+    if (!entry.Tag.empty())
+    {
+        // The replacement goes to the end, as the newest toast
+        Node* existing = FindLocked(entry.Tag, entry.Group);
+        if (existing != nullptr)
+        {
+            RemoveLocked(*existing);
+        }
+    }
+
+    m_nodes.push_back(Node{ std::move(entry), NodeList::iterator(), m_generation });
+    Node& node = m_nodes.back();
+    node.Self = std::prev(m_nodes.end());
+
+    const ToastHistoryEntry& added = node.Entry;
+    m_byGroup[added.Group].insert(&node);
+    if (!added.Tag.empty())
+    {
+        m_byKey.emplace(Key(added.Group, added.Tag), &node);
+    }
+    else
+    {
+        m_untagged.emplace(Key(added.Group, added.Launch), &node);
+    }
+
+    for (const ToastArgument& argument : ToastArguments(added.Launch))
+    {
+        m_byArgument[Key(argument.Key, argument.Value)].insert(&node);
+    }
+
+    return node;
+}
+
+void ToastHistoryIndex::RemoveLocked(Node& node)
+{
+    const ToastHistoryEntry& entry = node.Entry;
+
+    auto group = m_byGroup.find(entry.Group);
+    group->second.erase(&node);
+    if (group->second.empty())
+    {
+        m_byGroup.erase(group);
+    }
+
+    if (!entry.Tag.empty())
+    {
+        m_byKey.erase(Key(entry.Group, entry.Tag));
+    }
+    else
+    {
+        auto range = m_untagged.equal_range(Key(entry.Group, entry.Launch));
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == &node)
+            {
+                m_untagged.erase(it);
+                break;
+            }
+        }
+    }
+
+    for (const ToastArgument& argument : ToastArguments(entry.Launch))
+    {
+        auto nodes = m_byArgument.find(Key(argument.Key, argument.Value));
+        if (nodes != m_byArgument.end())
+        {
+            nodes->second.erase(&node);
+            if (nodes->second.empty())
+            {
+                m_byArgument.erase(nodes);
+            }
+        }
+    }
+
+    m_nodes.erase(node.Self);
+}
+
+ToastHistoryIndex::Node* ToastHistoryIndex::FindLocked(const std::wstring& tag, const std::wstring& group) const
+{
+    auto it = m_byKey.find(Key(group, tag));
+    return it != m_byKey.end() ? it->second : nullptr;
+}
+
+std::vector<ToastHistoryEntry> ToastHistoryIndex::Copy(const NodeSet* nodes)
+{
+    std::vector<ToastHistoryEntry> entries;
+    if (nodes != nullptr)
+    {
+        entries.reserve(nodes->size());
+        for (const Node* node : *nodes)
+        {
+            entries.push_back(node->Entry);
+        }
+    }
+    return entries;
+}
+
+void ToastHistoryIndex::OnShown(const ToastPayload& payload)
+{
+    ToastHistoryEntry entry{ payload.Tag, payload.Group, ReadToastLaunch(payload.Xml) };
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    AddLocked(std::move(entry));
+}
+
+void ToastHistoryIndex::Add(ToastHistoryEntry entry)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    AddLocked(std::move(entry));
+}
+
+void ToastHistoryIndex::OnRemoved(const std::wstring& tag, const std::wstring& group)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    Node* node = FindLocked(tag, group);
+    if (node != nullptr)
+    {
+        RemoveLocked(*node);
+    }
+}
+
+void ToastHistoryIndex::OnGroupRemoved(const std::wstring& group)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_byGroup.find(group);
+    if (it == m_byGroup.end())
+    {
+        return;
+    }
+
+    // RemoveLocked erases from the set, and the set itself once it's empty
+    std::vector<Node*> nodes(it->second.begin(), it->second.end());
+    for (Node* node : nodes)
+    {
+        RemoveLocked(*node);
+    }
+}
+
+void ToastHistoryIndex::OnCleared()
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_byKey.clear();
+    m_byGroup.clear();
+    m_byArgument.clear();
+    m_untagged.clear();
+    m_nodes.clear();
+}
+
+ToastHistoryReconcileResult ToastHistoryIndex::Reconcile(const std::vector<ToastHistoryEntry>& platformHistory)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    ToastHistoryReconcileResult result{ 0, 0 };
+
+    // Mark every toast the platform still has, then sweep away the ones that weren't marked
+    std::uint64_t generation = ++m_generation;
+    for (const ToastHistoryEntry& entry : platformHistory)
+    {
+        Node* match = nullptr;
+        if (!entry.Tag.empty())
+        {
+            match = FindLocked(entry.Tag, entry.Group);
+            if (match != nullptr && match->Entry.Launch != entry.Launch)
+            {
+                // Replaced on the platform by a toast we didn't see
+                RemoveLocked(*match);
+                match = nullptr;
+            }
+        }
+        else
+        {
+            auto range = m_untagged.equal_range(Key(entry.Group, entry.Launch));
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (it->second->Generation != generation)
+                {
+                    match = it->second;
+                    break;
+                }
+            }
+        }
+
+        if (match != nullptr)
+        {
+            match->Generation = generation;
+        }
+        else
+        {
+            AddLocked(entry);
+            result.Added++;
+        }
+    }
+
+    for (auto it = m_nodes.begin(); it != m_nodes.end();)
+    {
+        Node& node = *it++;
+        if (node.Generation != generation)
+        {
+            RemoveLocked(node);
+            result.Removed++;
+        }
+    }
+
+    return result;
+}
+
+std::size_t ToastHistoryIndex::Size() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_nodes.size();
+}
+
+bool ToastHistoryIndex::Contains(const std::wstring& tag, const std::wstring& group) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return FindLocked(tag, group) != nullptr;
+}
+
+bool ToastHistoryIndex::TryGet(const std::wstring& tag, const std::wstring& group, ToastHistoryEntry& entry) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    Node* node = FindLocked(tag, group);
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    entry = node->Entry;
+    return true;
+}
+
+std::size_t ToastHistoryIndex::CountInGroup(const std::wstring& group) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_byGroup.find(group);
+    return it != m_byGroup.end() ? it->second.size() : 0;
+}
+
+std::vector<ToastHistoryEntry> ToastHistoryIndex::GetGroup(const std::wstring& group) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_byGroup.find(group);
+    return Copy(it != m_byGroup.end() ? &it->second : nullptr);
+}
+
+std::vector<ToastHistoryEntry> ToastHistoryIndex::FindByArgument(std::wstring_view key, std::wstring_view value) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_byArgument.find(Key(key, value));
+    return Copy(it != m_byArgument.end() ? &it->second : nullptr);
+}
+
+std::size_t ToastHistoryIndex::CountWithArgument(std::wstring_view key, std::wstring_view value) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_byArgument.find(Key(key, value));
+    return it != m_byArgument.end() ? it->second.size() : 0;
+}
+
+std::vector<ToastHistoryEntry> ToastHistoryIndex::GetAll() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    std::vector<ToastHistoryEntry> entries;
+    entries.reserve(m_nodes.size());
+    for (const Node& node : m_nodes)
+    {
+        entries.push_back(node.Entry);
+    }
+    return entries;
+}
@@ -0,0 +1,119 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "INotificationPlatform.h"
+
+struct ToastHistoryReconcileResult
+{
+    /// <summary>
+    /// Toasts the platform has that the index didn't, such as scheduled toasts that have since been delivered.
+    /// </summary>
+    std::size_t Added;
+
+    /// <summary>
+    /// Toasts the index had that are gone from the platform, usually because the user dismissed them.
+    /// </summary>
+    std::size_t Removed;
+};
+
+/// <summary>
+/// A local mirror of an app's notification history, so questions like "is there already a toast for this
+/// conversation?" are answered without a cross-process call. Toasts are indexed by tag and group, by group, and
+/// by each key=value pair of their launch arguments; all of those lookups are hash lookups. Keep it current by
+/// calling the On* methods as the app shows and removes toasts, and call Reconcile with the platform's history
+/// from time to time to pick up what the user dismissed. Thread-safe.
+/// </summary>
+class ToastHistoryIndex
+{
+public:
+    /// <summary>
+    /// Records a toast the app has just shown. Like the platform, a toast with the same tag and group replaces the earlier one.
+    /// </summary>
+    void OnShown(const ToastPayload& payload);
+
+    void Add(ToastHistoryEntry entry);
+    void OnRemoved(const std::wstring& tag, const std::wstring& group);
+    void OnGroupRemoved(const std::wstring& group);
+    void OnCleared();
+
+    /// <summary>
+    /// Brings the index in line with the platform's history, touching only the entries that differ.
+    /// Tagged toasts are matched by tag and group, untagged ones by group and launch arguments.
+    /// </summary>
+    ToastHistoryReconcileResult Reconcile(const std::vector<ToastHistoryEntry>& platformHistory);
+
+    std::size_t Size() const;
+    bool Contains(const std::wstring& tag, const std::wstring& group) const;
+    bool TryGet(const std::wstring& tag, const std::wstring& group, ToastHistoryEntry& entry) const;
+
+    std::size_t CountInGroup(const std::wstring& group) const;
+    std::vector<ToastHistoryEntry> GetGroup(const std::wstring& group) const;
+
+    /// <summary>
+    /// Toasts whose launch arguments contain key=value. The value is compared as it appears in the arguments, still percent-encoded.
+    /// </summary>
+    std::vector<ToastHistoryEntry> FindByArgument(std::wstring_view key, std::wstring_view value) const;
+    std::size_t CountWithArgument(std::wstring_view key, std::wstring_view value) const;
+
+    /// <summary>
+    /// Every indexed toast, oldest first.
+    /// </summary>
+    std::vector<ToastHistoryEntry> GetAll() const;
+
+private:
+    struct Node;
+    using NodeList = std::list<Node>;
+    using NodeSet = std::unordered_set<Node*>;
+
+    struct Node
+    {
+        ToastHistoryEntry Entry;
+        NodeList::iterator Self;
+
+        // The last Reconcile that found this toast on the platform
+        std::uint64_t Generation;
+    };
+
+    Node& AddLocked(ToastHistoryEntry entry);
+    void RemoveLocked(Node& node);
+    Node* FindLocked(const std::wstring& tag, const std::wstring& group) const;
+    static std::vector<ToastHistoryEntry> Copy(const NodeSet* nodes);
+
+    static std::wstring Key(std::wstring_view first, std::wstring_view second);
+
+    mutable std::shared_mutex m_mutex;
+
+    // Oldest first, like Action Center
+    NodeList m_nodes;
+
+    // Keyed by group and tag; only tagged toasts can be addressed individually
+    std::unordered_map<std::wstring, Node*> m_byKey;
+    std::unordered_map<std::wstring, NodeSet> m_byGroup;
+
+    // Keyed by argument key and value
+    std::unordered_map<std::wstring, NodeSet> m_byArgument;
+
+    // Untagged toasts keyed by group and launch arguments, for Reconcile to match them up
+    std::unordered_multimap<std::wstring, Node*> m_untagged;
+
+    std::uint64_t m_generation = 0;
+};
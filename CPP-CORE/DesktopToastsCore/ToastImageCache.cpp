@@ -0,0 +1,1025 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastImageCache.h"
+#include "ToastTemplate.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+#endif
+
+namespace
+{
+    // Only the first half of the SHA-256 is kept in file names, which is still far beyond any chance of collision
+    constexpr std::size_t HashDigits = 32;
+
+    class Sha256
+    {
+    public:
+        void Update(const std::uint8_t* data, std::size_t size)
+        {
+            m_length += size;
+            while (size > 0)
+            {
+                std::size_t count = std::min(size, m_block.size() - m_blockSize);
+                std::copy(data, data + count, m_block.begin() + m_blockSize);
+                m_blockSize += count;
+                data += count;
+                size -= count;
+                if (m_blockSize == m_block.size())
+                {
+                    Transform();
+                    m_blockSize = 0;
+                }
+            }
+        }
+
+        std::array<std::uint8_t, 32> Finish()
+        {
+            std::uint64_t bits = m_length * 8;
+            std::uint8_t padding = 0x80;
+            Update(&padding, 1);
+            padding = 0;
+            while (m_blockSize != 56)
+            {
+                Update(&padding, 1);
+            }
+            std::uint8_t length[8];
+            for (int i = 0; i < 8; i++)
+            {
+                length[i] = static_cast<std::uint8_t>(bits >> (56 - 8 * i));
+            }
+            Update(length, 8);
+
+            std::array<std::uint8_t, 32> digest;
+            for (std::size_t i = 0; i < 8; i++)
+            {
+                for (std::size_t k = 0; k < 4; k++)
+                {
+                    digest[i * 4 + k] = static_cast<std::uint8_t>(m_state[i] >> (24 - 8 * k));
+                }
+            }
+            return digest;
+        }
+
+    private:
+        static std::uint32_t Rotate(std::uint32_t value, int count)
+        {
+            return (value >> count) | (value << (32 - count));
+        }
+
+        void Transform()
+        {
+            static constexpr std::uint32_t Rounds[64] =
+            {
+                0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+            };
+
+            std::uint32_t words[64];
+            for (std::size_t i = 0; i < 16; i++)
+            {
+                words[i] = (static_cast<std::uint32_t>(m_block[i * 4]) << 24) | (static_cast<std::uint32_t>(m_block[i * 4 + 1]) << 16) |
+                    (static_cast<std::uint32_t>(m_block[i * 4 + 2]) << 8) | m_block[i * 4 + 3];
+            }
+            for (std::size_t i = 16; i < 64; i++)
+            {
+                std::uint32_t s0 = Rotate(words[i - 15], 7) ^ Rotate(words[i - 15], 18) ^ (words[i - 15] >> 3);
+                std::uint32_t s1 = Rotate(words[i - 2], 17) ^ Rotate(words[i - 2], 19) ^ (words[i - 2] >> 10);
+                words[i] = words[i - 16] + s0 + words[i - 7] + s1;
+            }
+
+            std::uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+            std::uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+            for (std::size_t i = 0; i < 64; i++)
+            {
+                std::uint32_t t1 = h + (Rotate(e, 6) ^ Rotate(e, 11) ^ Rotate(e, 25)) + ((e & f) ^ (~e & g)) + Rounds[i] + words[i];
+                std::uint32_t t2 = (Rotate(a, 2) ^ Rotate(a, 13) ^ Rotate(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+
+            m_state[0] += a;
+            m_state[1] += b;
+            m_state[2] += c;
+            m_state[3] += d;
+            m_state[4] += e;
+            m_state[5] += f;
+            m_state[6] += g;
+            m_state[7] += h;
+        }
+
+        std::uint32_t m_state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+        std::array<std::uint8_t, 64> m_block{};
+        std::size_t m_blockSize = 0;
+        std::uint64_t m_length = 0;
+    };
+
+    std::wstring ContentHash(const std::vector<std::uint8_t>& image)
+    {
+        Sha256 hash;
+        hash.Update(image.data(), image.size());
+        std::array<std::uint8_t, 32> digest = hash.Finish();
+
+        static const wchar_t digits[] = L"0123456789abcdef";
+        std::wstring hex;
+        hex.reserve(HashDigits);
+        for (std::size_t i = 0; i < HashDigits / 2; i++)
+        {
+            hex += digits[digest[i] >> 4];
+            hex += digits[digest[i] & 0xF];
+        }
+        return hex;
+    }
+
+    const wchar_t* Extension(ToastImageFormat format)
+    {
+        switch (format)
+        {
+        case ToastImageFormat::Png:
+            return L".png";
+        case ToastImageFormat::Jpeg:
+            return L".jpg";
+        default:
+            return L".gif";
+        }
+    }
+
+    // Images are written under this prefix and renamed into place, so a file left behind by a process that exited
+    // part way through is known to be the cache's own
+    const std::wstring TemporaryPrefix = L"toastimage-";
+
+    bool IsTemporaryName(const std::filesystem::path& path)
+    {
+        return path.extension() == L".tmp" && path.filename().wstring().compare(0, TemporaryPrefix.size(), TemporaryPrefix) == 0;
+    }
+
+    // Names look like <hash>.png for an image kept as it was and <hash>-<width>x<height>.png for one that was scaled
+    bool IsStoredImageName(const std::wstring& stem, const std::wstring& extension)
+    {
+        if (extension != L".png" && extension != L".jpg" && extension != L".gif")
+        {
+            return false;
+        }
+        if (stem.size() < HashDigits || !std::all_of(stem.begin(), stem.begin() + HashDigits, [](wchar_t c) { return (c >= L'0' && c <= L'9') || (c >= L'a' && c <= L'f'); }))
+        {
+            return false;
+        }
+        if (stem.size() == HashDigits)
+        {
+            return true;
+        }
+
+        std::size_t times = stem.find(L'x', HashDigits);
+        auto isNumber = [&](std::size_t start, std::size_t end)
+        {
+            return end > start && std::all_of(stem.begin() + start, stem.begin() + end, [](wchar_t c) { return c >= L'0' && c <= L'9'; });
+        };
+        return stem[HashDigits] == L'-' && times != std::wstring::npos && isNumber(HashDigits + 1, times) && isNumber(times + 1, stem.size());
+    }
+
+    bool IsHttpUri(const std::wstring& uri)
+    {
+        return uri.compare(0, 7, L"http://") == 0 || uri.compare(0, 8, L"https://") == 0;
+    }
+
+    std::uint32_t ReadBigEndian16(const std::vector<std::uint8_t>& bytes, std::size_t offset)
+    {
+        return (static_cast<std::uint32_t>(bytes[offset]) << 8) | bytes[offset + 1];
+    }
+
+    std::uint32_t ReadBigEndian32(const std::vector<std::uint8_t>& bytes, std::size_t offset)
+    {
+        return (ReadBigEndian16(bytes, offset) << 16) | ReadBigEndian16(bytes, offset + 2);
+    }
+
+    bool ReadJpegSize(const std::vector<std::uint8_t>& image, ToastImageSize& size)
+    {
+        std::size_t i = 2;
+        while (i + 1 < image.size())
+        {
+            if (image[i] != 0xFF)
+            {
+                return false;
+            }
+            std::uint8_t marker = image[i + 1];
+            i += 2;
+            if (marker == 0xFF)
+            {
+                // Fill byte before the marker
+                i--;
+                continue;
+            }
+            if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+            {
+                continue;
+            }
+            if (i + 2 > image.size())
+            {
+                return false;
+            }
+
+            std::uint32_t length = ReadBigEndian16(image, i);
+            bool startOfFrame = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+            if (startOfFrame)
+            {
+                if (length < 7 || i + 7 > image.size())
+                {
+                    return false;
+                }
+                size.Height = ReadBigEndian16(image, i + 3);
+                size.Width = ReadBigEndian16(image, i + 5);
+                return true;
+            }
+            if (length < 2)
+            {
+                return false;
+            }
+            i += length;
+        }
+        return false;
+    }
+}
+
+ToastResult ReadToastImageInfo(const std::vector<std::uint8_t>& image, ToastImageInfo& info)
+{
+    static const std::uint8_t pngSignature[] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+
+    info = ToastImageInfo{ ToastImageFormat::Unknown, { 0, 0 } };
+    if (image.size() >= 24 && std::equal(std::begin(pngSignature), std::end(pngSignature), image.begin()) &&
+        std::equal(image.begin() + 12, image.begin() + 16, "IHDR"))
+    {
+        info.Format = ToastImageFormat::Png;
+        info.Size = { ReadBigEndian32(image, 16), ReadBigEndian32(image, 20) };
+    }
+    else if (image.size() >= 10 && (std::equal(image.begin(), image.begin() + 6, "GIF87a") || std::equal(image.begin(), image.begin() + 6, "GIF89a")))
+    {
+        info.Format = ToastImageFormat::Gif;
+        info.Size = { static_cast<std::uint32_t>(image[6] | (image[7] << 8)), static_cast<std::uint32_t>(image[8] | (image[9] << 8)) };
+    }
+    else if (image.size() >= 4 && image[0] == 0xFF && image[1] == 0xD8)
+    {
+        if (!ReadJpegSize(image, info.Size))
+        {
+            return ToastResultInvalidArgument;
+        }
+        info.Format = ToastImageFormat::Jpeg;
+    }
+
+    return info.Format != ToastImageFormat::Unknown && info.Size.Width != 0 && info.Size.Height != 0 ? ToastResultOk : ToastResultInvalidArgument;
+}
+
+#if defined(_WIN32)
+
+ToastResult ScaleToastImageWithWic(const std::vector<std::uint8_t>& image, ToastImageSize size, std::vector<std::uint8_t>& scaled)
+{
+    using Microsoft::WRL::ComPtr;
+
+    ComPtr<IWICImagingFactory> factory;
+    HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+
+    ComPtr<IWICStream> input;
+    ComPtr<IWICBitmapDecoder> decoder;
+    ComPtr<IWICBitmapFrameDecode> frame;
+    ComPtr<IWICBitmapScaler> scaler;
+    ComPtr<IWICFormatConverter> converter;
+    if (SUCCEEDED(hr)) hr = factory->CreateStream(&input);
+    if (SUCCEEDED(hr)) hr = input->InitializeFromMemory(const_cast<BYTE*>(image.data()), static_cast<DWORD>(image.size()));
+    if (SUCCEEDED(hr)) hr = factory->CreateDecoderFromStream(input.Get(), nullptr, WICDecodeMetadataCacheOnDemand, &decoder);
+    if (SUCCEEDED(hr)) hr = decoder->GetFrame(0, &frame);
+    if (SUCCEEDED(hr)) hr = factory->CreateBitmapScaler(&scaler);
+    if (SUCCEEDED(hr)) hr = scaler->Initialize(frame.Get(), size.Width, size.Height, WICBitmapInterpolationModeFant);
+    if (SUCCEEDED(hr)) hr = factory->CreateFormatConverter(&converter);
+    if (SUCCEEDED(hr)) hr = converter->Initialize(scaler.Get(), GUID_WICPixelFormat32bppBGRA, WICBitmapDitherTypeNone, nullptr, 0, WICBitmapPaletteTypeCustom);
+
+    ComPtr<IStream> output;
+    ComPtr<IWICBitmapEncoder> encoder;
+    ComPtr<IWICBitmapFrameEncode> target;
+    WICPixelFormatGUID pixelFormat = GUID_WICPixelFormat32bppBGRA;
+    if (SUCCEEDED(hr)) hr = CreateStreamOnHGlobal(nullptr, TRUE, &output);
+    if (SUCCEEDED(hr)) hr = factory->CreateEncoder(GUID_ContainerFormatPng, nullptr, &encoder);
+    if (SUCCEEDED(hr)) hr = encoder->Initialize(output.Get(), WICBitmapEncoderNoCache);
+    if (SUCCEEDED(hr)) hr = encoder->CreateNewFrame(&target, nullptr);
+    if (SUCCEEDED(hr)) hr = target->Initialize(nullptr);
+    if (SUCCEEDED(hr)) hr = target->SetSize(size.Width, size.Height);
+    if (SUCCEEDED(hr)) hr = target->SetPixelFormat(&pixelFormat);
+    if (SUCCEEDED(hr)) hr = target->WriteSource(converter.Get(), nullptr);
+    if (SUCCEEDED(hr)) hr = target->Commit();
+    if (SUCCEEDED(hr)) hr = encoder->Commit();
+
+    HGLOBAL memory = nullptr;
+    STATSTG stat = {};
+    if (SUCCEEDED(hr)) hr = GetHGlobalFromStream(output.Get(), &memory);
+    if (SUCCEEDED(hr)) hr = output->Stat(&stat, STATFLAG_NONAME);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    const std::uint8_t* data = static_cast<const std::uint8_t*>(GlobalLock(memory));
+    if (data == nullptr)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+    scaled.assign(data, data + stat.cbSize.QuadPart);
+    GlobalUnlock(memory);
+    return ToastResultOk;
+}
+
+#endif
+
+ToastImageCache::ToastImageCache(IToastImageFetcher& fetcher, ToastImageCacheOptions options) :
+    m_fetcher(fetcher),
+    m_options(std::move(options))
+{
+    if (!(m_options.ScaleFactor > 0))
+    {
+        throw std::invalid_argument("ScaleFactor must be positive.");
+    }
+    if (m_options.MaxSources == 0)
+    {
+        throw std::invalid_argument("MaxSources must be positive.");
+    }
+}
+
+ToastResult ToastImageCache::Open(const std::filesystem::path& directory)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error)
+    {
+        return ToastResultFail;
+    }
+
+    struct Found
+    {
+        std::filesystem::file_time_type Time;
+        std::wstring Stem;
+        std::wstring FileName;
+        std::uint64_t Bytes;
+    };
+    std::vector<Found> found;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+    {
+        const std::filesystem::path& path = it->path();
+        std::error_code entryError;
+        if (!it->is_regular_file(entryError))
+        {
+            continue;
+        }
+
+        // Left behind by a process that exited while storing an image
+        if (IsTemporaryName(path))
+        {
+            std::filesystem::remove(path, entryError);
+            continue;
+        }
+
+        std::wstring stem = path.stem().wstring();
+        if (IsStoredImageName(stem, path.extension().wstring()))
+        {
+            std::uint64_t bytes = it->file_size(entryError);
+            std::filesystem::file_time_type time = it->last_write_time(entryError);
+            if (!entryError)
+            {
+                found.push_back({ time, std::move(stem), path.filename().wstring(), bytes });
+            }
+        }
+    }
+    if (error)
+    {
+        return ToastResultFail;
+    }
+
+    std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.Time < b.Time; });
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_directory = directory;
+    m_images.clear();
+    m_imagesByStem.clear();
+    m_recentSources.clear();
+    m_sources.clear();
+    m_pins.clear();
+    m_pruneAt = 64;
+    m_bytes = 0;
+    for (Found& image : found)
+    {
+        m_images.push_front({ std::move(image.Stem), std::move(image.FileName), image.Bytes, {}, {} });
+        m_imagesByStem[m_images.front().Stem] = m_images.begin();
+        m_bytes += image.Bytes;
+    }
+    EvictLocked();
+    return ToastResultOk;
+}
+
+ToastResult ToastImageCache::Resolve(const std::wstring& source, ToastImagePlacement placement, std::wstring& localUri)
+{
+    std::wstring imageStem;
+    return Resolve(source, placement, localUri, imageStem);
+}
+
+ToastResult ToastImageCache::Resolve(const std::wstring& source, ToastImagePlacement placement, std::wstring& localUri, std::wstring& imageStem)
+{
+    // The same source is stored once per placement it's used in, since each is scaled differently
+    std::wstring key;
+    key.reserve(source.size() + 1);
+    key += static_cast<wchar_t>(L'0' + static_cast<int>(placement));
+    key += source;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_sources.find(key);
+        if (found != m_sources.end())
+        {
+            const SourceEntry& entry = found->second->second;
+            if (!entry.Stem.empty())
+            {
+                auto stored = m_imagesByStem.find(entry.Stem);
+                m_images.splice(m_images.begin(), m_images, stored->second);
+            }
+            m_recentSources.splice(m_recentSources.begin(), m_recentSources, found->second);
+            m_stats.Hits++;
+            localUri = entry.LocalUri;
+            imageStem = entry.Stem;
+            return ToastResultOk;
+        }
+        m_stats.Misses++;
+    }
+
+    std::filesystem::path localPath = ToastFileUriPath(source);
+    std::vector<std::uint8_t> image;
+    ToastResult result = !localPath.empty() ? ReadToastImageFile(localPath, image) : IsHttpUri(source) ? m_fetcher.Fetch(source, image) : ToastResultInvalidArgument;
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    ToastImageInfo info;
+    result = ReadToastImageInfo(image, info);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    ToastImageSize target = TargetSize(info.Size, placement);
+    bool scale = m_options.Scaler && (target.Width != info.Size.Width || target.Height != info.Size.Height);
+    if (!localPath.empty() && !scale)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        SourceEntry& entry = SourceLocked(key);
+        UnlinkLocked(key, entry.Stem);
+        entry.LocalUri = ToastFileUri(localPath);
+        entry.Stem.clear();
+        localUri = entry.LocalUri;
+        imageStem.clear();
+        return ToastResultOk;
+    }
+
+    std::wstring stem = ContentHash(image);
+    if (scale)
+    {
+        stem += L'-' + std::to_wstring(target.Width) + L'x' + std::to_wstring(target.Height);
+    }
+
+    // Another source may have brought in the same image already, in which case there's nothing to scale or write
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_directory.empty())
+        {
+            return ToastResultFail;
+        }
+        auto stored = m_imagesByStem.find(stem);
+        if (stored != m_imagesByStem.end())
+        {
+            m_stats.Deduplicated++;
+            LinkLocked(key, stored->second, localUri);
+            imageStem = stem;
+            return ToastResultOk;
+        }
+    }
+
+    std::vector<std::uint8_t> scaled;
+    const std::vector<std::uint8_t>* contents = &image;
+    ToastImageFormat format = info.Format;
+    if (scale)
+    {
+        ToastImageInfo scaledInfo;
+        result = m_options.Scaler(image, target, scaled);
+        if (ToastSucceeded(result))
+        {
+            result = ReadToastImageInfo(scaled, scaledInfo);
+        }
+        if (!ToastSucceeded(result))
+        {
+            return result;
+        }
+        contents = &scaled;
+        format = scaledInfo.Format;
+    }
+
+    result = Store(key, stem + Extension(format), *contents, scale, localUri);
+    if (ToastSucceeded(result))
+    {
+        imageStem = stem;
+    }
+    return result;
+}
+
+ToastResult ToastImageCache::Store(const std::wstring& key, const std::wstring& fileName, const std::vector<std::uint8_t>& contents, bool scaled, std::wstring& localUri)
+{
+    std::filesystem::path directory;
+    std::wstring temporaryName;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        directory = m_directory;
+        temporaryName = TemporaryPrefix + fileName + L'.' + std::to_wstring(m_nextTemporary++) + L".tmp";
+    }
+
+    // Written under another name first, so the file is never seen half written, even by another process
+    std::filesystem::path temporary = directory / temporaryName;
+    std::error_code error;
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size())) || !file.flush())
+        {
+            file.close();
+            std::filesystem::remove(temporary, error);
+            return ToastResultFail;
+        }
+    }
+    std::filesystem::rename(temporary, directory / fileName, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        return ToastResultFail;
+    }
+
+    std::wstring stem = std::filesystem::path(fileName).stem().wstring();
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Uninstalled, or opened on another directory, while the image was being written
+    if (m_directory != directory)
+    {
+        std::filesystem::remove(directory / fileName, error);
+        return ToastResultFail;
+    }
+
+    auto stored = m_imagesByStem.find(stem);
+    if (stored == m_imagesByStem.end())
+    {
+        m_images.push_front({ stem, fileName, contents.size(), {}, {} });
+        stored = m_imagesByStem.emplace(stem, m_images.begin()).first;
+        m_bytes += contents.size();
+        m_stats.Stored++;
+        m_stats.Scaled += scaled ? 1 : 0;
+    }
+    else
+    {
+        m_stats.Deduplicated++;
+    }
+
+    LinkLocked(key, stored->second, localUri);
+    EvictLocked();
+    return ToastResultOk;
+}
+
+void ToastImageCache::LinkLocked(const std::wstring& key, ImageList::iterator stored, std::wstring& localUri)
+{
+    m_images.splice(m_images.begin(), m_images, stored);
+
+    // Threads that missed on the same source at once link it to the same image
+    SourceEntry& entry = SourceLocked(key);
+    if (entry.Stem != stored->Stem)
+    {
+        UnlinkLocked(key, entry.Stem);
+        stored->Sources.push_back(key);
+    }
+    entry.LocalUri = ToastFileUri(m_directory / stored->FileName);
+    entry.Stem = stored->Stem;
+    localUri = entry.LocalUri;
+}
+
+ToastImageCache::SourceEntry& ToastImageCache::SourceLocked(const std::wstring& key)
+{
+    auto found = m_sources.find(key);
+    if (found != m_sources.end())
+    {
+        m_recentSources.splice(m_recentSources.begin(), m_recentSources, found->second);
+        return found->second->second;
+    }
+
+    m_recentSources.emplace_front(key, SourceEntry());
+    m_sources.emplace(key, m_recentSources.begin());
+    while (m_recentSources.size() > m_options.MaxSources)
+    {
+        std::pair<std::wstring, SourceEntry>& oldest = m_recentSources.back();
+        UnlinkLocked(oldest.first, oldest.second.Stem);
+        m_sources.erase(oldest.first);
+        m_recentSources.pop_back();
+    }
+    return m_recentSources.front().second;
+}
+
+void ToastImageCache::UnlinkLocked(const std::wstring& key, const std::wstring& stem)
+{
+    auto stored = stem.empty() ? m_imagesByStem.end() : m_imagesByStem.find(stem);
+    if (stored != m_imagesByStem.end())
+    {
+        std::vector<std::wstring>& sources = stored->second->Sources;
+        sources.erase(std::remove(sources.begin(), sources.end(), key), sources.end());
+    }
+}
+
+void ToastImageCache::EvictLocked()
+{
+    // The most recently used image is kept even if it's over the budget on its own, since it's about to be shown. So
+    // are images in toasts that are still up, which can leave the cache over its budget until they've gone
+    ImageList::iterator next = m_images.end();
+    while (m_bytes > m_options.MaxBytes && next != m_images.begin() && std::prev(next) != m_images.begin())
+    {
+        ImageList::iterator oldest = std::prev(next);
+        if (PinnedLocked(*oldest))
+        {
+            next = oldest;
+            continue;
+        }
+
+        std::error_code error;
+        std::filesystem::remove(m_directory / oldest->FileName, error);
+
+        for (const std::wstring& key : oldest->Sources)
+        {
+            auto source = m_sources.find(key);
+            if (source != m_sources.end() && source->second->second.Stem == oldest->Stem)
+            {
+                m_recentSources.erase(source->second);
+                m_sources.erase(source);
+            }
+        }
+
+        m_bytes -= oldest->Bytes;
+        m_imagesByStem.erase(oldest->Stem);
+        next = m_images.erase(oldest);
+        m_stats.Evicted++;
+    }
+}
+
+void ToastImageCache::PinLocked(const std::wstring& tag, const std::wstring& group, const std::vector<std::wstring>& stems)
+{
+    std::wstring key;
+    key.reserve(group.size() + 1 + tag.size());
+    key += group;
+    key += L'\0';
+    key += tag;
+
+    // A tagged toast replaces the one shown before it, whose images only need keeping if this one shows them too.
+    // Untagged toasts in a group can't be told apart, so their images add up until the group has gone
+    auto pin = m_pins.find(key);
+    if (pin != m_pins.end() && !tag.empty())
+    {
+        UnpinLocked(pin);
+        pin = m_pins.end();
+    }
+    if (pin == m_pins.end())
+    {
+        if (m_pins.size() >= m_pruneAt)
+        {
+            PruneLocked();
+        }
+        pin = m_pins.emplace(key, PinnedToast{ tag, group, {} }).first;
+    }
+
+    std::vector<std::wstring>& pinned = pin->second.Stems;
+    for (const std::wstring& stem : stems)
+    {
+        auto stored = m_imagesByStem.find(stem);
+        if (stored != m_imagesByStem.end() && std::find(pinned.begin(), pinned.end(), stem) == pinned.end())
+        {
+            pinned.push_back(stem);
+            stored->second->Toasts.push_back(key);
+        }
+    }
+    if (pinned.empty())
+    {
+        m_pins.erase(pin);
+    }
+}
+
+void ToastImageCache::UnpinLocked(PinMap::iterator pin)
+{
+    for (const std::wstring& stem : pin->second.Stems)
+    {
+        auto stored = m_imagesByStem.find(stem);
+        if (stored != m_imagesByStem.end())
+        {
+            std::vector<std::wstring>& toasts = stored->second->Toasts;
+            toasts.erase(std::remove(toasts.begin(), toasts.end(), pin->first), toasts.end());
+        }
+    }
+    m_pins.erase(pin);
+}
+
+bool ToastImageCache::PinnedLocked(StoredImage& image)
+{
+    while (!image.Toasts.empty())
+    {
+        auto pin = m_pins.find(image.Toasts.back());
+        if (pin == m_pins.end())
+        {
+            image.Toasts.pop_back();
+        }
+        else if (m_options.IsToastLive(pin->second.Tag, pin->second.Group))
+        {
+            return true;
+        }
+        else
+        {
+            // The toast has gone, so nothing it showed needs keeping for it
+            UnpinLocked(pin);
+        }
+    }
+    return false;
+}
+
+void ToastImageCache::PruneLocked()
+{
+    // Toasts that were dismissed or replaced without their images coming up for eviction
+    for (auto pin = m_pins.begin(); pin != m_pins.end();)
+    {
+        auto next = std::next(pin);
+        if (!m_options.IsToastLive(pin->second.Tag, pin->second.Group))
+        {
+            UnpinLocked(pin);
+        }
+        pin = next;
+    }
+    m_pruneAt = std::max<std::size_t>(64, m_pins.size() * 2);
+}
+
+ToastResult ToastImageCache::Rewrite(ToastPayload& payload)
+{
+    const std::wstring& xml = payload.Xml;
+    std::wstring rewritten;
+    std::size_t copied = 0;
+    ToastResult firstFailure = ToastResultOk;
+    std::vector<std::wstring> stems;
+
+    for (std::size_t start = xml.find(L"<image"); start != std::wstring::npos; start = xml.find(L"<image", start + 6))
+    {
+        std::size_t i = start + 6;
+        if (i >= xml.size() || (xml[i] != L' ' && xml[i] != L'\t' && xml[i] != L'\r' && xml[i] != L'\n' && xml[i] != L'/' && xml[i] != L'>'))
+        {
+            continue;
+        }
+
+        std::wstring_view src;
+        std::size_t srcOffset = 0;
+        std::wstring_view placement;
+        while (i < xml.size() && xml[i] != L'>' && xml[i] != L'/')
+        {
+            if (xml[i] == L' ' || xml[i] == L'\t' || xml[i] == L'\r' || xml[i] == L'\n')
+            {
+                i++;
+                continue;
+            }
+
+            std::size_t equals = xml.find(L'=', i);
+            std::size_t quote = equals == std::wstring::npos ? std::wstring::npos : xml.find_first_of(L"\"'", equals);
+            std::size_t closing = quote == std::wstring::npos ? std::wstring::npos : xml.find(xml[quote], quote + 1);
+            if (closing == std::wstring::npos)
+            {
+                break;
+            }
+
+            std::wstring_view name = std::wstring_view(xml).substr(i, equals - i);
+            name = name.substr(0, name.find_last_not_of(L" \t\r\n") + 1);
+            std::wstring_view value = std::wstring_view(xml).substr(quote + 1, closing - quote - 1);
+            if (name == L"src")
+            {
+                src = value;
+                srcOffset = quote + 1;
+            }
+            else if (name == L"placement")
+            {
+                placement = value;
+            }
+            i = closing + 1;
+        }
+
+        std::wstring source;
+        AppendUnescapedXml(source, src);
+        if (!IsHttpUri(source) && ToastFileUriPath(source).empty())
+        {
+            continue;
+        }
+
+        std::wstring localUri;
+        std::wstring stem;
+        ToastResult result = Resolve(source, placement == L"appLogoOverride" ? ToastImagePlacement::AppLogo : placement == L"hero" ? ToastImagePlacement::Hero : ToastImagePlacement::Inline, localUri, stem);
+        if (!ToastSucceeded(result))
+        {
+            firstFailure = ToastSucceeded(firstFailure) ? result : firstFailure;
+            continue;
+        }
+        if (!stem.empty())
+        {
+            stems.push_back(std::move(stem));
+        }
+
+        rewritten.append(xml, copied, srcOffset - copied);
+        AppendEscapedXml(rewritten, localUri, ToastTemplateSlotKind::Attribute);
+        copied = srcOffset + src.size();
+    }
+
+    if (copied > 0)
+    {
+        rewritten.append(xml, copied, std::wstring::npos);
+        payload.Xml = std::move(rewritten);
+    }
+
+    // Even with no images of its own, a tagged toast replaces one that may have had some
+    if (m_options.IsToastLive)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        PinLocked(payload.Tag, payload.Group, stems);
+    }
+    return firstFailure;
+}
+
+ToastImageSize ToastImageCache::TargetSize(ToastImageSize size, ToastImagePlacement placement) const
+{
+    // The size each placement is rendered at, in toast pixels; inline images are as tall as their aspect ratio makes them
+    double boxWidth = placement == ToastImagePlacement::AppLogo ? 48 : 364;
+    double boxHeight = placement == ToastImagePlacement::AppLogo ? 48 : placement == ToastImagePlacement::Hero ? 180 : 0;
+
+    double factor = boxWidth * m_options.ScaleFactor / size.Width;
+    if (boxHeight > 0)
+    {
+        factor = std::max(factor, boxHeight * m_options.ScaleFactor / size.Height);
+    }
+    if (factor >= 1)
+    {
+        return size;
+    }
+
+    auto scale = [factor](std::uint32_t length) { return std::max<std::uint32_t>(1, static_cast<std::uint32_t>(std::lround(length * factor))); };
+    return { scale(size.Width), scale(size.Height) };
+}
+
+ToastResult ToastImageCache::Uninstall()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_directory.empty())
+    {
+        return ToastResultOk;
+    }
+
+    ToastResult result = ToastResultOk;
+    for (const StoredImage& image : m_images)
+    {
+        std::error_code error;
+        std::filesystem::remove(m_directory / image.FileName, error);
+        result = error && ToastSucceeded(result) ? ToastResultFail : result;
+    }
+
+    // A Store still writing finds the cache closed once it's done, and deletes what it wrote itself
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(m_directory, error), end; !error && it != end; it.increment(error))
+    {
+        std::error_code ignored;
+        if (IsTemporaryName(it->path()))
+        {
+            std::filesystem::remove(it->path(), ignored);
+        }
+    }
+
+    // Fails, leaving it in place, if the app keeps anything else in it
+    std::filesystem::remove(m_directory, error);
+
+    m_directory.clear();
+    m_images.clear();
+    m_imagesByStem.clear();
+    m_recentSources.clear();
+    m_sources.clear();
+    m_pins.clear();
+    m_bytes = 0;
+    return result;
+}
+
+ToastImageCacheStats ToastImageCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ToastImageCacheStats stats = m_stats;
+    stats.Files = m_images.size();
+    stats.Bytes = m_bytes;
+    stats.PinnedToasts = m_pins.size();
+    return stats;
+}
+
+std::wstring ToastFileUri(const std::filesystem::path& path)
+{
+    std::wstring text = path.generic_wstring();
+    std::wstring uri = L"file://";
+    if (text.empty() || text[0] != L'/')
+    {
+        uri += L'/';
+    }
+
+    uri.reserve(uri.size() + text.size());
+    for (wchar_t c : text)
+    {
+        switch (c)
+        {
+        case L' ':
+            uri += L"%20";
+            break;
+        case L'#':
+            uri += L"%23";
+            break;
+        case L'%':
+            uri += L"%25";
+            break;
+        case L'?':
+            uri += L"%3F";
+            break;
+        default:
+            uri += c;
+            break;
+        }
+    }
+    return uri;
+}
+
+std::filesystem::path ToastFileUriPath(const std::wstring& uri)
+{
+    if (uri.compare(0, 8, L"file:///") != 0)
+    {
+        return std::filesystem::path();
+    }
+
+    std::size_t start = 7;
+#if defined(_WIN32)
+    // file:///C:/... is the drive-letter path C:/...
+    if (uri.size() > 10 && uri[9] == L':')
+    {
+        start = 8;
+    }
+#endif
+
+    auto hexValue = [](wchar_t c)
+    {
+        return c >= L'0' && c <= L'9' ? c - L'0' : c >= L'a' && c <= L'f' ? c - L'a' + 10 : c >= L'A' && c <= L'F' ? c - L'A' + 10 : -1;
+    };
+
+    // Only escaped ASCII is decoded; escaped UTF-8 is left as it is
+    std::wstring path;
+    path.reserve(uri.size() - start);
+    for (std::size_t i = start; i < uri.size(); i++)
+    {
+        int high = uri[i] == L'%' && i + 2 < uri.size() ? hexValue(uri[i + 1]) : -1;
+        int low = high >= 0 ? hexValue(uri[i + 2]) : -1;
+        if (low >= 0 && high < 8)
+        {
+            path += static_cast<wchar_t>(high * 16 + low);
+            i += 2;
+        }
+        else
+        {
+            path += uri[i];
+        }
+    }
+    return std::filesystem::path(path);
+}
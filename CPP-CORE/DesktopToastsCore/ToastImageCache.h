@@ -0,0 +1,273 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "INotificationPlatform.h"
+#include "ToastImageFetcher.h"
+#include "ToastPayload.h"
+
+/// <summary>
+/// Where an image sits in a toast, which decides the size it's rendered at.
+/// </summary>
+enum class ToastImagePlacement
+{
+    /// <summary>
+    /// placement="appLogoOverride", 48 by 48.
+    /// </summary>
+    AppLogo,
+
+    /// <summary>
+    /// placement="hero", 364 by 180 and cropped to fill.
+    /// </summary>
+    Hero,
+
+    /// <summary>
+    /// An image with no placement, 364 wide.
+    /// </summary>
+    Inline
+};
+
+enum class ToastImageFormat
+{
+    Unknown,
+    Png,
+    Jpeg,
+    Gif
+};
+
+struct ToastImageSize
+{
+    std::uint32_t Width;
+    std::uint32_t Height;
+};
+
+struct ToastImageInfo
+{
+    ToastImageFormat Format;
+    ToastImageSize Size;
+};
+
+/// <summary>
+/// Reads the format and size of a PNG, JPEG or GIF from its header. Returns ToastResultInvalidArgument for anything
+/// else, or for a header that's cut short.
+/// </summary>
+ToastResult ReadToastImageInfo(const std::vector<std::uint8_t>& image, ToastImageInfo& info);
+
+/// <summary>
+/// Scales image to exactly size, replacing scaled with the result in a format toasts can show.
+/// </summary>
+using ToastImageScaler = std::function<ToastResult(const std::vector<std::uint8_t>& image, ToastImageSize size, std::vector<std::uint8_t>& scaled)>;
+
+#if defined(_WIN32)
+
+/// <summary>
+/// A ToastImageScaler that decodes, scales and encodes as PNG with the Windows Imaging Component. COM must be
+/// initialized on the calling thread.
+/// </summary>
+ToastResult ScaleToastImageWithWic(const std::vector<std::uint8_t>& image, ToastImageSize size, std::vector<std::uint8_t>& scaled);
+
+#endif
+
+struct ToastImageCacheOptions
+{
+    /// <summary>
+    /// Most bytes of images kept on disk. The least recently used are deleted to stay under it.
+    /// </summary>
+    std::uint64_t MaxBytes = 64 * 1024 * 1024;
+
+    /// <summary>
+    /// Most sources remembered in memory. The least recently resolved are forgotten to stay under it; their images
+    /// stay on disk, and are found by their content the next time the source is resolved.
+    /// </summary>
+    std::size_t MaxSources = 4096;
+
+    /// <summary>
+    /// Pixels per toast pixel that images are kept at. The default covers displays scaled up to 200%.
+    /// </summary>
+    double ScaleFactor = 2;
+
+    /// <summary>
+    /// Scales images down that are bigger than their placement renders them. Defaults to ScaleToastImageWithWic on
+    /// Windows; elsewhere, and if this is set to null, images are kept at the size they were fetched at.
+    /// </summary>
+#if defined(_WIN32)
+    ToastImageScaler Scaler = ScaleToastImageWithWic;
+#else
+    ToastImageScaler Scaler;
+#endif
+
+    /// <summary>
+    /// Whether the toast with this tag and group is still in Action Center. Images that Rewrite put into a toast aren't
+    /// evicted while it is, so it never shows a deleted file; an untagged toast is only told apart by its group. Called
+    /// with the cache's lock held, so it mustn't call back into the cache. Null keeps nothing from eviction.
+    /// </summary>
+    std::function<bool(const std::wstring& tag, const std::wstring& group)> IsToastLive;
+};
+
+struct ToastImageCacheStats
+{
+    std::uint64_t Hits;
+    std::uint64_t Misses;
+
+    /// <summary>
+    /// Images stored on disk, and images that turned out to be stored already under another source.
+    /// </summary>
+    std::uint64_t Stored;
+    std::uint64_t Deduplicated;
+    std::uint64_t Scaled;
+    std::uint64_t Evicted;
+
+    std::size_t Files;
+    std::uint64_t Bytes;
+
+    /// <summary>
+    /// Toasts whose images are kept from eviction, as of the last time their images were looked at.
+    /// </summary>
+    std::size_t PinnedToasts;
+};
+
+/// <summary>
+/// Keeps local copies of toast images, so apps that can't use http images (see CanUseHttpImages) can still show
+/// them, and so oversized images are scaled down once rather than by the platform on every toast. Images are stored
+/// by a hash of their content and the size they're scaled to, so sources that serve the same image share one file.
+/// Sources are looked up in memory; only a miss touches the fetcher or the disk. Thread-safe: fetching and scaling
+/// happen outside the lock, so a slow download doesn't hold up lookups of images that are already cached.
+/// </summary>
+class ToastImageCache
+{
+public:
+    ToastImageCache(IToastImageFetcher& fetcher, ToastImageCacheOptions options = {});
+
+    ToastImageCache(const ToastImageCache&) = delete;
+    ToastImageCache& operator=(const ToastImageCache&) = delete;
+
+    /// <summary>
+    /// Uses the directory for the cache, creating it if need be. Images already in it are kept, oldest first in line
+    /// to be evicted, but their sources aren't known until they're resolved again.
+    /// </summary>
+    ToastResult Open(const std::filesystem::path& directory);
+
+    /// <summary>
+    /// Gets a file:/// URI for the image at an http, https or file:/// URI, scaled to its placement. A local image
+    /// that's no bigger than that is used where it is. Returns ToastResultInvalidArgument if the source isn't a
+    /// PNG, JPEG or GIF, or is some other kind of URI.
+    /// </summary>
+    ToastResult Resolve(const std::wstring& source, ToastImagePlacement placement, std::wstring& localUri);
+
+    /// <summary>
+    /// Points every http, https and file:/// image in the payload at its local copy. Images that can't be resolved
+    /// keep their source; the first failure is returned once the rest are done. With IsToastLive set, the copies are
+    /// kept from eviction for as long as the payload's toast is live.
+    /// </summary>
+    ToastResult Rewrite(ToastPayload& payload);
+
+    /// <summary>
+    /// The size an image is stored at for its placement: scaled down until it just covers the rendered size.
+    /// </summary>
+    ToastImageSize TargetSize(ToastImageSize size, ToastImagePlacement placement) const;
+
+    /// <summary>
+    /// Deletes the images this cache stored, and the files it was part way through writing, then the directory if
+    /// that leaves it empty; anything else in it is left alone. The cache is closed until Open is called again.
+    /// Returns the first failure to delete an image once the rest are done.
+    /// </summary>
+    ToastResult Uninstall();
+
+    ToastImageCacheStats GetStats() const;
+    const std::filesystem::path& Directory() const { return m_directory; }
+
+private:
+    struct StoredImage
+    {
+        // The hash of the image and the size it's scaled to, which is all that identifies it; the extension follows its format
+        std::wstring Stem;
+        std::wstring FileName;
+        std::uint64_t Bytes;
+
+        // Index keys of the sources that resolve to this file, so they can be forgotten along with it
+        std::vector<std::wstring> Sources;
+
+        // Keys of the pinned toasts showing this file
+        std::vector<std::wstring> Toasts;
+    };
+
+    using ImageList = std::list<StoredImage>;
+
+    struct SourceEntry
+    {
+        std::wstring LocalUri;
+
+        // Empty for a local image used where it is
+        std::wstring Stem;
+    };
+
+    using SourceList = std::list<std::pair<std::wstring, SourceEntry>>;
+
+    struct PinnedToast
+    {
+        std::wstring Tag;
+        std::wstring Group;
+
+        // Stems of the images it shows
+        std::vector<std::wstring> Stems;
+    };
+
+    using PinMap = std::unordered_map<std::wstring, PinnedToast>;
+
+    ToastResult Resolve(const std::wstring& source, ToastImagePlacement placement, std::wstring& localUri, std::wstring& stem);
+    ToastResult Store(const std::wstring& key, const std::wstring& fileName, const std::vector<std::uint8_t>& contents, bool scaled, std::wstring& localUri);
+    void LinkLocked(const std::wstring& key, ImageList::iterator stored, std::wstring& localUri);
+    SourceEntry& SourceLocked(const std::wstring& key);
+    void UnlinkLocked(const std::wstring& key, const std::wstring& stem);
+    void EvictLocked();
+    void PinLocked(const std::wstring& tag, const std::wstring& group, const std::vector<std::wstring>& stems);
+    void UnpinLocked(PinMap::iterator pin);
+    bool PinnedLocked(StoredImage& image);
+    void PruneLocked();
+
+    IToastImageFetcher& m_fetcher;
+    ToastImageCacheOptions m_options;
+    std::filesystem::path m_directory;
+
+    mutable std::mutex m_mutex;
+
+    // Most recently used first
+    ImageList m_images;
+    std::unordered_map<std::wstring, ImageList::iterator> m_imagesByStem;
+
+    // Most recently resolved first
+    SourceList m_recentSources;
+    std::unordered_map<std::wstring, SourceList::iterator> m_sources;
+
+    // Keyed by group and tag. Pins of toasts that have gone are dropped as their images come up for eviction, and all
+    // at once when there are twice as many as after the last sweep
+    PinMap m_pins;
+    std::size_t m_pruneAt = 64;
+    std::uint64_t m_bytes = 0;
+    std::uint64_t m_nextTemporary = 0;
+    ToastImageCacheStats m_stats{};
+};
+
+/// <summary>
+/// The file:/// URI for an absolute path, and the path for a file:/// URI (or an empty path if it isn't one).
+/// </summary>
+std::wstring ToastFileUri(const std::filesystem::path& path);
+std::filesystem::path ToastFileUriPath(const std::wstring& uri);
@@ -0,0 +1,158 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastImageFetcher.h"
+#include <fstream>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <urlmon.h>
+#endif
+
+namespace
+{
+    std::size_t SchemeLength(const std::wstring& uri)
+    {
+        if (uri.compare(0, 8, L"https://") == 0)
+        {
+            return 8;
+        }
+        if (uri.compare(0, 7, L"http://") == 0)
+        {
+            return 7;
+        }
+        return 0;
+    }
+
+    bool IsAllowedInFileName(wchar_t c)
+    {
+        return c >= 0x20 && c != L'<' && c != L'>' && c != L':' && c != L'"' && c != L'\\' && c != L'|' && c != L'?' && c != L'*';
+    }
+}
+
+ToastDirectoryImageFetcher::ToastDirectoryImageFetcher(std::filesystem::path directory) :
+    m_directory(std::move(directory))
+{
+}
+
+std::filesystem::path ToastDirectoryImageFetcher::PathFor(const std::wstring& uri) const
+{
+    std::size_t start = SchemeLength(uri);
+    if (start == 0 || start == uri.size())
+    {
+        return std::filesystem::path();
+    }
+
+    std::filesystem::path path = m_directory;
+    std::wstring segment;
+    for (std::size_t i = start; i <= uri.size(); i++)
+    {
+        if (i == uri.size() || uri[i] == L'/')
+        {
+            // Empty and dot segments would escape the directory or collapse into their parent
+            if (!segment.empty() && segment != L"." && segment != L"..")
+            {
+                path /= segment;
+            }
+            segment.clear();
+        }
+        else
+        {
+            segment += IsAllowedInFileName(uri[i]) ? uri[i] : L'_';
+        }
+    }
+    return path;
+}
+
+ToastResult ToastDirectoryImageFetcher::Fetch(const std::wstring& uri, std::vector<std::uint8_t>& bytes)
+{
+    m_fetchCount.fetch_add(1, std::memory_order_relaxed);
+
+    std::filesystem::path path = PathFor(uri);
+    if (path.empty())
+    {
+        return ToastResultInvalidArgument;
+    }
+    return ReadToastImageFile(path, bytes);
+}
+
+#if defined(_WIN32)
+
+ToastUrlImageFetcher::ToastUrlImageFetcher(std::size_t maxBytes) :
+    m_maxBytes(maxBytes)
+{
+}
+
+ToastResult ToastUrlImageFetcher::Fetch(const std::wstring& uri, std::vector<std::uint8_t>& bytes)
+{
+    if (SchemeLength(uri) == 0)
+    {
+        return ToastResultInvalidArgument;
+    }
+
+    IStream* stream = nullptr;
+    HRESULT hr = URLOpenBlockingStreamW(nullptr, uri.c_str(), &stream, 0, nullptr);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    bytes.clear();
+    std::uint8_t buffer[16 * 1024];
+    while (true)
+    {
+        ULONG read = 0;
+        hr = stream->Read(buffer, sizeof(buffer), &read);
+        if (FAILED(hr) || read == 0)
+        {
+            break;
+        }
+        if (bytes.size() + read > m_maxBytes)
+        {
+            hr = ToastResultTooLarge;
+            break;
+        }
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+    stream->Release();
+
+    return FAILED(hr) ? hr : ToastResultOk;
+}
+
+#endif
+
+ToastResult ReadToastImageFile(const std::filesystem::path& path, std::vector<std::uint8_t>& bytes)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        std::error_code error;
+        return std::filesystem::exists(path, error) ? ToastResultFail : ToastResultNotFound;
+    }
+
+    std::streamoff size = file.tellg();
+    if (size < 0)
+    {
+        return ToastResultFail;
+    }
+    bytes.resize(static_cast<std::size_t>(size));
+    file.seekg(0);
+    if (size > 0 && !file.read(reinterpret_cast<char*>(bytes.data()), size))
+    {
+        return ToastResultFail;
+    }
+    return ToastResultOk;
+}
@@ -0,0 +1,83 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "INotificationPlatform.h"
+
+/// <summary>
+/// Gets the bytes of a remote image for ToastImageCache. Implementations must be thread-safe; the cache calls
+/// Fetch from whichever thread resolves the image, outside its own lock.
+/// </summary>
+class IToastImageFetcher
+{
+public:
+    virtual ~IToastImageFetcher() = default;
+
+    /// <summary>
+    /// Replaces bytes with the image at the given http or https URI. Returns ToastResultNotFound if there's no such image.
+    /// </summary>
+    virtual ToastResult Fetch(const std::wstring& uri, std::vector<std::uint8_t>& bytes) = 0;
+};
+
+/// <summary>
+/// An IToastImageFetcher that serves images from a local directory rather than the network, for machines without
+/// one and for load tests. https://host/a/b?c=1 is read from directory/host/a/b_c=1: the scheme is dropped, and every
+/// character that isn't allowed in a file name on Windows becomes an underscore.
+/// </summary>
+class ToastDirectoryImageFetcher : public IToastImageFetcher
+{
+public:
+    explicit ToastDirectoryImageFetcher(std::filesystem::path directory);
+
+    /// <summary>
+    /// The file an http or https URI is served from, or an empty path if it isn't one.
+    /// </summary>
+    std::filesystem::path PathFor(const std::wstring& uri) const;
+
+    std::uint64_t FetchCount() const { return m_fetchCount.load(std::memory_order_relaxed); }
+
+    ToastResult Fetch(const std::wstring& uri, std::vector<std::uint8_t>& bytes) override;
+
+private:
+    std::filesystem::path m_directory;
+    std::atomic<std::uint64_t> m_fetchCount{ 0 };
+};
+
+#if defined(_WIN32)
+
+/// <summary>
+/// An IToastImageFetcher that downloads images with URLOpenBlockingStream, through the same cache and proxy settings
+/// as the rest of the system. Images bigger than maxBytes are refused with ToastResultTooLarge.
+/// </summary>
+class ToastUrlImageFetcher : public IToastImageFetcher
+{
+public:
+    explicit ToastUrlImageFetcher(std::size_t maxBytes = 8 * 1024 * 1024);
+
+    ToastResult Fetch(const std::wstring& uri, std::vector<std::uint8_t>& bytes) override;
+
+private:
+    std::size_t m_maxBytes;
+};
+
+#endif
+
+/// <summary>
+/// Reads a whole file into bytes. Returns ToastResultNotFound if it doesn't exist.
+/// </summary>
+ToastResult ReadToastImageFile(const std::filesystem::path& path, std::vector<std::uint8_t>& bytes);
@@ -0,0 +1,245 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastMappedFile.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#if defined(_WIN32)
+    ToastResult LastError()
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+#else
+    ToastResult LastError()
+    {
+        switch (errno)
+        {
+        case ENOENT:
+            return ToastResultNotFound;
+        case EINVAL:
+            return ToastResultInvalidArgument;
+        default:
+            return ToastResultFail;
+        }
+    }
+#endif
+}
+
+ToastMappedFile::~ToastMappedFile()
+{
+    Close();
+}
+
+#if defined(_WIN32)
+
+ToastResult ToastMappedFile::Open(const std::filesystem::path& path, std::uint64_t minimumSize)
+{
+    Close();
+
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return LastError();
+    }
+    m_file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        ToastResult result = LastError();
+        Close();
+        return result;
+    }
+
+    std::uint64_t mapSize = static_cast<std::uint64_t>(size.QuadPart);
+    ToastResult result = Map(mapSize < minimumSize ? minimumSize : mapSize);
+    if (!ToastSucceeded(result))
+    {
+        Close();
+    }
+    return result;
+}
+
+ToastResult ToastMappedFile::Resize(std::uint64_t size)
+{
+    Unmap();
+
+    // Mapping a larger size grows the file, but shrinking it has to be done by hand
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file))
+    {
+        return LastError();
+    }
+    return Map(size);
+}
+
+ToastResult ToastMappedFile::Flush(std::uint64_t offset, std::uint64_t length)
+{
+    if (!FlushViewOfFile(m_data + offset, static_cast<SIZE_T>(length)) || !FlushFileBuffers(m_file))
+    {
+        return LastError();
+    }
+    return ToastResultOk;
+}
+
+void ToastMappedFile::Close()
+{
+    Unmap();
+    if (m_file != nullptr)
+    {
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+}
+
+ToastResult ToastMappedFile::Map(std::uint64_t size)
+{
+    HANDLE mapping = CreateFileMappingW(m_file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+    if (mapping == nullptr)
+    {
+        return LastError();
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(size));
+    if (data == nullptr)
+    {
+        ToastResult result = LastError();
+        CloseHandle(mapping);
+        return result;
+    }
+
+    m_mapping = mapping;
+    m_data = static_cast<std::uint8_t*>(data);
+    m_size = size;
+    return ToastResultOk;
+}
+
+void ToastMappedFile::Unmap()
+{
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+        m_data = nullptr;
+    }
+    if (m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    m_size = 0;
+}
+
+#else
+
+ToastResult ToastMappedFile::Open(const std::filesystem::path& path, std::uint64_t minimumSize)
+{
+    Close();
+
+    m_file = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (m_file < 0)
+    {
+        return LastError();
+    }
+
+    struct stat status;
+    if (fstat(m_file, &status) != 0)
+    {
+        ToastResult result = LastError();
+        Close();
+        return result;
+    }
+
+    std::uint64_t size = static_cast<std::uint64_t>(status.st_size);
+    ToastResult result = size < minimumSize ? Resize(minimumSize) : Map(size);
+    if (!ToastSucceeded(result))
+    {
+        Close();
+    }
+    return result;
+}
+
+ToastResult ToastMappedFile::Resize(std::uint64_t size)
+{
+    Unmap();
+    if (ftruncate(m_file, static_cast<off_t>(size)) != 0)
+    {
+        return LastError();
+    }
+    return Map(size);
+}
+
+ToastResult ToastMappedFile::Flush(std::uint64_t offset, std::uint64_t length)
+{
+    // msync wants a page-aligned start
+    std::uint64_t pageSize = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+    std::uint64_t start = offset - offset % pageSize;
+    if (msync(m_data + start, static_cast<std::size_t>(offset + length - start), MS_SYNC) != 0 || fsync(m_file) != 0)
+    {
+        return LastError();
+    }
+    return ToastResultOk;
+}
+
+void ToastMappedFile::Close()
+{
+    Unmap();
+    if (m_file >= 0)
+    {
+        close(m_file);
+        m_file = -1;
+    }
+}
+
+ToastResult ToastMappedFile::Map(std::uint64_t size)
+{
+    if (size == 0)
+    {
+        return ToastResultInvalidArgument;
+    }
+
+    void* data = mmap(nullptr, static_cast<std::size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+    if (data == MAP_FAILED)
+    {
+        return LastError();
+    }
+
+    m_data = static_cast<std::uint8_t*>(data);
+    m_size = size;
+    return ToastResultOk;
+}
+
+void ToastMappedFile::Unmap()
+{
+    if (m_data != nullptr)
+    {
+        munmap(m_data, static_cast<std::size_t>(m_size));
+        m_data = nullptr;
+    }
+    m_size = 0;
+}
+
+#endif
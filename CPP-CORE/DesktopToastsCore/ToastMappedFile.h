@@ -0,0 +1,66 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include "INotificationPlatform.h"
+
+/// <summary>
+/// A file mapped read-write into memory, with MapViewOfFile on Windows and mmap elsewhere. Writes to the mapping
+/// reach the file even if the process crashes; Flush also gets them to disk. Not thread-safe.
+/// </summary>
+class ToastMappedFile
+{
+public:
+    ToastMappedFile() = default;
+    ~ToastMappedFile();
+
+    ToastMappedFile(const ToastMappedFile&) = delete;
+    ToastMappedFile& operator=(const ToastMappedFile&) = delete;
+
+    /// <summary>
+    /// Opens the file, creating it if it doesn't exist, and maps all of it. A file smaller than minimumSize is
+    /// extended with zeros to that size.
+    /// </summary>
+    ToastResult Open(const std::filesystem::path& path, std::uint64_t minimumSize);
+    void Close();
+
+    /// <summary>
+    /// Grows or shrinks the file and maps it again. Pointers into the old mapping are no longer valid afterwards.
+    /// </summary>
+    ToastResult Resize(std::uint64_t size);
+
+    /// <summary>
+    /// Writes the given range of the mapping, and the file's metadata, to disk.
+    /// </summary>
+    ToastResult Flush(std::uint64_t offset, std::uint64_t length);
+
+    bool IsOpen() const { return m_data != nullptr; }
+    std::uint8_t* Data() const { return m_data; }
+    std::uint64_t Size() const { return m_size; }
+
+private:
+    ToastResult Map(std::uint64_t size);
+    void Unmap();
+
+    std::uint8_t* m_data = nullptr;
+    std::uint64_t m_size = 0;
+
+#if defined(_WIN32)
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+};
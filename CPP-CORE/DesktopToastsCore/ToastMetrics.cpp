@@ -0,0 +1,321 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastMetrics.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+    // Threads are numbered as they first record, and each sticks to the shard its number picks
+    std::atomic<std::uint32_t> s_nextThread{ 0 };
+    thread_local std::uint32_t t_thread = s_nextThread.fetch_add(1, std::memory_order_relaxed);
+
+    int HighestBit(std::uint64_t value)
+    {
+        int bit = 0;
+        for (int shift = 32; shift > 0; shift >>= 1)
+        {
+            if (value >> shift != 0)
+            {
+                value >>= shift;
+                bit += shift;
+            }
+        }
+        return bit;
+    }
+
+    template <typename TKey>
+    void SortByCount(std::vector<std::pair<TKey, std::uint64_t>>& counts)
+    {
+        counts.erase(std::remove_if(counts.begin(), counts.end(), [](const auto& count) { return count.second == 0; }), counts.end());
+        std::stable_sort(counts.begin(), counts.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    }
+}
+
+std::size_t ToastHistogram::BucketIndex(std::uint64_t value)
+{
+    if (value < SubBucketCount)
+    {
+        return static_cast<std::size_t>(value);
+    }
+
+    int exponent = std::min(HighestBit(value), MaxValueBits - 1);
+    if (exponent == MaxValueBits - 1 && value >> exponent > 1)
+    {
+        return BucketCount - 1;
+    }
+
+    std::size_t subBucket = static_cast<std::size_t>(value >> (exponent - SubBucketBits)) - SubBucketCount;
+    return (exponent - SubBucketBits + 1) * SubBucketCount + subBucket;
+}
+
+std::uint64_t ToastHistogram::BucketLowestValue(std::size_t index)
+{
+    std::size_t block = index / SubBucketCount;
+    std::uint64_t subBucket = index % SubBucketCount;
+    return block == 0 ? subBucket : (SubBucketCount + subBucket) << (block - 1);
+}
+
+std::uint64_t ToastHistogram::BucketHighestValue(std::size_t index)
+{
+    std::size_t block = index / SubBucketCount;
+    return block == 0 ? BucketLowestValue(index) : BucketLowestValue(index) + (std::uint64_t(1) << (block - 1)) - 1;
+}
+
+std::uint64_t ToastHistogram::ValueAtPercentile(double percentile) const
+{
+    if (Count == 0)
+    {
+        return 0;
+    }
+
+    double clamped = std::min(std::max(percentile, 0.0), 100.0);
+    std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(clamped / 100.0 * Count)));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < Counts.size(); i++)
+    {
+        seen += Counts[i];
+        if (seen >= rank)
+        {
+            return std::min(BucketHighestValue(i), Max);
+        }
+    }
+    return Max;
+}
+
+void ToastMetrics::HistogramShard::Record(std::uint64_t value)
+{
+    Counts[ToastHistogram::BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    Sum.fetch_add(value, std::memory_order_relaxed);
+
+    std::uint64_t max = Max.load(std::memory_order_relaxed);
+    while (value > max && !Max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+void ToastMetrics::HistogramShard::AddTo(ToastHistogram& histogram) const
+{
+    for (std::size_t i = 0; i < Counts.size(); i++)
+    {
+        std::uint64_t count = Counts[i].load(std::memory_order_relaxed);
+        histogram.Counts[i] += count;
+        histogram.Count += count;
+    }
+    histogram.Sum += Sum.load(std::memory_order_relaxed);
+    histogram.Max = std::max(histogram.Max, Max.load(std::memory_order_relaxed));
+}
+
+ToastMetrics::ToastMetrics(ToastMetricsOptions options)
+{
+    std::size_t requested = options.ShardCount != 0 ? options.ShardCount : std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), 64);
+    std::size_t count = 1;
+    while (count < requested)
+    {
+        count <<= 1;
+    }
+
+    m_shardMask = count - 1;
+    m_shards.reset(new std::atomic<Shard*>[count]);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        m_shards[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    m_failureResults[0] = ToastResultFail;
+    m_actions[0] = L"*";
+}
+
+ToastMetrics::~ToastMetrics()
+{
+    for (std::size_t i = 0; i <= m_shardMask; i++)
+    {
+        delete m_shards[i].load(std::memory_order_relaxed);
+    }
+}
+
+ToastMetrics::Shard& ToastMetrics::CurrentShard()
+{
+    std::atomic<Shard*>& slot = m_shards[t_thread & m_shardMask];
+    Shard* shard = slot.load(std::memory_order_acquire);
+    if (shard != nullptr)
+    {
+        return *shard;
+    }
+
+    // Two threads sharing a shard may both get here first; the loser's shard is thrown away
+    Shard* created = new Shard();
+    if (slot.compare_exchange_strong(shard, created, std::memory_order_acq_rel))
+    {
+        return *created;
+    }
+    delete created;
+    return *shard;
+}
+
+std::uint32_t ToastMetrics::FailureKey(ToastResult result)
+{
+    std::uint32_t count = m_failureResultCount.load(std::memory_order_acquire);
+    for (std::uint32_t key = 1; key < count; key++)
+    {
+        if (m_failureResults[key] == result)
+        {
+            return key;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_keysMutex);
+    count = m_failureResultCount.load(std::memory_order_relaxed);
+    for (std::uint32_t key = 1; key < count; key++)
+    {
+        if (m_failureResults[key] == result)
+        {
+            return key;
+        }
+    }
+    if (count == MaxKeys)
+    {
+        return 0;
+    }
+    m_failureResults[count] = result;
+    m_failureResultCount.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+std::uint32_t ToastMetrics::ActionKey(std::wstring_view action)
+{
+    std::uint32_t count = m_actionCount.load(std::memory_order_acquire);
+    for (std::uint32_t key = 1; key < count; key++)
+    {
+        if (m_actions[key] == action)
+        {
+            return key;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_keysMutex);
+    count = m_actionCount.load(std::memory_order_relaxed);
+    for (std::uint32_t key = 1; key < count; key++)
+    {
+        if (m_actions[key] == action)
+        {
+            return key;
+        }
+    }
+    if (count == MaxKeys)
+    {
+        return 0;
+    }
+    m_actions[count] = std::wstring(action);
+    m_actionCount.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+void ToastMetrics::RecordSend(ToastResult result, std::chrono::nanoseconds latency)
+{
+    Shard& shard = CurrentShard();
+    shard.Sends.fetch_add(1, std::memory_order_relaxed);
+    shard.SendLatency.Record(static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count(), 0)));
+    if (!ToastSucceeded(result))
+    {
+        shard.SendFailures.fetch_add(1, std::memory_order_relaxed);
+        shard.FailuresByKey[FailureKey(result)].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ToastMetrics::RecordFailure(ToastResult result)
+{
+    CurrentShard().FailuresByKey[FailureKey(result)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void ToastMetrics::RecordCoalesced(std::uint64_t count)
+{
+    CurrentShard().Coalesced.fetch_add(count, std::memory_order_relaxed);
+}
+
+void ToastMetrics::RecordActivation(std::uint32_t actionKey, std::chrono::nanoseconds latency)
+{
+    Shard& shard = CurrentShard();
+    shard.Activations.fetch_add(1, std::memory_order_relaxed);
+    shard.ActivationsByKey[actionKey < MaxKeys ? actionKey : 0].fetch_add(1, std::memory_order_relaxed);
+    shard.ActivationLatency.Record(static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count(), 0)));
+}
+
+void ToastMetrics::RecordQueueDepth(ToastMetricsQueue queue, std::size_t depth)
+{
+    CurrentShard().QueueDepth[static_cast<std::size_t>(queue)].Record(depth);
+}
+
+ToastMetricsSnapshot ToastMetrics::Snapshot() const
+{
+    ToastMetricsSnapshot snapshot;
+    std::array<std::uint64_t, MaxKeys> failures{};
+    std::array<std::uint64_t, MaxKeys> activations{};
+
+    for (std::size_t i = 0; i <= m_shardMask; i++)
+    {
+        const Shard* shard = m_shards[i].load(std::memory_order_acquire);
+        if (shard == nullptr)
+        {
+            continue;
+        }
+
+        snapshot.Sends += shard->Sends.load(std::memory_order_relaxed);
+        snapshot.SendFailures += shard->SendFailures.load(std::memory_order_relaxed);
+        snapshot.Coalesced += shard->Coalesced.load(std::memory_order_relaxed);
+        snapshot.Activations += shard->Activations.load(std::memory_order_relaxed);
+        for (std::size_t key = 0; key < MaxKeys; key++)
+        {
+            failures[key] += shard->FailuresByKey[key].load(std::memory_order_relaxed);
+            activations[key] += shard->ActivationsByKey[key].load(std::memory_order_relaxed);
+        }
+
+        shard->SendLatency.AddTo(snapshot.SendLatency);
+        shard->ActivationLatency.AddTo(snapshot.ActivationLatency);
+        for (std::size_t queue = 0; queue < ToastMetricsQueueCount; queue++)
+        {
+            shard->QueueDepth[queue].AddTo(snapshot.QueueDepth[queue]);
+        }
+    }
+
+    // A key added by a writer racing with this snapshot may have been counted without its publication being
+    // visible here yet, in which case its count goes to slot 0 rather than reading the key unsynchronized
+    std::uint32_t failureResultCount = m_failureResultCount.load(std::memory_order_acquire);
+    for (std::uint32_t key = 0; key < MaxKeys; key++)
+    {
+        if (key < failureResultCount)
+        {
+            snapshot.FailuresByResult.emplace_back(m_failureResults[key], failures[key]);
+        }
+        else
+        {
+            snapshot.FailuresByResult[0].second += failures[key];
+        }
+    }
+    std::uint32_t actionCount = m_actionCount.load(std::memory_order_acquire);
+    for (std::uint32_t key = 0; key < MaxKeys; key++)
+    {
+        if (key < actionCount)
+        {
+            snapshot.ActivationsByAction.emplace_back(m_actions[key], activations[key]);
+        }
+        else
+        {
+            snapshot.ActivationsByAction[0].second += activations[key];
+        }
+    }
+    SortByCount(snapshot.FailuresByResult);
+    SortByCount(snapshot.ActivationsByAction);
+    return snapshot;
+}
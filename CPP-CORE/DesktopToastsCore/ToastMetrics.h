@@ -0,0 +1,203 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "INotificationPlatform.h"
+
+/// <summary>
+/// The queues whose depth ToastMetrics follows.
+/// </summary>
+enum class ToastMetricsQueue
+{
+    /// <summary>
+    /// Toasts waiting in a ToastDispatcher to be shown.
+    /// </summary>
+    Dispatch,
+
+    /// <summary>
+    /// Activations waiting in an ActivationExecutor to be handled.
+    /// </summary>
+    Activation
+};
+
+constexpr std::size_t ToastMetricsQueueCount = 2;
+
+/// <summary>
+/// A distribution of values in HDR histogram style: exact below 32, and above that in buckets 1/32 of a power of
+/// two wide, so every value is known to within about 3% from a fixed 1,216 buckets. Values from 2^42 (about 73
+/// minutes in nanoseconds) up share the last bucket.
+/// </summary>
+struct ToastHistogram
+{
+    static constexpr int SubBucketBits = 5;
+    static constexpr std::size_t SubBucketCount = std::size_t(1) << SubBucketBits;
+    static constexpr int MaxValueBits = 42;
+    static constexpr std::size_t BucketCount = (MaxValueBits - SubBucketBits + 1) * SubBucketCount;
+
+    static std::size_t BucketIndex(std::uint64_t value);
+    static std::uint64_t BucketLowestValue(std::size_t index);
+    static std::uint64_t BucketHighestValue(std::size_t index);
+
+    /// <summary>
+    /// The highest value in the bucket holding the given percentile (0 to 100) of the values, capped at Max. Zero if there are none.
+    /// </summary>
+    std::uint64_t ValueAtPercentile(double percentile) const;
+
+    double Mean() const { return Count == 0 ? 0.0 : static_cast<double>(Sum) / Count; }
+
+    std::vector<std::uint64_t> Counts = std::vector<std::uint64_t>(BucketCount);
+    std::uint64_t Count = 0;
+    std::uint64_t Sum = 0;
+    std::uint64_t Max = 0;
+};
+
+/// <summary>
+/// Everything ToastMetrics has counted, merged from every shard. Latencies are in nanoseconds.
+/// </summary>
+struct ToastMetricsSnapshot
+{
+    std::uint64_t Sends = 0;
+    std::uint64_t SendFailures = 0;
+    std::uint64_t Coalesced = 0;
+    std::uint64_t Activations = 0;
+
+    /// <summary>
+    /// Every failure recorded, from sends and elsewhere, by result, most frequent first. Results beyond the first
+    /// 31 distinct ones are counted under ToastResultFail.
+    /// </summary>
+    std::vector<std::pair<ToastResult, std::uint64_t>> FailuresByResult;
+
+    /// <summary>
+    /// Activations by the "action" argument of the toast, most frequent first. Actions beyond the first 31 distinct
+    /// ones are counted under "*".
+    /// </summary>
+    std::vector<std::pair<std::wstring, std::uint64_t>> ActivationsByAction;
+
+    ToastHistogram SendLatency;
+    ToastHistogram ActivationLatency;
+
+    /// <summary>
+    /// The depth of each queue as seen each time something was added to it, indexed by ToastMetricsQueue.
+    /// </summary>
+    std::array<ToastHistogram, ToastMetricsQueueCount> QueueDepth;
+};
+
+struct ToastMetricsOptions
+{
+    /// <summary>
+    /// Number of shards the writing threads are spread over, rounded up to a power of two. Zero means one per
+    /// hardware thread, up to 64. A shard's memory (about 40 KB) is only allocated once a thread writes to it.
+    /// </summary>
+    std::size_t ShardCount = 0;
+};
+
+/// <summary>
+/// Counters and latency histograms for sends, failures, coalesced toasts, activations and queue depth, cheap
+/// enough to record on every toast from any number of threads. Each thread writes with relaxed atomic adds
+/// to one of a set of cache-line-aligned shards, so writers on different shards never touch the same line.
+/// Snapshot adds the shards up while writers carry on, so a snapshot taken under load may be mid-way through
+/// a recording (a send counted but its latency not yet) but never loses or double-counts one.
+/// </summary>
+class ToastMetrics
+{
+public:
+    explicit ToastMetrics(ToastMetricsOptions options = {});
+    ~ToastMetrics();
+
+    ToastMetrics(const ToastMetrics&) = delete;
+    ToastMetrics& operator=(const ToastMetrics&) = delete;
+
+    /// <summary>
+    /// Records a toast handed to the platform, and the failure if it wasn't shown.
+    /// </summary>
+    void RecordSend(ToastResult result, std::chrono::nanoseconds latency);
+
+    /// <summary>
+    /// Records a failure that isn't a send, such as an activation handler or a cleanup call failing.
+    /// </summary>
+    void RecordFailure(ToastResult result);
+
+    void RecordCoalesced(std::uint64_t count = 1);
+
+    /// <summary>
+    /// The key that RecordActivation counts this action under. Looking a key up once and keeping it saves
+    /// comparing the action against the ones already seen on every activation.
+    /// </summary>
+    std::uint32_t ActionKey(std::wstring_view action);
+
+    /// <summary>
+    /// Records an activation handled, with latency measured from when it reached the app.
+    /// </summary>
+    void RecordActivation(std::uint32_t actionKey, std::chrono::nanoseconds latency);
+
+    void RecordActivation(std::wstring_view action, std::chrono::nanoseconds latency)
+    {
+        RecordActivation(ActionKey(action), latency);
+    }
+
+    void RecordQueueDepth(ToastMetricsQueue queue, std::size_t depth);
+
+    ToastMetricsSnapshot Snapshot() const;
+
+    std::size_t ShardCount() const { return m_shardMask + 1; }
+
+private:
+    // Slot 0 of each keyed table holds whatever doesn't fit in the rest
+    static constexpr std::size_t MaxKeys = 32;
+
+    struct HistogramShard
+    {
+        void Record(std::uint64_t value);
+        void AddTo(ToastHistogram& histogram) const;
+
+        std::array<std::atomic<std::uint64_t>, ToastHistogram::BucketCount> Counts{};
+        std::atomic<std::uint64_t> Sum{ 0 };
+        std::atomic<std::uint64_t> Max{ 0 };
+    };
+
+    struct alignas(64) Shard
+    {
+        std::atomic<std::uint64_t> Sends{ 0 };
+        std::atomic<std::uint64_t> SendFailures{ 0 };
+        std::atomic<std::uint64_t> Coalesced{ 0 };
+        std::atomic<std::uint64_t> Activations{ 0 };
+        std::array<std::atomic<std::uint64_t>, MaxKeys> FailuresByKey{};
+        std::array<std::atomic<std::uint64_t>, MaxKeys> ActivationsByKey{};
+        HistogramShard SendLatency;
+        HistogramShard ActivationLatency;
+        std::array<HistogramShard, ToastMetricsQueueCount> QueueDepth;
+    };
+
+    Shard& CurrentShard();
+    std::uint32_t FailureKey(ToastResult result);
+
+    std::size_t m_shardMask;
+    std::unique_ptr<std::atomic<Shard*>[]> m_shards;
+
+    // Keys are only ever added, each published by the release store to its count, so lookups don't need the mutex
+    std::mutex m_keysMutex;
+    std::array<ToastResult, MaxKeys> m_failureResults{};
+    std::atomic<std::uint32_t> m_failureResultCount{ 1 };
+    std::array<std::wstring, MaxKeys> m_actions;
+    std::atomic<std::uint32_t> m_actionCount{ 1 };
+};
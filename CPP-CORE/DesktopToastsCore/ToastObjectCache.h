@@ -0,0 +1,129 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+/// <summary>
+/// A thread-safe cache of platform objects (notifiers, history objects, activation factories) keyed by
+/// AUMID or activatable class name. Lookups take a shared lock, so concurrent senders don't serialize
+/// on each other once an object has been created. Creation runs under the exclusive lock, so a burst of
+/// first-time callers still only creates the object once.
+/// </summary>
+template <typename TValue>
+class ToastObjectCache
+{
+public:
+    /// <summary>
+    /// Gets the cached object for the key. Returns false if nothing is cached.
+    /// </summary>
+    bool TryGet(const std::wstring& key, TValue& value) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_values.find(key);
+        if (it == m_values.end())
+        {
+            return false;
+        }
+
+        value = it->second;
+        return true;
+    }
+
+    /// <summary>
+    /// Gets the cached object for the key, calling create() to make it if needed. Exceptions thrown by
+    /// create() propagate and nothing is cached.
+    /// </summary>
+    template <typename TCreate>
+    TValue GetOrCreate(const std::wstring& key, TCreate&& create)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            auto it = m_values.find(key);
+            if (it != m_values.end())
+            {
+                return it->second;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_values.find(key);
+        if (it != m_values.end())
+        {
+            return it->second;
+        }
+
+        return m_values.emplace(key, create()).first->second;
+    }
+
+    /// <summary>
+    /// Gets the cached object for the key, calling create(value) to make it if needed. create returns
+    /// false on failure, in which case nothing is cached and this returns false too.
+    /// </summary>
+    template <typename TCreate>
+    bool TryGetOrCreate(const std::wstring& key, TValue& value, TCreate&& create)
+    {
+        if (TryGet(key, value))
+        {
+            return true;
+        }
+
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_values.find(key);
+        if (it != m_values.end())
+        {
+            value = it->second;
+            return true;
+        }
+
+        TValue created{};
+        if (!create(created))
+        {
+            return false;
+        }
+
+        m_values.emplace(key, created);
+        value = created;
+        return true;
+    }
+
+    /// <summary>
+    /// Drops the cached object for the key.
+    /// </summary>
+    void Invalidate(const std::wstring& key)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_values.erase(key);
+    }
+
+    /// <summary>
+    /// Drops every cached object.
+    /// </summary>
+    void Clear()
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_values.clear();
+    }
+
+    std::size_t Size() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_values.size();
+    }
+
+private:
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<std::wstring, TValue> m_values;
+};
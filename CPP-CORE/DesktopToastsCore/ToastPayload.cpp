@@ -0,0 +1,88 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastPayload.h"
+#include <cwctype>
+#include <utility>
+
+void AppendUnescapedXml(std::wstring& result, std::wstring_view value)
+{
+    static const std::pair<std::wstring_view, wchar_t> entities[] =
+    {
+        { L"&amp;", L'&' }, { L"&lt;", L'<' }, { L"&gt;", L'>' }, { L"&quot;", L'"' }, { L"&apos;", L'\'' }
+    };
+
+    for (std::size_t i = 0; i < value.size(); i++)
+    {
+        bool replaced = false;
+        if (value[i] == L'&')
+        {
+            for (const auto& entity : entities)
+            {
+                if (value.compare(i, entity.first.size(), entity.first) == 0)
+                {
+                    result += entity.second;
+                    i += entity.first.size() - 1;
+                    replaced = true;
+                    break;
+                }
+            }
+        }
+
+        if (!replaced)
+        {
+            result += value[i];
+        }
+    }
+}
+
+std::wstring ReadToastLaunch(std::wstring_view xml)
+{
+    std::size_t start = xml.find(L"<toast");
+    if (start == std::wstring_view::npos)
+    {
+        return std::wstring();
+    }
+
+    std::size_t end = xml.find(L'>', start);
+    std::wstring_view element = xml.substr(start, end == std::wstring_view::npos ? std::wstring_view::npos : end - start);
+
+    for (std::size_t position = element.find(L"launch"); position != std::wstring_view::npos; position = element.find(L"launch", position + 1))
+    {
+        std::size_t equals = position + 6;
+        while (equals < element.size() && std::iswspace(element[equals]))
+        {
+            equals++;
+        }
+        if (position == 0 || !std::iswspace(element[position - 1]) || equals >= element.size() || element[equals] != L'=')
+        {
+            continue;
+        }
+
+        std::size_t quote = element.find_first_of(L"\"'", equals);
+        if (quote == std::wstring_view::npos)
+        {
+            break;
+        }
+        std::size_t closing = element.find(element[quote], quote + 1);
+        if (closing == std::wstring_view::npos)
+        {
+            break;
+        }
+
+        std::wstring launch;
+        AppendUnescapedXml(launch, element.substr(quote + 1, closing - quote - 1));
+        return launch;
+    }
+
+    return std::wstring();
+}
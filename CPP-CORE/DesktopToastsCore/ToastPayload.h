@@ -0,0 +1,64 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// <summary>
+/// A value for one of the {key} placeholders in a data-bound toast.
+/// </summary>
+struct ToastDataValue
+{
+    std::wstring Key;
+    std::wstring Value;
+};
+
+/// <summary>
+/// The values bound into a toast, as NotificationData. The platform ignores an update whose sequence number
+/// isn't greater than the toast's current one, so updates that race each other can't step a toast backwards.
+/// Zero applies the update unconditionally.
+/// </summary>
+struct ToastData
+{
+    std::vector<ToastDataValue> Values;
+    std::uint32_t SequenceNumber = 0;
+};
+
+/// <summary>
+/// A fully rendered toast, ready to be handed to the platform. Tag and group are optional and carry
+/// the same meaning as ToastNotification.Tag and ToastNotification.Group.
+/// </summary>
+struct ToastPayload
+{
+    std::wstring Xml;
+    std::wstring Tag;
+    std::wstring Group;
+
+    /// <summary>
+    /// Initial values for the toast's placeholders. Empty for a toast without any; only a tagged toast can be updated later.
+    /// </summary>
+    ToastData Data;
+};
+
+/// <summary>
+/// The launch attribute of a toast's root element with XML entities decoded, or an empty string if it has none.
+/// This is all that history keeps of a toast's content.
+/// </summary>
+std::wstring ReadToastLaunch(std::wstring_view xml);
+
+/// <summary>
+/// Appends value to result with the predefined XML entities decoded. Other entities are left as they are.
+/// </summary>
+void AppendUnescapedXml(std::wstring& result, std::wstring_view value);
@@ -0,0 +1,445 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastPayloadMinifier.h"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace
+{
+    constexpr std::size_t NoParent = static_cast<std::size_t>(-1);
+
+    struct ElementRecord
+    {
+        std::size_t Parent;
+        std::wstring_view Name;
+
+        // Among the siblings with the same name, from 1
+        std::size_t Ordinal;
+
+        // In UTF-16 code units, like everything the writer counts
+        std::size_t Units;
+        std::wstring_view LargestAttribute;
+        std::size_t LargestAttributeUnits;
+    };
+
+    struct OpenElement
+    {
+        std::size_t Index;
+        std::size_t StartUnits;
+        std::size_t ChildUnits;
+    };
+
+    bool IsXmlSpace(wchar_t c)
+    {
+        return c == L' ' || c == L'\t' || c == L'\r' || c == L'\n';
+    }
+
+    bool IsNameEnd(wchar_t c)
+    {
+        return IsXmlSpace(c) || c == L'/' || c == L'>' || c == L'=';
+    }
+
+    std::size_t Utf16Units(std::wstring_view text)
+    {
+        if constexpr (sizeof(wchar_t) == 2)
+        {
+            return text.size();
+        }
+        else
+        {
+            // Characters beyond the BMP take a surrogate pair once they're encoded as UTF-16
+            std::size_t units = text.size();
+            for (wchar_t c : text)
+            {
+                units += static_cast<std::uint32_t>(c) > 0xFFFF ? 1 : 0;
+            }
+            return units;
+        }
+    }
+
+    // Appends to the output and counts what it appended, so the size falls out of the minifying pass
+    class CountingWriter
+    {
+    public:
+        explicit CountingWriter(std::wstring& output) : m_output(output) {}
+
+        void Append(std::wstring_view text)
+        {
+            m_output.append(text);
+            m_units += Utf16Units(text);
+        }
+
+        void Append(wchar_t c)
+        {
+            m_output += c;
+            m_units += Utf16Units(std::wstring_view(&c, 1));
+        }
+
+        std::size_t Units() const { return m_units; }
+
+    private:
+        std::wstring& m_output;
+        std::size_t m_units = 0;
+    };
+
+    void SkipSpace(std::wstring_view xml, std::size_t& i)
+    {
+        while (i < xml.size() && IsXmlSpace(xml[i]))
+        {
+            i++;
+        }
+    }
+
+    bool IsWhitespace(std::wstring_view text)
+    {
+        return std::all_of(text.begin(), text.end(), IsXmlSpace);
+    }
+
+    std::size_t NextOrdinal(const std::vector<ElementRecord>& elements, std::size_t parent, std::wstring_view name)
+    {
+        std::size_t ordinal = 1;
+        for (const ElementRecord& element : elements)
+        {
+            if (element.Parent == parent && element.Name == name)
+            {
+                ordinal++;
+            }
+        }
+        return ordinal;
+    }
+
+    bool HasNamesake(const std::vector<ElementRecord>& elements, std::size_t index)
+    {
+        const ElementRecord& element = elements[index];
+        if (element.Ordinal > 1)
+        {
+            return true;
+        }
+        for (std::size_t i = index + 1; i < elements.size(); i++)
+        {
+            if (elements[i].Parent == element.Parent && elements[i].Name == element.Name)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::wstring ElementPath(const std::vector<ElementRecord>& elements, std::size_t index)
+    {
+        std::vector<std::size_t> chain;
+        for (std::size_t i = index; i != NoParent; i = elements[i].Parent)
+        {
+            chain.push_back(i);
+        }
+
+        std::wstring path;
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+        {
+            if (!path.empty())
+            {
+                path += L'/';
+            }
+            path.append(elements[*it].Name);
+            if (HasNamesake(elements, *it))
+            {
+                path += L'[' + std::to_wstring(elements[*it].Ordinal) + L']';
+            }
+        }
+        return path;
+    }
+
+    void FillReport(ToastPayloadReport& report, const std::vector<ElementRecord>& elements, std::size_t reportedElements)
+    {
+        std::vector<std::size_t> order(elements.size());
+        for (std::size_t i = 0; i < order.size(); i++)
+        {
+            order[i] = i;
+        }
+
+        // Only the reported elements need sorting, and only they need their paths built
+        std::size_t count = std::min(reportedElements, order.size());
+        std::partial_sort(order.begin(), order.begin() + count, order.end(), [&](std::size_t a, std::size_t b)
+        {
+            return elements[a].Units != elements[b].Units ? elements[a].Units > elements[b].Units : a < b;
+        });
+
+        report.LargestElements.clear();
+        report.LargestElements.reserve(count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            const ElementRecord& element = elements[order[i]];
+            report.LargestElements.push_back({ ElementPath(elements, order[i]), element.Units * 2, std::wstring(element.LargestAttribute), element.LargestAttributeUnits * 2 });
+        }
+    }
+}
+
+ToastPayloadMinifier::ToastPayloadMinifier(ToastPayloadBudget budget) :
+    m_budget(std::move(budget))
+{
+}
+
+ToastResult ToastPayloadMinifier::Minify(std::wstring_view xml, std::wstring& output, ToastPayloadReport* report) const
+{
+    output.clear();
+    output.reserve(xml.size());
+    CountingWriter out(output);
+
+    std::vector<ElementRecord> elements;
+    std::vector<OpenElement> open;
+
+    // Whitespace is only kept when it's the whole content of an element, since there it's the element's text
+    bool afterStartTag = false;
+
+    auto closeElement = [&]()
+    {
+        OpenElement closing = open.back();
+        open.pop_back();
+
+        std::size_t total = out.Units() - closing.StartUnits;
+        elements[closing.Index].Units = total - closing.ChildUnits;
+        if (!open.empty())
+        {
+            open.back().ChildUnits += total;
+        }
+    };
+
+    std::size_t i = 0;
+    while (i < xml.size())
+    {
+        if (xml[i] != L'<')
+        {
+            std::size_t end = xml.find(L'<', i);
+            if (end == std::wstring_view::npos)
+            {
+                end = xml.size();
+            }
+
+            std::wstring_view text = xml.substr(i, end - i);
+            if (!IsWhitespace(text) || (afterStartTag && xml.compare(end, 2, L"</") == 0))
+            {
+                out.Append(text);
+                afterStartTag = false;
+            }
+            i = end;
+            continue;
+        }
+
+        if (xml.compare(i, 4, L"<!--") == 0)
+        {
+            std::size_t end = xml.find(L"-->", i + 4);
+            if (end == std::wstring_view::npos)
+            {
+                return ToastResultInvalidArgument;
+            }
+            i = end + 3;
+            continue;
+        }
+
+        if (xml.compare(i, 9, L"<![CDATA[") == 0)
+        {
+            std::size_t end = xml.find(L"]]>", i + 9);
+            if (end == std::wstring_view::npos)
+            {
+                return ToastResultInvalidArgument;
+            }
+            out.Append(xml.substr(i, end + 3 - i));
+            afterStartTag = false;
+            i = end + 3;
+            continue;
+        }
+
+        if (xml.compare(i, 2, L"<?") == 0)
+        {
+            std::size_t end = xml.find(L"?>", i + 2);
+            if (end == std::wstring_view::npos)
+            {
+                return ToastResultInvalidArgument;
+            }
+
+            // The platform doesn't need the XML declaration, but other processing instructions are passed on
+            bool declaration = xml.compare(i + 2, 3, L"xml") == 0 && (IsXmlSpace(xml[i + 5]) || xml[i + 5] == L'?');
+            if (!declaration)
+            {
+                out.Append(xml.substr(i, end + 2 - i));
+            }
+            i = end + 2;
+            continue;
+        }
+
+        if (xml.compare(i, 2, L"<!") == 0)
+        {
+            std::size_t end = xml.find(L'>', i + 2);
+            if (end == std::wstring_view::npos)
+            {
+                return ToastResultInvalidArgument;
+            }
+            out.Append(xml.substr(i, end + 1 - i));
+            i = end + 1;
+            continue;
+        }
+
+        if (xml.compare(i, 2, L"</") == 0)
+        {
+            std::size_t nameEnd = i + 2;
+            while (nameEnd < xml.size() && !IsNameEnd(xml[nameEnd]))
+            {
+                nameEnd++;
+            }
+            std::wstring_view name = xml.substr(i + 2, nameEnd - i - 2);
+
+            std::size_t end = nameEnd;
+            SkipSpace(xml, end);
+            if (end >= xml.size() || xml[end] != L'>' || open.empty() || elements[open.back().Index].Name != name)
+            {
+                return ToastResultInvalidArgument;
+            }
+
+            out.Append(xml.substr(i, nameEnd - i));
+            out.Append(L'>');
+            closeElement();
+            afterStartTag = false;
+            i = end + 1;
+            continue;
+        }
+
+        // A start tag, which is written back with single spaces between attributes and nothing else
+        std::size_t nameEnd = i + 1;
+        while (nameEnd < xml.size() && !IsNameEnd(xml[nameEnd]))
+        {
+            nameEnd++;
+        }
+        if (nameEnd == i + 1)
+        {
+            return ToastResultInvalidArgument;
+        }
+
+        std::size_t parent = open.empty() ? NoParent : open.back().Index;
+        std::wstring_view name = xml.substr(i + 1, nameEnd - i - 1);
+        open.push_back({ elements.size(), out.Units(), 0 });
+        elements.push_back({ parent, name, NextOrdinal(elements, parent, name), 0, std::wstring_view(), 0 });
+        ElementRecord& element = elements.back();
+
+        out.Append(xml.substr(i, nameEnd - i));
+        i = nameEnd;
+
+        bool selfClosing = false;
+        while (true)
+        {
+            SkipSpace(xml, i);
+            if (i >= xml.size())
+            {
+                return ToastResultInvalidArgument;
+            }
+            if (xml[i] == L'>')
+            {
+                out.Append(L'>');
+                i++;
+                break;
+            }
+            if (xml.compare(i, 2, L"/>") == 0)
+            {
+                out.Append(L"/>");
+                selfClosing = true;
+                i += 2;
+                break;
+            }
+
+            std::size_t attributeStart = i;
+            while (i < xml.size() && !IsNameEnd(xml[i]))
+            {
+                i++;
+            }
+            std::wstring_view attributeName = xml.substr(attributeStart, i - attributeStart);
+
+            SkipSpace(xml, i);
+            if (attributeName.empty() || i >= xml.size() || xml[i] != L'=')
+            {
+                return ToastResultInvalidArgument;
+            }
+            i++;
+            SkipSpace(xml, i);
+            if (i >= xml.size() || (xml[i] != L'"' && xml[i] != L'\''))
+            {
+                return ToastResultInvalidArgument;
+            }
+
+            std::size_t closingQuote = xml.find(xml[i], i + 1);
+            if (closingQuote == std::wstring_view::npos || xml.find(L'<', i + 1) < closingQuote)
+            {
+                return ToastResultInvalidArgument;
+            }
+
+            std::size_t before = out.Units();
+            out.Append(L' ');
+            out.Append(attributeName);
+            out.Append(L'=');
+            out.Append(xml.substr(i, closingQuote + 1 - i));
+            i = closingQuote + 1;
+
+            std::size_t attributeUnits = out.Units() - before;
+            if (attributeUnits > element.LargestAttributeUnits)
+            {
+                element.LargestAttribute = attributeName;
+                element.LargestAttributeUnits = attributeUnits;
+            }
+        }
+
+        if (selfClosing)
+        {
+            closeElement();
+        }
+        afterStartTag = !selfClosing;
+    }
+
+    if (!open.empty())
+    {
+        return ToastResultInvalidArgument;
+    }
+
+    std::size_t outputBytes = out.Units() * 2;
+    bool overBudget = outputBytes > m_budget.MaxBytes;
+    if (report != nullptr || (overBudget && m_budget.OverBudget))
+    {
+        ToastPayloadReport localReport;
+        ToastPayloadReport& filled = report != nullptr ? *report : localReport;
+        filled.InputBytes = ToastUtf16Bytes(xml);
+        filled.OutputBytes = outputBytes;
+        filled.MaxBytes = m_budget.MaxBytes;
+        FillReport(filled, elements, m_budget.ReportedElements);
+
+        if (overBudget && m_budget.OverBudget)
+        {
+            m_budget.OverBudget(filled);
+        }
+    }
+
+    return overBudget && m_budget.Action == ToastPayloadBudgetAction::Fail ? ToastResultTooLarge : ToastResultOk;
+}
+
+ToastResult ToastPayloadMinifier::Minify(ToastPayload& payload, ToastPayloadReport* report) const
+{
+    std::wstring minified;
+    ToastResult result = Minify(payload.Xml, minified, report);
+    if (ToastSucceeded(result))
+    {
+        payload.Xml = std::move(minified);
+    }
+    return result;
+}
+
+std::size_t ToastUtf16Bytes(std::wstring_view text)
+{
+    return Utf16Units(text) * 2;
+}
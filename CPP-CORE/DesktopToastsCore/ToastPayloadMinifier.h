@@ -0,0 +1,118 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "INotificationPlatform.h"
+#include "ToastPayload.h"
+
+struct ToastPayloadElementSize
+{
+    /// <summary>
+    /// Path from the root element, like toast/actions/action[3]. Elements with same-named siblings are numbered from 1.
+    /// </summary>
+    std::wstring Path;
+
+    /// <summary>
+    /// UTF-16 bytes of the element's own tags, attributes and text, not counting its child elements.
+    /// </summary>
+    std::size_t Bytes;
+
+    /// <summary>
+    /// The element's largest attribute and the UTF-16 bytes it takes up, or an empty name if it has no attributes.
+    /// </summary>
+    std::wstring LargestAttribute;
+    std::size_t LargestAttributeBytes;
+};
+
+struct ToastPayloadReport
+{
+    std::size_t InputBytes;
+    std::size_t OutputBytes;
+    std::size_t MaxBytes;
+
+    /// <summary>
+    /// The elements taking up the most bytes, largest first.
+    /// </summary>
+    std::vector<ToastPayloadElementSize> LargestElements;
+};
+
+enum class ToastPayloadBudgetAction
+{
+    /// <summary>
+    /// Report the overrun through OverBudget and carry on.
+    /// </summary>
+    Warn,
+
+    /// <summary>
+    /// Report the overrun through OverBudget and return ToastResultTooLarge, so the toast never reaches the platform.
+    /// </summary>
+    Fail
+};
+
+struct ToastPayloadBudget
+{
+    /// <summary>
+    /// Largest payload allowed, in bytes of UTF-16 after minifying. Defaults to 5 KB, the documented limit for toast payloads.
+    /// </summary>
+    std::size_t MaxBytes = 5 * 1024;
+
+    ToastPayloadBudgetAction Action = ToastPayloadBudgetAction::Fail;
+
+    /// <summary>
+    /// How many elements a report lists.
+    /// </summary>
+    std::size_t ReportedElements = 5;
+
+    /// <summary>
+    /// Optional callback given the report for every payload over budget, whatever the action.
+    /// </summary>
+    std::function<void(const ToastPayloadReport&)> OverBudget;
+};
+
+/// <summary>
+/// Strips a toast payload down to what the platform reads and measures it in the same pass, so a toast that's over
+/// budget is caught before the call to Show rather than by it failing. Whitespace between elements and inside tags
+/// is dropped, along with comments and the XML declaration; text and attribute values are left exactly as they are.
+/// Sizes are in bytes of UTF-16, which is what the platform receives whatever the width of wchar_t. Thread-safe.
+/// </summary>
+class ToastPayloadMinifier
+{
+public:
+    explicit ToastPayloadMinifier(ToastPayloadBudget budget = {});
+
+    /// <summary>
+    /// Minifies xml into output, reusing its capacity, and checks it against the budget. Returns
+    /// ToastResultInvalidArgument if the XML is malformed, or ToastResultTooLarge if it's over a failing budget.
+    /// If report isn't null it's filled in whether or not the payload is over budget.
+    /// </summary>
+    ToastResult Minify(std::wstring_view xml, std::wstring& output, ToastPayloadReport* report = nullptr) const;
+
+    /// <summary>
+    /// Minifies a payload's XML in place. The payload is left as it was if this fails.
+    /// </summary>
+    ToastResult Minify(ToastPayload& payload, ToastPayloadReport* report = nullptr) const;
+
+    const ToastPayloadBudget& Budget() const { return m_budget; }
+
+private:
+    ToastPayloadBudget m_budget;
+};
+
+/// <summary>
+/// The size of text in bytes once it's encoded as UTF-16.
+/// </summary>
+std::size_t ToastUtf16Bytes(std::wstring_view text);
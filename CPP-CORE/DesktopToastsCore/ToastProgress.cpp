@@ -0,0 +1,363 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastProgress.h"
+#include <algorithm>
+
+ToastProgress::ToastProgress(INotificationPlatform& platform, std::wstring aumid, ToastProgressOptions options) :
+    m_platform(platform),
+    m_aumid(std::move(aumid)),
+    m_options(std::move(options)),
+    m_interval(Clock::duration::zero())
+{
+    if (m_options.MaxUpdatesPerSecond > 0.0)
+    {
+        m_interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_options.MaxUpdatesPerSecond));
+    }
+
+    if (m_options.BackgroundPump)
+    {
+        m_pumpThread = std::thread([this] { PumpLoop(); });
+    }
+}
+
+ToastProgress::~ToastProgress()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_pumpWake.notify_all();
+
+    if (m_pumpThread.joinable())
+    {
+        m_pumpThread.join();
+    }
+}
+
+ToastResult ToastProgress::Show(ToastPayload payload)
+{
+    if (payload.Tag.empty())
+    {
+        return ToastResultInvalidArgument;
+    }
+
+    if (payload.Data.SequenceNumber == 0)
+    {
+        payload.Data.SequenceNumber = 1;
+    }
+
+    // The toast is only tracked once it's showing, so a failed show leaves nothing behind to update
+    ToastResult result = m_platform.Show(m_aumid, payload);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::wstring key = ToastKey(payload.Tag, payload.Group);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ToastState& state = m_toasts[key];
+    state.Tag = std::move(payload.Tag);
+    state.Group = std::move(payload.Group);
+    state.Shown.clear();
+    state.Held.clear();
+    for (ToastDataValue& value : payload.Data.Values)
+    {
+        state.Shown[value.Key] = std::move(value.Value);
+    }
+    state.SequenceNumber = payload.Data.SequenceNumber;
+    state.LastUpdate = Now();
+    state.Generation = ++m_generation;
+    m_held.erase(key);
+    return result;
+}
+
+ToastResult ToastProgress::Report(const std::wstring& tag, const std::wstring& group, const std::vector<ToastDataValue>& values)
+{
+    Clock::time_point now = Now();
+    std::wstring key = ToastKey(tag, group);
+    std::vector<PendingUpdate> ready;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_toasts.find(key);
+        if (it == m_toasts.end())
+        {
+            return ToastResultNotFound;
+        }
+
+        m_reported++;
+        ToastState& state = it->second;
+        Hold(state, values);
+
+        if (state.Held.empty())
+        {
+            m_held.erase(key);
+            return ToastResultOk;
+        }
+
+        if (now < NextUpdate(state))
+        {
+            m_coalesced++;
+            if (m_held.insert(key).second)
+            {
+                m_pumpWake.notify_one();
+            }
+            return ToastResultOk;
+        }
+
+        TakeHeld(key, state, now, ready);
+        m_held.erase(key);
+    }
+
+    return Send(ready);
+}
+
+ToastResult ToastProgress::Complete(const std::wstring& tag, const std::wstring& group, const std::vector<ToastDataValue>& values)
+{
+    Clock::time_point now = Now();
+    std::wstring key = ToastKey(tag, group);
+    std::vector<PendingUpdate> ready;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_toasts.find(key);
+        if (it == m_toasts.end())
+        {
+            return ToastResultNotFound;
+        }
+
+        m_reported++;
+        Hold(it->second, values);
+        if (!it->second.Held.empty())
+        {
+            TakeHeld(key, it->second, now, ready);
+        }
+
+        m_toasts.erase(it);
+        m_held.erase(key);
+    }
+
+    return Send(ready);
+}
+
+ToastProgress::Clock::time_point ToastProgress::Pump()
+{
+    Clock::time_point now = Now();
+    Clock::time_point next = Clock::time_point::max();
+    std::vector<PendingUpdate> ready;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_held.begin(); it != m_held.end();)
+        {
+            ToastState& state = m_toasts.at(*it);
+            Clock::time_point due = NextUpdate(state);
+            if (due <= now)
+            {
+                TakeHeld(*it, state, now, ready);
+                it = m_held.erase(it);
+            }
+            else
+            {
+                next = std::min(next, due);
+                ++it;
+            }
+        }
+    }
+
+    Send(ready);
+    return next;
+}
+
+std::size_t ToastProgress::TrackedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_toasts.size();
+}
+
+ToastProgressStats ToastProgress::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    ToastProgressStats stats;
+    stats.Reported = m_reported;
+    stats.Updates = m_updates;
+    stats.Coalesced = m_coalesced;
+    stats.Failures = m_failures;
+    return stats;
+}
+
+ToastProgress::Clock::time_point ToastProgress::Now() const
+{
+    return m_options.Now ? m_options.Now() : Clock::now();
+}
+
+ToastProgress::Clock::time_point ToastProgress::NextUpdate(const ToastState& state) const
+{
+    return state.LastUpdate + m_interval;
+}
+
+void ToastProgress::Hold(ToastState& state, const std::vector<ToastDataValue>& values)
+{
+    for (const ToastDataValue& value : values)
+    {
+        // A key set back to what's showing has nothing left to send
+        auto shown = state.Shown.find(value.Key);
+        if (shown != state.Shown.end() && shown->second == value.Value)
+        {
+            state.Held.erase(value.Key);
+        }
+        else
+        {
+            state.Held[value.Key] = value.Value;
+        }
+    }
+}
+
+void ToastProgress::TakeHeld(const std::wstring& key, ToastState& state, Clock::time_point now, std::vector<PendingUpdate>& ready)
+{
+    PendingUpdate update;
+    update.Key = key;
+    update.Tag = state.Tag;
+    update.Group = state.Group;
+    update.Generation = state.Generation;
+    for (auto& held : state.Held)
+    {
+        state.Shown[held.first] = std::move(held.second);
+    }
+
+    // Every value goes out, so whichever update the platform keeps has all of them
+    update.Data.Values.reserve(state.Shown.size());
+    for (const auto& shown : state.Shown)
+    {
+        update.Data.Values.push_back(ToastDataValue{ shown.first, shown.second });
+    }
+    update.Data.SequenceNumber = ++state.SequenceNumber;
+
+    state.Held.clear();
+    state.LastUpdate = now;
+    m_updates++;
+    ready.push_back(std::move(update));
+}
+
+ToastResult ToastProgress::Send(std::vector<PendingUpdate>& ready)
+{
+    // Called without the lock held. Updates that overlap here can reach the platform in either order; the sequence
+    // numbers make it drop the older one, which is harmless since the newer carries every value.
+    ToastResult first = ToastResultOk;
+    for (PendingUpdate& update : ready)
+    {
+        ToastResult result = m_platform.Update(m_aumid, update.Tag, update.Group, update.Data);
+        if (ToastSucceeded(result))
+        {
+            continue;
+        }
+
+        if (ToastSucceeded(first))
+        {
+            first = result;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_failures++;
+
+        auto it = m_toasts.find(update.Key);
+        if (it == m_toasts.end() || it->second.Generation != update.Generation)
+        {
+            continue;
+        }
+
+        if (result == ToastResultNotFound)
+        {
+            m_toasts.erase(it);
+            m_held.erase(update.Key);
+            continue;
+        }
+
+        // A later update carries every value, so only the latest one's failure needs a retry
+        ToastState& state = it->second;
+        if (update.Data.SequenceNumber != state.SequenceNumber)
+        {
+            continue;
+        }
+
+        // Everything goes out again with the next update, with values reported since taking precedence
+        for (auto& shown : state.Shown)
+        {
+            state.Held.emplace(shown.first, std::move(shown.second));
+        }
+        state.Shown.clear();
+        if (m_held.insert(update.Key).second)
+        {
+            m_pumpWake.notify_one();
+        }
+    }
+
+    return first;
+}
+
+void ToastProgress::PumpLoop()
+{
+    if (m_options.PumpStarted)
+    {
+        try
+        {
+            m_options.PumpStarted();
+        }
+        catch (...)
+        {
+            // Updates that needed it fail on their own, and are counted as failures
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping)
+    {
+        Clock::time_point next = Clock::time_point::max();
+        for (const std::wstring& key : m_held)
+        {
+            next = std::min(next, NextUpdate(m_toasts.at(key)));
+        }
+
+        if (next != Clock::time_point::max())
+        {
+            // next is on the updater's clock, which may be virtual, so sleep in real time for what's left on it
+            Clock::duration remaining = std::max(next - Now(), Clock::duration::zero());
+            m_pumpWake.wait_until(lock, Clock::now() + remaining);
+        }
+        else
+        {
+            m_pumpWake.wait(lock);
+        }
+
+        if (m_stopping)
+        {
+            break;
+        }
+
+        lock.unlock();
+        Pump();
+        lock.lock();
+    }
+}
+
+std::wstring ToastProgress::ToastKey(const std::wstring& tag, const std::wstring& group)
+{
+    std::wstring key;
+    key.reserve(group.size() + 1 + tag.size());
+    key += group;
+    key += L'\0';
+    key += tag;
+    return key;
+}
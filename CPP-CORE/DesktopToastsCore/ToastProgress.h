@@ -0,0 +1,171 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "INotificationPlatform.h"
+
+struct ToastProgressOptions
+{
+    /// <summary>
+    /// Most updates each toast sends to the platform per second. Values reported in between are held, and
+    /// only the latest value of each key goes out with the next update.
+    /// </summary>
+    double MaxUpdatesPerSecond = 4.0;
+
+    /// <summary>
+    /// If true, a background thread sends held values as soon as their toast may be updated again.
+    /// Otherwise the caller is responsible for calling Pump.
+    /// </summary>
+    bool BackgroundPump = true;
+
+    /// <summary>
+    /// Optional callback run at the start of the background pump thread, for example to initialize COM. If it
+    /// throws, the pump runs anyway.
+    /// </summary>
+    std::function<void()> PumpStarted;
+
+    /// <summary>
+    /// Clock used for the update interval. Defaults to std::chrono::steady_clock; override to drive the updater with a virtual clock.
+    /// </summary>
+    std::function<std::chrono::steady_clock::time_point()> Now;
+};
+
+struct ToastProgressStats
+{
+    std::uint64_t Reported;
+    std::uint64_t Updates;
+    std::uint64_t Coalesced;
+    std::uint64_t Failures;
+};
+
+/// <summary>
+/// Keeps data-bound toasts (typically progress bars) up to date without re-rendering them. Show sends the toast
+/// once with its initial values; after that Report only sends an update when a value changed, through
+/// INotificationPlatform::Update by tag and group, with an increasing sequence number. Each update carries every
+/// bound value, not just the changed ones, so when two overlapping updates reach the platform out of order and
+/// the older is dropped as stale, nothing is lost. Each toast is updated at most MaxUpdatesPerSecond times a
+/// second: a report that comes sooner is merged into the held values, so a job reporting thousands of ticks a
+/// second costs a handful of platform calls.
+///
+/// A toast the user dismissed is forgotten the first time an update finds it gone, and reports for it return
+/// ToastResultNotFound from then on.
+/// </summary>
+class ToastProgress
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    ToastProgress(INotificationPlatform& platform, std::wstring aumid, ToastProgressOptions options = ToastProgressOptions());
+
+    /// <summary>
+    /// Stops the background pump. Held values that haven't been sent are discarded.
+    /// </summary>
+    ~ToastProgress();
+
+    ToastProgress(const ToastProgress&) = delete;
+    ToastProgress& operator=(const ToastProgress&) = delete;
+
+    /// <summary>
+    /// Shows the toast with payload.Data as its initial values and starts tracking it by tag and group.
+    /// Showing a toast that's already tracked replaces it and starts its values over.
+    /// Returns ToastResultInvalidArgument if the payload has no tag.
+    /// </summary>
+    ToastResult Show(ToastPayload payload);
+
+    /// <summary>
+    /// Sends the toast's values if any differ from what it last showed, now if the toast's interval has passed,
+    /// otherwise with its next update. Returns the platform's result when the update was sent, ToastResultOk
+    /// when it was held or nothing changed, and ToastResultNotFound if the toast isn't tracked.
+    /// </summary>
+    ToastResult Report(const std::wstring& tag, const std::wstring& group, const std::vector<ToastDataValue>& values);
+
+    /// <summary>
+    /// Sends the final values and any held ones straight away, whatever the interval, and stops tracking the toast.
+    /// </summary>
+    ToastResult Complete(const std::wstring& tag, const std::wstring& group, const std::vector<ToastDataValue>& values);
+
+    /// <summary>
+    /// Sends the held values of every toast whose interval has passed. Returns the earliest time at which
+    /// another toast's held values are due, or Clock::time_point::max() if nothing is held.
+    /// </summary>
+    Clock::time_point Pump();
+
+    /// <summary>
+    /// Number of toasts currently tracked.
+    /// </summary>
+    std::size_t TrackedCount() const;
+
+    ToastProgressStats GetStats() const;
+
+private:
+    struct ToastState
+    {
+        std::wstring Tag;
+        std::wstring Group;
+
+        // What the platform was last sent, and what's changed since and not yet sent
+        std::unordered_map<std::wstring, std::wstring> Shown;
+        std::unordered_map<std::wstring, std::wstring> Held;
+
+        std::uint32_t SequenceNumber = 0;
+        Clock::time_point LastUpdate;
+
+        // Tells a failed update apart from one for a newer show of the same toast
+        std::uint64_t Generation = 0;
+    };
+
+    struct PendingUpdate
+    {
+        std::wstring Key;
+        std::wstring Tag;
+        std::wstring Group;
+        std::uint64_t Generation;
+        ToastData Data;
+    };
+
+    Clock::time_point Now() const;
+    Clock::time_point NextUpdate(const ToastState& state) const;
+    void Hold(ToastState& state, const std::vector<ToastDataValue>& values);
+    void TakeHeld(const std::wstring& key, ToastState& state, Clock::time_point now, std::vector<PendingUpdate>& ready);
+    ToastResult Send(std::vector<PendingUpdate>& ready);
+    void PumpLoop();
+    static std::wstring ToastKey(const std::wstring& tag, const std::wstring& group);
+
+    INotificationPlatform& m_platform;
+    std::wstring m_aumid;
+    ToastProgressOptions m_options;
+    Clock::duration m_interval;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::wstring, ToastState> m_toasts;
+    std::unordered_set<std::wstring> m_held;
+    std::uint64_t m_generation = 0;
+
+    std::uint64_t m_reported = 0;
+    std::uint64_t m_updates = 0;
+    std::uint64_t m_coalesced = 0;
+    std::uint64_t m_failures = 0;
+
+    std::condition_variable m_pumpWake;
+    bool m_stopping = false;
+    std::thread m_pumpThread;
+};
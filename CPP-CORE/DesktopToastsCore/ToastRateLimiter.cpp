@@ -0,0 +1,401 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastRateLimiter.h"
+#include "ToastMetrics.h"
+#include <algorithm>
+#include <exception>
+
+ToastRateLimiter::ToastRateLimiter(ToastRateLimiterOptions options, Downstream downstream) :
+    m_options(std::move(options)),
+    m_downstream(std::move(downstream))
+{
+    if (m_options.MaxGroups == 0)
+    {
+        m_options.MaxGroups = 1;
+    }
+
+    if (m_options.BackgroundPump)
+    {
+        m_pumpThread = std::thread([this] { PumpLoop(); });
+    }
+}
+
+ToastRateLimiter::~ToastRateLimiter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_pumpWake.notify_all();
+
+    if (m_pumpThread.joinable())
+    {
+        m_pumpThread.join();
+    }
+}
+
+void ToastRateLimiter::SetGroupLimit(const std::wstring& group, ToastRateLimit limit)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_options.GroupLimits[group] = limit;
+
+    auto it = m_groups.find(group);
+    if (it != m_groups.end())
+    {
+        it->second.Limit = limit;
+        it->second.Tokens = std::min(it->second.Tokens, limit.Burst);
+    }
+}
+
+ToastResult ToastRateLimiter::Submit(ToastPayload payload)
+{
+    Clock::time_point now = Now();
+    std::vector<ToastPayload> ready;
+    std::uint64_t ticket;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_submitted++;
+
+        GroupState* group = GetGroup(payload.Group, now);
+        if (group == nullptr)
+        {
+            m_dropped++;
+            return ToastResultBusy;
+        }
+
+        GroupState& state = *group;
+        Refill(state, now);
+
+        // Replace a held toast with the same tag and group in place
+        if (!payload.Tag.empty())
+        {
+            auto existing = state.PendingByTag.find(payload.Tag);
+            if (existing != state.PendingByTag.end())
+            {
+                *existing->second = std::move(payload);
+                m_coalesced++;
+                if (m_options.Metrics != nullptr)
+                {
+                    m_options.Metrics->RecordCoalesced();
+                }
+                return ToastResultOk;
+            }
+        }
+
+        if (state.Pending.empty() && state.Tokens >= 1.0)
+        {
+            state.Tokens -= 1.0;
+            m_forwarded++;
+            ready.push_back(std::move(payload));
+        }
+        else if (m_options.MaxPendingPerGroup == 0)
+        {
+            m_dropped++;
+            return ToastResultBusy;
+        }
+        else
+        {
+            if (state.Pending.size() >= m_options.MaxPendingPerGroup)
+            {
+                ToastPayload& oldest = state.Pending.front();
+                if (!oldest.Tag.empty())
+                {
+                    state.PendingByTag.erase(oldest.Tag);
+                }
+                state.Pending.pop_front();
+                m_pendingCount--;
+                m_dropped++;
+            }
+
+            std::wstring tag = payload.Tag;
+            state.Pending.push_back(std::move(payload));
+            if (!tag.empty())
+            {
+                state.PendingByTag.emplace(std::move(tag), std::prev(state.Pending.end()));
+            }
+            m_pendingCount++;
+
+            if (m_backlogged.insert(&state).second)
+            {
+                m_pumpWake.notify_one();
+            }
+            return ToastResultOk;
+        }
+
+        ticket = m_nextTicket++;
+    }
+
+    return Forward(ticket, ready);
+}
+
+ToastRateLimiter::Clock::time_point ToastRateLimiter::Pump()
+{
+    Clock::time_point now = Now();
+    Clock::time_point next = Clock::time_point::max();
+    std::vector<ToastPayload> ready;
+    std::uint64_t ticket = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_backlogged.begin(); it != m_backlogged.end();)
+        {
+            GroupState& state = **it;
+            Refill(state, now);
+            Release(state, ready);
+
+            if (state.Pending.empty())
+            {
+                it = m_backlogged.erase(it);
+            }
+            else
+            {
+                next = std::min(next, NextRelease(state));
+                ++it;
+            }
+        }
+
+        if (ready.empty())
+        {
+            return next;
+        }
+        ticket = m_nextTicket++;
+    }
+
+    Forward(ticket, ready);
+    return next;
+}
+
+std::size_t ToastRateLimiter::PendingCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pendingCount;
+}
+
+ToastRateLimiterStats ToastRateLimiter::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    ToastRateLimiterStats stats;
+    stats.Submitted = m_submitted;
+    stats.Forwarded = m_forwarded;
+    stats.Coalesced = m_coalesced;
+    stats.Dropped = m_dropped;
+    return stats;
+}
+
+ToastRateLimiter::Clock::time_point ToastRateLimiter::Now() const
+{
+    return m_options.Now ? m_options.Now() : Clock::now();
+}
+
+ToastRateLimiter::GroupState* ToastRateLimiter::GetGroup(const std::wstring& group, Clock::time_point now)
+{
+    auto it = m_groups.find(group);
+    if (it != m_groups.end())
+    {
+        return &it->second;
+    }
+
+    if (m_groups.size() >= m_options.MaxGroups)
+    {
+        ForgetIdleGroups(now);
+        if (m_groups.size() >= m_options.MaxGroups)
+        {
+            return nullptr;
+        }
+    }
+
+    auto limit = m_options.GroupLimits.find(group);
+
+    GroupState& state = m_groups[group];
+    state.Limit = limit != m_options.GroupLimits.end() ? limit->second : m_options.DefaultLimit;
+    state.Tokens = state.Limit.Burst;
+    state.LastRefill = now;
+    return &state;
+}
+
+void ToastRateLimiter::ForgetIdleGroups(Clock::time_point now)
+{
+    // A group with a full bucket and nothing held back is just what it'd be created as, so forgetting it loses nothing
+    bool partlyRefilled = false;
+    for (auto it = m_groups.begin(); it != m_groups.end();)
+    {
+        GroupState& state = it->second;
+        if (!state.Pending.empty())
+        {
+            ++it;
+            continue;
+        }
+
+        Refill(state, now);
+        if (state.Tokens >= state.Limit.Burst)
+        {
+            it = m_groups.erase(it);
+        }
+        else
+        {
+            partlyRefilled = true;
+            ++it;
+        }
+    }
+
+    if (m_groups.size() < m_options.MaxGroups || !partlyRefilled)
+    {
+        return;
+    }
+
+    for (auto it = m_groups.begin(); it != m_groups.end();)
+    {
+        if (it->second.Pending.empty())
+        {
+            it = m_groups.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void ToastRateLimiter::Refill(GroupState& state, Clock::time_point now)
+{
+    if (now <= state.LastRefill)
+    {
+        return;
+    }
+
+    double elapsed = std::chrono::duration<double>(now - state.LastRefill).count();
+    state.Tokens = std::min(state.Limit.Burst, state.Tokens + elapsed * state.Limit.TokensPerSecond);
+    state.LastRefill = now;
+}
+
+ToastRateLimiter::Clock::time_point ToastRateLimiter::NextRelease(const GroupState& state)
+{
+    if (state.Tokens >= 1.0)
+    {
+        return state.LastRefill;
+    }
+    if (state.Limit.TokensPerSecond <= 0.0)
+    {
+        return Clock::time_point::max();
+    }
+
+    auto wait = std::chrono::duration<double>((1.0 - state.Tokens) / state.Limit.TokensPerSecond);
+    return state.LastRefill + std::chrono::duration_cast<Clock::duration>(wait) + Clock::duration(1);
+}
+
+void ToastRateLimiter::Release(GroupState& state, std::vector<ToastPayload>& ready)
+{
+    while (state.Tokens >= 1.0 && !state.Pending.empty())
+    {
+        ToastPayload& front = state.Pending.front();
+        if (!front.Tag.empty())
+        {
+            state.PendingByTag.erase(front.Tag);
+        }
+
+        ready.push_back(std::move(front));
+        state.Pending.pop_front();
+        state.Tokens -= 1.0;
+        m_pendingCount--;
+        m_forwarded++;
+    }
+}
+
+ToastResult ToastRateLimiter::Forward(std::uint64_t ticket, std::vector<ToastPayload>& ready)
+{
+    // Called without m_mutex held, since the downstream (e.g. a blocking ToastDispatcher) may wait. Batches
+    // released earlier go first, so a toast can't overtake one its group released before it.
+    std::unique_lock<std::mutex> lock(m_forwardMutex);
+    m_forwardTurn.wait(lock, [this, ticket] { return m_forwardingTicket == ticket; });
+
+    ToastResult result = ToastResultOk;
+    std::exception_ptr error;
+    for (ToastPayload& payload : ready)
+    {
+        try
+        {
+            result = m_downstream(std::move(payload));
+        }
+        catch (...)
+        {
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    m_forwardingTicket++;
+    lock.unlock();
+    m_forwardTurn.notify_all();
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    return result;
+}
+
+void ToastRateLimiter::PumpLoop()
+{
+    if (m_options.PumpStarted)
+    {
+        m_options.PumpStarted();
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping)
+    {
+        if (m_backlogged.empty())
+        {
+            m_pumpWake.wait(lock);
+        }
+        else
+        {
+            Clock::time_point next = Clock::time_point::max();
+            for (GroupState* state : m_backlogged)
+            {
+                next = std::min(next, NextRelease(*state));
+            }
+
+            if (next != Clock::time_point::max())
+            {
+                // next is on the limiter's clock, which may be virtual, so sleep in real time for what's left on it
+                Clock::duration remaining = std::max(next - Now(), Clock::duration::zero());
+                m_pumpWake.wait_until(lock, Clock::now() + remaining);
+            }
+            else
+            {
+                m_pumpWake.wait(lock);
+            }
+        }
+
+        if (m_stopping)
+        {
+            break;
+        }
+
+        lock.unlock();
+        try
+        {
+            Pump();
+        }
+        catch (...)
+        {
+            // The downstream threw for a released toast, which is lost like one it failed; the rest were still forwarded
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,186 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "INotificationPlatform.h"
+#include "ToastPayload.h"
+
+class ToastMetrics;
+
+/// <summary>
+/// A token bucket: Burst toasts can go out back to back, after which they're released at TokensPerSecond.
+/// </summary>
+struct ToastRateLimit
+{
+    double TokensPerSecond = 1.0;
+    double Burst = 5.0;
+};
+
+struct ToastRateLimiterOptions
+{
+    /// <summary>
+    /// Limit applied to groups that don't have their own entry in GroupLimits.
+    /// </summary>
+    ToastRateLimit DefaultLimit;
+
+    /// <summary>
+    /// Per-group limits, keyed by ToastPayload::Group. Toasts without a group share the "" entry.
+    /// </summary>
+    std::unordered_map<std::wstring, ToastRateLimit> GroupLimits;
+
+    /// <summary>
+    /// Maximum number of toasts held back per group. When exceeded, the oldest held toast is dropped.
+    /// </summary>
+    std::size_t MaxPendingPerGroup = 64;
+
+    /// <summary>
+    /// Maximum number of groups whose buckets are tracked. When a new group would go over, groups that aren't
+    /// holding anything back are forgotten, those whose buckets have refilled first; a group forgotten before its
+    /// bucket refilled starts again with a full burst. If every group is holding toasts back, the new toast is dropped.
+    /// </summary>
+    std::size_t MaxGroups = 1024;
+
+    /// <summary>
+    /// If true, a background thread releases held toasts as soon as their group has tokens again.
+    /// Otherwise the caller is responsible for calling Pump.
+    /// </summary>
+    bool BackgroundPump = true;
+
+    /// <summary>
+    /// Clock used for token refills. Defaults to std::chrono::steady_clock; override to drive the limiter with a virtual clock.
+    /// The background pump still sleeps in real time, for as long as the virtual clock says the next token is away.
+    /// </summary>
+    std::function<std::chrono::steady_clock::time_point()> Now;
+
+    /// <summary>
+    /// Optional callback run at the start of the background pump's thread, which forwards the toasts it releases.
+    /// </summary>
+    std::function<void()> PumpStarted;
+
+    /// <summary>
+    /// Optional metrics told about every coalesced toast. Must outlive the limiter.
+    /// </summary>
+    ToastMetrics* Metrics = nullptr;
+};
+
+struct ToastRateLimiterStats
+{
+    std::uint64_t Submitted;
+    std::uint64_t Forwarded;
+    std::uint64_t Coalesced;
+    std::uint64_t Dropped;
+};
+
+/// <summary>
+/// Rate-limits toasts per group before they reach the platform (typically a ToastDispatcher). Toasts
+/// are forwarded immediately while their group has tokens and held back otherwise. A held toast that
+/// has the same tag and group as a newly submitted one is replaced in place, since the platform would
+/// only replace it in Action Center anyway. Toasts without a tag are never coalesced.
+///
+/// Toasts reach the downstream one at a time and in the order they were released, even when Submit is called
+/// from several threads alongside the pump, so a group's toasts can't overtake each other. The downstream runs
+/// without the limiter's lock, and must not call Submit or Pump.
+/// </summary>
+class ToastRateLimiter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Downstream = std::function<ToastResult(ToastPayload&&)>;
+
+    ToastRateLimiter(ToastRateLimiterOptions options, Downstream downstream);
+
+    /// <summary>
+    /// Stops the background pump. Toasts that are still held back are discarded.
+    /// </summary>
+    ~ToastRateLimiter();
+
+    ToastRateLimiter(const ToastRateLimiter&) = delete;
+    ToastRateLimiter& operator=(const ToastRateLimiter&) = delete;
+
+    /// <summary>
+    /// Sets the limit for a group. Takes effect on the group's next refill.
+    /// </summary>
+    void SetGroupLimit(const std::wstring& group, ToastRateLimit limit);
+
+    /// <summary>
+    /// Forwards the toast if its group has a token, otherwise holds it back (replacing a held toast with the same tag and group).
+    /// Returns the downstream's result for a toast forwarded right away, ToastResultOk for one held back, and ToastResultBusy
+    /// for one dropped because there's no room to hold it.
+    /// </summary>
+    ToastResult Submit(ToastPayload payload);
+
+    /// <summary>
+    /// Forwards held toasts whose groups have tokens again. Returns the earliest time at which another
+    /// held toast can be released, or Clock::time_point::max() if nothing is held.
+    /// </summary>
+    Clock::time_point Pump();
+
+    /// <summary>
+    /// Number of toasts currently held back across all groups.
+    /// </summary>
+    std::size_t PendingCount() const;
+
+    ToastRateLimiterStats GetStats() const;
+
+private:
+    struct GroupState
+    {
+        ToastRateLimit Limit;
+        double Tokens;
+        Clock::time_point LastRefill;
+        std::list<ToastPayload> Pending;
+        std::unordered_map<std::wstring, std::list<ToastPayload>::iterator> PendingByTag;
+    };
+
+    Clock::time_point Now() const;
+    GroupState* GetGroup(const std::wstring& group, Clock::time_point now);
+    void ForgetIdleGroups(Clock::time_point now);
+    static void Refill(GroupState& state, Clock::time_point now);
+    static Clock::time_point NextRelease(const GroupState& state);
+    void Release(GroupState& state, std::vector<ToastPayload>& ready);
+    ToastResult Forward(std::uint64_t ticket, std::vector<ToastPayload>& ready);
+    void PumpLoop();
+
+    ToastRateLimiterOptions m_options;
+    Downstream m_downstream;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::wstring, GroupState> m_groups;
+    std::unordered_set<GroupState*> m_backlogged;
+    std::size_t m_pendingCount = 0;
+
+    std::uint64_t m_submitted = 0;
+    std::uint64_t m_forwarded = 0;
+    std::uint64_t m_coalesced = 0;
+    std::uint64_t m_dropped = 0;
+
+    // Each batch released under m_mutex takes the next ticket, and batches are forwarded in ticket order
+    std::uint64_t m_nextTicket = 0;
+    std::mutex m_forwardMutex;
+    std::condition_variable m_forwardTurn;
+    std::uint64_t m_forwardingTicket = 0;
+
+    std::condition_variable m_pumpWake;
+    bool m_stopping = false;
+    std::thread m_pumpThread;
+};
@@ -0,0 +1,190 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastRegistration.h"
+#include <cstdint>
+
+namespace
+{
+    // Bump this when the meaning of the registration changes without its values changing
+    constexpr std::uint64_t FingerprintVersion = 1;
+
+    class FingerprintHash
+    {
+    public:
+        void Add(std::uint64_t number)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                AddByte(static_cast<unsigned char>(number >> (i * 8)));
+            }
+        }
+
+        // Lengths go in first, so that ("ab", "c") and ("a", "bc") hash differently
+        void Add(const std::wstring& text)
+        {
+            Add(static_cast<std::uint64_t>(text.size()));
+            for (wchar_t c : text)
+            {
+                AddByte(static_cast<unsigned char>(c));
+                AddByte(static_cast<unsigned char>(static_cast<std::uint16_t>(c) >> 8));
+            }
+        }
+
+        std::wstring ToHex() const
+        {
+            static const wchar_t digits[] = L"0123456789abcdef";
+            std::wstring hex(16, L'0');
+            for (int i = 0; i < 16; i++)
+            {
+                hex[15 - i] = digits[(m_hash >> (i * 4)) & 0xF];
+            }
+            return hex;
+        }
+
+    private:
+        void AddByte(unsigned char byte)
+        {
+            m_hash ^= byte;
+            m_hash *= 1099511628211ull;
+        }
+
+        std::uint64_t m_hash = 14695981039346656037ull;
+    };
+}
+
+ToastRegistration::ToastRegistration(std::wstring fingerprintKey) :
+    m_fingerprintKey(std::move(fingerprintKey))
+{
+}
+
+ToastRegistration::KeyState& ToastRegistration::GetKey(const std::wstring& subKey)
+{
+    for (KeyState& key : m_keys)
+    {
+        if (key.SubKey == subKey)
+        {
+            return key;
+        }
+    }
+
+    m_keys.push_back({ subKey, {}, {} });
+    return m_keys.back();
+}
+
+void ToastRegistration::SetValue(const std::wstring& subKey, std::wstring name, std::wstring value)
+{
+    GetKey(subKey).Values.push_back({ std::move(name), std::move(value) });
+}
+
+void ToastRegistration::DeleteValue(const std::wstring& subKey, std::wstring name)
+{
+    GetKey(subKey).DeletedValues.push_back(std::move(name));
+}
+
+std::wstring ToastRegistration::Fingerprint() const
+{
+    FingerprintHash hash;
+    hash.Add(FingerprintVersion);
+    hash.Add(m_fingerprintKey);
+    hash.Add(static_cast<std::uint64_t>(m_keys.size()));
+
+    for (const KeyState& key : m_keys)
+    {
+        hash.Add(key.SubKey);
+        hash.Add(static_cast<std::uint64_t>(key.Values.size()));
+        for (const RegistryValue& value : key.Values)
+        {
+            hash.Add(value.Name);
+            hash.Add(value.Value);
+        }
+        hash.Add(static_cast<std::uint64_t>(key.DeletedValues.size()));
+        for (const std::wstring& name : key.DeletedValues)
+        {
+            hash.Add(name);
+        }
+    }
+
+    return hash.ToHex();
+}
+
+bool ToastRegistration::IsApplied(INotificationPlatform& platform) const
+{
+    std::wstring stored;
+    return ToastSucceeded(platform.ReadRegistryValue(m_fingerprintKey, FingerprintValueName, stored)) && stored == Fingerprint();
+}
+
+ToastResult ToastRegistration::Apply(INotificationPlatform& platform, bool* written) const
+{
+    if (written != nullptr)
+    {
+        *written = false;
+    }
+
+    std::wstring fingerprint = Fingerprint();
+    std::wstring stored;
+    if (ToastSucceeded(platform.ReadRegistryValue(m_fingerprintKey, FingerprintValueName, stored)) && stored == fingerprint)
+    {
+        return ToastResultOk;
+    }
+
+    if (written != nullptr)
+    {
+        *written = true;
+    }
+
+    // The fingerprint key goes last, with the fingerprint in the same write as its other values
+    const KeyState* fingerprintKeyState = nullptr;
+    for (const KeyState& key : m_keys)
+    {
+        if (key.SubKey == m_fingerprintKey)
+        {
+            fingerprintKeyState = &key;
+            continue;
+        }
+
+        if (!key.DeletedValues.empty())
+        {
+            ToastResult result = platform.DeleteRegistryValues(key.SubKey, key.DeletedValues);
+            if (!ToastSucceeded(result))
+            {
+                return result;
+            }
+        }
+
+        if (!key.Values.empty())
+        {
+            ToastResult result = platform.WriteRegistryValues(key.SubKey, key.Values);
+            if (!ToastSucceeded(result))
+            {
+                return result;
+            }
+        }
+    }
+
+    std::vector<RegistryValue> values;
+    if (fingerprintKeyState != nullptr)
+    {
+        if (!fingerprintKeyState->DeletedValues.empty())
+        {
+            ToastResult result = platform.DeleteRegistryValues(m_fingerprintKey, fingerprintKeyState->DeletedValues);
+            if (!ToastSucceeded(result))
+            {
+                return result;
+            }
+        }
+        values = fingerprintKeyState->Values;
+    }
+    values.push_back({ FingerprintValueName, fingerprint });
+
+    return platform.WriteRegistryValues(m_fingerprintKey, values);
+}
@@ -0,0 +1,73 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <string>
+#include <vector>
+#include "INotificationPlatform.h"
+
+/// <summary>
+/// The registry state an unpackaged app's registration should leave behind: values to set and values
+/// to remove, grouped by key. Apply stores a fingerprint of that state next to it, so on later starts
+/// the whole registration is one registry read when nothing has changed, and each key that does need
+/// writing is opened once.
+/// </summary>
+class ToastRegistration
+{
+public:
+    /// <summary>
+    /// Name of the value the fingerprint is stored in.
+    /// </summary>
+    static constexpr const wchar_t* FingerprintValueName = L"ToastRegistrationFingerprint";
+
+    /// <summary>
+    /// fingerprintKey is the key the fingerprint is kept in. Make it one of the keys being written, so that removing the
+    /// registration removes the fingerprint with it and the next Apply writes everything again.
+    /// </summary>
+    explicit ToastRegistration(std::wstring fingerprintKey);
+
+    void SetValue(const std::wstring& subKey, std::wstring name, std::wstring value);
+
+    /// <summary>
+    /// Removes a value when the registration is applied. It's fine if it doesn't exist.
+    /// </summary>
+    void DeleteValue(const std::wstring& subKey, std::wstring name);
+
+    /// <summary>
+    /// A hash of every key, value and deletion, as 16 hex digits.
+    /// </summary>
+    std::wstring Fingerprint() const;
+
+    /// <summary>
+    /// Whether the stored fingerprint matches, with a single registry read.
+    /// </summary>
+    bool IsApplied(INotificationPlatform& platform) const;
+
+    /// <summary>
+    /// Writes the registration unless it's already applied. The fingerprint is written last, so a failure
+    /// part way through is retried in full next time. written, if given, says whether anything was written.
+    /// </summary>
+    ToastResult Apply(INotificationPlatform& platform, bool* written = nullptr) const;
+
+private:
+    struct KeyState
+    {
+        std::wstring SubKey;
+        std::vector<RegistryValue> Values;
+        std::vector<std::wstring> DeletedValues;
+    };
+
+    KeyState& GetKey(const std::wstring& subKey);
+
+    std::wstring m_fingerprintKey;
+    std::vector<KeyState> m_keys;
+};
@@ -0,0 +1,701 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastScheduleJournal.h"
+#include "ToastCrc32.h"
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+
+namespace
+{
+    // Journal layout, all in native byte order:
+    //   Header: Magic, Version, CharSize, HeaderCrc (u32 each), Checkpoint (u64), Epoch (u32). HeaderCrc covers the other fields.
+    //   Records, back to back: BodySize (u32, a multiple of 8), Crc (u32, over the body), Body
+    //   Put body: Epoch (u32), Type (u8), HandedOff (u8), two bytes padding, DeliveryTime (i64 microseconds since the
+    //             Unix epoch), Interval (i64 microseconds), then Id, Xml, Tag and Group, each a u32 length in characters
+    //             followed by the characters, then padding
+    //   Remove body: Epoch (u32), Type (u8), three bytes padding, Id, padding
+    // A zero BodySize marks the end. Checkpoint is the end as of the last Flush, before which every record is known
+    // intact; Epoch is the one stamped on records written since the journal was last opened.
+    constexpr std::uint32_t Magic = 0x4A535454; // "TTSJ"
+    constexpr std::uint32_t Version = 1;
+    constexpr std::uint64_t HeaderSize = 64;
+    constexpr std::uint64_t HeaderCrcOffset = 12;
+    constexpr std::uint64_t CheckpointOffset = 16;
+    constexpr std::uint64_t EpochOffset = 24;
+    constexpr std::uint64_t RecordHeaderSize = 8;
+    constexpr std::uint64_t RecordAlignment = 8;
+    constexpr std::uint64_t TypeOffset = 4;
+    constexpr std::uint64_t HandedOffOffset = 5;
+    constexpr std::uint64_t DeliveryTimeOffset = 8;
+    constexpr std::uint64_t IntervalOffset = 16;
+    constexpr std::uint64_t PutIdOffset = 24;
+    constexpr std::uint64_t RemoveIdOffset = 8;
+
+    // Index slot offsets that can't be records
+    constexpr std::uint64_t EmptySlot = 0;
+    constexpr std::uint64_t RemovedSlot = 1;
+
+    using Microseconds = std::chrono::duration<std::int64_t, std::micro>;
+
+    std::uint64_t HashId(std::wstring_view id)
+    {
+        // FNV-1a
+        std::uint64_t hash = 14695981039346656037ull;
+        for (wchar_t c : id)
+        {
+            hash = (hash ^ static_cast<std::uint64_t>(c)) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    template <typename T>
+    T Read(const std::uint8_t* data)
+    {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    std::uint8_t* Write(std::uint8_t* data, T value)
+    {
+        std::memcpy(data, &value, sizeof(T));
+        return data + sizeof(T);
+    }
+
+    std::uint8_t* WriteString(std::uint8_t* data, const std::wstring& value)
+    {
+        data = Write(data, static_cast<std::uint32_t>(value.size()));
+        std::memcpy(data, value.data(), value.size() * sizeof(wchar_t));
+        return data + value.size() * sizeof(wchar_t);
+    }
+
+    std::uint64_t StringSize(const std::wstring& value)
+    {
+        return sizeof(std::uint32_t) + value.size() * sizeof(wchar_t);
+    }
+
+    // Reads a string out of a record body, advancing position. Returns false if it would run past the end.
+    bool ReadString(const std::uint8_t* body, std::uint64_t bodySize, std::uint64_t& position, std::wstring_view& value)
+    {
+        if (bodySize - position < sizeof(std::uint32_t))
+        {
+            return false;
+        }
+
+        std::uint64_t length = Read<std::uint32_t>(body + position);
+        position += sizeof(std::uint32_t);
+        if ((bodySize - position) / sizeof(wchar_t) < length)
+        {
+            return false;
+        }
+
+        // Records start 8-byte aligned and every field is a multiple of sizeof(wchar_t) long, so the characters are aligned
+        value = std::wstring_view(reinterpret_cast<const wchar_t*>(body + position), static_cast<std::size_t>(length));
+        position += length * sizeof(wchar_t);
+        return true;
+    }
+
+    std::uint32_t HeaderCrc(const std::uint8_t* data)
+    {
+        std::uint8_t fields[HeaderCrcOffset + EpochOffset + sizeof(std::uint32_t) - CheckpointOffset];
+        std::memcpy(fields, data, HeaderCrcOffset);
+        std::memcpy(fields + HeaderCrcOffset, data + CheckpointOffset, EpochOffset + sizeof(std::uint32_t) - CheckpointOffset);
+        return ComputeToastCrc32(fields, sizeof(fields));
+    }
+}
+
+ToastScheduleJournal::~ToastScheduleJournal()
+{
+    Close();
+}
+
+ToastResult ToastScheduleJournal::Open(const std::filesystem::path& path, ToastScheduleJournalOptions options)
+{
+    Close();
+    m_path = path;
+    m_options = options;
+
+    // Left behind if the process died while compacting, in which case the original is still complete
+    std::error_code ignored;
+    std::filesystem::remove(std::filesystem::path(path) += L".compact", ignored);
+
+    ToastResult result = OpenFile();
+    if (!ToastSucceeded(result))
+    {
+        // Without flushing, which would write a header to a file that may not be a journal
+        m_file.Close();
+        Close();
+    }
+    return result;
+}
+
+void ToastScheduleJournal::Close()
+{
+    if (m_file.IsOpen())
+    {
+        Flush();
+        m_file.Close();
+    }
+
+    m_end = 0;
+    m_epoch = 0;
+    m_index.clear();
+    m_liveCount = 0;
+    m_usedSlots = 0;
+    m_liveBytes = 0;
+    m_deadBytes = 0;
+    m_recovered = false;
+    m_compactions = 0;
+}
+
+ToastResult ToastScheduleJournal::Load(std::vector<ToastJournalEntry>& entries) const
+{
+    if (!m_file.IsOpen())
+    {
+        return ToastResultFail;
+    }
+
+    std::vector<std::uint64_t> offsets = LiveOffsets();
+    entries.reserve(entries.size() + offsets.size());
+
+    const std::uint8_t* data = m_file.Data();
+    for (std::uint64_t offset : offsets)
+    {
+        const std::uint8_t* body = data + offset + RecordHeaderSize;
+        std::uint64_t bodySize = Read<std::uint32_t>(data + offset);
+
+        // Scan has already checked that every string is in bounds
+        std::uint64_t position = PutIdOffset;
+        std::wstring_view id, xml, tag, group;
+        ReadString(body, bodySize, position, id);
+        ReadString(body, bodySize, position, xml);
+        ReadString(body, bodySize, position, tag);
+        ReadString(body, bodySize, position, group);
+
+        ToastJournalEntry entry;
+        entry.Toast.Id = std::wstring(id);
+        entry.Toast.Payload.Xml = std::wstring(xml);
+        entry.Toast.Payload.Tag = std::wstring(tag);
+        entry.Toast.Payload.Group = std::wstring(group);
+        entry.Toast.DeliveryTime = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(Microseconds(Read<std::int64_t>(body + DeliveryTimeOffset))));
+        entry.Interval = std::chrono::duration_cast<std::chrono::system_clock::duration>(Microseconds(Read<std::int64_t>(body + IntervalOffset)));
+        entry.HandedOff = body[HandedOffOffset] != 0;
+        entries.push_back(std::move(entry));
+    }
+    return ToastResultOk;
+}
+
+ToastResult ToastScheduleJournal::Put(const ScheduledToast& toast, std::chrono::system_clock::duration interval, bool handedOff)
+{
+    if (toast.Id.empty())
+    {
+        return ToastResultInvalidArgument;
+    }
+    return Append(RecordType::Put, &toast, interval, handedOff, toast.Id);
+}
+
+ToastResult ToastScheduleJournal::Remove(const std::wstring& id)
+{
+    if (!Contains(id))
+    {
+        return ToastResultNotFound;
+    }
+    return Append(RecordType::Remove, nullptr, std::chrono::system_clock::duration::zero(), false, id);
+}
+
+ToastResult ToastScheduleJournal::Compact()
+{
+    if (!m_file.IsOpen())
+    {
+        return ToastResultFail;
+    }
+
+    std::vector<std::uint64_t> offsets = LiveOffsets();
+    std::filesystem::path compactPath = std::filesystem::path(m_path) += L".compact";
+    std::uint64_t size = std::max(m_options.InitialSize, HeaderSize);
+    while (size < HeaderSize + m_liveBytes)
+    {
+        size *= 2;
+    }
+
+    // Records are copied whole, epochs and CRCs and all, so nothing is re-encoded
+    {
+        ToastMappedFile compacted;
+        ToastResult result = compacted.Open(compactPath, size);
+        if (!ToastSucceeded(result))
+        {
+            return result;
+        }
+
+        std::uint8_t* target = compacted.Data();
+        std::memcpy(target, m_file.Data(), HeaderSize);
+        std::uint64_t end = HeaderSize;
+        for (std::uint64_t offset : offsets)
+        {
+            std::uint64_t recordSize = RecordSize(offset);
+            std::memcpy(target + end, m_file.Data() + offset, static_cast<std::size_t>(recordSize));
+            end += recordSize;
+        }
+
+        Write(target + CheckpointOffset, end);
+        Write(target + HeaderCrcOffset, HeaderCrc(target));
+
+        result = compacted.Flush(0, end);
+        if (!ToastSucceeded(result))
+        {
+            compacted.Close();
+            std::error_code ignored;
+            std::filesystem::remove(compactPath, ignored);
+            return result;
+        }
+    }
+
+    // Both files are complete at every point: a crash before the rename leaves the original, and one after leaves the compacted file
+    m_file.Close();
+    std::error_code error;
+    std::filesystem::rename(compactPath, m_path, error);
+
+    std::uint64_t compactions = m_compactions;
+    ToastResult result = OpenFile();
+    if (ToastSucceeded(result) && error)
+    {
+        result = ToastResultFail;
+    }
+    m_compactions = compactions + (ToastSucceeded(result) ? 1 : 0);
+    return result;
+}
+
+ToastResult ToastScheduleJournal::Flush()
+{
+    if (!m_file.IsOpen())
+    {
+        return ToastResultFail;
+    }
+
+    std::uint64_t checkpoint = Read<std::uint64_t>(m_file.Data() + CheckpointOffset);
+    if (checkpoint == m_end)
+    {
+        return ToastResultOk;
+    }
+
+    // The records have to be on disk before the checkpoint that vouches for them
+    if (checkpoint < m_end)
+    {
+        ToastResult result = m_file.Flush(checkpoint, m_end - checkpoint);
+        if (!ToastSucceeded(result))
+        {
+            return result;
+        }
+    }
+    return Checkpoint();
+}
+
+bool ToastScheduleJournal::Contains(const std::wstring& id) const
+{
+    return FindLive(id, HashId(id)) != m_index.size();
+}
+
+ToastScheduleJournalStats ToastScheduleJournal::GetStats() const
+{
+    ToastScheduleJournalStats stats;
+    stats.LiveCount = m_liveCount;
+    stats.LiveBytes = m_liveBytes;
+    stats.DeadBytes = m_deadBytes;
+    stats.Recovered = m_recovered;
+    stats.Compactions = m_compactions;
+    return stats;
+}
+
+ToastResult ToastScheduleJournal::OpenFile()
+{
+    m_end = 0;
+    m_index.clear();
+    m_liveCount = 0;
+    m_usedSlots = 0;
+    m_liveBytes = 0;
+    m_deadBytes = 0;
+    m_recovered = false;
+
+    // Anything too small for a header can't be a journal, unless it's empty and about to become one
+    std::error_code error;
+    std::uint64_t existingSize = std::filesystem::exists(m_path, error) ? std::filesystem::file_size(m_path, error) : 0;
+    if (error || (existingSize != 0 && existingSize < HeaderSize))
+    {
+        return ToastResultFail;
+    }
+
+    ToastResult result = m_file.Open(m_path, existingSize == 0 ? std::max(m_options.InitialSize, HeaderSize) : HeaderSize);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    std::uint8_t* data = m_file.Data();
+    if (Read<std::uint32_t>(data) == 0)
+    {
+        // A new file, or one that was created but never written to. Anything other than zeros means it isn't ours after all.
+        if (std::any_of(data, data + m_file.Size(), [](std::uint8_t byte) { return byte != 0; }))
+        {
+            return ToastResultFail;
+        }
+
+        Write(data, Magic);
+        Write(data + 4, Version);
+        Write(data + 8, static_cast<std::uint32_t>(sizeof(wchar_t)));
+        m_end = HeaderSize;
+        m_epoch = 1;
+        return Checkpoint();
+    }
+
+    if (Read<std::uint32_t>(data) != Magic || Read<std::uint32_t>(data + 4) != Version || Read<std::uint32_t>(data + 8) != sizeof(wchar_t))
+    {
+        return ToastResultFail;
+    }
+
+    // A torn header just means checking everything
+    bool headerIntact = Read<std::uint32_t>(data + HeaderCrcOffset) == HeaderCrc(data);
+    std::uint64_t checkpoint = headerIntact ? Read<std::uint64_t>(data + CheckpointOffset) : HeaderSize;
+    std::uint32_t epoch = headerIntact ? Read<std::uint32_t>(data + EpochOffset) : 0;
+
+    result = Scan(m_options.VerifyAll ? HeaderSize : checkpoint);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    // Records the last session wrote after its last Flush may only have made it as far as the page cache
+    if (m_end > checkpoint)
+    {
+        result = m_file.Flush(checkpoint, m_end - checkpoint);
+        if (!ToastSucceeded(result))
+        {
+            return result;
+        }
+    }
+
+    m_epoch = std::max(m_epoch, epoch) + 1;
+    return Checkpoint();
+}
+
+// Rebuilds the index from the records, skipping the CRC check on those before verifiedEnd, and leaves m_epoch at the
+// last record's. Stops at the first record that's torn, corrupt, or from an earlier epoch than the one before it: a
+// record left over from before a crash, which new records have since been written around.
+ToastResult ToastScheduleJournal::Scan(std::uint64_t verifiedEnd)
+{
+    const std::uint8_t* data = m_file.Data();
+    std::uint64_t size = m_file.Size();
+    std::uint64_t offset = HeaderSize;
+    std::uint32_t lastEpoch = 0;
+    m_recovered = true;
+
+    ResizeIndex(16);
+
+    while (size - offset >= RecordHeaderSize)
+    {
+        std::uint64_t bodySize = Read<std::uint32_t>(data + offset);
+        if (bodySize == 0)
+        {
+            m_recovered = false;
+            break;
+        }
+
+        if (bodySize % RecordAlignment != 0 || bodySize < RemoveIdOffset || size - offset - RecordHeaderSize < bodySize)
+        {
+            break;
+        }
+
+        const std::uint8_t* body = data + offset + RecordHeaderSize;
+        if (offset >= verifiedEnd && ComputeToastCrc32(body, static_cast<std::size_t>(bodySize)) != Read<std::uint32_t>(data + offset + 4))
+        {
+            break;
+        }
+
+        std::uint32_t epoch = Read<std::uint32_t>(body);
+        if (epoch < lastEpoch)
+        {
+            break;
+        }
+
+        std::uint8_t type = body[TypeOffset];
+        std::wstring_view id;
+        if (type == static_cast<std::uint8_t>(RecordType::Put))
+        {
+            std::uint64_t position = PutIdOffset;
+            std::wstring_view xml, tag, group;
+            if (bodySize < position || !ReadString(body, bodySize, position, id) || !ReadString(body, bodySize, position, xml) ||
+                !ReadString(body, bodySize, position, tag) || !ReadString(body, bodySize, position, group))
+            {
+                break;
+            }
+        }
+        else
+        {
+            std::uint64_t position = RemoveIdOffset;
+            if (type != static_cast<std::uint8_t>(RecordType::Remove) || !ReadString(body, bodySize, position, id))
+            {
+                break;
+            }
+        }
+
+        // Whatever this record is, it supersedes the id's previous Put
+        std::uint64_t hash = HashId(id);
+        std::uint64_t recordSize = RecordHeaderSize + bodySize;
+        std::size_t previous = FindLive(id, hash);
+        if (previous != m_index.size())
+        {
+            std::uint64_t previousSize = RecordSize(m_index[previous].Offset);
+            m_liveBytes -= previousSize;
+            m_deadBytes += previousSize;
+            RemoveLive(previous);
+        }
+
+        if (type == static_cast<std::uint8_t>(RecordType::Put))
+        {
+            AddLive(hash, offset);
+            m_liveBytes += recordSize;
+        }
+        else
+        {
+            m_deadBytes += recordSize;
+        }
+
+        lastEpoch = epoch;
+        offset += recordSize;
+    }
+
+    m_end = offset;
+    m_epoch = lastEpoch;
+    return ToastResultOk;
+}
+
+ToastResult ToastScheduleJournal::Append(RecordType type, const ScheduledToast* toast, std::chrono::system_clock::duration interval, bool handedOff, const std::wstring& id)
+{
+    if (!m_file.IsOpen())
+    {
+        return ToastResultFail;
+    }
+
+    std::uint64_t bodySize = RemoveIdOffset + StringSize(id);
+    if (type == RecordType::Put)
+    {
+        const ToastPayload& payload = toast->Payload;
+        bodySize = PutIdOffset + StringSize(id) + StringSize(payload.Xml) + StringSize(payload.Tag) + StringSize(payload.Group);
+    }
+    bodySize = (bodySize + RecordAlignment - 1) / RecordAlignment * RecordAlignment;
+    if (bodySize > UINT32_MAX)
+    {
+        return ToastResultInvalidArgument;
+    }
+
+    std::uint64_t recordSize = RecordHeaderSize + bodySize;
+    ToastResult result = Reserve(recordSize);
+    if (!ToastSucceeded(result))
+    {
+        return result;
+    }
+
+    // The space may hold what's left of records from before a crash, so the padding is cleared along with everything else
+    std::uint64_t offset = m_end;
+    std::uint8_t* body = m_file.Data() + offset + RecordHeaderSize;
+    std::memset(body, 0, static_cast<std::size_t>(bodySize));
+    Write(body, m_epoch);
+    body[TypeOffset] = static_cast<std::uint8_t>(type);
+    if (type == RecordType::Put)
+    {
+        body[HandedOffOffset] = handedOff ? 1 : 0;
+        Write(body + DeliveryTimeOffset, std::chrono::duration_cast<Microseconds>(toast->DeliveryTime.time_since_epoch()).count());
+        Write(body + IntervalOffset, std::chrono::duration_cast<Microseconds>(interval).count());
+        std::uint8_t* position = WriteString(body + PutIdOffset, id);
+        position = WriteString(position, toast->Payload.Xml);
+        position = WriteString(position, toast->Payload.Tag);
+        WriteString(position, toast->Payload.Group);
+    }
+    else
+    {
+        WriteString(body + RemoveIdOffset, id);
+    }
+
+    // The size goes in last: until it's there, the record reads as the end of the journal or as a torn record, which ends it just the same
+    Write(m_file.Data() + offset + 4, ComputeToastCrc32(body, static_cast<std::size_t>(bodySize)));
+    Write(m_file.Data() + offset, static_cast<std::uint32_t>(bodySize));
+    m_end += recordSize;
+
+    std::uint64_t hash = HashId(id);
+    std::size_t previous = FindLive(id, hash);
+    if (previous != m_index.size())
+    {
+        std::uint64_t previousSize = RecordSize(m_index[previous].Offset);
+        m_liveBytes -= previousSize;
+        m_deadBytes += previousSize;
+        RemoveLive(previous);
+    }
+
+    if (type == RecordType::Put)
+    {
+        AddLive(hash, offset);
+        m_liveBytes += recordSize;
+    }
+    else
+    {
+        m_deadBytes += recordSize;
+    }
+
+    if (m_options.FlushEachWrite)
+    {
+        result = Flush();
+        if (!ToastSucceeded(result))
+        {
+            return result;
+        }
+    }
+    return CompactIfWorthIt();
+}
+
+ToastResult ToastScheduleJournal::Reserve(std::uint64_t bytes)
+{
+    if (m_file.Size() - m_end >= bytes)
+    {
+        return ToastResultOk;
+    }
+
+    std::uint64_t size = m_file.Size();
+    while (size - m_end < bytes)
+    {
+        size *= 2;
+    }
+    return m_file.Resize(size);
+}
+
+ToastResult ToastScheduleJournal::CompactIfWorthIt()
+{
+    if (m_options.CompactAfterDeadBytes == 0 || m_deadBytes < m_options.CompactAfterDeadBytes || m_deadBytes <= m_liveBytes)
+    {
+        return ToastResultOk;
+    }
+    return Compact();
+}
+
+// Records the current end as the point up to which the journal is known intact, and flushes the header
+ToastResult ToastScheduleJournal::Checkpoint()
+{
+    std::uint8_t* data = m_file.Data();
+    Write(data + CheckpointOffset, m_end);
+    Write(data + EpochOffset, m_epoch);
+    Write(data + HeaderCrcOffset, HeaderCrc(data));
+    return m_file.Flush(0, HeaderSize);
+}
+
+std::size_t ToastScheduleJournal::FindLive(std::wstring_view id, std::uint64_t hash) const
+{
+    if (m_index.empty())
+    {
+        return 0;
+    }
+
+    std::size_t mask = m_index.size() - 1;
+    for (std::size_t slot = static_cast<std::size_t>(hash) & mask;; slot = (slot + 1) & mask)
+    {
+        const IndexSlot& candidate = m_index[slot];
+        if (candidate.Offset == EmptySlot)
+        {
+            return m_index.size();
+        }
+        if (candidate.Hash == hash && candidate.Offset != RemovedSlot && RecordId(candidate.Offset) == id)
+        {
+            return slot;
+        }
+    }
+}
+
+// For an id that isn't live
+void ToastScheduleJournal::AddLive(std::uint64_t hash, std::uint64_t offset)
+{
+    // Kept at most three-quarters full, counting removed slots, so probes stay short and always end
+    if ((m_usedSlots + 1) * 4 > m_index.size() * 3)
+    {
+        std::size_t slotCount = 16;
+        while (slotCount < (m_liveCount + 1) * 2)
+        {
+            slotCount *= 2;
+        }
+        ResizeIndex(slotCount);
+    }
+
+    std::size_t mask = m_index.size() - 1;
+    std::size_t slot = static_cast<std::size_t>(hash) & mask;
+    while (m_index[slot].Offset != EmptySlot && m_index[slot].Offset != RemovedSlot)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    m_usedSlots += m_index[slot].Offset == EmptySlot ? 1 : 0;
+    m_index[slot] = IndexSlot{ hash, offset };
+    m_liveCount++;
+}
+
+void ToastScheduleJournal::RemoveLive(std::size_t slot)
+{
+    m_index[slot].Offset = RemovedSlot;
+    m_liveCount--;
+}
+
+void ToastScheduleJournal::ResizeIndex(std::size_t slotCount)
+{
+    std::vector<IndexSlot> previous(slotCount, IndexSlot{ 0, EmptySlot });
+    previous.swap(m_index);
+
+    std::size_t mask = slotCount - 1;
+    for (const IndexSlot& live : previous)
+    {
+        if (live.Offset != EmptySlot && live.Offset != RemovedSlot)
+        {
+            std::size_t slot = static_cast<std::size_t>(live.Hash) & mask;
+            while (m_index[slot].Offset != EmptySlot)
+            {
+                slot = (slot + 1) & mask;
+            }
+            m_index[slot] = live;
+        }
+    }
+    m_usedSlots = m_liveCount;
+}
+
+// In file order, which walks the mapping front to back and keeps entries in the order they were last written
+std::vector<std::uint64_t> ToastScheduleJournal::LiveOffsets() const
+{
+    std::vector<std::uint64_t> offsets;
+    offsets.reserve(m_liveCount);
+    for (const IndexSlot& slot : m_index)
+    {
+        if (slot.Offset != EmptySlot && slot.Offset != RemovedSlot)
+        {
+            offsets.push_back(slot.Offset);
+        }
+    }
+    std::sort(offsets.begin(), offsets.end());
+    return offsets;
+}
+
+std::wstring_view ToastScheduleJournal::RecordId(std::uint64_t offset) const
+{
+    const std::uint8_t* body = m_file.Data() + offset + RecordHeaderSize;
+    std::uint64_t length = Read<std::uint32_t>(body + PutIdOffset);
+    return std::wstring_view(reinterpret_cast<const wchar_t*>(body + PutIdOffset + sizeof(std::uint32_t)), static_cast<std::size_t>(length));
+}
+
+std::uint64_t ToastScheduleJournal::RecordSize(std::uint64_t offset) const
+{
+    return RecordHeaderSize + Read<std::uint32_t>(m_file.Data() + offset);
+}
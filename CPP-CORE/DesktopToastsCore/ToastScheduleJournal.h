@@ -0,0 +1,195 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "INotificationPlatform.h"
+#include "ToastMappedFile.h"
+
+/// <summary>
+/// A scheduled toast as the journal keeps it.
+/// </summary>
+struct ToastJournalEntry
+{
+    ScheduledToast Toast;
+
+    /// <summary>
+    /// Zero for a one-off toast, otherwise the interval it recurs at.
+    /// </summary>
+    std::chrono::system_clock::duration Interval;
+
+    /// <summary>
+    /// Whether the current occurrence has been handed to the platform's schedule, which delivers it even if the app isn't running.
+    /// </summary>
+    bool HandedOff;
+};
+
+struct ToastScheduleJournalOptions
+{
+    /// <summary>
+    /// Size the file is created with. It doubles whenever it fills up.
+    /// </summary>
+    std::uint64_t InitialSize = 1 << 20;
+
+    /// <summary>
+    /// The journal compacts itself once superseded and removed records take up this many bytes and more than the
+    /// live ones do. Zero turns automatic compaction off; Compact can still be called by hand.
+    /// </summary>
+    std::uint64_t CompactAfterDeadBytes = 16 << 20;
+
+    /// <summary>
+    /// If true, every Put and Remove is flushed to disk before it returns. Otherwise writes survive the process
+    /// crashing, but only those before the last Flush are guaranteed to survive the OS crashing or losing power.
+    /// </summary>
+    bool FlushEachWrite = false;
+
+    /// <summary>
+    /// If true, Open checks every record's CRC. Otherwise it only checks those written after the last Flush, which
+    /// are the only ones a crash can have torn; the rest were on disk, checked and intact when Flush returned.
+    /// </summary>
+    bool VerifyAll = false;
+};
+
+struct ToastScheduleJournalStats
+{
+    std::size_t LiveCount;
+    std::uint64_t LiveBytes;
+    std::uint64_t DeadBytes;
+
+    /// <summary>
+    /// Whether Open found a torn or corrupt record, and so discarded it and everything after it.
+    /// </summary>
+    bool Recovered;
+    std::uint64_t Compactions;
+};
+
+/// <summary>
+/// Keeps scheduled toasts on disk in an append-only, memory-mapped file, so an app can rebuild its schedule at
+/// startup without going back to whatever created it. Every change appends a record: a Put with the toast's
+/// payload, tag, group, delivery time and interval, or a Remove with its id. Each record carries a CRC32, and
+/// Open stops at the first torn or corrupt one, so a crash loses at most the writes that hadn't reached the
+/// disk. The journal compacts itself by copying the live records to a new file and swapping it in once most of
+/// the file is dead, so Open reads the live records and no more dead ones than that or CompactAfterDeadBytes, however
+/// often the schedule has been rewritten. Startup is linear in the live entries: milliseconds for tens of thousands, seconds for a million.
+/// Files are only readable on the architecture that wrote them. Not thread-safe.
+/// </summary>
+class ToastScheduleJournal
+{
+public:
+    ToastScheduleJournal() = default;
+    ~ToastScheduleJournal();
+
+    ToastScheduleJournal(const ToastScheduleJournal&) = delete;
+    ToastScheduleJournal& operator=(const ToastScheduleJournal&) = delete;
+
+    /// <summary>
+    /// Opens the journal, creating it if it doesn't exist. Returns ToastResultFail if the file isn't a journal
+    /// or was written with a different wchar_t size.
+    /// </summary>
+    ToastResult Open(const std::filesystem::path& path, ToastScheduleJournalOptions options = {});
+
+    /// <summary>
+    /// Flushes and closes the journal.
+    /// </summary>
+    void Close();
+
+    bool IsOpen() const { return m_file.IsOpen(); }
+
+    /// <summary>
+    /// Appends every live entry to entries, in the order they were last written.
+    /// </summary>
+    ToastResult Load(std::vector<ToastJournalEntry>& entries) const;
+
+    /// <summary>
+    /// Records an entry, replacing any earlier one with the same id. Returns ToastResultInvalidArgument for an empty id.
+    /// </summary>
+    ToastResult Put(const ScheduledToast& toast, std::chrono::system_clock::duration interval, bool handedOff);
+
+    ToastResult Put(const ToastJournalEntry& entry)
+    {
+        return Put(entry.Toast, entry.Interval, entry.HandedOff);
+    }
+
+    /// <summary>
+    /// Forgets the entry with this id. Returns ToastResultNotFound if there's none.
+    /// </summary>
+    ToastResult Remove(const std::wstring& id);
+
+    /// <summary>
+    /// Rewrites the file with only the live records.
+    /// </summary>
+    ToastResult Compact();
+
+    /// <summary>
+    /// Makes every write so far durable.
+    /// </summary>
+    ToastResult Flush();
+
+    bool Contains(const std::wstring& id) const;
+    ToastScheduleJournalStats GetStats() const;
+
+private:
+    enum class RecordType : std::uint8_t
+    {
+        Put = 1,
+        Remove = 2
+    };
+
+    // Slots of the open-addressed index from a hash of each live id to the offset of its Put record. Offsets are never
+    // below the header, so the low values mark empty and removed slots; hash collisions are told apart by the id in the record.
+    struct IndexSlot
+    {
+        std::uint64_t Hash;
+        std::uint64_t Offset;
+    };
+
+    ToastResult OpenFile();
+    ToastResult Scan(std::uint64_t verifiedEnd);
+    ToastResult Append(RecordType type, const ScheduledToast* toast, std::chrono::system_clock::duration interval, bool handedOff, const std::wstring& id);
+    ToastResult Reserve(std::uint64_t bytes);
+    ToastResult CompactIfWorthIt();
+    ToastResult Checkpoint();
+
+    // Returns the slot holding the id, or m_index.size() if it isn't live
+    std::size_t FindLive(std::wstring_view id, std::uint64_t hash) const;
+    void AddLive(std::uint64_t hash, std::uint64_t offset);
+    void RemoveLive(std::size_t slot);
+    void ResizeIndex(std::size_t slotCount);
+    std::vector<std::uint64_t> LiveOffsets() const;
+    std::wstring_view RecordId(std::uint64_t offset) const;
+    std::uint64_t RecordSize(std::uint64_t offset) const;
+
+    std::filesystem::path m_path;
+    ToastScheduleJournalOptions m_options;
+    ToastMappedFile m_file;
+
+    // Where the next record goes
+    std::uint64_t m_end = 0;
+
+    // Stamped on every record written since Open. Records never go back to an earlier epoch, so Open can tell
+    // records left over from before a crash apart from ones written after it.
+    std::uint32_t m_epoch = 0;
+
+    std::vector<IndexSlot> m_index;
+    std::size_t m_liveCount = 0;
+    std::size_t m_usedSlots = 0;
+    std::uint64_t m_liveBytes = 0;
+    std::uint64_t m_deadBytes = 0;
+    bool m_recovered = false;
+    std::uint64_t m_compactions = 0;
+};
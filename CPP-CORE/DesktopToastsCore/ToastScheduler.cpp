@@ -0,0 +1,529 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastScheduler.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+ToastScheduler::ToastScheduler(INotificationPlatform& platform, std::wstring aumid, ToastSchedulerOptions options) :
+    m_platform(platform),
+    m_aumid(std::move(aumid)),
+    m_options(std::move(options))
+{
+    if (m_options.Resolution <= Clock::duration::zero())
+    {
+        throw std::invalid_argument("Resolution must be positive");
+    }
+
+    m_epoch = Now();
+
+    if (m_options.BackgroundPump)
+    {
+        m_pumpThread = std::thread([this] { PumpLoop(); });
+    }
+}
+
+ToastScheduler::~ToastScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_pumpWake.notify_all();
+
+    if (m_pumpThread.joinable())
+    {
+        m_pumpThread.join();
+    }
+}
+
+ToastResult ToastScheduler::Schedule(ScheduledToast toast, Clock::duration interval)
+{
+    if (toast.Id.empty() || interval < Clock::duration::zero())
+    {
+        return ToastResultInvalidArgument;
+    }
+
+    std::wstring id = toast.Id;
+    bool retract = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto existing = m_entries.find(id);
+        if (existing != m_entries.end())
+        {
+            retract = existing->second.State == EntryState::HandedOff && BeginRetract(id);
+            Erase(existing->second);
+        }
+
+        Entry& entry = m_entries.emplace(id, Entry{ std::move(toast), interval, EntryState::Waiting, {} }).first->second;
+        m_byGroup[entry.Toast.Payload.Group].insert(&entry);
+        Arm(entry);
+        Record(entry);
+        m_scheduled++;
+    }
+    m_pumpWake.notify_one();
+
+    if (retract)
+    {
+        Retract(id);
+    }
+    return ToastResultOk;
+}
+
+ToastResult ToastScheduler::Cancel(const std::wstring& id)
+{
+    bool retract = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_entries.find(id);
+        if (it == m_entries.end())
+        {
+            return ToastResultNotFound;
+        }
+
+        retract = it->second.State == EntryState::HandedOff && BeginRetract(id);
+        Erase(it->second);
+        m_cancelled++;
+    }
+
+    if (retract)
+    {
+        Retract(id);
+    }
+    return ToastResultOk;
+}
+
+std::size_t ToastScheduler::CancelGroup(const std::wstring& group)
+{
+    std::vector<std::wstring> retract;
+    std::size_t cancelled = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_byGroup.find(group);
+        if (it == m_byGroup.end())
+        {
+            return 0;
+        }
+
+        // Erase removes entries from the group's set, and the set itself along with the last one
+        std::vector<Entry*> entries(it->second.begin(), it->second.end());
+        for (Entry* entry : entries)
+        {
+            if (entry->State == EntryState::HandedOff && BeginRetract(entry->Toast.Id))
+            {
+                retract.push_back(entry->Toast.Id);
+            }
+            Erase(*entry);
+        }
+
+        cancelled = entries.size();
+        m_cancelled += cancelled;
+    }
+
+    for (const std::wstring& id : retract)
+    {
+        Retract(id);
+    }
+    return cancelled;
+}
+
+ToastResult ToastScheduler::Snooze(const std::wstring& id, Clock::duration delay)
+{
+    if (delay < Clock::duration::zero())
+    {
+        return ToastResultInvalidArgument;
+    }
+
+    Clock::time_point now = Now();
+    bool retract = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_entries.find(id);
+        if (it == m_entries.end())
+        {
+            return ToastResultNotFound;
+        }
+
+        Entry& entry = it->second;
+        retract = entry.State == EntryState::HandedOff && BeginRetract(id);
+        m_wheel.Cancel(entry.Timer);
+        entry.Toast.DeliveryTime = now + delay;
+        Arm(entry);
+        Record(entry);
+    }
+    m_pumpWake.notify_one();
+
+    if (retract)
+    {
+        Retract(id);
+    }
+    return ToastResultOk;
+}
+
+std::size_t ToastScheduler::Restore(std::vector<ToastJournalEntry> entries)
+{
+    Clock::time_point now = Now();
+    std::size_t restored = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.reserve(m_entries.size() + entries.size());
+
+        for (ToastJournalEntry& restoredEntry : entries)
+        {
+            if (restoredEntry.Toast.Id.empty() || restoredEntry.Interval < Clock::duration::zero())
+            {
+                continue;
+            }
+
+            std::wstring id = restoredEntry.Toast.Id;
+            auto inserted = m_entries.try_emplace(std::move(id), Entry{ std::move(restoredEntry.Toast), restoredEntry.Interval, EntryState::Waiting, {} });
+            if (!inserted.second)
+            {
+                continue;
+            }
+
+            Entry& entry = inserted.first->second;
+            m_byGroup[entry.Toast.Payload.Group].insert(&entry);
+
+            if (restoredEntry.HandedOff && entry.Toast.DeliveryTime <= now)
+            {
+                bool recurring = entry.Interval != Clock::duration::zero();
+                FinishOccurrence(entry, now);
+                restored += recurring ? 1 : 0;
+                continue;
+            }
+
+            Arm(entry);
+            restored++;
+        }
+    }
+    m_pumpWake.notify_one();
+
+    return restored;
+}
+
+ToastScheduler::Clock::time_point ToastScheduler::Pump()
+{
+    std::lock_guard<std::mutex> pumpLock(m_pumpMutex);
+    Clock::time_point now = Now();
+    std::vector<PlatformCall> calls;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wheel.Advance(CurrentTick(now), [&](Entry* entry) { Expire(*entry, now, calls); });
+    }
+
+    Execute(calls);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return NextWake();
+}
+
+bool ToastScheduler::IsPending(const std::wstring& id) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.count(id) != 0;
+}
+
+std::size_t ToastScheduler::PendingCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+std::size_t ToastScheduler::HandedOffCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_handedOff;
+}
+
+ToastSchedulerStats ToastScheduler::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    ToastSchedulerStats stats;
+    stats.Scheduled = m_scheduled;
+    stats.Shown = m_shown;
+    stats.HandedOff = m_handOffs;
+    stats.Cancelled = m_cancelled;
+    stats.Failed = m_failed;
+    stats.JournalFailed = m_journalFailed;
+    return stats;
+}
+
+ToastScheduler::Clock::time_point ToastScheduler::Now() const
+{
+    return m_options.Now ? m_options.Now() : Clock::now();
+}
+
+// Rounded up, so nothing fires before its time
+ToastScheduler::Wheel::Tick ToastScheduler::DueTick(Clock::time_point time) const
+{
+    if (time <= m_epoch)
+    {
+        return 0;
+    }
+
+    Clock::duration elapsed = time - m_epoch;
+    return static_cast<Wheel::Tick>(elapsed / m_options.Resolution) + (elapsed % m_options.Resolution != Clock::duration::zero() ? 1 : 0);
+}
+
+ToastScheduler::Wheel::Tick ToastScheduler::CurrentTick(Clock::time_point now) const
+{
+    return now <= m_epoch ? 0 : static_cast<Wheel::Tick>((now - m_epoch) / m_options.Resolution);
+}
+
+// Called with m_mutex held
+ToastScheduler::Clock::time_point ToastScheduler::NextWake() const
+{
+    Wheel::Tick tick = m_wheel.NextExpiry();
+    auto ticksLeft = (Clock::time_point::max() - m_epoch) / m_options.Resolution;
+    if (tick == Wheel::NoExpiry || tick >= static_cast<Wheel::Tick>(ticksLeft))
+    {
+        return Clock::time_point::max();
+    }
+
+    return m_epoch + m_options.Resolution * static_cast<Clock::rep>(tick);
+}
+
+// Called with m_mutex held, for an entry that isn't in the wheel
+void ToastScheduler::Arm(Entry& entry)
+{
+    entry.State = EntryState::Waiting;
+    entry.Timer = m_wheel.Add(DueTick(entry.Toast.DeliveryTime - m_options.PlatformWindow), &entry);
+}
+
+// Called with m_mutex held when an entry's timer fires
+void ToastScheduler::Expire(Entry& entry, Clock::time_point now, std::vector<PlatformCall>& calls)
+{
+    switch (entry.State)
+    {
+    case EntryState::Waiting:
+        if (m_options.PlatformWindow > Clock::duration::zero() && entry.Toast.DeliveryTime > now)
+        {
+            if (m_retracting.count(entry.Toast.Id) != 0)
+            {
+                // An earlier toast with this id is still being taken out of the platform's schedule; try next tick
+                entry.Timer = m_wheel.Add(CurrentTick(now) + 1, &entry);
+                return;
+            }
+
+            // Within the window: the platform delivers it, and the wheel only keeps it until then in case it's cancelled
+            entry.State = EntryState::HandedOff;
+            entry.Timer = m_wheel.Add(DueTick(entry.Toast.DeliveryTime), &entry);
+            m_handedOff++;
+            m_handingOff.insert(entry.Toast.Id);
+            Record(entry);
+            calls.push_back(PlatformCall{ true, entry.Toast });
+            return;
+        }
+
+        calls.push_back(PlatformCall{ false, entry.Toast });
+        break;
+
+    case EntryState::HandedOff:
+        m_handedOff--;
+        break;
+
+    case EntryState::Local:
+        calls.push_back(PlatformCall{ false, entry.Toast });
+        break;
+    }
+
+    FinishOccurrence(entry, now);
+}
+
+// Called with m_mutex held once an occurrence has been delivered; re-arms a recurring entry and erases any other
+void ToastScheduler::FinishOccurrence(Entry& entry, Clock::time_point now)
+{
+    if (entry.Interval == Clock::duration::zero())
+    {
+        Erase(entry);
+        return;
+    }
+
+    Clock::time_point& due = entry.Toast.DeliveryTime;
+    if (due <= now)
+    {
+        due += ((now - due) / entry.Interval + 1) * entry.Interval;
+    }
+    Arm(entry);
+    Record(entry);
+}
+
+// Called with m_mutex held
+void ToastScheduler::Erase(Entry& entry)
+{
+    m_wheel.Cancel(entry.Timer);
+
+    auto group = m_byGroup.find(entry.Toast.Payload.Group);
+    group->second.erase(&entry);
+    if (group->second.empty())
+    {
+        m_byGroup.erase(group);
+    }
+
+    if (m_options.Journal != nullptr && !ToastSucceeded(m_options.Journal->Remove(entry.Toast.Id)))
+    {
+        m_journalFailed++;
+    }
+
+    m_entries.erase(m_entries.find(entry.Toast.Id));
+}
+
+// Called with m_mutex held whenever an entry's delivery time or state changes
+void ToastScheduler::Record(const Entry& entry)
+{
+    if (m_options.Journal != nullptr && !ToastSucceeded(m_options.Journal->Put(entry.Toast, entry.Interval, entry.State == EntryState::HandedOff)))
+    {
+        m_journalFailed++;
+    }
+}
+
+// Called with m_mutex held for a handed-off entry that's being cancelled, replaced or snoozed. Returns true if the
+// caller should take it out of the platform's schedule with Retract, or false if its hand-off is still on the way
+// and Pump will once it's done.
+bool ToastScheduler::BeginRetract(const std::wstring& id)
+{
+    m_handedOff--;
+    if (m_handingOff.count(id) != 0)
+    {
+        m_lateRetracts.push_back(id);
+        return false;
+    }
+
+    m_retracting[id]++;
+    return true;
+}
+
+// Called without either lock after BeginRetract returned true
+void ToastScheduler::Retract(const std::wstring& id)
+{
+    m_platform.RemoveFromSchedule(m_aumid, id);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_retracting.find(id);
+    if (--it->second == 0)
+    {
+        m_retracting.erase(it);
+    }
+}
+
+// Called with m_pumpMutex held but not m_mutex, since platform calls can be slow
+void ToastScheduler::Execute(std::vector<PlatformCall>& calls)
+{
+    if (calls.empty())
+    {
+        return;
+    }
+
+    std::uint64_t shown = 0;
+    std::uint64_t handedOff = 0;
+    std::uint64_t failed = 0;
+    std::vector<const std::wstring*> failedHandOffs;
+
+    for (PlatformCall& call : calls)
+    {
+        if (!call.HandOff)
+        {
+            bool succeeded = ToastSucceeded(m_platform.Show(m_aumid, call.Toast.Payload));
+            shown += succeeded ? 1 : 0;
+            failed += succeeded ? 0 : 1;
+        }
+        else if (ToastSucceeded(m_platform.AddToSchedule(m_aumid, call.Toast)))
+        {
+            handedOff++;
+        }
+        else
+        {
+            failedHandOffs.push_back(&call.Toast.Id);
+        }
+    }
+
+    std::vector<std::wstring> lateRetracts;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shown += shown;
+        m_handOffs += handedOff;
+        m_failed += failed;
+        m_handingOff.clear();
+        lateRetracts.swap(m_lateRetracts);
+
+        // An entry with the id may have been cancelled or replaced meanwhile, but only Pump hands entries off, so one
+        // that's still handed off is the one whose hand-off failed
+        for (const std::wstring* id : failedHandOffs)
+        {
+            auto it = m_entries.find(*id);
+            if (it != m_entries.end() && it->second.State == EntryState::HandedOff)
+            {
+                it->second.State = EntryState::Local;
+                m_handedOff--;
+                Record(it->second);
+            }
+        }
+    }
+
+    for (const std::wstring& id : lateRetracts)
+    {
+        m_platform.RemoveFromSchedule(m_aumid, id);
+    }
+}
+
+void ToastScheduler::PumpLoop()
+{
+    if (m_options.PumpStarted)
+    {
+        try
+        {
+            m_options.PumpStarted();
+        }
+        catch (...)
+        {
+            // Shows that needed it fail on their own, and are counted as failed
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping)
+    {
+        Clock::time_point next = NextWake();
+        if (next != Clock::time_point::max())
+        {
+            // next is on the scheduler's clock, which may be virtual, so sleep in real time for what's left on it
+            Clock::duration remaining = std::max(next - Now(), Clock::duration::zero());
+            m_pumpWake.wait_until(lock, Clock::now() + remaining);
+        }
+        else
+        {
+            m_pumpWake.wait(lock);
+        }
+
+        if (m_stopping)
+        {
+            break;
+        }
+
+        lock.unlock();
+        Pump();
+        lock.lock();
+    }
+}
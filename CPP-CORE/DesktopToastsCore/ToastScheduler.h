@@ -0,0 +1,229 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "INotificationPlatform.h"
+#include "ToastScheduleJournal.h"
+#include "ToastTimerWheel.h"
+
+struct ToastSchedulerOptions
+{
+    /// <summary>
+    /// Granularity of the timer wheel. Toasts are never shown early, and at most this late.
+    /// </summary>
+    std::chrono::system_clock::duration Resolution = std::chrono::seconds(1);
+
+    /// <summary>
+    /// How far ahead of its delivery time a toast is handed to the platform's schedule, so it's still delivered if the
+    /// app isn't running then. Only toasts within this window are ever in the platform's schedule. Zero keeps every
+    /// toast local, shown through the notifier when it's due.
+    /// </summary>
+    std::chrono::system_clock::duration PlatformWindow = std::chrono::minutes(5);
+
+    /// <summary>
+    /// If true, a background thread calls Pump whenever a toast is due. Otherwise the caller is responsible for calling Pump.
+    /// </summary>
+    bool BackgroundPump = true;
+
+    /// <summary>
+    /// Optional callback run at the start of the background pump thread, for example to initialize COM. If it
+    /// throws, the pump runs anyway.
+    /// </summary>
+    std::function<void()> PumpStarted;
+
+    /// <summary>
+    /// Clock used for delivery times. Defaults to std::chrono::system_clock; override to drive the scheduler with a virtual clock.
+    /// </summary>
+    std::function<std::chrono::system_clock::time_point()> Now;
+
+    /// <summary>
+    /// Optional journal that every pending toast is kept in, so the schedule can be restored when the app restarts. Must
+    /// be open, outlive the scheduler, and not be written to by anything else while the scheduler is using it.
+    /// </summary>
+    ToastScheduleJournal* Journal = nullptr;
+};
+
+struct ToastSchedulerStats
+{
+    std::uint64_t Scheduled;
+    std::uint64_t Shown;
+    std::uint64_t HandedOff;
+    std::uint64_t Cancelled;
+    std::uint64_t Failed;
+
+    /// <summary>
+    /// Number of journal writes that failed. The schedule itself carries on regardless.
+    /// </summary>
+    std::uint64_t JournalFailed;
+};
+
+/// <summary>
+/// Holds scheduled toasts in the app rather than the platform, which isn't built for very large schedules. Pending
+/// toasts sit in a hierarchical timer wheel, so scheduling and cancelling are O(1) however many there are. A toast
+/// is handed to the platform's schedule once it's within PlatformWindow of its delivery time, or shown through the
+/// notifier when it's due if the window is zero or the hand-off fails. Toasts can recur at a fixed interval, be
+/// snoozed, and be cancelled one at a time or a whole group at once. Thread-safe.
+/// </summary>
+class ToastScheduler
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    ToastScheduler(INotificationPlatform& platform, std::wstring aumid, ToastSchedulerOptions options);
+
+    /// <summary>
+    /// Stops the background pump. Toasts already handed to the platform are left there; the rest are discarded.
+    /// </summary>
+    ~ToastScheduler();
+
+    ToastScheduler(const ToastScheduler&) = delete;
+    ToastScheduler& operator=(const ToastScheduler&) = delete;
+
+    /// <summary>
+    /// Schedules a toast, replacing any pending toast with the same id. A non-zero interval makes it recur until
+    /// cancelled; occurrences missed while the app wasn't pumping are skipped. Returns ToastResultInvalidArgument
+    /// for an empty id or a negative interval.
+    /// </summary>
+    ToastResult Schedule(ScheduledToast toast, Clock::duration interval = Clock::duration::zero());
+
+    /// <summary>
+    /// Cancels a pending toast, taking it back out of the platform's schedule if it was handed off. Returns ToastResultNotFound if there's none.
+    /// </summary>
+    ToastResult Cancel(const std::wstring& id);
+
+    /// <summary>
+    /// Cancels every pending toast in the group. Returns the number cancelled.
+    /// </summary>
+    std::size_t CancelGroup(const std::wstring& group);
+
+    /// <summary>
+    /// Moves a pending toast's next delivery to delay from now. Later occurrences of a recurring toast follow on from
+    /// the new time. Returns ToastResultNotFound if there's no pending toast with this id; to snooze a one-off toast
+    /// that has already been shown, schedule it again.
+    /// </summary>
+    ToastResult Snooze(const std::wstring& id, Clock::duration delay);
+
+    /// <summary>
+    /// Adds toasts loaded from a journal, typically to a new scheduler at startup, without writing them back to it.
+    /// A toast that was handed off and has since come due is taken to have been delivered by the platform, so a
+    /// one-off toast is dropped and a recurring one moves on to its next occurrence. Every other toast is handed off
+    /// again when it's within the window, so clear the platform's schedule beforehand. Toasts with an id that's
+    /// already pending are skipped. Returns the number restored.
+    /// </summary>
+    std::size_t Restore(std::vector<ToastJournalEntry> entries);
+
+    /// <summary>
+    /// Shows or hands off every toast that's due. Returns the earliest time at which another might be, or
+    /// Clock::time_point::max() if nothing is pending.
+    /// </summary>
+    Clock::time_point Pump();
+
+    bool IsPending(const std::wstring& id) const;
+    std::size_t PendingCount() const;
+
+    /// <summary>
+    /// Number of pending toasts currently in the platform's schedule.
+    /// </summary>
+    std::size_t HandedOffCount() const;
+
+    ToastSchedulerStats GetStats() const;
+
+private:
+    enum class EntryState
+    {
+        // In the wheel until it's due or within the platform window
+        Waiting,
+
+        // In the platform's schedule; in the wheel until its delivery time
+        HandedOff,
+
+        // The hand-off failed; in the wheel until its delivery time, when it's shown locally
+        Local
+    };
+
+    struct Entry
+    {
+        ScheduledToast Toast;
+        Clock::duration Interval;
+        EntryState State;
+        ToastTimerHandle Timer;
+    };
+
+    struct PlatformCall
+    {
+        // Added to the platform's schedule if true, otherwise shown
+        bool HandOff;
+        ScheduledToast Toast;
+    };
+
+    using Wheel = ToastTimerWheel<Entry*>;
+
+    Clock::time_point Now() const;
+    Wheel::Tick DueTick(Clock::time_point time) const;
+    Wheel::Tick CurrentTick(Clock::time_point now) const;
+    Clock::time_point NextWake() const;
+
+    void Arm(Entry& entry);
+    void Expire(Entry& entry, Clock::time_point now, std::vector<PlatformCall>& calls);
+    void FinishOccurrence(Entry& entry, Clock::time_point now);
+    void Erase(Entry& entry);
+    void Record(const Entry& entry);
+    bool BeginRetract(const std::wstring& id);
+    void Retract(const std::wstring& id);
+    void Execute(std::vector<PlatformCall>& calls);
+    void PumpLoop();
+
+    INotificationPlatform& m_platform;
+    std::wstring m_aumid;
+    ToastSchedulerOptions m_options;
+    Clock::time_point m_epoch;
+
+    // Held across Pump, ahead of m_mutex, so only one batch of platform calls is on its way at a time. Schedule, Cancel
+    // and the like never take it, so they don't wait behind a slow batch; m_mutex is only held for bookkeeping.
+    std::mutex m_pumpMutex;
+
+    mutable std::mutex m_mutex;
+    Wheel m_wheel;
+    std::unordered_map<std::wstring, Entry> m_entries;
+    std::unordered_map<std::wstring, std::unordered_set<Entry*>> m_byGroup;
+    std::size_t m_handedOff = 0;
+
+    // Ids whose hand-off is in the batch Pump is running, and those among them cancelled meanwhile, which Pump takes
+    // back out of the platform's schedule once the hand-off is done so the retraction can't overtake it
+    std::unordered_set<std::wstring> m_handingOff;
+    std::vector<std::wstring> m_lateRetracts;
+
+    // Ids with a retraction on its way to the platform, and how many; they aren't handed off again until it's done
+    std::unordered_map<std::wstring, std::size_t> m_retracting;
+
+    std::uint64_t m_scheduled = 0;
+    std::uint64_t m_shown = 0;
+    std::uint64_t m_handOffs = 0;
+    std::uint64_t m_cancelled = 0;
+    std::uint64_t m_failed = 0;
+    std::uint64_t m_journalFailed = 0;
+
+    std::condition_variable m_pumpWake;
+    bool m_stopping = false;
+    std::thread m_pumpThread;
+};
@@ -0,0 +1,362 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastTemplate.h"
+#include <stdexcept>
+
+namespace
+{
+    bool IsFieldNameChar(wchar_t c)
+    {
+        return (c >= L'a' && c <= L'z')
+            || (c >= L'A' && c <= L'Z')
+            || (c >= L'0' && c <= L'9')
+            || c == L'_' || c == L'.' || c == L'-';
+    }
+
+    bool IsNameEnd(wchar_t c)
+    {
+        return c == L' ' || c == L'\t' || c == L'\r' || c == L'\n' || c == L'/' || c == L'>';
+    }
+
+    // Copies input[pos, end of terminator) to output and returns the position after the terminator
+    std::size_t CopyThrough(std::wstring_view input, std::size_t pos, std::wstring_view terminator, std::wstring& output)
+    {
+        std::size_t end = input.find(terminator, pos);
+        if (end == std::wstring_view::npos)
+        {
+            throw std::invalid_argument("Toast template has an unterminated markup declaration.");
+        }
+
+        end += terminator.size();
+        output.append(input.substr(pos, end - pos));
+        return end;
+    }
+
+    // Returns the length of the {name} placeholder starting at pos, or 0 if there isn't one
+    std::size_t MatchPlaceholder(std::wstring_view input, std::size_t pos, std::wstring_view& name)
+    {
+        std::size_t i = pos + 1;
+        while (i < input.size() && IsFieldNameChar(input[i]))
+        {
+            i++;
+        }
+
+        if (i == pos + 1 || i >= input.size() || input[i] != L'}')
+        {
+            return 0;
+        }
+
+        name = input.substr(pos + 1, i - pos - 1);
+        return i - pos + 1;
+    }
+}
+
+ToastTemplate::ToastTemplate(std::wstring_view xml)
+{
+    m_literal.reserve(xml.size());
+
+    std::vector<std::wstring_view> openElements;
+    std::size_t i = 0;
+
+    // Handles a brace in text or attribute values, returns the number of input characters consumed
+    auto handleBrace = [&](ToastTemplateSlotKind kind) -> std::size_t
+    {
+        if (i + 1 < xml.size() && xml[i + 1] == L'{')
+        {
+            m_literal.push_back(L'{');
+            return 2;
+        }
+
+        std::wstring_view name;
+        std::size_t length = MatchPlaceholder(xml, i, name);
+        if (length == 0)
+        {
+            m_literal.push_back(L'{');
+            return 1;
+        }
+
+        m_slots.push_back({ m_literal.size(), AddField(name), kind });
+        return length;
+    };
+
+    // }} is a literal brace, like {{; a lone } is copied as it is
+    auto isEscapedCloseBrace = [&]
+    {
+        return xml[i] == L'}' && i + 1 < xml.size() && xml[i + 1] == L'}';
+    };
+
+    while (i < xml.size())
+    {
+        wchar_t c = xml[i];
+
+        if (c == L'{')
+        {
+            i += handleBrace(ToastTemplateSlotKind::Text);
+            continue;
+        }
+
+        if (isEscapedCloseBrace())
+        {
+            m_literal.push_back(L'}');
+            i += 2;
+            continue;
+        }
+
+        if (c != L'<')
+        {
+            m_literal.push_back(c);
+            i++;
+            continue;
+        }
+
+        std::wstring_view rest = xml.substr(i);
+        if (rest.compare(0, 4, L"<!--") == 0)
+        {
+            i = CopyThrough(xml, i, L"-->", m_literal);
+            continue;
+        }
+        if (rest.compare(0, 9, L"<![CDATA[") == 0)
+        {
+            i = CopyThrough(xml, i, L"]]>", m_literal);
+            continue;
+        }
+        if (rest.compare(0, 2, L"<?") == 0 || rest.compare(0, 2, L"<!") == 0)
+        {
+            i = CopyThrough(xml, i, L">", m_literal);
+            continue;
+        }
+
+        // Element start or end tag
+        bool isEndTag = rest.size() > 1 && rest[1] == L'/';
+        std::size_t nameStart = i + (isEndTag ? 2 : 1);
+        std::size_t nameEnd = nameStart;
+        while (nameEnd < xml.size() && !IsNameEnd(xml[nameEnd]))
+        {
+            nameEnd++;
+        }
+        if (nameEnd == nameStart)
+        {
+            throw std::invalid_argument("Toast template has a tag without an element name.");
+        }
+        std::wstring_view elementName = xml.substr(nameStart, nameEnd - nameStart);
+
+        m_literal.append(xml.substr(i, nameEnd - i));
+        i = nameEnd;
+
+        bool selfClosing = false;
+        bool closed = false;
+        while (i < xml.size() && !closed)
+        {
+            c = xml[i];
+            if (c == L'"' || c == L'\'')
+            {
+                wchar_t quote = c;
+                m_literal.push_back(c);
+                i++;
+
+                while (true)
+                {
+                    if (i >= xml.size())
+                    {
+                        throw std::invalid_argument("Toast template has an unterminated attribute value.");
+                    }
+                    if (xml[i] == quote)
+                    {
+                        m_literal.push_back(quote);
+                        i++;
+                        break;
+                    }
+                    if (xml[i] == L'<')
+                    {
+                        throw std::invalid_argument("Toast template has a '<' inside an attribute value.");
+                    }
+                    if (xml[i] == L'{')
+                    {
+                        i += handleBrace(ToastTemplateSlotKind::Attribute);
+                        continue;
+                    }
+                    if (isEscapedCloseBrace())
+                    {
+                        m_literal.push_back(L'}');
+                        i += 2;
+                        continue;
+                    }
+
+                    m_literal.push_back(xml[i]);
+                    i++;
+                }
+                continue;
+            }
+
+            if (c == L'>')
+            {
+                closed = true;
+                selfClosing = i > 0 && xml[i - 1] == L'/';
+            }
+
+            m_literal.push_back(c);
+            i++;
+        }
+
+        if (!closed)
+        {
+            throw std::invalid_argument("Toast template has an unterminated tag.");
+        }
+
+        if (isEndTag)
+        {
+            if (openElements.empty() || openElements.back() != elementName)
+            {
+                throw std::invalid_argument("Toast template has a mismatched end tag.");
+            }
+            openElements.pop_back();
+        }
+        else if (!selfClosing)
+        {
+            openElements.push_back(elementName);
+        }
+    }
+
+    if (!openElements.empty())
+    {
+        throw std::invalid_argument("Toast template has an unclosed element.");
+    }
+}
+
+std::size_t ToastTemplate::AddField(std::wstring_view name)
+{
+    std::size_t index = FieldIndex(name);
+    if (index != npos)
+    {
+        return index;
+    }
+
+    m_fields.emplace_back(name);
+    return m_fields.size() - 1;
+}
+
+std::size_t ToastTemplate::FieldIndex(std::wstring_view name) const
+{
+    // Templates only have a handful of fields, so a scan beats hashing here
+    for (std::size_t i = 0; i < m_fields.size(); i++)
+    {
+        if (m_fields[i] == name)
+        {
+            return i;
+        }
+    }
+
+    return npos;
+}
+
+ToastTemplateValues ToastTemplate::CreateValues() const
+{
+    return ToastTemplateValues(*this);
+}
+
+void ToastTemplate::RenderTo(const std::wstring_view* values, std::size_t valueCount, std::wstring& output) const
+{
+    // Size for the unescaped values up front; escaping rarely grows the payload further
+    std::size_t required = m_literal.size();
+    for (const ToastTemplateSlot& slot : m_slots)
+    {
+        if (slot.FieldIndex < valueCount)
+        {
+            required += values[slot.FieldIndex].size();
+        }
+    }
+
+    output.clear();
+    output.reserve(required);
+
+    std::size_t position = 0;
+    for (const ToastTemplateSlot& slot : m_slots)
+    {
+        output.append(m_literal, position, slot.Offset - position);
+        position = slot.Offset;
+
+        if (slot.FieldIndex < valueCount)
+        {
+            AppendEscapedXml(output, values[slot.FieldIndex], slot.Kind);
+        }
+    }
+
+    output.append(m_literal, position, std::wstring::npos);
+}
+
+std::wstring ToastTemplate::Render(std::initializer_list<std::wstring_view> values) const
+{
+    std::wstring output;
+    RenderTo(values.begin(), values.size(), output);
+    return output;
+}
+
+std::wstring ToastTemplate::Render(const ToastTemplateValues& values) const
+{
+    std::wstring output;
+    RenderTo(values.Data(), values.Size(), output);
+    return output;
+}
+
+ToastTemplateValues::ToastTemplateValues(const ToastTemplate& owner) :
+    m_owner(&owner),
+    m_values(owner.FieldCount())
+{
+}
+
+ToastTemplateValues& ToastTemplateValues::Set(std::wstring_view name, std::wstring_view value)
+{
+    std::size_t index = m_owner->FieldIndex(name);
+    if (index == ToastTemplate::npos)
+    {
+        throw std::invalid_argument("Toast template has no field with that name.");
+    }
+
+    return Set(index, value);
+}
+
+ToastTemplateValues& ToastTemplateValues::Set(std::size_t index, std::wstring_view value)
+{
+    m_values.at(index) = value;
+    return *this;
+}
+
+void AppendEscapedXml(std::wstring& output, std::wstring_view value, ToastTemplateSlotKind kind)
+{
+    bool isAttribute = kind == ToastTemplateSlotKind::Attribute;
+
+    // Copy runs of characters that don't need escaping in one go
+    std::size_t runStart = 0;
+    for (std::size_t i = 0; i < value.size(); i++)
+    {
+        const wchar_t* entity;
+        switch (value[i])
+        {
+        case L'&': entity = L"&amp;"; break;
+        case L'<': entity = L"&lt;"; break;
+        case L'>': entity = L"&gt;"; break;
+        case L'"': entity = isAttribute ? L"&quot;" : nullptr; break;
+        case L'\'': entity = isAttribute ? L"&apos;" : nullptr; break;
+        default: entity = nullptr; break;
+        }
+
+        if (entity != nullptr)
+        {
+            output.append(value.data() + runStart, i - runStart);
+            output.append(entity);
+            runStart = i + 1;
+        }
+    }
+
+    output.append(value.data() + runStart, value.size() - runStart);
+}
@@ -0,0 +1,149 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class ToastTemplateSlotKind
+{
+    Text,
+    Attribute
+};
+
+/// <summary>
+/// A position in the compiled template where the value of a field is spliced in.
+/// </summary>
+struct ToastTemplateSlot
+{
+    /// <summary>
+    /// Offset (in characters) into the compiled literal at which the value is inserted.
+    /// </summary>
+    std::size_t Offset;
+
+    /// <summary>
+    /// Index of the field whose value fills this slot.
+    /// </summary>
+    std::size_t FieldIndex;
+
+    /// <summary>
+    /// Whether the slot sits in element text or in an attribute value, which decides how the value is escaped.
+    /// </summary>
+    ToastTemplateSlotKind Kind;
+};
+
+class ToastTemplateValues;
+
+/// <summary>
+/// A toast XML template that is parsed once and then rendered many times by splicing escaped values into
+/// the recorded slot offsets. Fields are written as {name} inside element text or attribute values, and
+/// the same field may appear in several places. Use {{ and }} to emit literal braces.
+/// </summary>
+class ToastTemplate
+{
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    /// <summary>
+    /// Parses the template. Throws std::invalid_argument if the XML is malformed.
+    /// </summary>
+    explicit ToastTemplate(std::wstring_view xml);
+
+    /// <summary>
+    /// Gets the number of distinct fields in the template.
+    /// </summary>
+    std::size_t FieldCount() const { return m_fields.size(); }
+
+    /// <summary>
+    /// Gets the name of the field at the specified index.
+    /// </summary>
+    const std::wstring& FieldName(std::size_t index) const { return m_fields[index]; }
+
+    /// <summary>
+    /// Gets the index of the named field, or npos if the template has no such field.
+    /// </summary>
+    std::size_t FieldIndex(std::wstring_view name) const;
+
+    /// <summary>
+    /// Gets every slot in the template, ordered by offset.
+    /// </summary>
+    const std::vector<ToastTemplateSlot>& Slots() const { return m_slots; }
+
+    /// <summary>
+    /// Gets the template XML with all the field placeholders removed.
+    /// </summary>
+    const std::wstring& Literal() const { return m_literal; }
+
+    /// <summary>
+    /// Creates an empty value set sized for this template.
+    /// </summary>
+    ToastTemplateValues CreateValues() const;
+
+    /// <summary>
+    /// Renders the template into output, reusing its capacity. values[i] fills field i; missing trailing
+    /// values render as empty strings.
+    /// </summary>
+    void RenderTo(const std::wstring_view* values, std::size_t valueCount, std::wstring& output) const;
+
+    /// <summary>
+    /// Renders the template with the values listed in field order.
+    /// </summary>
+    std::wstring Render(std::initializer_list<std::wstring_view> values) const;
+
+    /// <summary>
+    /// Renders the template with the values from the specified value set.
+    /// </summary>
+    std::wstring Render(const ToastTemplateValues& values) const;
+
+private:
+    std::size_t AddField(std::wstring_view name);
+
+    std::wstring m_literal;
+    std::vector<ToastTemplateSlot> m_slots;
+    std::vector<std::wstring> m_fields;
+};
+
+/// <summary>
+/// Named values used to render a ToastTemplate. The values are views, so the strings they point to must
+/// outlive any call to Render.
+/// </summary>
+class ToastTemplateValues
+{
+public:
+    /// <summary>
+    /// Sets the value of the named field. Throws std::invalid_argument if the template has no such field.
+    /// </summary>
+    ToastTemplateValues& Set(std::wstring_view name, std::wstring_view value);
+
+    /// <summary>
+    /// Sets the value of the field at the specified index.
+    /// </summary>
+    ToastTemplateValues& Set(std::size_t index, std::wstring_view value);
+
+    const std::wstring_view* Data() const { return m_values.data(); }
+    std::size_t Size() const { return m_values.size(); }
+
+private:
+    friend class ToastTemplate;
+    explicit ToastTemplateValues(const ToastTemplate& owner);
+
+    const ToastTemplate* m_owner;
+    std::vector<std::wstring_view> m_values;
+};
+
+/// <summary>
+/// Appends value to output, escaped for use in XML element text or attribute values.
+/// </summary>
+void AppendEscapedXml(std::wstring& output, std::wstring_view value, ToastTemplateSlotKind kind);
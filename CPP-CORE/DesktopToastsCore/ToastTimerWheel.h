@@ -0,0 +1,372 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/// <summary>
+/// Identifies a timer in a ToastTimerWheel. A default-constructed handle refers to no timer, and a handle stays
+/// safe to pass to Cancel after its timer has fired or been cancelled.
+/// </summary>
+struct ToastTimerHandle
+{
+    std::uint32_t Index = 0;
+    std::uint32_t Generation = 0;
+};
+
+/// <summary>
+/// A hierarchical timer wheel: four levels of 256 slots, each level covering 256 times the span of the one below,
+/// with timers further out than that kept in an overflow list. Adding and cancelling a timer are O(1); a timer
+/// moves down a level each time the level below wraps around, and fires from the bottom level on its exact tick.
+/// Each level keeps a bitmap of its occupied slots, so Advance jumps straight to the next tick that has work however
+/// sparse the timers are. Time is in abstract ticks that only move forward through Advance. Not thread-safe.
+/// </summary>
+template <typename T>
+class ToastTimerWheel
+{
+public:
+    using Tick = std::uint64_t;
+
+    static constexpr Tick NoExpiry = std::numeric_limits<Tick>::max();
+
+    explicit ToastTimerWheel(Tick now = 0) :
+        m_now(now)
+    {
+        m_nodes.resize(SentinelCount);
+        for (std::uint32_t i = 0; i < SentinelCount; i++)
+        {
+            m_nodes[i].Prev = i;
+            m_nodes[i].Next = i;
+        }
+    }
+
+    Tick Now() const { return m_now; }
+    std::size_t Size() const { return m_size; }
+
+    /// <summary>
+    /// Adds a timer that fires on the first Advance to due or later. A timer that's already due fires on the next Advance.
+    /// </summary>
+    ToastTimerHandle Add(Tick due, T value)
+    {
+        std::uint32_t index = Allocate();
+        m_nodes[index].Due = due;
+        m_nodes[index].Value.emplace(std::move(value));
+        Place(index);
+        m_size++;
+        return ToastTimerHandle{ index, m_nodes[index].Generation };
+    }
+
+    /// <summary>
+    /// Returns false if the timer has already fired or been cancelled.
+    /// </summary>
+    bool Cancel(ToastTimerHandle handle)
+    {
+        if (handle.Index < SentinelCount || handle.Index >= m_nodes.size() ||
+            m_nodes[handle.Index].Generation != handle.Generation || !m_nodes[handle.Index].Value)
+        {
+            return false;
+        }
+
+        Unlink(handle.Index);
+        Free(handle.Index);
+        m_size--;
+        return true;
+    }
+
+    /// <summary>
+    /// Moves the wheel forward to now, calling expired with the value of every timer due by then, in order of due tick.
+    /// The callback may add and cancel timers but not call Advance; timers it adds that are already due fire on the
+    /// next Advance. Returns the number fired.
+    /// </summary>
+    template <typename TCallback>
+    std::size_t Advance(Tick now, TCallback&& expired)
+    {
+        std::size_t fired = Fire(ExpiredList, expired);
+
+        while (m_now < now)
+        {
+            Tick next = NextEvent();
+            if (next > now)
+            {
+                m_now = now;
+                break;
+            }
+
+            m_now = next;
+            if ((m_now & SlotMask) == 0)
+            {
+                Cascade(1);
+            }
+            fired += Fire(SlotList(0, static_cast<std::size_t>(m_now & SlotMask)), expired);
+        }
+
+        return fired;
+    }
+
+    /// <summary>
+    /// The earliest tick at which Advance might fire a timer, or NoExpiry if there are none. This is exact for timers
+    /// in the bottom level; for the others it's the tick at which they move down, which is never later than they're due.
+    /// </summary>
+    Tick NextExpiry() const
+    {
+        return IsEmpty(ExpiredList) ? NextEvent() : m_now;
+    }
+
+private:
+    static constexpr std::size_t LevelCount = 4;
+    static constexpr std::size_t SlotBits = 8;
+    static constexpr std::size_t SlotCount = std::size_t(1) << SlotBits;
+    static constexpr Tick SlotMask = SlotCount - 1;
+
+    // Every list is circular through a sentinel node at the front of m_nodes
+    static constexpr std::uint32_t ExpiredList = LevelCount * SlotCount;
+    static constexpr std::uint32_t OverflowList = ExpiredList + 1;
+    static constexpr std::uint32_t WorkList = ExpiredList + 2;
+    static constexpr std::uint32_t SentinelCount = ExpiredList + 3;
+
+    using SlotBitmap = std::array<std::uint64_t, SlotCount / 64>;
+
+    struct Node
+    {
+        std::uint32_t Prev = 0;
+        std::uint32_t Next = 0;
+        std::uint32_t Generation = 1;
+        Tick Due = 0;
+        std::optional<T> Value;
+    };
+
+    static std::uint32_t SlotList(std::size_t level, std::size_t slot)
+    {
+        return static_cast<std::uint32_t>(level * SlotCount + slot);
+    }
+
+    bool IsEmpty(std::uint32_t list) const
+    {
+        return m_nodes[list].Next == list;
+    }
+
+    std::uint32_t Allocate()
+    {
+        if (!m_free.empty())
+        {
+            std::uint32_t index = m_free.back();
+            m_free.pop_back();
+            return index;
+        }
+
+        m_nodes.emplace_back();
+        return static_cast<std::uint32_t>(m_nodes.size() - 1);
+    }
+
+    void Free(std::uint32_t index)
+    {
+        Node& node = m_nodes[index];
+        node.Value.reset();
+        if (++node.Generation == 0)
+        {
+            node.Generation = 1;
+        }
+        m_free.push_back(index);
+    }
+
+    static std::size_t CountTrailingZeros(std::uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        return static_cast<std::size_t>(__builtin_ctzll(value));
+#endif
+    }
+
+    // Steps from slot to the next occupied slot in a level, going round at most once (1 to SlotCount), or 0 if the level is empty
+    std::size_t StepsToOccupied(std::size_t level, std::size_t slot) const
+    {
+        const SlotBitmap& occupied = m_occupied[level];
+        for (std::size_t step = 1; step <= SlotCount;)
+        {
+            std::size_t next = (slot + step) & SlotMask;
+            std::uint64_t word = occupied[next / 64] >> (next % 64);
+            if (word != 0)
+            {
+                return step + CountTrailingZeros(word);
+            }
+            step += 64 - next % 64;
+        }
+        return 0;
+    }
+
+    // The next tick after now with work to do: a bottom slot to fire, or a higher slot or the overflow list to move down
+    Tick NextEvent() const
+    {
+        Tick next = NoExpiry;
+        for (std::size_t level = 0; level < LevelCount; level++)
+        {
+            unsigned shift = static_cast<unsigned>(SlotBits * level);
+            std::size_t steps = StepsToOccupied(level, static_cast<std::size_t>((m_now >> shift) & SlotMask));
+            if (steps != 0)
+            {
+                Tick tick = ((m_now >> shift) + steps) << shift;
+                next = tick < next ? tick : next;
+            }
+        }
+
+        if (!IsEmpty(OverflowList))
+        {
+            Tick wrap = ((m_now >> (SlotBits * LevelCount)) + 1) << (SlotBits * LevelCount);
+            next = wrap < next ? wrap : next;
+        }
+        return next;
+    }
+
+    void Link(std::uint32_t list, std::uint32_t index)
+    {
+        if (list < ExpiredList)
+        {
+            m_occupied[list / SlotCount][(list % SlotCount) / 64] |= std::uint64_t(1) << (list % 64);
+        }
+
+        std::uint32_t last = m_nodes[list].Prev;
+        m_nodes[index].Prev = last;
+        m_nodes[index].Next = list;
+        m_nodes[last].Next = index;
+        m_nodes[list].Prev = index;
+    }
+
+    void Unlink(std::uint32_t index)
+    {
+        Node& node = m_nodes[index];
+        m_nodes[node.Prev].Next = node.Next;
+        m_nodes[node.Next].Prev = node.Prev;
+
+        // The last timer in a slot leaves its sentinel pointing at itself
+        if (node.Prev == node.Next && node.Prev < ExpiredList)
+        {
+            m_occupied[node.Prev / SlotCount][(node.Prev % SlotCount) / 64] &= ~(std::uint64_t(1) << (node.Prev % 64));
+        }
+    }
+
+    // Moves a whole list onto the (empty) work list in O(1)
+    void TakeAll(std::uint32_t list)
+    {
+        if (IsEmpty(list))
+        {
+            return;
+        }
+
+        if (list < ExpiredList)
+        {
+            m_occupied[list / SlotCount][(list % SlotCount) / 64] &= ~(std::uint64_t(1) << (list % 64));
+        }
+
+        std::uint32_t first = m_nodes[list].Next;
+        std::uint32_t last = m_nodes[list].Prev;
+        m_nodes[WorkList].Next = first;
+        m_nodes[WorkList].Prev = last;
+        m_nodes[first].Prev = WorkList;
+        m_nodes[last].Next = WorkList;
+        m_nodes[list].Next = list;
+        m_nodes[list].Prev = list;
+    }
+
+    // A timer goes in the lowest level whose span covers the time left until it's due, in the slot for its due tick
+    void Place(std::uint32_t index)
+    {
+        Tick due = m_nodes[index].Due;
+        if (due <= m_now)
+        {
+            Link(ExpiredList, index);
+            return;
+        }
+
+        Tick remaining = due - m_now;
+        for (std::size_t level = 0; level < LevelCount; level++)
+        {
+            if (remaining < (Tick(1) << (SlotBits * (level + 1))))
+            {
+                Link(SlotList(level, static_cast<std::size_t>((due >> (SlotBits * level)) & SlotMask)), index);
+                return;
+            }
+        }
+
+        Link(OverflowList, index);
+    }
+
+    // Called when every level below this one has wrapped to slot 0; moves the timers in this level's current slot down
+    void Cascade(std::size_t level)
+    {
+        std::uint32_t list = OverflowList;
+        if (level < LevelCount)
+        {
+            std::size_t slot = static_cast<std::size_t>((m_now >> (SlotBits * level)) & SlotMask);
+            if (slot == 0)
+            {
+                Cascade(level + 1);
+            }
+            list = SlotList(level, slot);
+        }
+
+        TakeAll(list);
+        while (!IsEmpty(WorkList))
+        {
+            std::uint32_t index = m_nodes[WorkList].Next;
+            Unlink(index);
+
+            // Due on this very tick, so it goes in the bottom slot that Advance is about to fire
+            if (m_nodes[index].Due == m_now)
+            {
+                Link(SlotList(0, static_cast<std::size_t>(m_now & SlotMask)), index);
+            }
+            else
+            {
+                Place(index);
+            }
+        }
+    }
+
+    template <typename TCallback>
+    std::size_t Fire(std::uint32_t list, TCallback& expired)
+    {
+        std::size_t fired = 0;
+        TakeAll(list);
+        while (!IsEmpty(WorkList))
+        {
+            std::uint32_t index = m_nodes[WorkList].Next;
+            Unlink(index);
+            T value = std::move(*m_nodes[index].Value);
+            Free(index);
+            m_size--;
+
+            // May add or cancel timers, including ones still on the work list, and may grow m_nodes
+            expired(std::move(value));
+            fired++;
+        }
+        return fired;
+    }
+
+    std::vector<Node> m_nodes;
+    std::vector<std::uint32_t> m_free;
+    std::array<SlotBitmap, LevelCount> m_occupied{};
+    std::size_t m_size = 0;
+    Tick m_now;
+};
@@ -0,0 +1,397 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "ToastTrace.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <random>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    bool IsXmlSpace(wchar_t c)
+    {
+        return c == L' ' || c == L'\t' || c == L'\r' || c == L'\n';
+    }
+
+    struct XmlAttribute
+    {
+        std::wstring_view Name;
+        std::wstring_view Value;
+
+        // Offset in the document of the value's closing quote
+        std::size_t End;
+    };
+
+    // Reads the attributes of the element whose name ends at position, stopping at the end of its start tag
+    std::vector<XmlAttribute> ReadAttributes(const std::wstring& xml, std::size_t position, std::size_t& tagEnd)
+    {
+        std::vector<XmlAttribute> attributes;
+        while (position < xml.size() && xml[position] != L'>' && xml[position] != L'/')
+        {
+            if (IsXmlSpace(xml[position]))
+            {
+                position++;
+                continue;
+            }
+
+            std::size_t equals = xml.find(L'=', position);
+            std::size_t quote = equals == std::wstring::npos ? std::wstring::npos : xml.find_first_of(L"\"'", equals);
+            std::size_t closing = quote == std::wstring::npos ? std::wstring::npos : xml.find(xml[quote], quote + 1);
+            if (closing == std::wstring::npos)
+            {
+                break;
+            }
+
+            std::wstring_view name = std::wstring_view(xml).substr(position, equals - position);
+            name = name.substr(0, name.find_last_not_of(L" \t\r\n") + 1);
+            attributes.push_back({ name, std::wstring_view(xml).substr(quote + 1, closing - quote - 1), closing });
+            position = closing + 1;
+        }
+        tagEnd = position;
+        return attributes;
+    }
+
+    const XmlAttribute* FindAttribute(const std::vector<XmlAttribute>& attributes, std::wstring_view name)
+    {
+        for (const XmlAttribute& attribute : attributes)
+        {
+            if (attribute.Name == name)
+            {
+                return &attribute;
+            }
+        }
+        return nullptr;
+    }
+
+    std::wstring TraceIdHex(std::uint64_t correlationId)
+    {
+        wchar_t hex[17];
+        std::swprintf(hex, 17, L"%llx", static_cast<unsigned long long>(correlationId));
+        return hex;
+    }
+}
+
+void AddToastTraceId(std::wstring& xml, std::uint64_t correlationId)
+{
+    const std::wstring argument = std::wstring(ToastTraceIdArgument) + L"=" + TraceIdHex(correlationId);
+
+    // Insertions are collected first and made back to front, so the offsets found stay valid
+    std::vector<std::pair<std::size_t, std::wstring>> insertions;
+    for (std::wstring_view element : { std::wstring_view(L"<toast"), std::wstring_view(L"<action") })
+    {
+        bool isToast = element == L"<toast";
+        for (std::size_t start = xml.find(element); start != std::wstring::npos; start = xml.find(element, start + element.size()))
+        {
+            std::size_t position = start + element.size();
+            if (position >= xml.size() || (!IsXmlSpace(xml[position]) && xml[position] != L'/' && xml[position] != L'>'))
+            {
+                continue;
+            }
+
+            std::size_t tagEnd;
+            std::vector<XmlAttribute> attributes = ReadAttributes(xml, position, tagEnd);
+
+            const XmlAttribute* activationType = FindAttribute(attributes, L"activationType");
+            if (activationType != nullptr && activationType->Value != L"foreground" && activationType->Value != L"background")
+            {
+                continue;
+            }
+
+            const XmlAttribute* arguments = FindAttribute(attributes, isToast ? L"launch" : L"arguments");
+            if (arguments != nullptr)
+            {
+                insertions.emplace_back(arguments->End, arguments->Value.empty() ? argument : L"&amp;" + argument);
+            }
+            else if (isToast)
+            {
+                insertions.emplace_back(position, L" launch=\"" + argument + L"\"");
+            }
+
+            if (isToast)
+            {
+                break;
+            }
+        }
+    }
+
+    std::sort(insertions.begin(), insertions.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (const auto& insertion : insertions)
+    {
+        xml.insert(insertion.first, insertion.second);
+    }
+}
+
+std::uint64_t TakeToastTraceId(std::wstring_view& arguments)
+{
+    std::size_t separator = arguments.rfind(L'&');
+    std::size_t start = separator == std::wstring_view::npos ? 0 : separator + 1;
+    std::wstring_view last = arguments.substr(start);
+    if (last.size() <= ToastTraceIdArgument.size() + 1 || last.size() > ToastTraceIdArgument.size() + 17 ||
+        last.substr(0, ToastTraceIdArgument.size()) != ToastTraceIdArgument || last[ToastTraceIdArgument.size()] != L'=')
+    {
+        return 0;
+    }
+
+    std::uint64_t correlationId = 0;
+    for (wchar_t c : last.substr(ToastTraceIdArgument.size() + 1))
+    {
+        int digit = c >= L'0' && c <= L'9' ? c - L'0' : c >= L'a' && c <= L'f' ? c - L'a' + 10 : -1;
+        if (digit < 0)
+        {
+            return 0;
+        }
+        correlationId = correlationId << 4 | static_cast<std::uint64_t>(digit);
+    }
+
+    arguments = arguments.substr(0, separator == std::wstring_view::npos ? 0 : separator);
+    return correlationId;
+}
+
+#if TOAST_TRACING
+
+namespace
+{
+    std::atomic<std::uint64_t> s_nextTracerInstance{ 1 };
+
+    // The buffer this thread last recorded into, and the tracer it belongs to
+    struct CachedThreadBuffer
+    {
+        std::uint64_t Instance;
+        void* Buffer;
+    };
+
+    thread_local CachedThreadBuffer t_cachedBuffer{ 0, nullptr };
+
+    unsigned long CurrentProcessId()
+    {
+#if defined(_WIN32)
+        return GetCurrentProcessId();
+#else
+        return static_cast<unsigned long>(getpid());
+#endif
+    }
+
+    std::string JsonString(const char* value)
+    {
+        std::string escaped = "\"";
+        for (const char* c = value; *c != '\0'; c++)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                escaped += '\\';
+                escaped += *c;
+            }
+            else if (static_cast<unsigned char>(*c) < 0x20)
+            {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", *c);
+                escaped += code;
+            }
+            else
+            {
+                escaped += *c;
+            }
+        }
+        return escaped + "\"";
+    }
+}
+
+ToastTracer::ToastTracer(ToastTracerOptions options) :
+    m_options(options),
+    m_instance(s_nextTracerInstance.fetch_add(1))
+{
+    // Start from a random point so IDs from different runs of the app don't collide
+    std::random_device random;
+    std::uint64_t seed = static_cast<std::uint64_t>(random()) << 32 | random();
+    m_nextCorrelationId.store(seed, std::memory_order_relaxed);
+}
+
+ToastTracer::~ToastTracer() = default;
+
+std::uint64_t ToastTracer::NewCorrelationId()
+{
+    std::uint64_t correlationId;
+    do
+    {
+        correlationId = m_nextCorrelationId.fetch_add(1, std::memory_order_relaxed);
+    } while (correlationId == 0);
+    return correlationId;
+}
+
+ToastTracer::ThreadBuffer* ToastTracer::CurrentThreadBuffer()
+{
+    if (t_cachedBuffer.Instance == m_instance)
+    {
+        return static_cast<ThreadBuffer*>(t_cachedBuffer.Buffer);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_ptr<ThreadBuffer>& buffer = m_buffers[std::this_thread::get_id()];
+    if (buffer == nullptr)
+    {
+        buffer = std::make_unique<ThreadBuffer>(m_options.PerThreadCapacity, static_cast<std::uint32_t>(m_buffers.size()));
+    }
+    t_cachedBuffer = { m_instance, buffer.get() };
+    return buffer.get();
+}
+
+void ToastTracer::Record(const char* name, std::uint64_t correlationId, std::int64_t startNanoseconds, std::int64_t endNanoseconds)
+{
+    ThreadBuffer* buffer = CurrentThreadBuffer();
+    ToastTraceSpan span{ name, correlationId, startNanoseconds, endNanoseconds - startNanoseconds, buffer->Thread };
+    if (buffer->Ring.TryPush(span))
+    {
+        m_recorded.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ToastTracer::CollectLocked()
+{
+    std::size_t collected = m_spans.size();
+    ToastTraceSpan span;
+    for (auto& buffer : m_buffers)
+    {
+        while (buffer.second->Ring.TryPop(span))
+        {
+            m_spans.push_back(span);
+        }
+    }
+
+    // Spans from different threads interleave, so sort what's new and merge it into what was already in order
+    std::sort(m_spans.begin() + collected, m_spans.end(), [](const ToastTraceSpan& a, const ToastTraceSpan& b) { return a.StartNanoseconds < b.StartNanoseconds; });
+    std::inplace_merge(m_spans.begin(), m_spans.begin() + collected, m_spans.end(), [](const ToastTraceSpan& a, const ToastTraceSpan& b) { return a.StartNanoseconds < b.StartNanoseconds; });
+
+    while (m_spans.size() > m_options.MaxRetainedSpans)
+    {
+        m_spans.pop_front();
+    }
+}
+
+std::vector<ToastTraceSpan> ToastTracer::Collect()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    CollectLocked();
+    return std::vector<ToastTraceSpan>(m_spans.begin(), m_spans.end());
+}
+
+std::string ToastTracer::ExportChromeTrace()
+{
+    std::vector<ToastTraceSpan> spans = Collect();
+    unsigned long processId = CurrentProcessId();
+
+    std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    char event[256];
+    bool first = true;
+    for (const ToastTraceSpan& span : spans)
+    {
+        // Chrome's timestamps are in microseconds
+        double start = span.StartNanoseconds / 1000.0;
+        std::snprintf(event, sizeof(event), "%s\n{\"name\":%s,\"cat\":\"toast\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lu,\"tid\":%u,\"args\":{\"correlationId\":\"%llx\"}}",
+            first ? "" : ",", JsonString(span.Name).c_str(), start, span.DurationNanoseconds / 1000.0, processId, span.Thread, static_cast<unsigned long long>(span.CorrelationId));
+        json += event;
+        first = false;
+
+        // A flow arrow from each show to the activation of the same toast
+        bool isShow = std::string_view(span.Name) == ToastTraceShow;
+        if (isShow || std::string_view(span.Name) == ToastTraceActivate)
+        {
+            std::snprintf(event, sizeof(event), ",\n{\"name\":\"toast\",\"cat\":\"toast\",\"ph\":\"%s\",\"bp\":\"e\",\"id\":\"%llx\",\"ts\":%.3f,\"pid\":%lu,\"tid\":%u}",
+                isShow ? "s" : "f", static_cast<unsigned long long>(span.CorrelationId), isShow ? start + span.DurationNanoseconds / 1000.0 : start, processId, span.Thread);
+            json += event;
+        }
+    }
+    json += "\n]}\n";
+    return json;
+}
+
+ToastResult ToastTracer::WriteChromeTrace(const std::filesystem::path& path)
+{
+    std::string json = ExportChromeTrace();
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(json.data(), static_cast<std::streamsize>(json.size()));
+    file.close();
+    return file.good() ? ToastResultOk : ToastResultFail;
+}
+
+std::vector<ToastTraceLatency> ToastTracer::ShowToActivateLatencies()
+{
+    std::vector<ToastTraceSpan> spans = Collect();
+
+    // The spans are in start order, so a toast's build and show are seen before its activation
+    struct Shown
+    {
+        ToastTraceLatency Latency;
+        std::int64_t End;
+        bool HasShow;
+    };
+    std::map<std::uint64_t, Shown> pending;
+    std::vector<ToastTraceLatency> latencies;
+    for (const ToastTraceSpan& span : spans)
+    {
+        std::string_view name = span.Name;
+        if (name == ToastTraceBuild)
+        {
+            pending[span.CorrelationId].Latency.BuildNanoseconds = span.DurationNanoseconds;
+        }
+        else if (name == ToastTraceShow)
+        {
+            Shown& shown = pending[span.CorrelationId];
+            shown.Latency.ShowNanoseconds = span.DurationNanoseconds;
+            shown.End = span.StartNanoseconds + span.DurationNanoseconds;
+            shown.HasShow = true;
+        }
+        else if (name == ToastTraceActivate)
+        {
+            // A toast can be activated more than once, through its body and each of its buttons
+            auto found = pending.find(span.CorrelationId);
+            if (found != pending.end() && found->second.HasShow)
+            {
+                ToastTraceLatency latency = found->second.Latency;
+                latency.CorrelationId = span.CorrelationId;
+                latency.ShowToActivateNanoseconds = span.StartNanoseconds - found->second.End;
+                latencies.push_back(latency);
+            }
+        }
+    }
+    return latencies;
+}
+
+void ToastTracer::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    CollectLocked();
+    m_spans.clear();
+}
+
+ToastTracerStats ToastTracer::GetStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    CollectLocked();
+    return ToastTracerStats{ m_recorded.load(std::memory_order_relaxed), m_dropped.load(std::memory_order_relaxed), m_spans.size(), m_buffers.size() };
+}
+
+#endif
@@ -0,0 +1,271 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "INotificationPlatform.h"
+#include "MpscRing.h"
+
+// Define TOAST_TRACING as 0 to compile tracing out. ToastTracer and ToastTraceScope keep their interface but
+// do nothing, so call sites don't need their own #if and pay nothing for them.
+#ifndef TOAST_TRACING
+#define TOAST_TRACING 1
+#endif
+
+/// <summary>
+/// The launch and action argument that carries a toast's correlation ID, as lowercase hex.
+/// </summary>
+constexpr std::wstring_view ToastTraceIdArgument = L"toastTraceId";
+
+// Names of the spans recorded for each toast
+constexpr const char* ToastTraceBuild = "build";
+constexpr const char* ToastTraceShow = "show";
+constexpr const char* ToastTraceActivate = "activate";
+
+/// <summary>
+/// Appends the correlation ID to the launch arguments of the toast and the arguments of each of its actions that
+/// activates the app. Protocol and system actions are left alone, as is the launch of a protocol-activated toast.
+/// A toast without launch arguments is given some, so clicking it can still be matched to the show.
+/// </summary>
+void AddToastTraceId(std::wstring& xml, std::uint64_t correlationId);
+
+/// <summary>
+/// Reads the correlation ID AddToastTraceId appended to these activation arguments and removes it, leaving the
+/// arguments as the app wrote them. Returns 0, leaving the arguments alone, if they don't end with one.
+/// </summary>
+std::uint64_t TakeToastTraceId(std::wstring_view& arguments);
+
+/// <summary>
+/// A timed span of work on one toast. Name is one of the ToastTrace names, or another string literal.
+/// </summary>
+struct ToastTraceSpan
+{
+    const char* Name;
+    std::uint64_t CorrelationId;
+
+    /// <summary>
+    /// On the steady clock, which is shared by every process on the machine.
+    /// </summary>
+    std::int64_t StartNanoseconds;
+    std::int64_t DurationNanoseconds;
+
+    /// <summary>
+    /// Numbers the threads that recorded spans, from 1, in the order they first did.
+    /// </summary>
+    std::uint32_t Thread;
+};
+
+/// <summary>
+/// Where the time went for one toast that was both shown and activated while the tracer was collecting.
+/// </summary>
+struct ToastTraceLatency
+{
+    std::uint64_t CorrelationId;
+
+    /// <summary>
+    /// Zero if no build span was recorded for the toast.
+    /// </summary>
+    std::int64_t BuildNanoseconds;
+    std::int64_t ShowNanoseconds;
+
+    /// <summary>
+    /// From the end of the show to the start of the activation, which is mostly the user.
+    /// </summary>
+    std::int64_t ShowToActivateNanoseconds;
+};
+
+struct ToastTracerOptions
+{
+    /// <summary>
+    /// Spans each thread can hold until they're next collected, rounded up to a power of two. Spans recorded
+    /// while a thread's buffer is full are dropped.
+    /// </summary>
+    std::size_t PerThreadCapacity = 4096;
+
+    /// <summary>
+    /// Collected spans kept for export and for joining, oldest discarded first.
+    /// </summary>
+    std::size_t MaxRetainedSpans = 65536;
+};
+
+struct ToastTracerStats
+{
+    std::uint64_t Recorded;
+    std::uint64_t Dropped;
+    std::size_t Retained;
+    std::size_t Threads;
+};
+
+#if TOAST_TRACING
+
+/// <summary>
+/// Records spans of the work done on each toast from any number of threads, for export as Chrome trace-event JSON
+/// and for joining a toast's show to its activation. Every thread records into a ring buffer of its own, so
+/// recording never takes a lock or contends with another thread; Collect drains the buffers into one list.
+/// </summary>
+class ToastTracer
+{
+public:
+    explicit ToastTracer(ToastTracerOptions options = {});
+    ~ToastTracer();
+
+    ToastTracer(const ToastTracer&) = delete;
+    ToastTracer& operator=(const ToastTracer&) = delete;
+
+    static std::int64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// <summary>
+    /// Never zero, and random enough that toasts shown by different runs of the app don't share one.
+    /// </summary>
+    std::uint64_t NewCorrelationId();
+
+    void Record(const char* name, std::uint64_t correlationId, std::int64_t startNanoseconds, std::int64_t endNanoseconds);
+
+    /// <summary>
+    /// Moves every thread's recorded spans into the retained list, and returns a copy of it ordered by start time.
+    /// </summary>
+    std::vector<ToastTraceSpan> Collect();
+
+    /// <summary>
+    /// The retained spans in Chrome's trace-event format, for chrome://tracing or Perfetto. Each toast's show
+    /// and activation are joined by a flow arrow.
+    /// </summary>
+    std::string ExportChromeTrace();
+    ToastResult WriteChromeTrace(const std::filesystem::path& path);
+
+    /// <summary>
+    /// Joins each toast's show span to its activation span, in the order the toasts were activated.
+    /// </summary>
+    std::vector<ToastTraceLatency> ShowToActivateLatencies();
+
+    /// <summary>
+    /// Discards every recorded span.
+    /// </summary>
+    void Clear();
+
+    ToastTracerStats GetStats();
+
+private:
+    struct ThreadBuffer
+    {
+        ThreadBuffer(std::size_t capacity, std::uint32_t thread) : Ring(capacity), Thread(thread) {}
+
+        MpscRing<ToastTraceSpan> Ring;
+        std::uint32_t Thread;
+    };
+
+    ThreadBuffer* CurrentThreadBuffer();
+    void CollectLocked();
+
+    ToastTracerOptions m_options;
+
+    // Identifies this tracer to the per-thread cache of buffers, which can't use its address because a later tracer may reuse it
+    std::uint64_t m_instance;
+    std::atomic<std::uint64_t> m_nextCorrelationId;
+    std::atomic<std::uint64_t> m_recorded{ 0 };
+    std::atomic<std::uint64_t> m_dropped{ 0 };
+
+    std::mutex m_mutex;
+    std::unordered_map<std::thread::id, std::unique_ptr<ThreadBuffer>> m_buffers;
+    std::deque<ToastTraceSpan> m_spans;
+};
+
+/// <summary>
+/// Records a span from construction until End or destruction. Does nothing if the tracer is null. Given no
+/// correlation ID, the span starts a new toast; pass CorrelationId() on to the spans that follow it.
+/// </summary>
+class ToastTraceScope
+{
+public:
+    ToastTraceScope(ToastTracer* tracer, const char* name, std::uint64_t correlationId = 0) :
+        m_tracer(tracer),
+        m_name(name)
+    {
+        if (m_tracer != nullptr)
+        {
+            m_correlationId = correlationId != 0 ? correlationId : m_tracer->NewCorrelationId();
+            m_start = ToastTracer::Now();
+        }
+    }
+
+    ~ToastTraceScope()
+    {
+        End();
+    }
+
+    ToastTraceScope(const ToastTraceScope&) = delete;
+    ToastTraceScope& operator=(const ToastTraceScope&) = delete;
+
+    std::uint64_t CorrelationId() const { return m_correlationId; }
+
+    void End()
+    {
+        if (m_tracer != nullptr)
+        {
+            m_tracer->Record(m_name, m_correlationId, m_start, ToastTracer::Now());
+            m_tracer = nullptr;
+        }
+    }
+
+private:
+    ToastTracer* m_tracer;
+    const char* m_name;
+    std::uint64_t m_correlationId = 0;
+    std::int64_t m_start = 0;
+};
+
+#else
+
+class ToastTracer
+{
+public:
+    explicit ToastTracer(ToastTracerOptions = {}) {}
+
+    static std::int64_t Now() { return 0; }
+    std::uint64_t NewCorrelationId() { return 0; }
+    void Record(const char*, std::uint64_t, std::int64_t, std::int64_t) {}
+    std::vector<ToastTraceSpan> Collect() { return {}; }
+    std::string ExportChromeTrace() { return "{\"traceEvents\":[]}\n"; }
+    ToastResult WriteChromeTrace(const std::filesystem::path&) { return ToastResultFail; }
+    std::vector<ToastTraceLatency> ShowToActivateLatencies() { return {}; }
+    void Clear() {}
+    ToastTracerStats GetStats() { return {}; }
+};
+
+class ToastTraceScope
+{
+public:
+    ToastTraceScope(ToastTracer*, const char*, std::uint64_t = 0) {}
+
+    ToastTraceScope(const ToastTraceScope&) = delete;
+    ToastTraceScope& operator=(const ToastTraceScope&) = delete;
+
+    std::uint64_t CorrelationId() const { return 0; }
+    void End() {}
+};
+
+#endif
@@ -0,0 +1,390 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Compares two sets of benchmark results written through TOAST_BENCHMARK_JSON and flags every benchmark that
+// got slower by more than the threshold. Each side is a results file or a directory of them; a benchmark reported by
+// more than one file, as it is by repeated runs, is compared by the median of its times, so one noisy run (and
+// one-off timings especially) doesn't decide the result.
+//
+//   BenchmarkCompare [--threshold PERCENT] BASELINE CURRENT
+//
+// Exits with 1 if anything regressed, and 2 if the command line is wrong or a results file can't be read.
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Result
+    {
+        double Nanoseconds;
+        unsigned long long Iterations;
+    };
+
+    // Every time reported for one benchmark, one per run
+    struct Samples
+    {
+        std::vector<double> Nanoseconds;
+
+        double Median() const
+        {
+            std::vector<double> sorted = Nanoseconds;
+            std::sort(sorted.begin(), sorted.end());
+            std::size_t middle = sorted.size() / 2;
+            return sorted.size() % 2 == 1 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+        }
+    };
+
+    // Reads just what Benchmark.h writes: an object with a suite name and an array of flat result objects
+    class ResultsReader
+    {
+    public:
+        explicit ResultsReader(const std::string& text) : m_text(text) {}
+
+        bool Read(std::map<std::string, Samples>& results)
+        {
+            std::string suite;
+            std::map<std::string, Result> suiteResults;
+            if (!Expect('{'))
+            {
+                return false;
+            }
+            do
+            {
+                std::string key;
+                if (!ReadString(key) || !Expect(':'))
+                {
+                    return false;
+                }
+                if (key == "suite")
+                {
+                    if (!ReadString(suite))
+                    {
+                        return false;
+                    }
+                }
+                else if (key == "benchmarks")
+                {
+                    if (!ReadBenchmarks(suiteResults))
+                    {
+                        return false;
+                    }
+                }
+                else if (!SkipValue())
+                {
+                    return false;
+                }
+            } while (Accept(','));
+
+            if (!Expect('}'))
+            {
+                return false;
+            }
+            for (auto& result : suiteResults)
+            {
+                results[suite + " / " + result.first].Nanoseconds.push_back(result.second.Nanoseconds);
+            }
+            return true;
+        }
+
+    private:
+        bool ReadBenchmarks(std::map<std::string, Result>& results)
+        {
+            if (!Expect('['))
+            {
+                return false;
+            }
+            if (Accept(']'))
+            {
+                return true;
+            }
+            do
+            {
+                std::string name;
+                Result result{ 0, 0 };
+                if (!Expect('{'))
+                {
+                    return false;
+                }
+                do
+                {
+                    std::string key;
+                    double number = 0;
+                    if (!ReadString(key) || !Expect(':'))
+                    {
+                        return false;
+                    }
+                    if (key == "name" ? !ReadString(name) : key == "ns_per_op" || key == "iterations" ? !ReadNumber(number) : !SkipValue())
+                    {
+                        return false;
+                    }
+                    if (key == "ns_per_op")
+                    {
+                        result.Nanoseconds = number;
+                    }
+                    else if (key == "iterations")
+                    {
+                        result.Iterations = static_cast<unsigned long long>(number);
+                    }
+                } while (Accept(','));
+                if (!Expect('}'))
+                {
+                    return false;
+                }
+                results[name] = result;
+            } while (Accept(','));
+            return Expect(']');
+        }
+
+        void SkipSpace()
+        {
+            while (m_position < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_position])))
+            {
+                m_position++;
+            }
+        }
+
+        bool Accept(char c)
+        {
+            SkipSpace();
+            if (m_position < m_text.size() && m_text[m_position] == c)
+            {
+                m_position++;
+                return true;
+            }
+            return false;
+        }
+
+        bool Expect(char c)
+        {
+            return Accept(c);
+        }
+
+        bool ReadString(std::string& value)
+        {
+            if (!Expect('"'))
+            {
+                return false;
+            }
+            value.clear();
+            while (m_position < m_text.size() && m_text[m_position] != '"')
+            {
+                char c = m_text[m_position++];
+                if (c == '\\' && m_position < m_text.size())
+                {
+                    char escaped = m_text[m_position++];
+                    if (escaped == 'u' && m_position + 4 <= m_text.size())
+                    {
+                        // Benchmark.h only escapes control characters this way
+                        c = static_cast<char>(std::strtol(m_text.substr(m_position, 4).c_str(), nullptr, 16));
+                        m_position += 4;
+                    }
+                    else
+                    {
+                        c = escaped == 'n' ? '\n' : escaped == 't' ? '\t' : escaped;
+                    }
+                }
+                value += c;
+            }
+            return Expect('"');
+        }
+
+        bool ReadNumber(double& value)
+        {
+            SkipSpace();
+            const char* start = m_text.c_str() + m_position;
+            char* end = nullptr;
+            value = std::strtod(start, &end);
+            m_position += end - start;
+            return end != start;
+        }
+
+        bool SkipValue()
+        {
+            SkipSpace();
+            if (m_position >= m_text.size())
+            {
+                return false;
+            }
+            std::string ignored;
+            double number;
+            switch (m_text[m_position])
+            {
+            case '"':
+                return ReadString(ignored);
+            case '{':
+            case '[':
+            {
+                char open = m_text[m_position];
+                char close = open == '{' ? '}' : ']';
+                m_position++;
+                if (Accept(close))
+                {
+                    return true;
+                }
+                do
+                {
+                    if (open == '{' && (!ReadString(ignored) || !Expect(':')))
+                    {
+                        return false;
+                    }
+                    if (!SkipValue())
+                    {
+                        return false;
+                    }
+                } while (Accept(','));
+                return Expect(close);
+            }
+            default:
+                for (const char* literal : { "true", "false", "null" })
+                {
+                    if (m_text.compare(m_position, std::strlen(literal), literal) == 0)
+                    {
+                        m_position += std::strlen(literal);
+                        return true;
+                    }
+                }
+                return ReadNumber(number);
+            }
+        }
+
+        const std::string& m_text;
+        std::size_t m_position = 0;
+    };
+
+    bool ReadResultsFile(const std::filesystem::path& path, std::map<std::string, Samples>& results)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (!file.good() && !file.eof())
+        {
+            return false;
+        }
+        return ResultsReader(text).Read(results);
+    }
+
+    bool ReadResults(const std::filesystem::path& path, std::map<std::string, Samples>& results)
+    {
+        std::error_code error;
+        if (!std::filesystem::is_directory(path, error))
+        {
+            if (!ReadResultsFile(path, results))
+            {
+                std::fprintf(stderr, "%s: not a benchmark results file\n", path.string().c_str());
+                return false;
+            }
+            return true;
+        }
+
+        std::set<std::filesystem::path> files;
+        for (const auto& entry : std::filesystem::directory_iterator(path, error))
+        {
+            if (entry.path().extension() == ".json")
+            {
+                files.insert(entry.path());
+            }
+        }
+        for (const std::filesystem::path& file : files)
+        {
+            if (!ReadResultsFile(file, results))
+            {
+                std::fprintf(stderr, "%s: not a benchmark results file\n", file.string().c_str());
+                return false;
+            }
+        }
+        return !error;
+    }
+
+    int Usage()
+    {
+        std::fprintf(stderr, "usage: BenchmarkCompare [--threshold PERCENT] BASELINE CURRENT\n");
+        return 2;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    double threshold = 10;
+    const char* paths[2] = {};
+    int pathCount = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+        {
+            char* end = nullptr;
+            threshold = std::strtod(argv[++i], &end);
+            if (*end != '\0' || threshold < 0)
+            {
+                return Usage();
+            }
+        }
+        else if (argv[i][0] == '-' || pathCount == 2)
+        {
+            return Usage();
+        }
+        else
+        {
+            paths[pathCount++] = argv[i];
+        }
+    }
+    if (pathCount != 2)
+    {
+        return Usage();
+    }
+
+    std::map<std::string, Samples> baseline;
+    std::map<std::string, Samples> current;
+    if (!ReadResults(paths[0], baseline) || !ReadResults(paths[1], current))
+    {
+        return 2;
+    }
+
+    int regressions = 0;
+    std::printf("%-80s %14s %14s %9s %5s\n", "benchmark", "baseline ns", "current ns", "change", "runs");
+    for (const auto& result : current)
+    {
+        double now = result.second.Median();
+        auto before = baseline.find(result.first);
+        if (before == baseline.end())
+        {
+            std::printf("%-80s %14s %14.2f %9s %5zu\n", result.first.c_str(), "-", now, "new", result.second.Nanoseconds.size());
+            continue;
+        }
+
+        double then = before->second.Median();
+        double change = then > 0 ? (now / then - 1) * 100 : 0;
+        bool regressed = change > threshold;
+        regressions += regressed ? 1 : 0;
+        std::printf("%-80s %14.2f %14.2f %+8.1f%% %5zu%s\n", result.first.c_str(), then, now, change, result.second.Nanoseconds.size(),
+            regressed ? "  REGRESSION" : change < -threshold ? "  faster" : "");
+    }
+    for (const auto& result : baseline)
+    {
+        if (current.find(result.first) == current.end())
+        {
+            std::printf("%-80s %14.2f %14s %9s %5zu\n", result.first.c_str(), result.second.Median(), "-", "missing", result.second.Nanoseconds.size());
+        }
+    }
+
+    std::printf("%d regression%s beyond %.1f%%\n", regressions, regressions == 1 ? "" : "s", threshold);
+    return regressions == 0 ? 0 : 1;
+}
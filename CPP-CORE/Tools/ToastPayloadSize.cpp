@@ -0,0 +1,301 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Reports how big toast templates are once they're minified, so an oversize payload is caught when the
+// template is written rather than when Show fails. Each file is rendered through ToastTemplate with the
+// values given on the command line (fields without one render empty), minified, and checked against the
+// budget, listing the elements that take up the most bytes.
+//
+//   ToastPayloadSize [--budget BYTES] [--warn] [--top N] [--value NAME=VALUE]... [--out DIR] FILE...
+//
+// Files are read as UTF-8, or as UTF-16 if they start with a byte order mark. Exits with 1 if any file is
+// malformed or over budget (unless --warn is given) and 2 if the command line is wrong.
+
+#include "ToastPayloadMinifier.h"
+#include "ToastTemplate.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    void AppendCodePoint(std::wstring& text, char32_t codePoint)
+    {
+        if (sizeof(wchar_t) == 2 && codePoint > 0xFFFF)
+        {
+            codePoint -= 0x10000;
+            text += static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+            text += static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+        }
+        else
+        {
+            text += static_cast<wchar_t>(codePoint);
+        }
+    }
+
+    // Invalid sequences become U+FFFD rather than failing the file
+    std::wstring FromUtf8(const std::string& bytes)
+    {
+        std::wstring text;
+        text.reserve(bytes.size());
+        for (std::size_t i = 0; i < bytes.size();)
+        {
+            unsigned char lead = static_cast<unsigned char>(bytes[i]);
+            std::size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+            char32_t codePoint = length == 1 ? lead : length == 2 ? (lead & 0x1F) : length == 3 ? (lead & 0x0F) : (lead & 0x07);
+
+            bool valid = length != 0 && i + length <= bytes.size();
+            for (std::size_t k = 1; valid && k < length; k++)
+            {
+                unsigned char next = static_cast<unsigned char>(bytes[i + k]);
+                valid = (next & 0xC0) == 0x80;
+                codePoint = (codePoint << 6) | (next & 0x3F);
+            }
+
+            AppendCodePoint(text, valid && codePoint <= 0x10FFFF ? codePoint : 0xFFFD);
+            i += valid ? length : 1;
+        }
+        return text;
+    }
+
+    std::string ToUtf8(std::wstring_view text)
+    {
+        std::string bytes;
+        bytes.reserve(text.size());
+        for (std::size_t i = 0; i < text.size(); i++)
+        {
+            char32_t codePoint = static_cast<char32_t>(text[i]);
+            if (sizeof(wchar_t) == 2 && codePoint >= 0xD800 && codePoint < 0xDC00 && i + 1 < text.size())
+            {
+                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (static_cast<char32_t>(text[++i]) - 0xDC00);
+            }
+
+            if (codePoint < 0x80)
+            {
+                bytes += static_cast<char>(codePoint);
+            }
+            else if (codePoint < 0x800)
+            {
+                bytes += static_cast<char>(0xC0 | (codePoint >> 6));
+                bytes += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else if (codePoint < 0x10000)
+            {
+                bytes += static_cast<char>(0xE0 | (codePoint >> 12));
+                bytes += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                bytes += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else
+            {
+                bytes += static_cast<char>(0xF0 | (codePoint >> 18));
+                bytes += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                bytes += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                bytes += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+        }
+        return bytes;
+    }
+
+    bool ReadTemplate(const std::filesystem::path& path, std::wstring& text)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        if (bytes.size() >= 2 && static_cast<unsigned char>(bytes[0]) == 0xFF && static_cast<unsigned char>(bytes[1]) == 0xFE)
+        {
+            text.clear();
+            for (std::size_t i = 2; i + 1 < bytes.size(); i += 2)
+            {
+                char32_t unit = static_cast<unsigned char>(bytes[i]) | (static_cast<unsigned char>(bytes[i + 1]) << 8);
+                if (sizeof(wchar_t) != 2 && unit >= 0xD800 && unit < 0xDC00 && i + 3 < bytes.size())
+                {
+                    char32_t low = static_cast<unsigned char>(bytes[i + 2]) | (static_cast<unsigned char>(bytes[i + 3]) << 8);
+                    unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                    i += 2;
+                }
+                text += static_cast<wchar_t>(unit);
+            }
+            return true;
+        }
+
+        bool bom = bytes.size() >= 3 && bytes.compare(0, 3, "\xEF\xBB\xBF") == 0;
+        text = FromUtf8(bom ? bytes.substr(3) : bytes);
+        return true;
+    }
+
+    int Usage()
+    {
+        std::fprintf(stderr, "usage: ToastPayloadSize [--budget BYTES] [--warn] [--top N] [--value NAME=VALUE]... [--out DIR] FILE...\n");
+        return 2;
+    }
+
+    bool ParseSize(const char* text, std::size_t& value)
+    {
+        char* end = nullptr;
+        unsigned long long parsed = std::strtoull(text, &end, 10);
+        if (end == text || *end != '\0')
+        {
+            return false;
+        }
+        value = static_cast<std::size_t>(parsed);
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    ToastPayloadBudget budget;
+    std::vector<std::pair<std::wstring, std::wstring>> values;
+    std::vector<std::filesystem::path> files;
+    std::filesystem::path outputDirectory;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--budget") == 0 && hasValue)
+        {
+            if (!ParseSize(argv[++i], budget.MaxBytes))
+            {
+                return Usage();
+            }
+        }
+        else if (std::strcmp(argv[i], "--top") == 0 && hasValue)
+        {
+            if (!ParseSize(argv[++i], budget.ReportedElements))
+            {
+                return Usage();
+            }
+        }
+        else if (std::strcmp(argv[i], "--warn") == 0)
+        {
+            budget.Action = ToastPayloadBudgetAction::Warn;
+        }
+        else if (std::strcmp(argv[i], "--value") == 0 && hasValue)
+        {
+            std::wstring assignment = FromUtf8(argv[++i]);
+            std::size_t equals = assignment.find(L'=');
+            if (equals == std::wstring::npos)
+            {
+                return Usage();
+            }
+            values.emplace_back(assignment.substr(0, equals), assignment.substr(equals + 1));
+        }
+        else if (std::strcmp(argv[i], "--out") == 0 && hasValue)
+        {
+            outputDirectory = argv[++i];
+        }
+        else if (argv[i][0] == '-')
+        {
+            return Usage();
+        }
+        else
+        {
+            files.emplace_back(argv[i]);
+        }
+    }
+
+    if (files.empty())
+    {
+        return Usage();
+    }
+
+    ToastPayloadMinifier minifier(budget);
+    int exitCode = 0;
+    for (const std::filesystem::path& path : files)
+    {
+        std::string name = path.string();
+        std::wstring source;
+        if (!ReadTemplate(path, source))
+        {
+            std::printf("%s: can't be read\n", name.c_str());
+            exitCode = 1;
+            continue;
+        }
+
+        std::wstring xml;
+        try
+        {
+            ToastTemplate toastTemplate(source);
+            ToastTemplateValues templateValues = toastTemplate.CreateValues();
+            for (const auto& value : values)
+            {
+                if (toastTemplate.FieldIndex(value.first) != ToastTemplate::npos)
+                {
+                    templateValues.Set(value.first, value.second);
+                }
+            }
+            xml = toastTemplate.Render(templateValues);
+        }
+        catch (const std::invalid_argument& e)
+        {
+            std::printf("%s: malformed template: %s\n", name.c_str(), e.what());
+            exitCode = 1;
+            continue;
+        }
+
+        std::wstring minified;
+        ToastPayloadReport report;
+        ToastResult result = minifier.Minify(xml, minified, &report);
+        if (result == ToastResultInvalidArgument)
+        {
+            std::printf("%s: malformed XML\n", name.c_str());
+            exitCode = 1;
+            continue;
+        }
+
+        bool overBudget = report.OutputBytes > report.MaxBytes;
+        std::printf("%s: %zu bytes, %zu minified, budget %zu%s\n", name.c_str(), report.InputBytes, report.OutputBytes, report.MaxBytes,
+            overBudget ? (result == ToastResultTooLarge ? " - OVER BUDGET" : " - over budget (warning)") : "");
+        for (const ToastPayloadElementSize& element : report.LargestElements)
+        {
+            std::string elementPath = ToUtf8(element.Path);
+            if (element.LargestAttribute.empty())
+            {
+                std::printf("  %-40s %6zu bytes\n", elementPath.c_str(), element.Bytes);
+            }
+            else
+            {
+                std::printf("  %-40s %6zu bytes, largest attribute %s (%zu bytes)\n", elementPath.c_str(), element.Bytes,
+                    ToUtf8(element.LargestAttribute).c_str(), element.LargestAttributeBytes);
+            }
+        }
+
+        if (result == ToastResultTooLarge)
+        {
+            exitCode = 1;
+        }
+
+        if (!outputDirectory.empty())
+        {
+            std::ofstream output(outputDirectory / path.filename(), std::ios::binary | std::ios::trunc);
+            std::string bytes = ToUtf8(minified);
+            if (!output.write(bytes.data(), static_cast<std::streamsize>(bytes.size())))
+            {
+                std::printf("%s: the minified payload couldn't be written\n", name.c_str());
+                exitCode = 1;
+            }
+        }
+    }
+
+    return exitCode;
+}
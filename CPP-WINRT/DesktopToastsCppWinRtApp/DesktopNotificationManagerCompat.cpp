@@ -13,15 +13,16 @@
 #include "pch.h"
 #include "DesktopNotificationManagerCompat.h"
 
-#include <winrt/Windows.ApplicationModel.h>
 #include <Windows.h>
-#include <appmodel.h>
 #include "NotificationActivationCallback.h"
-#include <winrt/Windows.Storage.h>
+#include "ProcessIdentity.h"
+#include "WinRtNotificationPlatform.h"
 #include <winrt/Windows.Foundation.Collections.h>
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
 
 using namespace winrt;
-using namespace Windows::ApplicationModel;
 using namespace Windows::UI::Notifications;
 using namespace Windows::Foundation::Collections;
 
@@ -34,16 +35,54 @@ struct Win32AppInfo
 
 bool IsContainerized();
 bool HasIdentity();
-void SetRegistryKeyValue(HKEY hKey, std::wstring subKey, std::wstring valueName, std::wstring value);
-void DeleteRegistryKeyValue(HKEY hKey, std::wstring subKey, std::wstring valueName);
-void DeleteRegistryKey(HKEY hKey, std::wstring subKey);
-void EnsureRegistered();
-std::wstring CreateAndRegisterActivator();
-std::wstring GenerateGuid(std::wstring name);
-std::wstring get_module_path();
+DesktopNotificationManager& DefaultManager();
+DWORD RegisterManager(std::shared_ptr<DesktopNotificationManager> const& manager, std::wstring const& displayName, std::wstring const& iconPath);
+DWORD RegisterClassObject(std::shared_ptr<DesktopNotificationManager> const& manager);
 
-std::wstring _win32Aumid;
-std::function<void(DesktopNotificationActivatedEventArgsCompat)> _onActivated = nullptr;
+// Only CreateToastNotifier, which hands out the native notifier, uses this directly
+WinRtNotificationPlatform _winRtPlatform;
+
+// Every other call to the notification platform, registry and package APIs goes through here
+INotificationPlatform& _platform = _winRtPlatform;
+
+// Opened by UseActivationJournal, and declared first so it outlives the handlers writing to it
+ActivationJournal _activationJournal;
+
+// The default instance: its AUMID and activator, activation handler and executor, history index and metrics.
+// Created once, under the mutex, by Register or RegisterForActivation, or on first use for apps with identity, and
+// never replaced, since senders, workers and COM threads keep the reference DefaultManager hands them
+std::mutex _managerMutex;
+std::shared_ptr<DesktopNotificationManager> _manager;
+std::atomic<DesktopNotificationManager*> _defaultManager{ nullptr };
+DWORD _classObject{};
+
+// Made with the globals, so its launch phase starts about when the process does
+ActivationStartup _startup;
+
+// Set by UsePayloadBudget; payloads are shown as they are while this is null
+std::unique_ptr<ToastPayloadMinifier> _payloadMinifier;
+
+// Set by UseImageCache, which downloads through the fetcher
+ToastUrlImageFetcher _imageFetcher;
+std::unique_ptr<ToastImageCache> _imageCache;
+
+// Opened by UseScheduler when given a path, and declared first so it outlives the scheduler writing to it
+ToastScheduleJournal _scheduleJournal;
+std::filesystem::path _scheduleJournalPath;
+
+// Set by UseScheduler
+std::unique_ptr<ToastScheduler> _scheduler;
+
+// Set once by UseTracing and never replaced, since Show and COM threads read it without a lock. _tracer owns it and
+// _activeTracer is what they read
+std::unique_ptr<ToastTracer> _tracer;
+std::atomic<ToastTracer*> _activeTracer{ nullptr };
+
+// Set by UseProgress
+std::unique_ptr<ToastProgress> _progress;
+
+// Package identity, module path and launch command, read once and then shared by every thread
+ProcessIdentity _identity(_platform, L"" TOAST_ACTIVATED_LAUNCH_ARG);
 
 
 void DesktopNotificationManagerCompat::Register(std::wstring aumid, std::wstring displayName, std::wstring iconPath)
@@ -55,193 +94,470 @@ void DesktopNotificationManagerCompat::Register(std::wstring aumid, std::wstring
 		return;
 	}
 
-	_win32Aumid = aumid;
+	std::lock_guard<std::mutex> lock(_managerMutex);
 
-	std::wstring clsidStr = CreateAndRegisterActivator();
+	// Registering again writes the registration again and replaces the activator, but keeps the default instance
+	if (_manager != nullptr && _manager->Aumid() != aumid)
+	{
+		throw hresult_illegal_method_call(L"Already registered under another AUMID; use CreateManager for a second identity.");
+	}
+	std::shared_ptr<DesktopNotificationManager> manager = _manager != nullptr ? _manager : std::make_shared<DesktopNotificationManager>(_platform, aumid);
+	DWORD classObject = RegisterManager(manager, displayName, iconPath);
 
-	// Register via registry
-	std::wstring subKey = LR"(SOFTWARE\Classes\AppUserModelId\)" + _win32Aumid;
+	if (_classObject != 0)
+	{
+		CoRevokeClassObject(_classObject);
+	}
+	_classObject = classObject;
+	if (_manager == nullptr)
+	{
+		_manager = std::move(manager);
+		_defaultManager.store(_manager.get(), std::memory_order_release);
+	}
+}
 
-	// Set the display name and icon uri
-	SetRegistryKeyValue(HKEY_CURRENT_USER, subKey, L"DisplayName", displayName);
+// A manager made by CreateManager. It has a platform of its own so its notifier and history caches aren't shared,
+// and revokes its activator when it goes
+struct HostedManager
+{
+	WinRtNotificationPlatform Platform;
+	DesktopNotificationManager Manager;
+	DWORD ClassObject{};
 
-	if (!iconPath.empty())
+	explicit HostedManager(std::wstring aumid) : Manager(Platform, std::move(aumid))
 	{
-		SetRegistryKeyValue(HKEY_CURRENT_USER, subKey, L"IconUri", iconPath);
 	}
-	else
+
+	~HostedManager()
 	{
-		DeleteRegistryKeyValue(HKEY_CURRENT_USER, subKey, L"IconUri");
+		if (ClassObject != 0)
+		{
+			CoRevokeClassObject(ClassObject);
+		}
 	}
+};
 
-	// Background color only appears in the settings page, format is
-	// hex without leading #, like "FFDDDDDD"
-	SetRegistryKeyValue(HKEY_CURRENT_USER, subKey, L"IconBackgroundColor", iconPath);
+std::shared_ptr<DesktopNotificationManager> DesktopNotificationManagerCompat::CreateManager(std::wstring aumid, std::wstring displayName, std::wstring iconPath)
+{
+	auto hosted = std::make_shared<HostedManager>(std::move(aumid));
+	std::shared_ptr<DesktopNotificationManager> manager(hosted, &hosted->Manager);
+	hosted->ClassObject = RegisterManager(manager, displayName, iconPath);
+	return manager;
+}
+
+void DesktopNotificationManagerCompat::RegisterForActivation(std::wstring aumid)
+{
+	_startup.EndPhase(ActivationStartupPhase::Launch);
+
+	// COM started the process through the registration, so it's already there and only the activator is needed
+	if (!HasIdentity())
+	{
+		std::lock_guard<std::mutex> lock(_managerMutex);
+		if (_manager == nullptr)
+		{
+			winrt::check_hresult(CoInitializeEx(NULL, COINIT_MULTITHREADED));
+			_manager = std::make_shared<DesktopNotificationManager>(_platform, aumid);
+			_defaultManager.store(_manager.get(), std::memory_order_release);
+		}
+	}
 
-	SetRegistryKeyValue(HKEY_CURRENT_USER, subKey, L"CustomActivator", L"{" + clsidStr + L"}");
+	DefaultManager().TrackActivations(&_startup);
+}
+
+ActivationStartupTimings DesktopNotificationManagerCompat::WaitForActivations(ActivationStartupOptions options)
+{
+	DesktopNotificationManager& manager = DefaultManager();
+
+	// Registered last so no activation arrives before OnActivated has been set
+	if (!HasIdentity() && _classObject == 0)
+	{
+		_classObject = RegisterClassObject(_manager);
+	}
+	_startup.EndPhase(ActivationStartupPhase::Register);
+
+	_startup.WaitForActivations(options);
+	if (!_startup.Timings().KeptRunning)
+	{
+		if (_classObject != 0)
+		{
+			CoRevokeClassObject(_classObject);
+			_classObject = 0;
+		}
+
+		// An activation can arrive between the end of the wait and the revoke
+		_startup.Drain(options);
+		manager.TrackActivations(nullptr);
+	}
+
+	return _startup.Timings();
+}
+
+void DesktopNotificationManagerCompat::KeepRunning()
+{
+	_startup.KeepRunning();
+}
+
+DesktopNotificationManager& DesktopNotificationManagerCompat::Default()
+{
+	return DefaultManager();
 }
 
 void DesktopNotificationManagerCompat::OnActivated(std::function<void(DesktopNotificationActivatedEventArgsCompat)> callback)
 {
-	EnsureRegistered();
+	DesktopNotificationManager& manager = DefaultManager();
+
+	if (callback == nullptr)
+	{
+		manager.OnActivated(nullptr);
+		return;
+	}
+
+	// The callback sees the args the bus shares between its subscribers; only a caller that keeps them clones them
+	manager.OnActivated([callback](ActivationEventArgs const& args) { callback(DesktopNotificationActivatedEventArgsCompat(args)); });
+}
+
+void DesktopNotificationManagerCompat::UseActivationJournal(std::filesystem::path path, ActivationJournalOptions options)
+{
+	DesktopNotificationManager& manager = DefaultManager();
+
+	std::error_code ignored;
+	std::filesystem::create_directories(path.parent_path(), ignored);
+	check_hresult(_activationJournal.Open(path, options));
+	manager.JournalActivations(&_activationJournal);
+
+	// A handler that fails again is counted in Metrics, and given up on after MaxAttempts starts
+	manager.ReplayActivations();
+}
+
+ActivationBus& DesktopNotificationManagerCompat::Activations()
+{
+	return DefaultManager().Activations();
+}
+
+void DesktopNotificationManagerCompat::UseActivationExecutor(ActivationExecutorOptions options, std::wstring orderingArgument)
+{
+	if (!options.WorkerStarted)
+	{
+		// Handlers use WinRT objects, so the workers need COM. If a worker can't join the apartment, its handlers fail
+		// and are counted as failed rather than ending the process.
+		options.WorkerStarted = [] { CoInitializeEx(NULL, COINIT_MULTITHREADED); };
+	}
 
-	_onActivated = callback;
+	check_hresult(DefaultManager().UseActivationExecutor(std::move(options), orderingArgument));
 }
 
-void EnsureRegistered()
+DesktopNotificationManager& DefaultManager()
 {
-	if (!HasIdentity() && _win32Aumid.empty())
+	DesktopNotificationManager* manager = _defaultManager.load(std::memory_order_acquire);
+	if (manager != nullptr)
+	{
+		return *manager;
+	}
+
+	if (!HasIdentity())
 	{
 		throw "Must call Register first.";
 	}
+
+	// Already registered through the manifest, so the package identity's instance needs no registration. Threads
+	// that get here at once all end up with the one instance
+	std::lock_guard<std::mutex> lock(_managerMutex);
+	if (_manager == nullptr)
+	{
+		_manager = std::make_shared<DesktopNotificationManager>(_platform, L"");
+		_defaultManager.store(_manager.get(), std::memory_order_release);
+	}
+	return *_manager;
+}
+
+void DesktopNotificationManagerCompat::UseScheduler(ToastSchedulerOptions options)
+{
+	const std::wstring& aumid = DefaultManager().Aumid();
+
+	if (!options.PumpStarted)
+	{
+		// The pump shows toasts through WinRT, so its thread joins the multithreaded apartment. If it can't, those
+		// shows and hand-offs fail and are counted as such rather than ending the process.
+		options.PumpStarted = [] { CoInitializeEx(NULL, COINIT_MULTITHREADED); };
+	}
+
+	_scheduler = std::make_unique<ToastScheduler>(_platform, aumid, std::move(options));
+}
+
+void DesktopNotificationManagerCompat::UseScheduler(std::filesystem::path journalPath, ToastSchedulerOptions options, ToastScheduleJournalOptions journalOptions)
+{
+	const std::wstring& aumid = DefaultManager().Aumid();
+
+	// The current scheduler may be writing to the journal
+	_scheduler.reset();
+
+	check_hresult(_scheduleJournal.Open(journalPath, journalOptions));
+	_scheduleJournalPath = journalPath;
+
+	std::vector<ToastJournalEntry> entries;
+	check_hresult(_scheduleJournal.Load(entries));
+
+	// Take back what the last run handed to the platform, since the restored scheduler hands it off again
+	for (const ToastJournalEntry& entry : entries)
+	{
+		if (entry.HandedOff)
+		{
+			_platform.RemoveFromSchedule(aumid, entry.Toast.Id);
+		}
+	}
+
+	options.Journal = &_scheduleJournal;
+	UseScheduler(std::move(options));
+	_scheduler->Restore(std::move(entries));
+}
+
+ToastScheduler& DesktopNotificationManagerCompat::Scheduler()
+{
+	if (_scheduler == nullptr)
+	{
+		throw "Must call UseScheduler first.";
+	}
+
+	return *_scheduler;
 }
 
 ToastNotifier DesktopNotificationManagerCompat::CreateToastNotifier()
 {
-	if (HasIdentity())
+	return _winRtPlatform.GetNotifier(DefaultManager().Aumid());
+}
+
+void DesktopNotificationManagerCompat::Show(ToastPayload const& payload, std::uint64_t traceId)
+{
+	DesktopNotificationManager& manager = DefaultManager();
+
+	auto start = std::chrono::steady_clock::now();
+	ToastTraceScope showSpan(_activeTracer.load(std::memory_order_acquire), ToastTraceShow, traceId);
+
+	const ToastPayload* shown = &payload;
+	ToastPayload rewritten;
+	if (_imageCache || _payloadMinifier || showSpan.CorrelationId() != 0)
+	{
+		rewritten = payload;
+		shown = &rewritten;
+	}
+
+	// The ID comes back in the arguments of the activation, and is counted against the payload budget like the rest
+	if (showSpan.CorrelationId() != 0)
+	{
+		AddToastTraceId(rewritten.Xml, showSpan.CorrelationId());
+	}
+
+	// Images that can't be cached keep their source; the toast is still shown, just as it would have been without the cache
+	if (_imageCache)
 	{
-		return ToastNotificationManager::CreateToastNotifier();
+		_imageCache->Rewrite(rewritten);
+	}
+
+	// A payload over budget counts as a failed send, like one the platform rejects
+	ToastResult result = _payloadMinifier ? _payloadMinifier->Minify(rewritten) : ToastResultOk;
+	if (ToastSucceeded(result))
+	{
+		// Counted, and added to the history index once it's shown, by the manager
+		result = manager.Show(*shown);
 	}
 	else
 	{
-		return ToastNotificationManager::CreateToastNotifier(_win32Aumid);
+		manager.Metrics().RecordSend(result, std::chrono::steady_clock::now() - start);
 	}
+	check_hresult(result);
+	showSpan.End();
 }
 
-void DesktopNotificationManagerCompat::Uninstall()
+void DesktopNotificationManagerCompat::UseProgress(ToastProgressOptions options)
 {
-	if (IsContainerized())
+	const std::wstring& aumid = DefaultManager().Aumid();
+
+	if (!options.PumpStarted)
 	{
-		// Packaged containerized apps automatically clean everything up already
-		return;
+		// The pump updates toasts through WinRT, so its thread joins the multithreaded apartment. If it can't, those
+		// updates fail and are counted as such rather than ending the process.
+		options.PumpStarted = [] { CoInitializeEx(NULL, COINIT_MULTITHREADED); };
 	}
 
-	if (!HasIdentity() && !_win32Aumid.empty())
+	_progress = std::make_unique<ToastProgress>(_platform, aumid, std::move(options));
+}
+
+void DesktopNotificationManagerCompat::ShowProgress(ToastPayload const& payload)
+{
+	DesktopNotificationManager& manager = DefaultManager();
+
+	auto start = std::chrono::steady_clock::now();
+	ToastResult result = Progress().Show(payload);
+	manager.Metrics().RecordSend(result, std::chrono::steady_clock::now() - start);
+	check_hresult(result);
+
+	manager.HistoryIndex().OnShown(payload);
+}
+
+ToastProgress& DesktopNotificationManagerCompat::Progress()
+{
+	if (_progress == nullptr)
 	{
-		try
-		{
-			// Remove all scheduled notifications (do this first before clearing current notifications)
-			auto notifier = CreateToastNotifier();
-			auto scheduled = notifier.GetScheduledToastNotifications();
-			for (int i = 0; i < scheduled.Size(); i++)
-			{
-				try
-				{
-					notifier.RemoveFromSchedule(scheduled.GetAt(i));
-				}
-				catch (...) {}
-			}
-		}
-		catch (...) {}
+		throw "Must call UseProgress first.";
+	}
 
-		try
-		{
-			// Clear all current notifications
-			History().Clear();
-		}
-		catch (...) {}
+	return *_progress;
+}
+
+void DesktopNotificationManagerCompat::UseRateLimiter(ToastRateLimiterOptions options)
+{
+	if (!options.PumpStarted)
+	{
+		// The pump shows held toasts through WinRT, so its thread joins the multithreaded apartment. If it can't, those
+		// sends fail and are counted as such rather than ending the process.
+		options.PumpStarted = [] { CoInitializeEx(NULL, COINIT_MULTITHREADED); };
 	}
 
-	try
+	check_hresult(DefaultManager().UseRateLimiter(std::move(options)));
+}
+
+void DesktopNotificationManagerCompat::UsePayloadBudget(ToastPayloadBudget budget)
+{
+	_payloadMinifier = std::make_unique<ToastPayloadMinifier>(std::move(budget));
+}
+
+void DesktopNotificationManagerCompat::UseImageCache(std::filesystem::path directory, ToastImageCacheOptions options)
+{
+	// Images in toasts the history index still has aren't evicted. The check holds on to the default manager rather than
+	// going through the global each time
+	if (!options.IsToastLive)
 	{
-		// Remove registry key
-		if (!_win32Aumid.empty())
+		DefaultManager();
+		std::shared_ptr<DesktopNotificationManager> manager;
 		{
-			std::wstring subKey = LR"(SOFTWARE\Classes\AppUserModelId\)" + _win32Aumid;
-			DeleteRegistryKey(HKEY_CURRENT_USER, subKey);
+			std::lock_guard<std::mutex> lock(_managerMutex);
+			manager = _manager;
 		}
+		options.IsToastLive = [manager](std::wstring const& tag, std::wstring const& group)
+		{
+			return tag.empty() ? manager->HistoryIndex().CountInGroup(group) > 0 : manager->HistoryIndex().Contains(tag, group);
+		};
 	}
-	catch (...) {}
+
+	auto cache = std::make_unique<ToastImageCache>(_imageFetcher, std::move(options));
+	check_hresult(cache->Open(directory));
+	_imageCache = std::move(cache);
 }
 
-std::wstring GenerateGuid(std::wstring name)
+std::wstring DesktopNotificationManagerCompat::LocalImage(std::wstring const& source, ToastImagePlacement placement)
 {
-	// From https://stackoverflow.com/a/41622689/1454643
-	wchar_t const* bytes = name.c_str();
+	if (_imageCache == nullptr)
+	{
+		throw "Must call UseImageCache first.";
+	}
+
+	std::wstring localUri;
+	return ToastSucceeded(_imageCache->Resolve(source, placement, localUri)) ? localUri : source;
+}
 
-	if (name.length() <= 16)
+INotificationPlatform& DesktopNotificationManagerCompat::Platform()
+{
+	return _platform;
+}
+
+void DesktopNotificationManagerCompat::UseTracing(ToastTracerOptions options)
+{
+	auto tracer = std::make_unique<ToastTracer>(options);
+	ToastTracer* expected = nullptr;
+	if (!_activeTracer.compare_exchange_strong(expected, tracer.get(), std::memory_order_acq_rel))
 	{
-		wchar_t guid[36];
-		swprintf_s(
-			guid,
-			36,
-			L"%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
-			name[0], name[1], name[2], name[3], name[4], name[5], name[6], name[7], name[8], name[9], name[10], name[11], name[12], name[13], name[14], name[15]);
-		return guid;
+		throw hresult_illegal_method_call(L"UseTracing was already called.");
 	}
-	else
+	_tracer = std::move(tracer);
+}
+
+ToastTracer* DesktopNotificationManagerCompat::Tracer()
+{
+	return _activeTracer.load(std::memory_order_acquire);
+}
+
+ToastMetrics& DesktopNotificationManagerCompat::Metrics()
+{
+	return DefaultManager().Metrics();
+}
+
+void DesktopNotificationManagerCompat::Uninstall()
+{
+	if (IsContainerized())
 	{
-		std::size_t hash = std::hash<std::wstring>{}(name);
+		// Packaged containerized apps automatically clean everything up already
+		return;
+	}
 
-		// Only ever at most 20 chars long
-		std::wstring hashStr = std::to_wstring(hash);
+	// Drop the scheduler's pending toasts, and stop it handing more to the platform
+	_scheduler.reset();
 
-		wchar_t guid[37];
-		for (int i = 0; i < 36; i++)
-		{
-			if (i == 8 || i == 13 || i == 18 || i == 23)
-			{
-				guid[i] = '-';
-			}
-			else
-			{
-				int strPos = i;
-				if (i > 23)
-				{
-					strPos -= 4;
-				}
-				else if (i > 18)
-				{
-					strPos -= 3;
-				}
-				else if (i > 13)
-				{
-					strPos -= 2;
-				}
-				else if (i > 8)
-				{
-					strPos -= 1;
-				}
-
-				if (strPos < hashStr.length())
-				{
-					guid[i] = hashStr[strPos];
-				}
-				else
-				{
-					guid[i] = '0';
-				}
-			}
-		}
+	// Progress toasts are about to be cleared, so there's nothing left to update
+	_progress.reset();
 
-		guid[36] = '\0';
+	if (!_scheduleJournalPath.empty())
+	{
+		_scheduleJournal.Close();
+		std::error_code ignored;
+		std::filesystem::remove(_scheduleJournalPath, ignored);
+		_scheduleJournalPath.clear();
+	}
 
-		return guid;
+	// Remove all scheduled and current notifications, and the registry key. Uninstall carries on past failures,
+	// so they're only counted in Metrics.
+	if (DesktopNotificationManager* manager = _defaultManager.load(std::memory_order_acquire))
+	{
+		manager->Uninstall();
 	}
+
+	// Nothing in history refers to the cached images any more. Only the files the cache stored are deleted, since the
+	// directory may hold the app's own files too
+	if (_imageCache)
+	{
+		_imageCache->Uninstall();
+		_imageCache.reset();
+	}
+
+	// The cached notifier and history objects belong to the registration being removed
+	_platform.ClearCaches();
 }
 
 // https://docs.microsoft.com/en-us/windows/uwp/cpp-and-winrt-apis/author-coclasses#implement-the-coclass-and-class-factory
 struct callback : implements<callback, INotificationActivationCallback>
 {
+	// Held weakly, so an activation that arrives while the manager is going away is dropped
+	std::weak_ptr<DesktopNotificationManager> _target;
+
+	explicit callback(std::weak_ptr<DesktopNotificationManager> target) : _target(std::move(target))
+	{
+	}
+
 	HRESULT __stdcall Activate(
 		LPCWSTR appUserModelId,
 		LPCWSTR invokedArgs,
 		[[maybe_unused]] NOTIFICATION_USER_INPUT_DATA const* data,
 		[[maybe_unused]] ULONG dataCount) noexcept
 	{
-		if (_onActivated != nullptr)
+		std::shared_ptr<DesktopNotificationManager> target = _target.lock();
+		if (target == nullptr)
 		{
-			std::wstring argument(invokedArgs);
-
-			StringMap userInput;
+			return S_OK;
+		}
 
-			for (int i = 0; i < dataCount; i++)
-			{
-				userInput.Insert(data[i].Key, data[i].Value);
-			}
+		// Toasts shown while tracing carry a correlation ID, which is taken off before the app sees the arguments
+		std::wstring_view arguments = invokedArgs != nullptr ? invokedArgs : L"";
+		ToastTraceScope activateSpan(_activeTracer.load(std::memory_order_acquire), ToastTraceActivate, TakeToastTraceId(arguments));
 
-			DesktopNotificationActivatedEventArgsCompat args(argument, userInput);
-			_onActivated(args);
+		// Everything the handler needs is copied into the args, so with an executor the COM call returns now.
+		// The manager counts the activation, and any failure to queue or handle it; a throwing handler doesn't get
+		// past it, so the only thing left to catch here is running out of memory copying the args.
+		try
+		{
+			target->Activate(ActivationEventArgs(arguments, data, dataCount));
+		}
+		catch (...)
+		{
+			return to_hresult();
 		}
 		return S_OK;
 	}
@@ -249,6 +565,12 @@ struct callback : implements<callback, INotificationActivationCallback>
 
 struct callback_factory : implements<callback_factory, IClassFactory>
 {
+	std::weak_ptr<DesktopNotificationManager> _target;
+
+	explicit callback_factory(std::weak_ptr<DesktopNotificationManager> target) : _target(std::move(target))
+	{
+	}
+
 	HRESULT __stdcall CreateInstance(
 		IUnknown* outer,
 		GUID const& iid,
@@ -261,7 +583,7 @@ struct callback_factory : implements<callback_factory, IClassFactory>
 			return CLASS_E_NOAGGREGATION;
 		}
 
-		return make<callback>()->QueryInterface(iid, result);
+		return make<callback>(_target)->QueryInterface(iid, result);
 	}
 
 	HRESULT __stdcall LockServer(BOOL) noexcept
@@ -270,209 +592,180 @@ struct callback_factory : implements<callback_factory, IClassFactory>
 	}
 };
 
-std::wstring CreateAndRegisterActivator()
+// Writes the manager's registration and registers its activator, returning the class object's cookie
+DWORD RegisterManager(std::shared_ptr<DesktopNotificationManager> const& manager, std::wstring const& displayName, std::wstring const& iconPath)
 {
 	// Need to initialize the thread
 	winrt::check_hresult(CoInitializeEx(NULL, COINIT_MULTITHREADED));
 
-	DWORD registration{};
-	std::wstring clsidStr = GenerateGuid(_win32Aumid);
+	DesktopNotificationRegistration registration;
+	registration.DisplayName = displayName;
+	registration.IconPath = iconPath;
+
+	// Background color only appears in the settings page, format is
+	// hex without leading #, like "FFDDDDDD"
+	registration.IconBackgroundColor = iconPath;
+
+	// Register the EXE for the activator. The launch command includes a flag so we know this was a
+	// toast activation and should wait for COM to process, and wraps the EXE path in quotes for extra security
+	const ProcessIdentitySnapshot& identity = _identity.Get();
+	check_hresult(identity.Result);
+	registration.LaunchCommand = identity.LaunchCommand;
+
+	// The activator's CLSID is a name-based UUID, so it's the same for an AUMID on every start and every machine
+	check_hresult(manager->Register(registration));
+
+	return RegisterClassObject(manager);
+}
+
+// Registers the manager's activator, returning the class object's cookie
+DWORD RegisterClassObject(std::shared_ptr<DesktopNotificationManager> const& manager)
+{
 	GUID clsid;
-	winrt::check_hresult(::CLSIDFromString((L"{" + clsidStr + L"}").c_str(), &clsid));
+	winrt::check_hresult(::CLSIDFromString(manager->ActivatorClsid().c_str(), &clsid));
 
 	// Register callback
-	auto result = CoRegisterClassObject(
+	DWORD classObject{};
+	winrt::check_hresult(CoRegisterClassObject(
 		clsid,
-		make<callback_factory>().get(),
+		make<callback_factory>(manager).get(),
 		CLSCTX_LOCAL_SERVER,
 		REGCLS_MULTIPLEUSE,
-		&registration);
-
-	// Create launch path+args
-    // Include a flag so we know this was a toast activation and should wait for COM to process
-    // We also wrap EXE path in quotes for extra security
-	std::string launchArg = TOAST_ACTIVATED_LAUNCH_ARG;
-	std::wstring launchArgW(launchArg.begin(), launchArg.end());
-	std::wstring launchStr = L"\"" + get_module_path() + L"\" " + launchArgW;
+		&classObject));
 
-	// Update registry with activator
-	std::wstring key_path = LR"(SOFTWARE\Classes\CLSID\{)" + clsidStr + LR"(}\LocalServer32)";
-	SetRegistryKeyValue(HKEY_CURRENT_USER, key_path, L"", launchStr);
-
-	return clsidStr;
+	return classObject;
 }
 
-std::wstring get_module_path()
+bool IsContainerized()
 {
-	std::wstring path(100, L'?');
-	uint32_t path_size{};
-	DWORD actual_size{};
-
-	do
-	{
-		path_size = static_cast<uint32_t>(path.size());
-		actual_size = ::GetModuleFileName(nullptr, path.data(), path_size);
+	const ProcessIdentitySnapshot& identity = _identity.Get();
+	check_hresult(identity.Result);
 
-		if (actual_size + 1 > path_size)
-		{
-			path.resize(path_size * 2, L'?');
-		}
-	} while (actual_size + 1 > path_size);
-
-	path.resize(actual_size);
-	return path;
+	return identity.IsContainerized;
 }
 
-void SetRegistryKeyValue(HKEY hKey, std::wstring subKey, std::wstring valueName, std::wstring value)
+bool HasIdentity()
 {
-	winrt::check_hresult(::RegSetKeyValue(
-		hKey,
-		subKey.c_str(),
-		valueName.empty() ? nullptr : valueName.c_str(),
-		REG_SZ,
-		reinterpret_cast<const BYTE*>(value.c_str()),
-		static_cast<DWORD>((value.length() + 1) * sizeof(WCHAR))));
+	return _identity.HasIdentity();
 }
 
-void DeleteRegistryKeyValue(HKEY hKey, std::wstring subKey, std::wstring valueName)
+DesktopNotificationHistoryCompat DesktopNotificationManagerCompat::History()
 {
-	winrt::check_hresult(::RegDeleteKeyValue(
-		hKey,
-		subKey.c_str(),
-		valueName.c_str()));
+	DesktopNotificationHistoryCompat history(DefaultManager());
+	return history;
 }
 
-void DeleteRegistryKey(HKEY hKey, std::wstring subKey)
+void DesktopNotificationHistoryCompat::Clear()
 {
-	winrt::check_hresult(::RegDeleteKey(
-		hKey,
-		subKey.c_str()));
+	check_hresult(_manager->ClearHistory());
 }
 
-bool _checkedIsContainerized;
-bool _isContainerized;
-bool IsContainerized()
+IVectorView<ToastNotification> DesktopNotificationHistoryCompat::GetHistory()
 {
-	if (!_checkedIsContainerized)
+	// The only call that needs the native history object, since it hands out the toasts themselves. Every manager here,
+	// the default one and those from CreateManager, sits on a WinRtNotificationPlatform, so it comes from that cache
+	ToastNotificationHistory history = static_cast<WinRtNotificationPlatform&>(_manager->Platform()).GetNativeHistory(_manager->Aumid());
+	if (_manager->Aumid().empty())
 	{
-		// If MSIX or sparse
-		if (HasIdentity())
-		{
-			// Sparse is identified if EXE is running outside of installed package location
-			winrt::hstring packageInstalledLocation = Package::Current().InstalledLocation().Path();
-			wchar_t exePath[MAX_PATH];
-			DWORD charWritten = GetModuleFileNameW(nullptr, exePath, ARRAYSIZE(exePath));
-			if (charWritten == 0)
-			{
-				throw HRESULT_FROM_WIN32(GetLastError());
-			}
-
-			// If inside package location
-			std::wstring stdExePath = exePath;
-			if (stdExePath.find(packageInstalledLocation.c_str()) == 0)
-			{
-				_isContainerized = true;
-			}
-			else
-			{
-				_isContainerized = false;
-			}
-		}
-
-		// Plain Win32
-		else
-		{
-			_isContainerized = false;
-		}
-
-		_checkedIsContainerized = true;
+		return history.GetHistory();
 	}
-
-	return _isContainerized;
-}
-
-bool _checkedHasIdentity;
-bool _hasIdentity;
-bool HasIdentity()
-{
-	if (!_checkedHasIdentity)
+	else
 	{
-		// https://stackoverflow.com/questions/39609643/determine-if-c-application-is-running-as-a-uwp-app-in-desktop-bridge-project
-		UINT32 length;
-		wchar_t packageFamilyName[PACKAGE_FAMILY_NAME_MAX_LENGTH + 1];
-		LONG result = GetPackageFamilyName(GetCurrentProcess(), &length, packageFamilyName);
-		_hasIdentity = result == ERROR_SUCCESS;
-
-		_checkedHasIdentity = true;
+		return history.GetHistory(_manager->Aumid());
 	}
+}
 
-	return _hasIdentity;
+void DesktopNotificationHistoryCompat::Remove(std::wstring tag)
+{
+	check_hresult(_manager->RemoveFromHistory(tag, L""));
 }
 
-DesktopNotificationHistoryCompat DesktopNotificationManagerCompat::History()
+void DesktopNotificationHistoryCompat::Remove(std::wstring tag, std::wstring group)
 {
-	EnsureRegistered();
+	check_hresult(_manager->RemoveFromHistory(tag, group));
+}
 
-	DesktopNotificationHistoryCompat history(_win32Aumid);
-	return history;
+void DesktopNotificationHistoryCompat::RemoveGroup(std::wstring group)
+{
+	check_hresult(_manager->RemoveGroupFromHistory(group));
 }
 
-void DesktopNotificationHistoryCompat::Clear()
+void PrepareBatchWorkers(ToastHistoryBatchOptions& options)
 {
-	if (_win32Aumid.empty())
-	{
-		_history.Clear();
-	}
-	else
+	if (!options.WorkerStarted)
 	{
-		_history.Clear(_win32Aumid);
+		// The batch catches a failed CoInitializeEx, and only uninitializes workers that got that far
+		options.WorkerStarted = [] { winrt::check_hresult(CoInitializeEx(NULL, COINIT_MULTITHREADED)); };
+		options.WorkerStopped = [] { CoUninitialize(); };
 	}
 }
 
-IVectorView<ToastNotification> DesktopNotificationHistoryCompat::GetHistory()
+void ForgetRemoved(ToastHistoryIndex& historyIndex, std::vector<std::wstring> const& groups, std::vector<ToastHistoryEntry> const& toasts, ToastHistoryBatchResults const& results)
 {
-	if (_win32Aumid.empty())
+	// Toasts in a group that was removed whole went with the group
+	std::unordered_set<std::wstring> removedGroups;
+	for (size_t i = 0; i < groups.size(); i++)
 	{
-		return _history.GetHistory();
+		if (ToastSucceeded(results.Groups[i]) && removedGroups.insert(groups[i]).second)
+		{
+			historyIndex.OnGroupRemoved(groups[i]);
+		}
 	}
-	else
+	for (size_t i = 0; i < toasts.size(); i++)
 	{
-		return _history.GetHistory(_win32Aumid);
+		if (ToastSucceeded(results.Toasts[i]) && removedGroups.count(toasts[i].Group) == 0)
+		{
+			historyIndex.OnRemoved(toasts[i].Tag, toasts[i].Group);
+		}
 	}
 }
 
-void DesktopNotificationHistoryCompat::Remove(std::wstring tag)
+ToastHistoryBatchResults DesktopNotificationHistoryCompat::RemoveMany(std::vector<ToastHistoryEntry> const& toasts, std::vector<std::wstring> const& groups, ToastHistoryBatchOptions options)
 {
-	if (_win32Aumid.empty())
-	{
-		_history.Remove(tag);
-	}
-	else
-	{
-		_history.Remove(tag, L"", _win32Aumid);
-	}
+	PrepareBatchWorkers(options);
+
+	ToastHistoryBatchResults results;
+	RemoveManyFromHistory(_manager->Platform(), _manager->Aumid(), toasts, groups, options, results);
+	ForgetRemoved(_manager->HistoryIndex(), groups, toasts, results);
+	return results;
 }
 
-void DesktopNotificationHistoryCompat::Remove(std::wstring tag, std::wstring group)
+ToastHistoryBatchResults DesktopNotificationHistoryCompat::RemoveWhere(std::function<bool(ToastHistoryEntry const&)> const& predicate, std::vector<ToastHistoryEntry>& removed, ToastHistoryBatchOptions options)
 {
-	if (_win32Aumid.empty())
-	{
-		_history.Remove(tag, group);
-	}
-	else
+	PrepareBatchWorkers(options);
+
+	ToastHistoryBatchResults results;
+	std::vector<std::wstring> groups;
+	ToastResult result = RemoveFromHistoryWhere(_manager->Platform(), _manager->Aumid(), predicate, options, removed, groups, results);
+	if (removed.empty())
 	{
-		_history.Remove(tag, group, _win32Aumid);
+		// Nothing was matched, so any failure came from reading the history
+		check_hresult(result);
 	}
+
+	ForgetRemoved(_manager->HistoryIndex(), groups, removed, results);
+	return results;
 }
 
-void DesktopNotificationHistoryCompat::RemoveGroup(std::wstring group)
+bool DesktopNotificationHistoryCompat::Contains(std::wstring tag, std::wstring group)
 {
-	if (_win32Aumid.empty())
-	{
-		_history.RemoveGroup(group);
-	}
-	else
-	{
-		_history.RemoveGroup(group, _win32Aumid);
-	}
+	return _manager->HistoryIndex().Contains(tag, group);
+}
+
+std::vector<ToastHistoryEntry> DesktopNotificationHistoryCompat::GetGroup(std::wstring group)
+{
+	return _manager->HistoryIndex().GetGroup(group);
+}
+
+std::vector<ToastHistoryEntry> DesktopNotificationHistoryCompat::FindByArgument(std::wstring key, std::wstring value)
+{
+	return _manager->HistoryIndex().FindByArgument(key, value);
+}
+
+ToastHistoryReconcileResult DesktopNotificationHistoryCompat::Reconcile()
+{
+	ToastHistoryReconcileResult result;
+	check_hresult(_manager->ReconcileHistory(result));
+
+	return result;
 }
\ No newline at end of file
@@ -11,9 +11,27 @@
 // ******************************************************************
 
 #pragma once
+#include <filesystem>
 #include <functional>
 #include <winrt/Windows.UI.Notifications.h>
 #include <winrt/Windows.Foundation.Collections.h>
+#include "ActivationEventArgs.h"
+#include "ActivationExecutor.h"
+#include "ActivationJournal.h"
+#include "ActivationStartup.h"
+#include "DesktopNotificationManager.h"
+#include "INotificationPlatform.h"
+#include "ToastHistoryBatch.h"
+#include "ToastHistoryIndex.h"
+#include "ToastImageCache.h"
+#include "ToastMetrics.h"
+#include "ToastPayload.h"
+#include "ToastPayloadMinifier.h"
+#include "ToastProgress.h"
+#include "ToastRateLimiter.h"
+#include "ToastScheduleJournal.h"
+#include "ToastScheduler.h"
+#include "ToastTrace.h"
 #define TOAST_ACTIVATED_LAUNCH_ARG "-ToastActivated"
 
 class DesktopNotificationManagerCompat;
@@ -23,35 +41,132 @@ class DesktopNotificationHistoryCompat;
 class DesktopNotificationManagerCompat
 {
 public:
+	// Creates the default instance and registers it. Calling it again with the same AUMID writes the registration again;
+	// with another it throws E_ILLEGAL_METHOD_CALL, since the default instance is never replaced under threads using it.
 	static void Register(std::wstring aumid, std::wstring displayName, std::wstring iconPath);
+
+	// Registers another identity alongside the default one, with its own activator, notifier and history caches,
+	// activation handler and metrics, so several identities can send from separate threads without sharing locks.
+	// Activations for it go to its own OnActivated handler. Its activator is revoked when the last reference is released.
+	static std::shared_ptr<DesktopNotificationManager> CreateManager(std::wstring aumid, std::wstring displayName, std::wstring iconPath);
+
+	// The instance the rest of this API is a facade over; the package identity's for apps that have one.
+	static DesktopNotificationManager& Default();
+
+	// For a process COM started to handle a toast activation. Skips writing the registration, which COM started the
+	// process through, so call this instead of Register, then set OnActivated and call WaitForActivations.
+	static void RegisterForActivation(std::wstring aumid);
+
+	// Registers the activator and waits for activations until the timeout, or until none has come for the idle timeout,
+	// then revokes it and waits for the ones still being handled, for up to the handler timeout. Returns how long each
+	// phase of the start took. If a handler calls KeepRunning it returns at once instead, with the activator still registered.
+	static ActivationStartupTimings WaitForActivations(ActivationStartupOptions options = {});
+
+	// Called by an activation handler that opens a window, so the process carries on as a normal start.
+	static void KeepRunning();
+
 	static void OnActivated(std::function<void(DesktopNotificationActivatedEventArgsCompat)> callback);
 
+	// Writes each activation to a journal at path before the OnActivated callback runs, and marks it done once the callback
+	// returns, then hands the callback again the activations the last run didn't finish because the process died. Call
+	// after OnActivated. The callback is one of several subscribers to Activations(), so one that throws is counted as a
+	// failure in Metrics and not retried, which would run the other subscribers again. Replays happen at least once, so
+	// handle repeats gracefully.
+	static void UseActivationJournal(std::filesystem::path path, ActivationJournalOptions options = {});
+
+	// Every activation is published here too, so other parts of the app can subscribe alongside OnActivated, to all
+	// activations or to one action. Handlers can come and go while activations are being delivered.
+	static ActivationBus& Activations();
+
+	// Opt in to running the OnActivated callback on worker threads, so the COM call that delivers an activation returns
+	// immediately. Activations whose arguments have the same value for orderingArgument, a key your toasts put in their
+	// launch arguments such as L"conversationId", are handled one at a time, in order. Those without it, or every
+	// activation if it's empty, are handled in parallel.
+	static void UseActivationExecutor(ActivationExecutorOptions options, std::wstring orderingArgument);
+
 	static winrt::Windows::UI::Notifications::ToastNotifier CreateToastNotifier();
+
+	// Shows the toast, stamped with traceId if tracing is on. Pass the correlation ID of the span the toast was built in,
+	// or leave it 0 to start a new one. As a ToastDispatcher sender, wrap it as
+	// [](ToastPayload const& payload) { Show(payload); return ToastResultOk; }, so that a throw counts as a failed send.
+	static void Show(ToastPayload const& payload, std::uint64_t traceId = 0);
+
+	// Opt in to progress toasts through the notifier CreateToastNotifier returns. ShowProgress shows a toast once with its
+	// placeholders bound to payload.Data; after that Progress().Report sends only the values that changed, by tag and group,
+	// at most options.MaxUpdatesPerSecond times a second per toast.
+	static void UseProgress(ToastProgressOptions options = {});
+
+	// Throws E_INVALIDARG if the payload has no tag, since that's how its updates find it.
+	static void ShowProgress(ToastPayload const& payload);
+	static ToastProgress& Progress();
+
+	// Opt in to rate-limiting Show per toast group. A toast over its group's limit is held back, replacing a held toast
+	// with the same tag and group, and shown from a background thread once the group has tokens again; Show throws
+	// HRESULT_FROM_WIN32(ERROR_BUSY) for a toast dropped for lack of room to hold it.
+	static void UseRateLimiter(ToastRateLimiterOptions options = {});
+
+	// Opt in to minifying every payload passed to Show and checking it against the budget before it reaches the platform.
+	// A payload over a failing budget throws E_BOUNDS from Show; budget.OverBudget is told which elements are the largest.
+	static void UsePayloadBudget(ToastPayloadBudget budget = {});
+
+	// Opt in to keeping local copies of toast images in directory, scaled to the size they're shown at. Show points http,
+	// https and oversized local images at their copies, so they appear even though unpackaged apps can't use http images.
+	// Copies in toasts that are still in the history index aren't evicted; Uninstall deletes the copies and nothing else.
+	// Call it after Register, since it checks the default manager's history index.
+	static void UseImageCache(std::filesystem::path directory, ToastImageCacheOptions options = {});
+
+	// Gets a file:/// URI for the local copy of an image, or source itself if it can't be fetched or isn't an image.
+	static std::wstring LocalImage(std::wstring const& source, ToastImagePlacement placement = ToastImagePlacement::Inline);
+	static INotificationPlatform& Platform();
+
+	// Opt in to tracing each toast from Show to its activation. Spans are recorded for the show and the activation,
+	// and for builds the app wraps in a ToastTraceScope on Tracer(); export them with Tracer()->WriteChromeTrace.
+	// Call it once; the tracer is never replaced, so a second call throws hresult_illegal_method_call.
+	static void UseTracing(ToastTracerOptions options = {});
+
+	// Null until UseTracing is called, so a ToastTraceScope on it does nothing.
+	static ToastTracer* Tracer();
+
+	// Counts and times the default instance's sends and activations, and counts failures by HRESULT. Always on once
+	// registered; Snapshot() can be taken at any time.
+	static ToastMetrics& Metrics();
 	static DesktopNotificationHistoryCompat History();
 
+	// Opt in to keeping scheduled toasts in the app rather than the platform's schedule. Toasts are handed to the
+	// platform once they're within options.PlatformWindow of their delivery time, and held in a timer wheel until then.
+	static void UseScheduler(ToastSchedulerOptions options = {});
+
+	// Like UseScheduler, but also keeps the schedule in a journal file so it survives the app exiting. Toasts that were
+	// pending when the app last exited are restored from the journal, and handed to the platform again as they come due.
+	static void UseScheduler(std::filesystem::path journalPath, ToastSchedulerOptions options = {}, ToastScheduleJournalOptions journalOptions = {});
+	static ToastScheduler& Scheduler();
+
 	static void Uninstall();
 };
 
+// A view of the activation's args, which the OnActivated callback shares with the other subscribers rather than copying.
+// It and the views Argument() and UserInput(key) return are only valid until the callback returns; call Clone() for a
+// copy that outlives it, for instance to hand the activation to another thread.
 class DesktopNotificationActivatedEventArgsCompat
 {
-	std::wstring _argument;
-	winrt::Windows::Foundation::Collections::StringMap _userInput;
+	ActivationEventArgs const& _args;
 
 public:
-	std::wstring Argument() { return _argument; }
-	winrt::Windows::Foundation::Collections::StringMap UserInput() { return _userInput; }
+	explicit DesktopNotificationActivatedEventArgsCompat(ActivationEventArgs const& args) : _args(args) {}
 
-	DesktopNotificationActivatedEventArgsCompat(std::wstring argument, winrt::Windows::Foundation::Collections::StringMap userInput)
-	{
-		_argument = argument;
-		_userInput = userInput;
-	}
+	std::wstring_view Argument() const { return _args.Argument(); }
+	std::wstring_view UserInput(std::wstring_view key) const { return _args.UserInput(key); }
+	bool TryGetUserInput(std::wstring_view key, std::wstring_view& value) const { return _args.TryGetUserInput(key, value); }
+	std::size_t UserInputCount() const { return _args.UserInputCount(); }
+	ActivationUserInput UserInputAt(std::size_t index) const { return _args.UserInputAt(index); }
+
+	ActivationEventArgs const& Args() const { return _args; }
+	ActivationEventArgs Clone() const { return _args.Clone(); }
 };
 
 class DesktopNotificationHistoryCompat
 {
-	std::wstring _win32Aumid;
-	winrt::Windows::UI::Notifications::ToastNotificationHistory _history = nullptr;
+	DesktopNotificationManager* _manager;
 
 public:
 	void Clear();
@@ -60,9 +175,20 @@ public:
 	void Remove(std::wstring tag, std::wstring group);
 	void RemoveGroup(std::wstring group);
 
-	DesktopNotificationHistoryCompat(std::wstring win32Aumid)
+	// Remove many toasts and groups at once, deduplicated and batched over a few worker threads. These don't throw
+	// when a removal fails; check the result for each toast and group instead.
+	ToastHistoryBatchResults RemoveMany(std::vector<ToastHistoryEntry> const& toasts, std::vector<std::wstring> const& groups = {}, ToastHistoryBatchOptions options = {});
+	ToastHistoryBatchResults RemoveWhere(std::function<bool(ToastHistoryEntry const&)> const& predicate, std::vector<ToastHistoryEntry>& removed, ToastHistoryBatchOptions options = {});
+
+	// Answered from a local index of the toasts this app has shown, without asking the platform. Call Reconcile
+	// to pick up toasts the user has dismissed and scheduled toasts that have been delivered since.
+	bool Contains(std::wstring tag, std::wstring group);
+	std::vector<ToastHistoryEntry> GetGroup(std::wstring group);
+	std::vector<ToastHistoryEntry> FindByArgument(std::wstring key, std::wstring value);
+	ToastHistoryReconcileResult Reconcile();
+
+	DesktopNotificationHistoryCompat(DesktopNotificationManager& manager)
 	{
-		_win32Aumid = win32Aumid;
-		_history = winrt::Windows::UI::Notifications::ToastNotificationManager::History();
+		_manager = &manager;
 	}
 };
\ No newline at end of file
@@ -0,0 +1,452 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "pch.h"
+#include "WinRtNotificationPlatform.h"
+
+#include <winrt/Windows.ApplicationModel.h>
+#include <winrt/Windows.Data.Xml.Dom.h>
+#include <winrt/Windows.Foundation.Collections.h>
+#include <winrt/Windows.Storage.h>
+#include <Windows.h>
+#include <appmodel.h>
+
+using namespace winrt;
+using namespace Windows::ApplicationModel;
+using namespace Windows::Data::Xml::Dom;
+using namespace Windows::UI::Notifications;
+
+namespace
+{
+	// Runs a platform call, turning whatever it throws into an HRESULT
+	template <typename TCall>
+	ToastResult Invoke(TCall&& call)
+	{
+		try
+		{
+			call();
+			return ToastResultOk;
+		}
+		catch (...)
+		{
+			return to_hresult();
+		}
+	}
+
+	void RemoveOne(ToastNotificationHistory const& history, hstring const& aumid, std::wstring const& tag, std::wstring const& group)
+	{
+		if (!aumid.empty())
+		{
+			history.Remove(tag, group, aumid);
+		}
+		else if (group.empty())
+		{
+			history.Remove(tag);
+		}
+		else
+		{
+			history.Remove(tag, group);
+		}
+	}
+
+	XmlDocument LoadPayload(ToastPayload const& payload)
+	{
+		XmlDocument doc;
+		doc.LoadXml(payload.Xml);
+		return doc;
+	}
+
+	NotificationData ToNotificationData(ToastData const& data)
+	{
+		NotificationData notificationData;
+		for (ToastDataValue const& value : data.Values)
+		{
+			notificationData.Values().Insert(value.Key, value.Value);
+		}
+		notificationData.SequenceNumber(data.SequenceNumber);
+		return notificationData;
+	}
+}
+
+ToastNotifier WinRtNotificationPlatform::GetNotifier(std::wstring const& aumid)
+{
+	return _notifierCache.GetOrCreate(aumid, [&aumid]
+	{
+		return aumid.empty() ? ToastNotificationManager::CreateToastNotifier() : ToastNotificationManager::CreateToastNotifier(aumid);
+	});
+}
+
+ToastNotificationHistory WinRtNotificationPlatform::GetNativeHistory(std::wstring const& aumid)
+{
+	return _historyCache.GetOrCreate(aumid, [] { return ToastNotificationManager::History(); });
+}
+
+void WinRtNotificationPlatform::ClearCaches()
+{
+	_notifierCache.Clear();
+	_historyCache.Clear();
+}
+
+ToastResult WinRtNotificationPlatform::Show(std::wstring const& aumid, ToastPayload const& payload)
+{
+	return Invoke([&]
+	{
+		ToastNotification notif{ LoadPayload(payload) };
+		if (!payload.Tag.empty())
+		{
+			notif.Tag(payload.Tag);
+		}
+		if (!payload.Group.empty())
+		{
+			notif.Group(payload.Group);
+		}
+		if (!payload.Data.Values.empty())
+		{
+			notif.Data(ToNotificationData(payload.Data));
+		}
+
+		GetNotifier(aumid).Show(notif);
+	});
+}
+
+ToastResult WinRtNotificationPlatform::Update(std::wstring const& aumid, std::wstring const& tag, std::wstring const& group, ToastData const& data)
+{
+	NotificationUpdateResult updateResult = NotificationUpdateResult::Succeeded;
+	ToastResult result = Invoke([&]
+	{
+		ToastNotifier notifier = GetNotifier(aumid);
+		updateResult = group.empty() ? notifier.Update(ToNotificationData(data), tag) : notifier.Update(ToNotificationData(data), tag, group);
+	});
+
+	if (!ToastSucceeded(result))
+	{
+		return result;
+	}
+
+	switch (updateResult)
+	{
+	case NotificationUpdateResult::NotificationNotFound:
+		return ToastResultNotFound;
+	case NotificationUpdateResult::Failed:
+		return ToastResultFail;
+	default:
+		return ToastResultOk;
+	}
+}
+
+ToastResult WinRtNotificationPlatform::GetHistory(std::wstring const& aumid, std::vector<ToastHistoryEntry>& entries)
+{
+	return Invoke([&]
+	{
+		ToastNotificationHistory history = GetNativeHistory(aumid);
+		auto toasts = aumid.empty() ? history.GetHistory() : history.GetHistory(aumid);
+
+		entries.clear();
+		entries.reserve(toasts.Size());
+		for (ToastNotification const& toast : toasts)
+		{
+			entries.push_back(ToastHistoryEntry{
+				std::wstring(toast.Tag()),
+				std::wstring(toast.Group()),
+				std::wstring(toast.Content().DocumentElement().GetAttribute(L"launch")) });
+		}
+	});
+}
+
+ToastResult WinRtNotificationPlatform::RemoveFromHistory(std::wstring const& aumid, std::wstring const& tag, std::wstring const& group)
+{
+	return Invoke([&]
+	{
+		RemoveOne(GetNativeHistory(aumid), hstring(aumid), tag, group);
+	});
+}
+
+void WinRtNotificationPlatform::RemoveBatchFromHistory(std::wstring const& aumid, std::vector<ToastHistoryEntry> const& toasts, std::vector<ToastResult>& results)
+{
+	// ToastNotificationHistory removes one toast per call, so the batch saves the history lookup and the AUMID
+	// string that each RemoveFromHistory call would otherwise repeat
+	results.clear();
+	ToastNotificationHistory history{ nullptr };
+	hstring id;
+	ToastResult lookup = Invoke([&]
+	{
+		history = GetNativeHistory(aumid);
+		id = aumid;
+	});
+	if (!ToastSucceeded(lookup))
+	{
+		results.assign(toasts.size(), lookup);
+		return;
+	}
+
+	results.reserve(toasts.size());
+	for (ToastHistoryEntry const& toast : toasts)
+	{
+		results.push_back(Invoke([&] { RemoveOne(history, id, toast.Tag, toast.Group); }));
+	}
+}
+
+ToastResult WinRtNotificationPlatform::RemoveGroupFromHistory(std::wstring const& aumid, std::wstring const& group)
+{
+	return Invoke([&]
+	{
+		ToastNotificationHistory history = GetNativeHistory(aumid);
+		if (aumid.empty())
+		{
+			history.RemoveGroup(group);
+		}
+		else
+		{
+			history.RemoveGroup(group, aumid);
+		}
+	});
+}
+
+ToastResult WinRtNotificationPlatform::ClearHistory(std::wstring const& aumid)
+{
+	return Invoke([&]
+	{
+		ToastNotificationHistory history = GetNativeHistory(aumid);
+		if (aumid.empty())
+		{
+			history.Clear();
+		}
+		else
+		{
+			history.Clear(aumid);
+		}
+	});
+}
+
+ToastResult WinRtNotificationPlatform::AddToSchedule(std::wstring const& aumid, ScheduledToast const& toast)
+{
+	return Invoke([&]
+	{
+		ScheduledToastNotification scheduled{ LoadPayload(toast.Payload), clock::from_sys(toast.DeliveryTime) };
+		if (!toast.Id.empty())
+		{
+			scheduled.Id(toast.Id);
+		}
+		if (!toast.Payload.Tag.empty())
+		{
+			scheduled.Tag(toast.Payload.Tag);
+		}
+		if (!toast.Payload.Group.empty())
+		{
+			scheduled.Group(toast.Payload.Group);
+		}
+
+		GetNotifier(aumid).AddToSchedule(scheduled);
+	});
+}
+
+ToastResult WinRtNotificationPlatform::GetScheduled(std::wstring const& aumid, std::vector<ScheduledToast>& toasts)
+{
+	return Invoke([&]
+	{
+		auto scheduled = GetNotifier(aumid).GetScheduledToastNotifications();
+
+		toasts.clear();
+		toasts.reserve(scheduled.Size());
+		for (ScheduledToastNotification const& toast : scheduled)
+		{
+			ToastPayload payload{ std::wstring(toast.Content().GetXml()), std::wstring(toast.Tag()), std::wstring(toast.Group()) };
+			toasts.push_back(ScheduledToast{ std::wstring(toast.Id()), std::move(payload), clock::to_sys(toast.DeliveryTime()) });
+		}
+	});
+}
+
+ToastResult WinRtNotificationPlatform::RemoveFromSchedule(std::wstring const& aumid, std::wstring const& id)
+{
+	bool found = false;
+	ToastResult result = Invoke([&]
+	{
+		ToastNotifier notifier = GetNotifier(aumid);
+		for (ScheduledToastNotification const& toast : notifier.GetScheduledToastNotifications())
+		{
+			if (toast.Id() == id)
+			{
+				notifier.RemoveFromSchedule(toast);
+				found = true;
+			}
+		}
+	});
+
+	return ToastSucceeded(result) && !found ? ToastResultNotFound : result;
+}
+
+ToastResult WinRtNotificationPlatform::ClearSchedule(std::wstring const& aumid)
+{
+	ToastResult firstFailure = ToastResultOk;
+	ToastResult result = Invoke([&]
+	{
+		ToastNotifier notifier = GetNotifier(aumid);
+		for (ScheduledToastNotification const& toast : notifier.GetScheduledToastNotifications())
+		{
+			// Keep going past toasts that can't be removed
+			ToastResult removed = Invoke([&] { notifier.RemoveFromSchedule(toast); });
+			if (!ToastSucceeded(removed) && ToastSucceeded(firstFailure))
+			{
+				firstFailure = removed;
+			}
+		}
+	});
+
+	return ToastSucceeded(result) ? firstFailure : result;
+}
+
+ToastResult WinRtNotificationPlatform::ReadRegistryValue(std::wstring const& subKey, std::wstring const& valueName, std::wstring& value)
+{
+	LPCWSTR name = valueName.empty() ? nullptr : valueName.c_str();
+
+	DWORD size = 0;
+	LSTATUS status = ::RegGetValueW(HKEY_CURRENT_USER, subKey.c_str(), name, RRF_RT_REG_SZ, nullptr, nullptr, &size);
+	while (status == ERROR_SUCCESS || status == ERROR_MORE_DATA)
+	{
+		std::wstring buffer(size / sizeof(wchar_t), L'\0');
+		status = ::RegGetValueW(HKEY_CURRENT_USER, subKey.c_str(), name, RRF_RT_REG_SZ, nullptr, buffer.data(), &size);
+		if (status == ERROR_SUCCESS)
+		{
+			// The size includes the terminating null
+			buffer.resize(size / sizeof(wchar_t) > 0 ? size / sizeof(wchar_t) - 1 : 0);
+			value = std::move(buffer);
+			return ToastResultOk;
+		}
+	}
+
+	return HRESULT_FROM_WIN32(status);
+}
+
+ToastResult WinRtNotificationPlatform::WriteRegistryValues(std::wstring const& subKey, std::vector<RegistryValue> const& values)
+{
+	HKEY key;
+	LSTATUS status = ::RegCreateKeyExW(HKEY_CURRENT_USER, subKey.c_str(), 0, nullptr, REG_OPTION_NON_VOLATILE, KEY_SET_VALUE, nullptr, &key, nullptr);
+	if (status != ERROR_SUCCESS)
+	{
+		return HRESULT_FROM_WIN32(status);
+	}
+
+	for (RegistryValue const& value : values)
+	{
+		status = ::RegSetValueExW(
+			key,
+			value.Name.empty() ? nullptr : value.Name.c_str(),
+			0,
+			REG_SZ,
+			reinterpret_cast<const BYTE*>(value.Value.c_str()),
+			static_cast<DWORD>((value.Value.length() + 1) * sizeof(WCHAR)));
+		if (status != ERROR_SUCCESS)
+		{
+			break;
+		}
+	}
+
+	::RegCloseKey(key);
+	return HRESULT_FROM_WIN32(status);
+}
+
+ToastResult WinRtNotificationPlatform::DeleteRegistryValue(std::wstring const& subKey, std::wstring const& valueName)
+{
+	return HRESULT_FROM_WIN32(::RegDeleteKeyValueW(HKEY_CURRENT_USER, subKey.c_str(), valueName.c_str()));
+}
+
+ToastResult WinRtNotificationPlatform::DeleteRegistryValues(std::wstring const& subKey, std::vector<std::wstring> const& valueNames)
+{
+	HKEY key;
+	LSTATUS status = ::RegOpenKeyExW(HKEY_CURRENT_USER, subKey.c_str(), 0, KEY_SET_VALUE, &key);
+	if (status == ERROR_FILE_NOT_FOUND)
+	{
+		return ToastResultOk;
+	}
+	if (status != ERROR_SUCCESS)
+	{
+		return HRESULT_FROM_WIN32(status);
+	}
+
+	for (std::wstring const& valueName : valueNames)
+	{
+		status = ::RegDeleteValueW(key, valueName.empty() ? nullptr : valueName.c_str());
+		if (status == ERROR_FILE_NOT_FOUND)
+		{
+			status = ERROR_SUCCESS;
+		}
+		else if (status != ERROR_SUCCESS)
+		{
+			break;
+		}
+	}
+
+	::RegCloseKey(key);
+	return HRESULT_FROM_WIN32(status);
+}
+
+ToastResult WinRtNotificationPlatform::DeleteRegistryKey(std::wstring const& subKey)
+{
+	return HRESULT_FROM_WIN32(::RegDeleteKeyW(HKEY_CURRENT_USER, subKey.c_str()));
+}
+
+ToastResult WinRtNotificationPlatform::GetPackageFamilyName(std::wstring& familyName)
+{
+	// https://stackoverflow.com/questions/39609643/determine-if-c-application-is-running-as-a-uwp-app-in-desktop-bridge-project
+	UINT32 length = 0;
+	LONG result = ::GetPackageFamilyName(GetCurrentProcess(), &length, nullptr);
+	if (result == APPMODEL_ERROR_NO_PACKAGE)
+	{
+		return ToastResultNotFound;
+	}
+	if (result != ERROR_INSUFFICIENT_BUFFER)
+	{
+		return HRESULT_FROM_WIN32(result);
+	}
+
+	std::wstring name(length, L'\0');
+	result = ::GetPackageFamilyName(GetCurrentProcess(), &length, name.data());
+	if (result != ERROR_SUCCESS)
+	{
+		return HRESULT_FROM_WIN32(result);
+	}
+
+	// The length includes the terminating null
+	name.resize(length > 0 ? length - 1 : 0);
+	familyName = std::move(name);
+	return ToastResultOk;
+}
+
+ToastResult WinRtNotificationPlatform::GetPackageInstalledLocation(std::wstring& path)
+{
+	return Invoke([&]
+	{
+		path = Package::Current().InstalledLocation().Path();
+	});
+}
+
+ToastResult WinRtNotificationPlatform::GetModulePath(std::wstring& path)
+{
+	std::wstring buffer(MAX_PATH, L'?');
+	while (true)
+	{
+		DWORD actual_size = ::GetModuleFileName(nullptr, buffer.data(), static_cast<DWORD>(buffer.size()));
+		if (actual_size == 0)
+		{
+			return HRESULT_FROM_WIN32(::GetLastError());
+		}
+
+		if (actual_size < buffer.size())
+		{
+			buffer.resize(actual_size);
+			path = std::move(buffer);
+			return ToastResultOk;
+		}
+
+		buffer.resize(buffer.size() * 2, L'?');
+	}
+}
@@ -0,0 +1,57 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <winrt/Windows.UI.Notifications.h>
+#include "INotificationPlatform.h"
+#include "ToastObjectCache.h"
+
+// INotificationPlatform on top of ToastNotificationManager and the Win32 registry and package APIs.
+// Platform exceptions are caught and returned as their HRESULT.
+class WinRtNotificationPlatform : public INotificationPlatform
+{
+public:
+	// Notifier and history objects are cached per AUMID (empty for apps with identity) so each call
+	// doesn't go back to ToastNotificationManager
+	winrt::Windows::UI::Notifications::ToastNotifier GetNotifier(std::wstring const& aumid);
+	winrt::Windows::UI::Notifications::ToastNotificationHistory GetNativeHistory(std::wstring const& aumid);
+
+	ToastResult Show(std::wstring const& aumid, ToastPayload const& payload) override;
+	ToastResult Update(std::wstring const& aumid, std::wstring const& tag, std::wstring const& group, ToastData const& data) override;
+
+	ToastResult GetHistory(std::wstring const& aumid, std::vector<ToastHistoryEntry>& entries) override;
+	ToastResult RemoveFromHistory(std::wstring const& aumid, std::wstring const& tag, std::wstring const& group) override;
+	ToastResult RemoveGroupFromHistory(std::wstring const& aumid, std::wstring const& group) override;
+	void RemoveBatchFromHistory(std::wstring const& aumid, std::vector<ToastHistoryEntry> const& toasts, std::vector<ToastResult>& results) override;
+	ToastResult ClearHistory(std::wstring const& aumid) override;
+
+	ToastResult AddToSchedule(std::wstring const& aumid, ScheduledToast const& toast) override;
+	ToastResult GetScheduled(std::wstring const& aumid, std::vector<ScheduledToast>& toasts) override;
+	ToastResult RemoveFromSchedule(std::wstring const& aumid, std::wstring const& id) override;
+	ToastResult ClearSchedule(std::wstring const& aumid) override;
+
+	ToastResult ReadRegistryValue(std::wstring const& subKey, std::wstring const& valueName, std::wstring& value) override;
+	ToastResult WriteRegistryValues(std::wstring const& subKey, std::vector<RegistryValue> const& values) override;
+	ToastResult DeleteRegistryValue(std::wstring const& subKey, std::wstring const& valueName) override;
+	ToastResult DeleteRegistryValues(std::wstring const& subKey, std::vector<std::wstring> const& valueNames) override;
+	ToastResult DeleteRegistryKey(std::wstring const& subKey) override;
+
+	ToastResult GetPackageFamilyName(std::wstring& familyName) override;
+	ToastResult GetPackageInstalledLocation(std::wstring& path) override;
+	ToastResult GetModulePath(std::wstring& path) override;
+
+	void ClearCaches() override;
+
+private:
+	ToastObjectCache<winrt::Windows::UI::Notifications::ToastNotifier> _notifierCache;
+	ToastObjectCache<winrt::Windows::UI::Notifications::ToastNotificationHistory> _historyCache;
+};
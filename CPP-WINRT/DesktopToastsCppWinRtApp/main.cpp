@@ -2,7 +2,12 @@
 #include "pch.h"
 #include <iostream>
 #include "DesktopNotificationManagerCompat.h";
+#include "ToastPayloadMinifier.h"
+#include "ToastTemplate.h"
+#include "ToastArguments.h"
+#include "ToastActionRouter.h"
 #include <functional>
+#include <future>
 #include <winrt/Windows.Data.Xml.Dom.h>
 #include <winrt/Windows.UI.Notifications.h>
 #include <conio.h>
@@ -13,87 +18,139 @@ using namespace Windows::UI::Notifications;
 
 bool _hasStarted;
 
+// The toast's images, fetched and scaled by the image cache on a background thread at startup
+const std::wstring _logoSrc = L"https://unsplash.it/64?image=1005";
+const std::wstring _imageSrc = L"https://picsum.photos/364/202?image=883";
+std::future<void> _prefetchImages;
+
+enum class ToastAction
+{
+    None,
+    Like,
+    Reply,
+    ViewConversation,
+    ViewImage
+};
+
+constexpr auto _actionRouter = MakeToastActionRouter<ToastAction>({
+    { L"like", ToastAction::Like },
+    { L"reply", ToastAction::Reply },
+    { L"viewConversation", ToastAction::ViewConversation },
+    { L"viewImage", ToastAction::ViewImage }
+});
+
 void start();
 void sendToast();
+void sendProgressToast();
+
 void showWindow();
 void sendBasicToast(std::wstring message);
 
 int main(int argc, char* argv[])
 {
-    DesktopNotificationManagerCompat::Register(L"Microsoft.SampleCppWinRtApp", L"Sample C++ WinRT App", L"C:\\MyIcon.png");
+    bool toastActivated = argc >= 2 && strcmp(argv[1], TOAST_ACTIVATED_LAUNCH_ARG) == 0;
+
+    if (toastActivated)
+    {
+        // Launched by COM for a toast, which only happens once we're registered
+        DesktopNotificationManagerCompat::RegisterForActivation(L"Microsoft.SampleCppWinRtApp");
+    }
+
+    else
+    {
+        DesktopNotificationManagerCompat::Register(L"Microsoft.SampleCppWinRtApp", L"Sample C++ WinRT App", L"C:\\MyIcon.png");
+    }
 
     DesktopNotificationManagerCompat::OnActivated([](DesktopNotificationActivatedEventArgsCompat e)
         {
-            if (e.Argument()._Starts_with(L"action=like"))
+            ToastAction action = _actionRouter.Lookup(ToastArguments(e.Argument()).Action(), ToastAction::None);
+
+            if (action == ToastAction::Like)
             {
                 sendBasicToast(L"Sent like!");
-
-                if (!_hasStarted)
-                {
-                    exit(0);
-                }
             }
 
-            else if (e.Argument()._Starts_with(L"action=reply"))    
+            else if (action == ToastAction::Reply)    
             {
-                std::wstring msg = e.UserInput().Lookup(L"tbReply").c_str();
+                std::wstring msg(e.UserInput(L"tbReply"));
 
                 sendBasicToast(L"Sent reply! Reply: " + msg);
-
-                if (!_hasStarted)
-                {
-                    exit(0);
-                }
             }
 
             else
             {
                 if (!_hasStarted)
                 {
-                    if (e.Argument()._Starts_with(L"action=viewConversation"))
+                    if (action == ToastAction::ViewConversation)
                     {
                         std::cout << "Launched from toast, opening the conversation!\n\n";
                     }
 
-                    start();
+                    // main starts the app once the wait for activations returns
+                    DesktopNotificationManagerCompat::KeepRunning();
                 }
                 else
                 {
                     showWindow();
 
-                    if (e.Argument()._Starts_with(L"action=viewConversation"))
+                    if (action == ToastAction::ViewConversation)
                     {
                         std::cout << "\n\nOpening the conversation!\n\nEnter a number to continue: ";
                     }
                     else
                     {
-                        std::wcout << L"\n\nToast activated!\n - Argument: " + e.Argument() + L"\n\nEnter a number to continue: ";
+                        std::wcout << L"\n\nToast activated!\n - Argument: " + std::wstring(e.Argument()) + L"\n\nEnter a number to continue: ";
                     }
                 }
             }
         });
 
-    if (argc >= 2 && strcmp(argv[1], TOAST_ACTIVATED_LAUNCH_ARG) == 0)
-    {
-        // Was launched from a toast, OnActivated will be called and we'll decide whether to start the app or exit
-        std::cin.ignore();   
-    }
+    // A like or reply the last run didn't finish sending is sent now
+    DesktopNotificationManagerCompat::UseActivationJournal(std::filesystem::temp_directory_path() / L"SampleCppWinRtApp" / L"activations.journal");
 
-    else
+    if (toastActivated)
     {
-        start();
+        // Was launched from a toast, OnActivated will be called and decides whether to start the app. Otherwise this
+        // returns once the activations have been handled, and the app exits
+        ActivationStartupTimings timings = DesktopNotificationManagerCompat::WaitForActivations();
+        if (!timings.KeptRunning)
+        {
+            return 0;
+        }
     }
+
+    start();
 }
 
 void start()
 {
     _hasStarted = true;
 
+    // The image cache, tracing and progress are set up here rather than in main, so a start that only handles a like
+    // or a reply doesn't pay for them. Unpackaged apps can't use http images, so toasts show local copies instead
+    DesktopNotificationManagerCompat::UseImageCache(std::filesystem::temp_directory_path() / L"SampleCppWinRtApp" / L"Images");
+
+    // Trace each toast from sendToast() to its activation; the trace is written out when the app exits
+    DesktopNotificationManagerCompat::UseTracing();
+
+    // Progress toasts are updated in place, a few times a second however often the job reports
+    DesktopNotificationManagerCompat::UseProgress();
+
+    // The images are downloaded and scaled now rather than when a toast is sent, so Show finds them in the cache
+    _prefetchImages = std::async(std::launch::async, []
+        {
+            // The fetcher and the scaler are COM objects
+            CoInitializeEx(NULL, COINIT_MULTITHREADED);
+            DesktopNotificationManagerCompat::LocalImage(_logoSrc, ToastImagePlacement::AppLogo);
+            DesktopNotificationManagerCompat::LocalImage(_imageSrc);
+            CoUninitialize();
+        });
+
     std::cout << "Welcome!";
 
     while (true)
     {
-        std::cout << "\n\nHere are your options...\n\n - 1. Send a toast\n - 2. Clear all toasts\n - 3. Uninstall and quit\n - 4. Exit\n\nEnter a number to continue: ";
+        std::cout << "\n\nHere are your options...\n\n - 1. Send a toast\n - 2. Send a progress toast\n - 3. Clear all toasts\n - 4. Uninstall and quit\n - 5. Exit\n\nEnter a number to continue: ";
 
         bool exit = false;
 
@@ -103,13 +160,17 @@ void start()
             sendToast();
             break;
         case '2':
-            DesktopNotificationManagerCompat::History().Clear();
+            sendProgressToast();
             break;
         case '3':
+            DesktopNotificationManagerCompat::History().Clear();
+            break;
+        case '4':
+            _prefetchImages.wait();
             DesktopNotificationManagerCompat::Uninstall();
             exit = true;
             break;
-        case '4':
+        case '5':
             exit = true;
             break;
         default:
@@ -122,57 +183,115 @@ void start()
             break;
         }
     }
+
+    // The cache mustn't go away under the prefetch
+    _prefetchImages.wait();
+
+    // Open this in chrome://tracing or Perfetto to see where the time went between each send and its activation
+    DesktopNotificationManagerCompat::Tracer()->WriteChromeTrace(std::filesystem::temp_directory_path() / L"SampleCppWinRtApp" / L"trace.json");
 }
 
 void sendToast()
 {
     std::cout << "\n\nSending a toast... ";
 
-    // Construct the toast template
-    XmlDocument doc;
-    doc.LoadXml(L"<toast>\
-    <visual>\
-        <binding template=\"ToastGeneric\">\
-            <text></text>\
-            <text></text>\
-            <image placement=\"appLogoOverride\" hint-crop=\"circle\"/>\
-            <image/>\
-        </binding>\
-    </visual>\
-    <actions>\
-        <input\
-            id=\"tbReply\"\
-            type=\"text\"\
-            placeHolderContent=\"Type a reply\"/>\
-        <action\
-            content=\"Reply\"\
-            activationType=\"background\"/>\
-        <action\
-            content=\"Like\"\
-            activationType=\"background\"/>\
-        <action\
-            content=\"View\"\
-            activationType=\"background\"/>\
-    </actions>\
-</toast>");
+    // Everything up to Show is the toast's build span, and Show and the activation are traced under the same ID
+    ToastTraceScope build(DesktopNotificationManagerCompat::Tracer(), ToastTraceBuild);
+
+    // The template is parsed once; each send only splices the values into the recorded slots
+    static const ToastTemplate conversationTemplate(LR"(<toast launch="action=viewConversation&amp;conversationId={conversationId}">
+    <visual>
+        <binding template="ToastGeneric">
+            <text>{title}</text>
+            <text>{body}</text>
+            <image placement="appLogoOverride" hint-crop="circle" src="{logoSrc}"/>
+            <image src="{imageFile}"/>
+        </binding>
+    </visual>
+    <actions>
+        <input
+            id="tbReply"
+            type="text"
+            placeHolderContent="Type a reply"/>
+        <action
+            content="Reply"
+            activationType="background"
+            arguments="action=reply&amp;conversationId={conversationId}"/>
+        <action
+            content="Like"
+            activationType="background"
+            arguments="action=like&amp;conversationId={conversationId}"/>
+        <action
+            content="View"
+            activationType="background"
+            arguments="action=viewImage&amp;imageUrl={imageSrc}"/>
+    </actions>
+</toast>)");
 
     // Populate with text and values
-    doc.DocumentElement().SetAttribute(L"launch", L"action=viewConversation&conversationId=9813");
-    doc.SelectSingleNode(L"//text[1]").InnerText(L"Andrew sent you a picture");
-    doc.SelectSingleNode(L"//text[2]").InnerText(L"Check this out, Happy Canyon in Utah!");
-    doc.SelectSingleNode(L"//image[1]").as<XmlElement>().SetAttribute(L"src", L"https://unsplash.it/64?image=1005");
-    doc.SelectSingleNode(L"//image[2]").as<XmlElement>().SetAttribute(L"src", L"https://picsum.photos/364/202?image=883");
-    doc.SelectSingleNode(L"//action[1]").as<XmlElement>().SetAttribute(L"arguments", L"action=reply&conversationId=9813");
-    doc.SelectSingleNode(L"//action[2]").as<XmlElement>().SetAttribute(L"arguments", L"action=like&conversationId=9813");
-    doc.SelectSingleNode(L"//action[3]").as<XmlElement>().SetAttribute(L"arguments", L"action=viewImage&imageUrl=https://picsum.photos/364/202?image=883");
+    ToastTemplateValues values = conversationTemplate.CreateValues();
+    values.Set(L"conversationId", L"9813");
+    values.Set(L"title", L"Andrew sent you a picture");
+    values.Set(L"body", L"Check this out, Happy Canyon in Utah!");
+    values.Set(L"logoSrc", _logoSrc);
+    values.Set(L"imageSrc", _imageSrc);
+    values.Set(L"imageFile", _imageSrc);
+
+    // The indentation is stripped and the size checked before the platform sees it, so an oversize toast fails here
+    static const ToastPayloadMinifier minifier;
+    std::wstring xml;
+    check_hresult(minifier.Minify(conversationTemplate.Render(values), xml));
+    build.End();
+
+    // And send it! The compat stamps it with the build's correlation ID, which comes back when it's activated, and
+    // points the images at the copies prefetched at startup
+    DesktopNotificationManagerCompat::Show(ToastPayload{ xml }, build.CorrelationId());
 
-    // Construct the notification
-    ToastNotification notif{ doc };
+    std::cout << "Sent!\n";
+}
 
-    // And send it!
-    DesktopNotificationManagerCompat::CreateToastNotifier().Show(notif);
+void sendProgressToast()
+{
+    std::cout << "\n\nExporting photos... ";
+
+    // Shown once; the placeholders are bound to the toast's data rather than rendered into the XML
+    ToastPayload payload{ LR"(<toast>
+    <visual>
+        <binding template="ToastGeneric">
+            <text>Exporting photos</text>
+            <progress title="{title}" value="{value}" valueStringOverride="{count}" status="{status}"/>
+        </binding>
+    </visual>
+</toast>)", L"export", L"exports" };
+
+    const int total = 10000;
+    payload.Data.Values = {
+        { L"title", L"Vacation album" },
+        { L"value", L"0" },
+        { L"count", L"0/" + std::to_wstring(total) + L" photos" },
+        { L"status", L"Exporting..." } };
+    DesktopNotificationManagerCompat::ShowProgress(payload);
+
+    // Every photo is reported, but only the changed values go out, a few times a second
+    ToastProgress& progress = DesktopNotificationManagerCompat::Progress();
+    for (int done = 1; done < total; done++)
+    {
+        progress.Report(L"export", L"exports", {
+            { L"value", std::to_wstring(static_cast<double>(done) / total) },
+            { L"count", std::to_wstring(done) + L"/" + std::to_wstring(total) + L" photos" } });
 
-    std::cout << "Sent!\n";
+        if (done % 100 == 0)
+        {
+            Sleep(30);
+        }
+    }
+
+    progress.Complete(L"export", L"exports", {
+        { L"value", L"1" },
+        { L"count", std::to_wstring(total) + L"/" + std::to_wstring(total) + L" photos" },
+        { L"status", L"Done!" } });
+
+    std::cout << "Done!\n";
 }
 
 void showWindow()
@@ -198,18 +317,17 @@ void showWindow()
 
 void sendBasicToast(std::wstring message)
 {
-    // Construct the toast template
-    XmlDocument doc;
-    doc.LoadXml(L"<toast>\
-    <visual>\
-        <binding template=\"ToastGeneric\">\
-            <text></text>\
-        </binding>\
-    </visual>\
-</toast>");
+    static const ToastTemplate basicTemplate(LR"(<toast>
+    <visual>
+        <binding template="ToastGeneric">
+            <text>{message}</text>
+        </binding>
+    </visual>
+</toast>)");
 
     // Populate with text and values
-    doc.SelectSingleNode(L"//text[1]").InnerText(message);
+    XmlDocument doc;
+    doc.LoadXml(basicTemplate.Render({ message }));
 
     // Construct the notification
     ToastNotification notif{ doc };
@@ -11,8 +11,15 @@
 // ******************************************************************
 
 #include "DesktopNotificationManagerCompat.h"
-#include <appmodel.h>
 #include <wrl\wrappers\corewrappers.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_set>
+#include "ProcessIdentity.h"
+#include "WrlNotificationPlatform.h"
 
 #define RETURN_IF_FAILED(hr) do { HRESULT _hrTemp = hr; if (FAILED(_hrTemp)) { return _hrTemp; } } while (false)
 
@@ -20,43 +27,237 @@ using namespace ABI::Windows::Data::Xml::Dom;
 using namespace Microsoft::WRL;
 using namespace Microsoft::WRL::Wrappers;
 
+/// <summary>
+/// Call from a catch block. Returns the HRESULT for the exception being handled: E_OUTOFMEMORY only for a failed
+/// allocation, E_INVALIDARG and E_BOUNDS for rejected arguments and sizes, the Win32 error a std::system_error
+/// carries, and E_FAIL for anything without a better match.
+/// </summary>
+static HRESULT CaughtExceptionToHResult()
+{
+    try
+    {
+        throw;
+    }
+    catch (const std::bad_alloc&)
+    {
+        return E_OUTOFMEMORY;
+    }
+    catch (const std::invalid_argument&)
+    {
+        return E_INVALIDARG;
+    }
+    catch (const std::length_error&)
+    {
+        return E_BOUNDS;
+    }
+    catch (const std::system_error& error)
+    {
+        return error.code().category() == std::system_category() ? HRESULT_FROM_WIN32(error.code().value()) : E_FAIL;
+    }
+    catch (...)
+    {
+        return E_FAIL;
+    }
+}
+
 namespace DesktopNotificationManagerCompat
 {
-    HRESULT RegisterComServer(GUID clsid, const wchar_t exePath[]);
-    HRESULT EnsureRegistered();
+    HRESULT RegisterComServer(DesktopNotificationManager& manager, GUID clsid);
+    HRESULT EnsureRegistered(DesktopNotificationManager** manager);
     bool IsRunningAsUwp();
 
-    bool s_registeredAumidAndComServer = false;
-    std::wstring s_aumid;
     bool s_registeredActivator = false;
-    bool s_hasCheckedIsRunningAsUwp = false;
-    bool s_isRunningAsUwp = false;
+
+    // Only the calls that hand out native notifiers and notifications use this directly
+    WrlNotificationPlatform s_wrlPlatform;
+
+    // Every other call to the notification platform, registry and package APIs goes through here
+    INotificationPlatform& s_platform = s_wrlPlatform;
+
+    // Opened by UseActivationJournal, and declared first so it outlives the handlers writing to it
+    ActivationJournal s_activationJournal;
+
+    // The default instance: its AUMID, activation executor, the index of what it has shown through ShowToast, and its
+    // metrics. Made by RegisterAumidAndComServer, or on first use when running under Desktop Bridge. Created once, under
+    // the mutex, and never replaced, since senders, workers and COM threads keep the pointer get_Manager hands them
+    std::mutex s_managerMutex;
+    std::shared_ptr<DesktopNotificationManager> s_manager;
+    std::atomic<DesktopNotificationManager*> s_defaultManager{ nullptr };
+
+    // Makes the default instance with the AUMID unless there is one already. Call with s_managerMutex held
+    static DesktopNotificationManager& CreateDefaultManagerLocked(const wchar_t *aumid)
+    {
+        if (s_manager == nullptr)
+        {
+            s_manager = std::make_shared<DesktopNotificationManager>(s_platform, aumid);
+            s_defaultManager.store(s_manager.get(), std::memory_order_release);
+        }
+        return *s_manager;
+    }
+
+    // Made with the globals, so its launch phase starts about when the process does
+    ActivationStartup s_startup;
+
+    // Package identity, module path and launch command, read once and then shared by every thread
+    ProcessIdentity s_identity(s_platform, TOAST_ACTIVATED_LAUNCH_ARG);
+
+    // Set by UsePayloadBudget; payloads are shown as they are while this is null
+    std::unique_ptr<ToastPayloadMinifier> s_payloadMinifier;
+
+    // Set by UseImageCache, which downloads through the fetcher
+    ToastUrlImageFetcher s_imageFetcher;
+    std::unique_ptr<ToastImageCache> s_imageCache;
+
+    // Opened by UseScheduler when given a path, and declared first so it outlives the scheduler writing to it
+    ToastScheduleJournal s_scheduleJournal;
+    std::filesystem::path s_scheduleJournalPath;
+
+    // Set by UseScheduler
+    std::unique_ptr<ToastScheduler> s_scheduler;
+
+    // Set once by UseTracing and never replaced, since ShowToast and COM threads read it without a lock. s_tracer owns it
+    // and s_activeTracer is what they read
+    std::unique_ptr<ToastTracer> s_tracer;
+    std::atomic<ToastTracer*> s_activeTracer{ nullptr };
+
+    // Set by UseProgress
+    std::unique_ptr<ToastProgress> s_progress;
 
     HRESULT RegisterAumidAndComServer(const wchar_t *aumid, GUID clsid)
     {
-        // If running as Desktop Bridge
-        if (IsRunningAsUwp())
+        try
         {
-            // Clear the AUMID since Desktop Bridge doesn't use it, and then we're done.
-            // Desktop Bridge apps are registered with platform through their manifest.
-            // Their LocalServer32 key is also registered through their manifest.
-            s_aumid = L"";
-            s_registeredAumidAndComServer = true;
-            return S_OK;
+            // If running as Desktop Bridge
+            if (IsRunningAsUwp())
+            {
+                // Clear the AUMID since Desktop Bridge doesn't use it, and then we're done.
+                // Desktop Bridge apps are registered with platform through their manifest.
+                // Their LocalServer32 key is also registered through their manifest.
+                std::lock_guard<std::mutex> lock(s_managerMutex);
+                CreateDefaultManagerLocked(L"");
+                return S_OK;
+            }
+
+            // Registering again writes the registration again, but keeps the default instance
+            std::lock_guard<std::mutex> lock(s_managerMutex);
+            if (s_manager != nullptr && s_manager->Aumid() != aumid)
+            {
+                return E_ILLEGAL_METHOD_CALL;
+            }
+
+            // Register the COM server
+            RETURN_IF_FAILED(RegisterComServer(CreateDefaultManagerLocked(aumid), clsid));
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
         }
+        return S_OK;
+    }
 
-        // Copy the aumid
-        s_aumid = std::wstring(aumid);
+    HRESULT RegisterForActivation(const wchar_t *aumid)
+    {
+        s_startup.EndPhase(ActivationStartupPhase::Launch);
+
+        try
+        {
+            // COM started the process through the LocalServer32 registration, so there's nothing to write.
+            // Desktop Bridge apps don't use the AUMID.
+            std::lock_guard<std::mutex> lock(s_managerMutex);
+            CreateDefaultManagerLocked(IsRunningAsUwp() ? L"" : aumid).TrackActivations(&s_startup);
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+        return S_OK;
+    }
+
+    HRESULT WaitForActivations(ActivationStartupOptions options, ActivationStartupTimings* timings)
+    {
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(get_Manager(&manager));
+
+        if (!s_registeredActivator)
+        {
+            RETURN_IF_FAILED(RegisterActivator());
+        }
+        s_startup.EndPhase(ActivationStartupPhase::Register);
+
+        HRESULT hr = s_startup.WaitForActivations(options);
+        if (!s_startup.Timings().KeptRunning)
+        {
+            Module<OutOfProc>::GetModule().UnregisterObjects();
+            s_registeredActivator = false;
+
+            // An activation can arrive between the end of the wait and the unregister
+            HRESULT drained = s_startup.Drain(options);
+            hr = SUCCEEDED(hr) ? drained : hr;
+            manager->TrackActivations(nullptr);
+        }
+
+        *timings = s_startup.Timings();
+        return hr;
+    }
+
+    void KeepRunning()
+    {
+        s_startup.KeepRunning();
+    }
 
-        // Get the EXE path
-        wchar_t exePath[MAX_PATH];
-        DWORD charWritten = ::GetModuleFileName(nullptr, exePath, ARRAYSIZE(exePath));
-        RETURN_IF_FAILED(charWritten > 0 ? S_OK : HRESULT_FROM_WIN32(::GetLastError()));
+    // A manager made by CreateManager, with a platform of its own so its notifier and history caches aren't shared
+    struct HostedManager
+    {
+        WrlNotificationPlatform Platform;
+        DesktopNotificationManager Manager;
 
-        // Register the COM server
-        RETURN_IF_FAILED(RegisterComServer(clsid, exePath));
+        explicit HostedManager(std::wstring aumid) : Manager(Platform, std::move(aumid))
+        {
+        }
+    };
 
-        s_registeredAumidAndComServer = true;
+    HRESULT CreateManager(const wchar_t *aumid, GUID clsid, std::shared_ptr<DesktopNotificationManager>* manager)
+    {
+        try
+        {
+            auto hosted = std::make_shared<HostedManager>(aumid);
+            std::shared_ptr<DesktopNotificationManager> created(hosted, &hosted->Manager);
+            RETURN_IF_FAILED(RegisterComServer(*created, clsid));
+
+            *manager = std::move(created);
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+        return S_OK;
+    }
+
+    HRESULT get_Manager(DesktopNotificationManager** manager)
+    {
+        *manager = s_defaultManager.load(std::memory_order_acquire);
+        if (*manager != nullptr)
+        {
+            return S_OK;
+        }
+
+        // Desktop Bridge apps are registered implicitly, through their manifest
+        if (!IsRunningAsUwp())
+        {
+            // Otherwise, incorrect usage, must call RegisterAumidAndComServer first
+            return E_ILLEGAL_METHOD_CALL;
+        }
+
+        // Threads that get here at once all end up with the one instance
+        try
+        {
+            std::lock_guard<std::mutex> lock(s_managerMutex);
+            *manager = &CreateDefaultManagerLocked(L"");
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
         return S_OK;
     }
 
@@ -79,95 +280,458 @@ namespace DesktopNotificationManagerCompat
         return S_OK;
     }
 
-    HRESULT RegisterComServer(GUID clsid, const wchar_t exePath[])
+    HRESULT UseActivationExecutor(ActivationExecutorOptions options, const wchar_t *orderingArgument)
+    {
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(get_Manager(&manager));
+
+        if (!options.WorkerStarted)
+        {
+            // Handlers call into WinRT, so the workers join the multithreaded apartment
+            options.WorkerStarted = [] { RoInitialize(RO_INIT_MULTITHREADED); };
+        }
+
+        try
+        {
+            return manager->UseActivationExecutor(std::move(options), orderingArgument);
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+    }
+
+    HRESULT DispatchActivation(const wchar_t *invokedArgs, std::function<HRESULT()> handler)
+    {
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(get_Manager(&manager));
+
+        std::wstring_view arguments = invokedArgs != nullptr ? invokedArgs : L"";
+        ToastTraceScope activateSpan(s_activeTracer.load(std::memory_order_acquire), ToastTraceActivate, TakeToastTraceId(arguments));
+
+        try
+        {
+            // The manager counts the activation and its latency, including any wait for a worker, and any failure
+            return manager->Dispatch(arguments, std::move(handler));
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+    }
+
+    HRESULT DispatchActivation(ActivationEventArgs args, std::function<HRESULT(const ActivationEventArgs&)> handler)
+    {
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(get_Manager(&manager));
+
+        std::wstring_view arguments = args.Argument();
+        ToastTraceScope activateSpan(s_activeTracer.load(std::memory_order_acquire), ToastTraceActivate, TakeToastTraceId(arguments));
+
+        try
+        {
+            // Journaled and handed on as the app wrote them, without the correlation ID
+            if (arguments.size() != args.Argument().size())
+            {
+                std::vector<ActivationUserInput> userInput;
+                for (std::size_t i = 0; i < args.UserInputCount(); i++)
+                {
+                    userInput.push_back(args.UserInputAt(i));
+                }
+                args = ActivationEventArgs(arguments, userInput.data(), userInput.size());
+            }
+
+            return manager->Dispatch(std::move(args), std::move(handler));
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+    }
+
+    HRESULT UseActivationJournal(const std::filesystem::path& path, ActivationJournalOptions options, std::function<HRESULT(const ActivationEventArgs&)> handler)
+    {
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(get_Manager(&manager));
+
+        try
+        {
+            std::error_code ignored;
+            std::filesystem::create_directories(path.parent_path(), ignored);
+            RETURN_IF_FAILED(s_activationJournal.Open(path, options));
+            manager->JournalActivations(&s_activationJournal);
+
+            // A handler that fails again is counted in get_Metrics(), and given up on after MaxAttempts starts
+            manager->ReplayActivations(std::move(handler));
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+        return S_OK;
+    }
+
+    HRESULT RegisterComServer(DesktopNotificationManager& manager, GUID clsid)
     {
+        // Get the EXE path and the command that launches it
+        const ProcessIdentitySnapshot& identity = s_identity.Get();
+        RETURN_IF_FAILED(identity.Result);
+
         // Turn the GUID into a string
         OLECHAR* clsidOlechar;
-        StringFromCLSID(clsid, &clsidOlechar);
+        RETURN_IF_FAILED(StringFromCLSID(clsid, &clsidOlechar));
         std::wstring clsidStr(clsidOlechar);
         ::CoTaskMemFree(clsidOlechar);
 
-        // Create the subkey
-        // Something like SOFTWARE\Classes\CLSID\{23A5B06E-20BB-4E7E-A0AC-6982ED6A6041}\LocalServer32
-        std::wstring subKey = LR"(SOFTWARE\Classes\CLSID\)" + clsidStr + LR"(\LocalServer32)";
+        // Register the EXE for the COM server under SOFTWARE\Classes\CLSID\{...}\LocalServer32, skipping the write if the
+        // fingerprint stored alongside shows it's already there. The AUMID comes from the app's shortcut, so there's no display name.
+        DesktopNotificationRegistration registration;
+        registration.ActivatorClsid = clsidStr;
+        registration.LaunchCommand = identity.LaunchCommand;
+        return manager.Register(registration);
+    }
 
-        // Include -ToastActivated launch args on the exe
-        std::wstring exePathStr(exePath);
-        exePathStr = L"\"" + exePathStr + L"\" " + TOAST_ACTIVATED_LAUNCH_ARG;
+    HRESULT CreateToastNotifier(IToastNotifier **notifier)
+    {
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(EnsureRegistered(&manager));
 
-        // We don't need to worry about overflow here as ::GetModuleFileName won't
-        // return anything bigger than the max file system path (much fewer than max of DWORD).
-        DWORD dataSize = static_cast<DWORD>((exePathStr.length() + 1) * sizeof(WCHAR));
+        ComPtr<IToastNotifier> cached;
+        RETURN_IF_FAILED(s_wrlPlatform.GetNotifier(manager->Aumid(), &cached));
 
-        // Register the EXE for the COM server
-        return HRESULT_FROM_WIN32(::RegSetKeyValue(
-            HKEY_CURRENT_USER,
-            subKey.c_str(),
-            nullptr,
-            REG_SZ,
-            reinterpret_cast<const BYTE*>(exePathStr.c_str()),
-            dataSize));
+        return cached.CopyTo(notifier);
     }
 
-    HRESULT CreateToastNotifier(IToastNotifier **notifier)
+    HRESULT CreateXmlDocumentFromString(const wchar_t *xmlString, IXmlDocument **doc)
+    {
+        return WrlNotificationPlatform::CreateXmlDocumentFromString(xmlString, doc);
+    }
+
+    HRESULT CreateToastNotification(IXmlDocument *content, IToastNotification **notification)
+    {
+        return s_wrlPlatform.CreateToastNotification(content, notification);
+    }
+
+    HRESULT ShowToast(const ToastPayload& payload, std::uint64_t traceId)
+    {
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(EnsureRegistered(&manager));
+
+        auto start = std::chrono::steady_clock::now();
+        ToastTraceScope showSpan(s_activeTracer.load(std::memory_order_acquire), ToastTraceShow, traceId);
+
+        const ToastPayload* shown = &payload;
+        ToastPayload rewritten;
+        if (s_imageCache || s_payloadMinifier || showSpan.CorrelationId() != 0)
+        {
+            HRESULT hr = S_OK;
+            try
+            {
+                rewritten = payload;
+
+                // The ID comes back in the arguments of the activation, and is counted against the payload budget like the rest
+                if (showSpan.CorrelationId() != 0)
+                {
+                    AddToastTraceId(rewritten.Xml, showSpan.CorrelationId());
+                }
+
+                // Images that can't be cached keep their source; the toast is still shown, just as it would have been without the cache
+                if (s_imageCache)
+                {
+                    s_imageCache->Rewrite(rewritten);
+                }
+
+                if (s_payloadMinifier)
+                {
+                    hr = s_payloadMinifier->Minify(rewritten);
+                }
+            }
+            catch (...)
+            {
+                return CaughtExceptionToHResult();
+            }
+
+            // A payload over budget counts as a failed send, like one the platform rejects
+            if (FAILED(hr))
+            {
+                manager->Metrics().RecordSend(hr, std::chrono::steady_clock::now() - start);
+                return hr;
+            }
+            shown = &rewritten;
+        }
+
+        // Counted, and added to the history index once it's shown, by the manager
+        RETURN_IF_FAILED(manager->Show(*shown));
+        showSpan.End();
+        return S_OK;
+    }
+
+    HRESULT UseProgress(ToastProgressOptions options)
     {
-        RETURN_IF_FAILED(EnsureRegistered());
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(EnsureRegistered(&manager));
 
-        ComPtr<IToastNotificationManagerStatics> toastStatics;
-        RETURN_IF_FAILED(Windows::Foundation::GetActivationFactory(
-            HStringReference(RuntimeClass_Windows_UI_Notifications_ToastNotificationManager).Get(),
-            &toastStatics));
+        if (!options.PumpStarted)
+        {
+            // The pump updates toasts through WinRT, so it joins the multithreaded apartment
+            options.PumpStarted = [] { RoInitialize(RO_INIT_MULTITHREADED); };
+        }
 
-        if (s_aumid.empty())
+        try
         {
-            return toastStatics->CreateToastNotifier(notifier);
+            s_progress = std::make_unique<ToastProgress>(s_platform, manager->Aumid(), std::move(options));
         }
-        else
+        catch (...)
         {
-            return toastStatics->CreateToastNotifierWithId(HStringReference(s_aumid.c_str()).Get(), notifier);
+            return CaughtExceptionToHResult();
         }
+        return S_OK;
     }
 
-    HRESULT CreateXmlDocumentFromString(const wchar_t *xmlString, IXmlDocument **doc)
+    HRESULT ShowProgressToast(const ToastPayload& payload)
+    {
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(EnsureRegistered(&manager));
+        if (s_progress == nullptr)
+        {
+            return E_ILLEGAL_METHOD_CALL;
+        }
+
+        try
+        {
+            auto start = std::chrono::steady_clock::now();
+            HRESULT hr = s_progress->Show(payload);
+            manager->Metrics().RecordSend(hr, std::chrono::steady_clock::now() - start);
+            RETURN_IF_FAILED(hr);
+
+            manager->HistoryIndex().OnShown(payload);
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+        return S_OK;
+    }
+
+    HRESULT get_Progress(ToastProgress** progress)
     {
-        ComPtr<IXmlDocument> answer;
-        RETURN_IF_FAILED(Windows::Foundation::ActivateInstance(HStringReference(RuntimeClass_Windows_Data_Xml_Dom_XmlDocument).Get(), &answer));
+        if (s_progress == nullptr)
+        {
+            return E_ILLEGAL_METHOD_CALL;
+        }
 
-        ComPtr<IXmlDocumentIO> docIO;
-        RETURN_IF_FAILED(answer.As(&docIO));
+        *progress = s_progress.get();
+        return S_OK;
+    }
 
-        // Load the XML string
-        RETURN_IF_FAILED(docIO->LoadXml(HStringReference(xmlString).Get()));
+    HRESULT UseRateLimiter(ToastRateLimiterOptions options)
+    {
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(EnsureRegistered(&manager));
 
-        return answer.CopyTo(doc);
+        if (!options.PumpStarted)
+        {
+            // The pump shows held toasts through WinRT, so it joins the multithreaded apartment
+            options.PumpStarted = [] { RoInitialize(RO_INIT_MULTITHREADED); };
+        }
+
+        try
+        {
+            return manager->UseRateLimiter(std::move(options));
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
     }
 
-    HRESULT CreateToastNotification(IXmlDocument *content, IToastNotification **notification)
+    HRESULT UsePayloadBudget(ToastPayloadBudget budget)
     {
-        ComPtr<IToastNotificationFactory> factory;
-        RETURN_IF_FAILED(Windows::Foundation::GetActivationFactory(
-            HStringReference(RuntimeClass_Windows_UI_Notifications_ToastNotification).Get(),
-            &factory));
+        try
+        {
+            s_payloadMinifier = std::make_unique<ToastPayloadMinifier>(std::move(budget));
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+        return S_OK;
+    }
+
+    HRESULT UseImageCache(const std::filesystem::path& directory, ToastImageCacheOptions options)
+    {
+        try
+        {
+            // Images in toasts the history index still has aren't evicted. The check holds on to the default manager rather
+            // than going through the global each time
+            if (!options.IsToastLive)
+            {
+                DesktopNotificationManager* defaultManager;
+                RETURN_IF_FAILED(get_Manager(&defaultManager));
+
+                std::shared_ptr<DesktopNotificationManager> manager;
+                {
+                    std::lock_guard<std::mutex> lock(s_managerMutex);
+                    manager = s_manager;
+                }
+                options.IsToastLive = [manager](const std::wstring& tag, const std::wstring& group)
+                {
+                    return tag.empty() ? manager->HistoryIndex().CountInGroup(group) > 0 : manager->HistoryIndex().Contains(tag, group);
+                };
+            }
+
+            auto cache = std::make_unique<ToastImageCache>(s_imageFetcher, std::move(options));
+            RETURN_IF_FAILED(cache->Open(directory));
+            s_imageCache = std::move(cache);
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+        return S_OK;
+    }
+
+    HRESULT GetLocalImage(const std::wstring& source, ToastImagePlacement placement, std::wstring* localUri)
+    {
+        if (s_imageCache == nullptr)
+        {
+            return E_ILLEGAL_METHOD_CALL;
+        }
 
-        return factory->CreateToastNotification(content, notification);
+        try
+        {
+            return s_imageCache->Resolve(source, placement, *localUri);
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+    }
+
+    INotificationPlatform& Platform()
+    {
+        return s_platform;
+    }
+
+    HRESULT UseTracing(ToastTracerOptions options)
+    {
+        std::unique_ptr<ToastTracer> tracer;
+        try
+        {
+            tracer = std::make_unique<ToastTracer>(options);
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+
+        ToastTracer* expected = nullptr;
+        if (!s_activeTracer.compare_exchange_strong(expected, tracer.get(), std::memory_order_acq_rel))
+        {
+            return E_ILLEGAL_METHOD_CALL;
+        }
+        s_tracer = std::move(tracer);
+        return S_OK;
+    }
+
+    ToastTracer* Tracer()
+    {
+        return s_activeTracer.load(std::memory_order_acquire);
+    }
+
+    HRESULT get_Metrics(ToastMetrics** metrics)
+    {
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(get_Manager(&manager));
+
+        *metrics = &manager->Metrics();
+        return S_OK;
     }
 
     HRESULT get_History(std::unique_ptr<DesktopNotificationHistoryCompat>* history)
     {
-        RETURN_IF_FAILED(EnsureRegistered());
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(EnsureRegistered(&manager));
 
-        ComPtr<IToastNotificationManagerStatics> toastStatics;
-        RETURN_IF_FAILED(Windows::Foundation::GetActivationFactory(
-            HStringReference(RuntimeClass_Windows_UI_Notifications_ToastNotificationManager).Get(),
-            &toastStatics));
+        *history = std::unique_ptr<DesktopNotificationHistoryCompat>(new DesktopNotificationHistoryCompat(manager));
+        return S_OK;
+    }
 
-        ComPtr<IToastNotificationManagerStatics2> toastStatics2;
-        RETURN_IF_FAILED(toastStatics.As(&toastStatics2));
+    HRESULT UseScheduler(ToastSchedulerOptions options)
+    {
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(EnsureRegistered(&manager));
 
-        ComPtr<IToastNotificationHistory> nativeHistory;
-        RETURN_IF_FAILED(toastStatics2->get_History(&nativeHistory));
+        if (!options.PumpStarted)
+        {
+            // The pump shows toasts through WinRT, so it joins the multithreaded apartment
+            options.PumpStarted = [] { RoInitialize(RO_INIT_MULTITHREADED); };
+        }
+
+        try
+        {
+            s_scheduler = std::make_unique<ToastScheduler>(s_platform, manager->Aumid(), std::move(options));
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
 
-        *history = std::unique_ptr<DesktopNotificationHistoryCompat>(new DesktopNotificationHistoryCompat(s_aumid.c_str(), nativeHistory));
+        return S_OK;
+    }
+
+    HRESULT UseScheduler(const std::filesystem::path& journalPath, ToastSchedulerOptions options, ToastScheduleJournalOptions journalOptions)
+    {
+        DesktopNotificationManager* manager;
+        RETURN_IF_FAILED(EnsureRegistered(&manager));
+
+        // The current scheduler may be writing to the journal
+        s_scheduler.reset();
+
+        std::vector<ToastJournalEntry> entries;
+        try
+        {
+            RETURN_IF_FAILED(s_scheduleJournal.Open(journalPath, journalOptions));
+            s_scheduleJournalPath = journalPath;
+            RETURN_IF_FAILED(s_scheduleJournal.Load(entries));
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+
+        // Take back what the last run handed to the platform, since the restored scheduler hands it off again
+        for (const ToastJournalEntry& entry : entries)
+        {
+            if (entry.HandedOff)
+            {
+                s_platform.RemoveFromSchedule(manager->Aumid(), entry.Toast.Id);
+            }
+        }
+
+        options.Journal = &s_scheduleJournal;
+        RETURN_IF_FAILED(UseScheduler(std::move(options)));
+
+        try
+        {
+            s_scheduler->Restore(std::move(entries));
+        }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+
+        return S_OK;
+    }
+
+    HRESULT get_Scheduler(ToastScheduler** scheduler)
+    {
+        if (s_scheduler == nullptr)
+        {
+            return E_ILLEGAL_METHOD_CALL;
+        }
+
+        *scheduler = s_scheduler.get();
         return S_OK;
     }
 
@@ -176,23 +740,62 @@ namespace DesktopNotificationManagerCompat
         return IsRunningAsUwp();
     }
 
-    HRESULT EnsureRegistered()
+    HRESULT Uninstall()
     {
-        // If not registered AUMID yet
-        if (!s_registeredAumidAndComServer)
+        const ProcessIdentitySnapshot& identity = s_identity.Get();
+        RETURN_IF_FAILED(identity.Result);
+        if (identity.IsContainerized)
         {
-            // Check if Desktop Bridge
-            if (IsRunningAsUwp())
+            // Packaged containerized apps automatically clean everything up already
+            return S_OK;
+        }
+
+        // Drop the scheduler's pending toasts, and stop it handing more to the platform
+        s_scheduler.reset();
+
+        // Progress toasts are about to be cleared, so there's nothing left to update
+        s_progress.reset();
+
+        HRESULT hr = S_OK;
+        try
+        {
+            if (!s_scheduleJournalPath.empty())
             {
-                // Implicitly registered, all good!
-                s_registeredAumidAndComServer = true;
+                s_scheduleJournal.Close();
+                std::error_code ignored;
+                std::filesystem::remove(s_scheduleJournalPath, ignored);
+                s_scheduleJournalPath.clear();
             }
-            else
+
+            // Remove all scheduled and current notifications, and the registry key, carrying on past failures
+            if (DesktopNotificationManager* manager = s_defaultManager.load(std::memory_order_acquire))
             {
-                // Otherwise, incorrect usage, must call RegisterAumidAndComServer first
-                return E_ILLEGAL_METHOD_CALL;
+                hr = manager->Uninstall();
+            }
+
+            // Nothing in history refers to the cached images any more. Only the files the cache stored are deleted, since
+            // the directory may hold the app's own files too
+            if (s_imageCache)
+            {
+                HRESULT removed = s_imageCache->Uninstall();
+                hr = SUCCEEDED(hr) ? removed : hr;
+                s_imageCache.reset();
             }
         }
+        catch (...)
+        {
+            return CaughtExceptionToHResult();
+        }
+
+        // The cached notifier and history objects belong to the registration being removed
+        s_platform.ClearCaches();
+        return hr;
+    }
+
+    HRESULT EnsureRegistered(DesktopNotificationManager** manager)
+    {
+        // Desktop Bridge apps are registered implicitly; anything else must have called RegisterAumidAndComServer
+        RETURN_IF_FAILED(get_Manager(manager));
 
         // If not registered activator yet
         if (!s_registeredActivator)
@@ -206,85 +809,144 @@ namespace DesktopNotificationManagerCompat
 
     bool IsRunningAsUwp()
     {
-        if (!s_hasCheckedIsRunningAsUwp)
-        {
-            // https://stackoverflow.com/questions/39609643/determine-if-c-application-is-running-as-a-uwp-app-in-desktop-bridge-project
-            UINT32 length;
-            wchar_t packageFamilyName[PACKAGE_FAMILY_NAME_MAX_LENGTH + 1];
-            LONG result = GetPackageFamilyName(GetCurrentProcess(), &length, packageFamilyName);
-            s_isRunningAsUwp = result == ERROR_SUCCESS;
-            s_hasCheckedIsRunningAsUwp = true;
-        }
-
-        return s_isRunningAsUwp;
+        return s_identity.HasIdentity();
     }
 }
 
-DesktopNotificationHistoryCompat::DesktopNotificationHistoryCompat(const wchar_t *aumid, ComPtr<IToastNotificationHistory> history)
+DesktopNotificationHistoryCompat::DesktopNotificationHistoryCompat(DesktopNotificationManager* manager)
 {
-    m_aumid = std::wstring(aumid);
-    m_history = history;
+    m_manager = manager;
 }
 
 HRESULT DesktopNotificationHistoryCompat::Clear()
 {
-    if (m_aumid.empty())
-    {
-        return m_history->Clear();
-    }
-    else
-    {
-        return m_history->ClearWithId(HStringReference(m_aumid.c_str()).Get());
-    }
+    return m_manager->ClearHistory();
 }
 
 HRESULT DesktopNotificationHistoryCompat::GetHistory(ABI::Windows::Foundation::Collections::IVectorView<ToastNotification*> **toasts)
 {
+    // The only call that needs the native history object, since it hands out the toasts themselves. Every manager here,
+    // the default one and those from CreateManager, sits on a WrlNotificationPlatform, so it comes from that cache
+    ComPtr<IToastNotificationHistory> history;
+    RETURN_IF_FAILED(static_cast<WrlNotificationPlatform&>(m_manager->Platform()).GetNativeHistory(&history));
+
     ComPtr<IToastNotificationHistory2> history2;
-    RETURN_IF_FAILED(m_history.As(&history2));
+    RETURN_IF_FAILED(history.As(&history2));
 
-    if (m_aumid.empty())
+    if (m_manager->Aumid().empty())
     {
         return history2->GetHistory(toasts);
     }
     else
     {
-        return history2->GetHistoryWithId(HStringReference(m_aumid.c_str()).Get(), toasts);
+        return history2->GetHistoryWithId(HStringReference(m_manager->Aumid().c_str()).Get(), toasts);
     }
 }
 
 HRESULT DesktopNotificationHistoryCompat::Remove(const wchar_t *tag)
 {
-    if (m_aumid.empty())
+    return m_manager->RemoveFromHistory(tag, L"");
+}
+
+HRESULT DesktopNotificationHistoryCompat::RemoveGroupedTag(const wchar_t *tag, const wchar_t *group)
+{
+    return m_manager->RemoveFromHistory(tag, group);
+}
+
+HRESULT DesktopNotificationHistoryCompat::RemoveGroup(const wchar_t *group)
+{
+    return m_manager->RemoveGroupFromHistory(group);
+}
+
+static thread_local bool t_batchWorkerInitialized = false;
+
+static void PrepareBatchWorkers(ToastHistoryBatchOptions& options)
+{
+    if (!options.WorkerStarted)
     {
-        return m_history->Remove(HStringReference(tag).Get());
+        // Removals call into WinRT, so the workers join the multithreaded apartment, and leave it when they're done
+        options.WorkerStarted = [] { t_batchWorkerInitialized = SUCCEEDED(RoInitialize(RO_INIT_MULTITHREADED)); };
+        options.WorkerStopped = []
+        {
+            if (t_batchWorkerInitialized)
+            {
+                RoUninitialize();
+            }
+        };
     }
-    else
+}
+
+static void ForgetRemoved(ToastHistoryIndex& historyIndex, const std::vector<std::wstring>& groups, const std::vector<ToastHistoryEntry>& toasts, const ToastHistoryBatchResults& results)
+{
+    // Toasts in a group that was removed whole went with the group
+    std::unordered_set<std::wstring> removedGroups;
+    for (size_t i = 0; i < groups.size(); i++)
+    {
+        if (SUCCEEDED(results.Groups[i]) && removedGroups.insert(groups[i]).second)
+        {
+            historyIndex.OnGroupRemoved(groups[i]);
+        }
+    }
+    for (size_t i = 0; i < toasts.size(); i++)
     {
-        return m_history->RemoveGroupedTagWithId(HStringReference(tag).Get(), HStringReference(L"").Get(), HStringReference(m_aumid.c_str()).Get());
+        if (SUCCEEDED(results.Toasts[i]) && removedGroups.count(toasts[i].Group) == 0)
+        {
+            historyIndex.OnRemoved(toasts[i].Tag, toasts[i].Group);
+        }
     }
 }
 
-HRESULT DesktopNotificationHistoryCompat::RemoveGroupedTag(const wchar_t *tag, const wchar_t *group)
+HRESULT DesktopNotificationHistoryCompat::RemoveMany(const std::vector<ToastHistoryEntry>& toasts, const std::vector<std::wstring>& groups, ToastHistoryBatchResults* results, ToastHistoryBatchOptions options)
 {
-    if (m_aumid.empty())
+    PrepareBatchWorkers(options);
+
+    HRESULT hr;
+    try
     {
-        return m_history->RemoveGroupedTag(HStringReference(tag).Get(), HStringReference(group).Get());
+        hr = RemoveManyFromHistory(m_manager->Platform(), m_manager->Aumid(), toasts, groups, options, *results);
+        ForgetRemoved(m_manager->HistoryIndex(), groups, toasts, *results);
     }
-    else
+    catch (...)
     {
-        return m_history->RemoveGroupedTagWithId(HStringReference(tag).Get(), HStringReference(group).Get(), HStringReference(m_aumid.c_str()).Get());
+        return CaughtExceptionToHResult();
     }
+    return hr;
 }
 
-HRESULT DesktopNotificationHistoryCompat::RemoveGroup(const wchar_t *group)
+HRESULT DesktopNotificationHistoryCompat::RemoveWhere(const std::function<bool(const ToastHistoryEntry&)>& predicate, std::vector<ToastHistoryEntry>* removed, ToastHistoryBatchResults* results, ToastHistoryBatchOptions options)
 {
-    if (m_aumid.empty())
+    PrepareBatchWorkers(options);
+
+    HRESULT hr;
+    try
     {
-        return m_history->RemoveGroup(HStringReference(group).Get());
+        std::vector<std::wstring> groups;
+        hr = RemoveFromHistoryWhere(m_manager->Platform(), m_manager->Aumid(), predicate, options, *removed, groups, *results);
+        ForgetRemoved(m_manager->HistoryIndex(), groups, *removed, *results);
     }
-    else
+    catch (...)
     {
-        return m_history->RemoveGroupWithId(HStringReference(group).Get(), HStringReference(m_aumid.c_str()).Get());
+        return CaughtExceptionToHResult();
     }
+    return hr;
+}
+
+bool DesktopNotificationHistoryCompat::Contains(const wchar_t *tag, const wchar_t *group)
+{
+    return m_manager->HistoryIndex().Contains(tag, group);
+}
+
+std::vector<ToastHistoryEntry> DesktopNotificationHistoryCompat::GetGroup(const wchar_t *group)
+{
+    return m_manager->HistoryIndex().GetGroup(group);
+}
+
+std::vector<ToastHistoryEntry> DesktopNotificationHistoryCompat::FindByArgument(const wchar_t *key, const wchar_t *value)
+{
+    return m_manager->HistoryIndex().FindByArgument(key, value);
+}
+
+HRESULT DesktopNotificationHistoryCompat::Reconcile(ToastHistoryReconcileResult* result)
+{
+    return m_manager->ReconcileHistory(*result);
 }
\ No newline at end of file
@@ -12,10 +12,29 @@
 
 #pragma once
 #include <string>
+#include <filesystem>
+#include <functional>
 #include <memory>
+#include <vector>
 #include <Windows.h>
 #include <windows.ui.notifications.h>
 #include <wrl.h>
+#include "ActivationExecutor.h"
+#include "ActivationJournal.h"
+#include "ActivationStartup.h"
+#include "DesktopNotificationManager.h"
+#include "INotificationPlatform.h"
+#include "ToastHistoryBatch.h"
+#include "ToastHistoryIndex.h"
+#include "ToastImageCache.h"
+#include "ToastMetrics.h"
+#include "ToastProgress.h"
+#include "ToastRateLimiter.h"
+#include "ToastScheduler.h"
+#include "ToastScheduleJournal.h"
+#include "ToastPayload.h"
+#include "ToastPayloadMinifier.h"
+#include "ToastTrace.h"
 #define TOAST_ACTIVATED_LAUNCH_ARG L"-ToastActivated"
 
 using namespace ABI::Windows::UI::Notifications;
@@ -27,17 +46,87 @@ namespace DesktopNotificationManagerCompat
     /// <summary>
     /// If not running under the Desktop Bridge, you must call this method to register your AUMID with the Compat library and to
     /// register your COM CLSID and EXE in LocalServer32 registry. Feel free to call this regardless, and we will no-op if running
-    /// under Desktop Bridge. Call this upon application startup, before calling any other APIs.
+    /// under Desktop Bridge. Call this upon application startup, before calling any other APIs. Calling it again with the same
+    /// AUMID writes the registration again; another AUMID returns E_ILLEGAL_METHOD_CALL, since the default manager is created
+    /// once and never replaced. Use CreateManager for a second identity.
     /// </summary>
     /// <param name="aumid">An AUMID that uniquely identifies your application.</param>
     /// <param name="clsid">The CLSID of your NotificationActivator class.</param>
     HRESULT RegisterAumidAndComServer(const wchar_t *aumid, GUID clsid);
 
+    /// <summary>
+    /// Call this instead of RegisterAumidAndComServer when COM launched the process to handle a toast activation. It skips
+    /// writing the LocalServer32 registration, which COM started the process through. Then call WaitForActivations.
+    /// </summary>
+    /// <param name="aumid">An AUMID that uniquely identifies your application.</param>
+    HRESULT RegisterForActivation(const wchar_t *aumid);
+
+    /// <summary>
+    /// Registers your module to handle COM activations if it isn't already, and waits until no activation has come for the
+    /// idle timeout, or none at all within the activation timeout, which returns HRESULT_FROM_WIN32(ERROR_TIMEOUT). The
+    /// objects are then unregistered and the activations still being handled are waited for, so the process can return
+    /// from wWinMain. Handlers still running after the handler timeout are given up on, which also returns
+    /// HRESULT_FROM_WIN32(ERROR_TIMEOUT). If a handler calls KeepRunning it returns at once with the objects still
+    /// registered instead.
+    /// </summary>
+    /// <param name="timings">Receives how long each phase of the start took.</param>
+    HRESULT WaitForActivations(ActivationStartupOptions options, ActivationStartupTimings* timings);
+
+    /// <summary>
+    /// Called by an activation handler that opens a window, so the process carries on as a normal start.
+    /// </summary>
+    void KeepRunning();
+
+    /// <summary>
+    /// Registers the COM server for another identity alongside the one passed to RegisterAumidAndComServer. The manager has its
+    /// own notifier and history caches, history index, activation executor and metrics, so several identities can send from
+    /// separate threads without sharing locks. Its activator is your class with this CLSID, whose Activate should pass
+    /// activations to the manager's Dispatch. Classic Win32 apps still need a shortcut carrying the AUMID and CLSID.
+    /// </summary>
+    HRESULT CreateManager(const wchar_t *aumid, GUID clsid, std::shared_ptr<DesktopNotificationManager>* manager);
+
+    /// <summary>
+    /// Gets the instance the rest of this API is a facade over. Returns E_ILLEGAL_METHOD_CALL if RegisterAumidAndComServer hasn't been called.
+    /// </summary>
+    HRESULT get_Manager(DesktopNotificationManager** manager);
+
     /// <summary>
     /// Registers your module to handle COM activations. Call this upon application startup.
     /// </summary>
     HRESULT RegisterActivator();
 
+    /// <summary>
+    /// Opts in to running activation handlers on a pool of worker threads, so that your NotificationActivator's Activate
+    /// can return as soon as it has copied what it needs and hand the work to DispatchActivation. Activations whose
+    /// arguments have the same value for orderingArgument, a key your toasts put in their launch arguments such as
+    /// L"conversationId", are handled one at a time, in order. Those without it, or every activation if it's empty,
+    /// are handled in parallel.
+    /// </summary>
+    HRESULT UseActivationExecutor(ActivationExecutorOptions options, const wchar_t *orderingArgument);
+
+    /// <summary>
+    /// Runs the handler for an activation: on a worker thread if UseActivationExecutor was called, otherwise right away on
+    /// the calling thread, returning its result. The handler must not refer to the arguments of Activate, which are gone
+    /// by the time a worker runs it. Returns HRESULT_FROM_WIN32(ERROR_BUSY) if the executor's queue is full and rejects it.
+    /// When tracing, records the activation against the toast's correlation ID; TakeToastTraceId removes it from invokedArgs.
+    /// </summary>
+    HRESULT DispatchActivation(const wchar_t *invokedArgs, std::function<HRESULT()> handler);
+
+    /// <summary>
+    /// Like the overload above, but the handler is given the arguments and user input, copied out of Activate, so the
+    /// activation can be written to the journal first if UseActivationJournal was called.
+    /// </summary>
+    HRESULT DispatchActivation(ActivationEventArgs args, std::function<HRESULT(const ActivationEventArgs&)> handler);
+
+    /// <summary>
+    /// Writes each activation passed to DispatchActivation with its args to a journal at path before the handler runs, and
+    /// marks it done once the handler returns. Then runs the handler again for the activations the last run didn't
+    /// finish, because the handler threw or the process died. An activation whose handler throws is retried on the next
+    /// start only, not in this run. Replays happen at least once, so handle repeats gracefully.
+    /// Returns the failure if the journal can't be opened; failures of replayed handlers are counted in get_Metrics().
+    /// </summary>
+    HRESULT UseActivationJournal(const std::filesystem::path& path, ActivationJournalOptions options, std::function<HRESULT(const ActivationEventArgs&)> handler);
+
     /// <summary>
     /// Creates a toast notifier. You must have called RegisterActivator first (and also RegisterAumidAndComServer if you're a classic Win32 app), or this will throw an exception.
     /// </summary>
@@ -53,15 +142,118 @@ namespace DesktopNotificationManagerCompat
     /// </summary>
     HRESULT CreateToastNotification(ABI::Windows::Data::Xml::Dom::IXmlDocument* content, IToastNotification** notification);
 
+    /// <summary>
+    /// Creates a toast from a rendered payload, applies its tag and group, and shows it. As a ToastDispatcher sender,
+    /// [](const ToastPayload& payload) { return ShowToast(payload); } counts a failed HRESULT as a failed send. When
+    /// tracing, the toast is stamped with traceId, the correlation ID of the span it was built in, or with a new one if
+    /// that's 0.
+    /// </summary>
+    HRESULT ShowToast(const ToastPayload& payload, std::uint64_t traceId = 0);
+
+    /// <summary>
+    /// Opts in to progress toasts, which are shown once with their placeholders bound to payload.Data and then kept up to
+    /// date by sending only the values that change, at most options.MaxUpdatesPerSecond times a second per toast.
+    /// You must have called RegisterActivator first (and also RegisterAumidAndComServer if you're a classic Win32 app).
+    /// </summary>
+    HRESULT UseProgress(ToastProgressOptions options = ToastProgressOptions());
+
+    /// <summary>
+    /// Shows a data-bound toast and starts tracking it by its tag and group; report on it with get_Progress()->Report.
+    /// Returns E_INVALIDARG if the payload has no tag, and E_ILLEGAL_METHOD_CALL if UseProgress hasn't been called.
+    /// </summary>
+    HRESULT ShowProgressToast(const ToastPayload& payload);
+
+    /// <summary>
+    /// Gets the tracker created by UseProgress. Returns E_ILLEGAL_METHOD_CALL if UseProgress hasn't been called.
+    /// </summary>
+    HRESULT get_Progress(ToastProgress** progress);
+
+    /// <summary>
+    /// Opts in to rate-limiting ShowToast per toast group. A toast over its group's limit is held back, replacing a held toast
+    /// with the same tag and group, and shown from a background thread once the group has tokens again; ShowToast returns
+    /// HRESULT_FROM_WIN32(ERROR_BUSY) for a toast dropped for lack of room to hold it. You must have called RegisterActivator first
+    /// (and also RegisterAumidAndComServer if you're a classic Win32 app).
+    /// </summary>
+    HRESULT UseRateLimiter(ToastRateLimiterOptions options = ToastRateLimiterOptions());
+
+    /// <summary>
+    /// Opts in to minifying every payload passed to ShowToast and checking it against the budget before it reaches the platform.
+    /// ShowToast returns E_BOUNDS for a payload over a failing budget, and budget.OverBudget is told which elements are the largest.
+    /// </summary>
+    HRESULT UsePayloadBudget(ToastPayloadBudget budget);
+
+    /// <summary>
+    /// Opts in to keeping local copies of toast images in directory, scaled to the size they're shown at. ShowToast points http,
+    /// https and oversized local images at their copies, so they appear even when CanUseHttpImages is false. Copies in toasts
+    /// that are still in the history index aren't evicted; Uninstall deletes the copies and nothing else. Call it after
+    /// RegisterAumidAndComServer, since it checks the default manager's history index.
+    /// </summary>
+    HRESULT UseImageCache(const std::filesystem::path& directory, ToastImageCacheOptions options = ToastImageCacheOptions());
+
+    /// <summary>
+    /// Gets a file:/// URI for the local copy of an image, fetching it if need be. Returns E_ILLEGAL_METHOD_CALL if UseImageCache hasn't been called.
+    /// </summary>
+    HRESULT GetLocalImage(const std::wstring& source, ToastImagePlacement placement, std::wstring* localUri);
+
+    /// <summary>
+    /// Gets the platform backend the Compat library sends toasts, history, registry and identity calls through.
+    /// </summary>
+    INotificationPlatform& Platform();
+
+    /// <summary>
+    /// Opts in to tracing each toast from ShowToast to its activation. Spans are recorded for the show and the activation,
+    /// and for builds the app wraps in a ToastTraceScope on Tracer(); export them with Tracer()->WriteChromeTrace.
+    /// Call it once; the tracer is never replaced, so a second call returns E_ILLEGAL_METHOD_CALL.
+    /// </summary>
+    HRESULT UseTracing(ToastTracerOptions options = ToastTracerOptions());
+
+    /// <summary>
+    /// Null until UseTracing is called, so a ToastTraceScope on it does nothing.
+    /// </summary>
+    ToastTracer* Tracer();
+
+    /// <summary>
+    /// Gets the metrics that count and time every ShowToast and DispatchActivation, and count failures by HRESULT, including
+    /// those of activation handlers. Always on; Snapshot() can be taken at any time. Returns E_ILLEGAL_METHOD_CALL if
+    /// RegisterAumidAndComServer hasn't been called.
+    /// </summary>
+    HRESULT get_Metrics(ToastMetrics** metrics);
+
     /// <summary>
     /// Gets the DesktopNotificationHistoryCompat object. You must have called RegisterActivator first (and also RegisterAumidAndComServer if you're a classic Win32 app), or this will throw an exception.
     /// </summary>
     HRESULT get_History(std::unique_ptr<DesktopNotificationHistoryCompat>* history);
 
+    /// <summary>
+    /// Opts in to keeping scheduled toasts in the app rather than the platform's schedule, which isn't built for large numbers
+    /// of them. Toasts are held in a timer wheel and handed to the platform once they're within options.PlatformWindow of their
+    /// delivery time. You must have called RegisterActivator first (and also RegisterAumidAndComServer if you're a classic Win32 app).
+    /// </summary>
+    HRESULT UseScheduler(ToastSchedulerOptions options);
+
+    /// <summary>
+    /// Like UseScheduler, but also keeps the schedule in a journal file so it survives the app exiting. Toasts that were pending
+    /// when the app last exited are restored from the journal, and handed to the platform again as they come due.
+    /// </summary>
+    /// <param name="journalPath">The journal file, which is created if it doesn't exist. Only one process should use it at a time.</param>
+    HRESULT UseScheduler(const std::filesystem::path& journalPath, ToastSchedulerOptions options, ToastScheduleJournalOptions journalOptions = ToastScheduleJournalOptions());
+
+    /// <summary>
+    /// Gets the scheduler created by UseScheduler. Returns E_ILLEGAL_METHOD_CALL if UseScheduler hasn't been called.
+    /// </summary>
+    HRESULT get_Scheduler(ToastScheduler** scheduler);
+
     /// <summary>
     /// Gets a boolean representing whether http images can be used within toasts. This is true if running under Desktop Bridge.
     /// </summary>
     bool CanUseHttpImages();
+
+    /// <summary>
+    /// Removes the app's scheduled and current notifications and its AUMID registration, and deletes the schedule journal and
+    /// cached images. Does nothing for packaged containerized apps, which are cleaned up automatically. Carries on past failures,
+    /// and returns the first.
+    /// </summary>
+    HRESULT Uninstall();
 }
 
 class DesktopNotificationHistoryCompat
@@ -97,12 +289,47 @@ public:
     /// <param name="group">The group label of the toast notifications to be removed.</param>
     HRESULT RemoveGroup(const wchar_t *group);
 
+    /// <summary>
+    /// Removes many toast notifications and groups from action center at once. Duplicates are dropped and the rest are
+    /// removed in batches, spread over a few worker threads. Returns S_OK if everything was removed, or the first failure.
+    /// </summary>
+    /// <param name="toasts">The tag and group labels of the toast notifications to be removed.</param>
+    /// <param name="groups">The group labels of whole groups to be removed.</param>
+    /// <param name="results">Receives the result for each toast and group, in the order they were passed in.</param>
+    HRESULT RemoveMany(const std::vector<ToastHistoryEntry>& toasts, const std::vector<std::wstring>& groups, ToastHistoryBatchResults* results, ToastHistoryBatchOptions options = ToastHistoryBatchOptions());
+
+    /// <summary>
+    /// Removes every toast notification in action center that the predicate matches, reading the history only once.
+    /// </summary>
+    /// <param name="removed">Receives the matched toasts, in the same order as results->Toasts.</param>
+    HRESULT RemoveWhere(const std::function<bool(const ToastHistoryEntry&)>& predicate, std::vector<ToastHistoryEntry>* removed, ToastHistoryBatchResults* results, ToastHistoryBatchOptions options = ToastHistoryBatchOptions());
+
+    /// <summary>
+    /// Checks whether a toast with this tag and group is in action center, using the local index of toasts shown through
+    /// ShowToast rather than calling the platform. Call Reconcile to pick up toasts the user has dismissed since.
+    /// </summary>
+    bool Contains(const wchar_t *tag, const wchar_t *group);
+
+    /// <summary>
+    /// Gets the toasts in a group, from the local index.
+    /// </summary>
+    std::vector<ToastHistoryEntry> GetGroup(const wchar_t *group);
+
+    /// <summary>
+    /// Gets the toasts whose launch arguments contain key=value, from the local index.
+    /// </summary>
+    std::vector<ToastHistoryEntry> FindByArgument(const wchar_t *key, const wchar_t *value);
+
+    /// <summary>
+    /// Updates the local index from the platform's history, adding and removing only the toasts that differ.
+    /// </summary>
+    HRESULT Reconcile(ToastHistoryReconcileResult* result);
+
     /// <summary>
     /// Do not call this. Instead, call DesktopNotificationManagerCompat.get_History() to obtain an instance.
     /// </summary>
-    DesktopNotificationHistoryCompat(const wchar_t *aumid, Microsoft::WRL::ComPtr<IToastNotificationHistory> history);
+    DesktopNotificationHistoryCompat(DesktopNotificationManager* manager);
 
 private:
-    std::wstring m_aumid;
-    Microsoft::WRL::ComPtr<IToastNotificationHistory> m_history = nullptr;
+    DesktopNotificationManager* m_manager;
 };
\ No newline at end of file
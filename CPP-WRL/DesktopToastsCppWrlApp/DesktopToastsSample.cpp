@@ -13,6 +13,10 @@
 #include <atlstr.h>
 #include "DesktopNotificationManagerCompat.h"
 #include "NotificationActivationCallback.h"
+#include "ToastPayloadMinifier.h"
+#include "ToastTemplate.h"
+#include "ToastArguments.h"
+#include "ToastActionRouter.h"
 #include <SDKDDKVer.h>
 #include <string>
 #include <windows.ui.notifications.h>
@@ -70,20 +74,6 @@ private:
     static HRESULT ShowToast(
         _In_ ABI::Windows::Data::Xml::Dom::IXmlDocument* xml
         );
-    static HRESULT DesktopToastsApp::SetImageSrc(
-        _In_ PCWSTR imagePath,
-        _In_ ABI::Windows::Data::Xml::Dom::IXmlDocument* toastXml
-        );
-    static HRESULT DesktopToastsApp::SetTextValues(
-        _In_reads_(textValuesCount) const PCWSTR* textValues,
-        _In_ UINT32 textValuesCount,
-        _Inout_ ABI::Windows::Data::Xml::Dom::IXmlDocument* toastXml
-        );
-    static HRESULT DesktopToastsApp::SetNodeValueString(
-        _In_ HSTRING onputString,
-        _Inout_ ABI::Windows::Data::Xml::Dom::IXmlNode* node,
-        _In_ ABI::Windows::Data::Xml::Dom::IXmlDocument* xml
-        );
 
     HINSTANCE m_hInstance;
     HWND m_hwnd = nullptr;
@@ -98,6 +88,23 @@ private:
 
 DesktopToastsApp* DesktopToastsApp::s_currentInstance = nullptr;
 
+enum class ToastAction
+{
+    None,
+    Reply,
+    Like,
+    ViewImage,
+    ViewConversation
+};
+
+// Maps the action in our toasts' arguments to what Activate should do
+constexpr auto s_actionRouter = MakeToastActionRouter<ToastAction>({
+    { L"reply", ToastAction::Reply },
+    { L"like", ToastAction::Like },
+    { L"viewImage", ToastAction::ViewImage },
+    { L"viewConversation", ToastAction::ViewConversation }
+});
+
 // For the app to be activated from Action Center, it needs to provide a COM server to be called
 // when the notification is activated.  The CLSID of the object needs to be registered with the
 // OS via its shortcut so that it knows who to call later. The WiX installer adds that to the shortcut.
@@ -112,39 +119,52 @@ public:
         _In_reads_(dataCount) const NOTIFICATION_USER_INPUT_DATA* data,
         ULONG dataCount) override
     {
-        std::wstring arguments(invokedArgs);
+        // The arguments and user input are copied, because the handler may run on a worker thread after we've returned,
+        // or on the next start if this process dies first.
+        // A failure, whether dispatching or in the handler, is counted by HRESULT in DesktopNotificationManagerCompat::get_Metrics()
+        DesktopNotificationManagerCompat::DispatchActivation(ActivationEventArgs(invokedArgs, data, dataCount), HandleActivation);
+
+        return S_OK;
+    }
+
+    static HRESULT HandleActivation(const ActivationEventArgs& args)
+    {
         HRESULT hr;
+        ToastAction action = s_actionRouter.Lookup(ToastArguments(args.Argument()).Action(), ToastAction::None);
+
+        // Get the response user typed (we know this is first and only user input since our toasts only have one input)
+        std::wstring response(args.UserInputCount() > 0 ? args.UserInputAt(0).Value : std::wstring_view());
 
         // Background: Quick reply to the conversation
-        if (arguments.find(L"action=reply") == 0)
+        if (action == ToastAction::Reply)
         {
-            // Get the response user typed (we know this is first and only user input since our toasts only have one input)
-            LPCWSTR response = data[0].Value;
-
-            hr = DesktopToastsApp::SendBasicToast(response);
+            hr = DesktopToastsApp::SendBasicToast(response.c_str());
         }
 
         // Background: Send a like
-        else if (arguments.find(L"action=like") == 0)
+        else if (action == ToastAction::Like)
         {
             hr = DesktopToastsApp::SendBasicToast(L"Sending like...");
         }
 
         else
         {
-            // The remaining scenarios are foreground activations,
-            // so we first make sure we have a window open and in foreground
+            // The remaining scenarios are foreground activations, so if we were launched from the toast
+            // wWinMain carries on into the message loop instead of returning
+            DesktopNotificationManagerCompat::KeepRunning();
+
+            // Then we make sure we have a window open and in foreground
             hr = DesktopToastsApp::GetInstance()->OpenWindowIfNeeded();
             if (SUCCEEDED(hr))
             {
                 // Open the image
-                if (arguments.find(L"action=viewImage") == 0)
+                if (action == ToastAction::ViewImage)
                 {
                     DesktopToastsApp::GetInstance()->SetMessage(L"NotificationActivator - The user wants to view the image.");
                 }
 
                 // Open the conversation
-                else if (arguments.find(L"action=viewConversation") == 0)
+                else if (action == ToastAction::ViewConversation)
                 {
                     DesktopToastsApp::GetInstance()->SetMessage(L"NotificationActivator - The user wants to view the conversation.");
                 }
@@ -157,27 +177,18 @@ public:
             }
         }
 
-        if (FAILED(hr))
-        {
-            // Log failed HRESULT
-        }
-
-        return S_OK;
-    }
-
-    ~NotificationActivator()
-    {
-        // If we don't have window open
-        if (!DesktopToastsApp::GetInstance()->HasWindow())
-        {
-            // Exit
-            exit(0);
-        }
+        return hr;
     }
 };
 CoCreatableClass(NotificationActivator);
 
 
+// Where activations wait until they've been handled, so a toast launch and a normal launch share it
+std::filesystem::path ActivationJournalPath()
+{
+    return std::filesystem::temp_directory_path() / L"DesktopToastsCpp" / L"activations.journal";
+}
+
 // Main function
 int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE, _In_ LPWSTR cmdLineArgs, _In_ int)
 {
@@ -185,12 +196,6 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE, _In_ LPWSTR cm
 
     RETURN_IF_FAILED(winRtInitializer);
 
-    // Register AUMID and COM server (for Desktop Bridge apps, this no-ops)
-    RETURN_IF_FAILED(DesktopNotificationManagerCompat::RegisterAumidAndComServer(L"WindowsNotifications.DesktopToastsCpp", __uuidof(NotificationActivator)));
-
-    // Register activator type
-    RETURN_IF_FAILED(DesktopNotificationManagerCompat::RegisterActivator());
-
     // Create our desktop app
     DesktopToastsApp app;
     app.SetHInstance(hInstance);
@@ -200,13 +205,37 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE, _In_ LPWSTR cm
     // If launched from toast
     if (cmdLineArgsStr.find(TOAST_ACTIVATED_LAUNCH_ARG) != std::string::npos)
     {
-        // Let our NotificationActivator handle activation
+        // COM launched us through our registration, so there's nothing to register but the activator
+        RETURN_IF_FAILED(DesktopNotificationManagerCompat::RegisterForActivation(L"WindowsNotifications.DesktopToastsCpp"));
+
+        // Make sure this thread has a message queue before any activation can post to it to open the window
+        MSG msg;
+        PeekMessage(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+
+        // A like or reply the last run didn't finish sending is sent now
+        RETURN_IF_FAILED(DesktopNotificationManagerCompat::UseActivationJournal(ActivationJournalPath(), ActivationJournalOptions(), NotificationActivator::HandleActivation));
+
+        // Let our NotificationActivator handle activation, then exit unless it opened the window
+        ActivationStartupTimings timings;
+        DesktopNotificationManagerCompat::WaitForActivations(ActivationStartupOptions(), &timings);
+        if (!timings.KeptRunning)
+        {
+            return 0;
+        }
     }
 
     else
     {
+        // Register AUMID and COM server (for Desktop Bridge apps, this no-ops)
+        RETURN_IF_FAILED(DesktopNotificationManagerCompat::RegisterAumidAndComServer(L"WindowsNotifications.DesktopToastsCpp", __uuidof(NotificationActivator)));
+
+        // Register activator type
+        RETURN_IF_FAILED(DesktopNotificationManagerCompat::RegisterActivator());
+
         // Otherwise launch like normal
         RETURN_IF_FAILED(app.Initialize(hInstance));
+
+        RETURN_IF_FAILED(DesktopNotificationManagerCompat::UseActivationJournal(ActivationJournalPath(), ActivationJournalOptions(), NotificationActivator::HandleActivation));
     }
 
     app.RunMessageLoop();
@@ -358,92 +387,35 @@ HRESULT DesktopToastsApp::DisplayToast()
 _Use_decl_annotations_
 HRESULT DesktopToastsApp::CreateToastXml(IXmlDocument **toastXml)
 {
-    ComPtr<IXmlDocument> doc;
-    RETURN_IF_FAILED(DesktopNotificationManagerCompat::CreateXmlDocumentFromString(LR"(<toast launch="action=viewConversation&amp;conversationId=5">
+    // The template is parsed once; each toast only splices the values into the recorded slots
+    static const ToastTemplate conversationTemplate(LR"(<toast launch="action=viewConversation&amp;conversationId={conversationId}">
     <visual>
         <binding template="ToastGeneric">
-            <text></text>
-            <text></text>
+            <text>{title}</text>
+            <text>{body}</text>
         </binding>
     </visual>
     <actions>
         <input id="tbReply" type="text" placeHolderContent="Type a response"/>
-        <action content="Reply" arguments="action=reply&amp;conversationId=5"/>
-        <action content="Like" arguments="action=like&amp;conversationId=5"/>
-        <action content="View" arguments="action=viewImage&amp;imageUrl=https://picsum.photos/364/202?image=883"/>
+        <action content="Reply" arguments="action=reply&amp;conversationId={conversationId}"/>
+        <action content="Like" arguments="action=like&amp;conversationId={conversationId}"/>
+        <action content="View" arguments="action=viewImage&amp;imageUrl={imageUrl}"/>
     </actions>
-</toast>)", &doc));
-
-    PCWSTR textValues[] = {
-        L"Andrew sent you a picture",
-        L"Check this out, The Enchantments!"
-    };
-    SetTextValues(textValues, ARRAYSIZE(textValues), doc.Get());
-
-    return doc.CopyTo(toastXml);
-}
-
-// Set the value of the "src" attribute of the "image" node
-_Use_decl_annotations_
-HRESULT DesktopToastsApp::SetImageSrc(PCWSTR imagePath, IXmlDocument* toastXml)
-{
-    wchar_t imageSrcUri[MAX_PATH];
-    DWORD size = ARRAYSIZE(imageSrcUri);
-
-    RETURN_IF_FAILED(::UrlCreateFromPath(imagePath, imageSrcUri, &size, 0));
-
-    ComPtr<IXmlNodeList> nodeList;
-    RETURN_IF_FAILED(toastXml->GetElementsByTagName(HStringReference(L"image").Get(), &nodeList));
-
-    ComPtr<IXmlNode> imageNode;
-    RETURN_IF_FAILED(nodeList->Item(0, &imageNode));
+</toast>)");
 
-    ComPtr<IXmlNamedNodeMap> attributes;
+    ToastTemplateValues values = conversationTemplate.CreateValues();
+    values.Set(L"conversationId", L"5");
+    values.Set(L"title", L"Andrew sent you a picture");
+    values.Set(L"body", L"Check this out, The Enchantments!");
+    values.Set(L"imageUrl", L"https://picsum.photos/364/202?image=883");
 
-    RETURN_IF_FAILED(imageNode->get_Attributes(&attributes));
+    // The indentation is stripped and the size checked before the platform sees it, so an oversize toast fails here
+    static const ToastPayloadMinifier minifier;
+    std::wstring xml;
+    RETURN_IF_FAILED(minifier.Minify(conversationTemplate.Render(values), xml));
 
-    ComPtr<IXmlNode> srcAttribute;
-    RETURN_IF_FAILED(attributes->GetNamedItem(HStringReference(L"src").Get(), &srcAttribute));
-
-    return SetNodeValueString(HStringReference(imageSrcUri).Get(), srcAttribute.Get(), toastXml);
-}
-
-// Set the values of each of the text nodes
-_Use_decl_annotations_
-HRESULT DesktopToastsApp::SetTextValues(const PCWSTR* textValues, UINT32 textValuesCount, IXmlDocument* toastXml)
-{
-    ComPtr<IXmlNodeList> nodeList;
-    RETURN_IF_FAILED(toastXml->GetElementsByTagName(HStringReference(L"text").Get(), &nodeList));
-
-    UINT32 nodeListLength;
-    RETURN_IF_FAILED(nodeList->get_Length(&nodeListLength));
-
-    // If a template was chosen with fewer text elements, also change the amount of strings
-    // passed to this method.
-    RETURN_IF_FAILED(textValuesCount <= nodeListLength ? S_OK : E_INVALIDARG);
-
-    for (UINT32 i = 0; i < textValuesCount; i++)
-    {
-        ComPtr<IXmlNode> textNode;
-        RETURN_IF_FAILED(nodeList->Item(i, &textNode));
-
-        RETURN_IF_FAILED(SetNodeValueString(HStringReference(textValues[i]).Get(), textNode.Get(), toastXml));
-    }
-
-    return S_OK;
-}
-
-_Use_decl_annotations_
-HRESULT DesktopToastsApp::SetNodeValueString(HSTRING inputString, IXmlNode* node, IXmlDocument* xml)
-{
-    ComPtr<IXmlText> inputText;
-    RETURN_IF_FAILED(xml->CreateTextNode(inputString, &inputText));
-
-    ComPtr<IXmlNode> inputTextNode;
-    RETURN_IF_FAILED(inputText.As(&inputTextNode));
-
-    ComPtr<IXmlNode> appendedChild;
-    return node->AppendChild(inputTextNode.Get(), &appendedChild);
+    // Only the final hand-off creates the platform document
+    return DesktopNotificationManagerCompat::CreateXmlDocumentFromString(xml.c_str(), toastXml);
 }
 
 // Create and display the toast
@@ -531,19 +503,16 @@ LRESULT CALLBACK DesktopToastsApp::WndProc(HWND hwnd, UINT32 message, WPARAM wPa
 
 HRESULT DesktopToastsApp::SendBasicToast(PCWSTR message)
 {
-    ComPtr<IXmlDocument> doc;
-    RETURN_IF_FAILED(DesktopNotificationManagerCompat::CreateXmlDocumentFromString(LR"(<toast>
+    static const ToastTemplate basicTemplate(LR"(<toast>
     <visual>
         <binding template="ToastGeneric">
-            <text></text>
+            <text>{message}</text>
         </binding>
     </visual>
-</toast>)", &doc));
+</toast>)");
 
-    PCWSTR textValues[] = {
-        message
-    };
-    RETURN_IF_FAILED(SetTextValues(textValues, ARRAYSIZE(textValues), doc.Get()));
+    ComPtr<IXmlDocument> doc;
+    RETURN_IF_FAILED(DesktopNotificationManagerCompat::CreateXmlDocumentFromString(basicTemplate.Render({ message }).c_str(), &doc));
 
     return ShowToast(doc.Get());
 }
\ No newline at end of file
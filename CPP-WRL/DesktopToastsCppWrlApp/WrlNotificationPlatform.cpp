@@ -0,0 +1,694 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "WrlNotificationPlatform.h"
+#include <appmodel.h>
+#include <chrono>
+#include <wrl\wrappers\corewrappers.h>
+
+#define RETURN_IF_FAILED(hr) do { HRESULT _hrTemp = hr; if (FAILED(_hrTemp)) { return _hrTemp; } } while (false)
+
+using namespace ABI::Windows::Data::Xml::Dom;
+using namespace ABI::Windows::Foundation;
+using namespace ABI::Windows::Foundation::Collections;
+using namespace ABI::Windows::UI::Notifications;
+using namespace Microsoft::WRL;
+using namespace Microsoft::WRL::Wrappers;
+
+namespace
+{
+    const std::wstring s_toastNotificationManagerClass(RuntimeClass_Windows_UI_Notifications_ToastNotificationManager);
+    const std::wstring s_toastNotificationClass(RuntimeClass_Windows_UI_Notifications_ToastNotification);
+    const std::wstring s_scheduledToastNotificationClass(RuntimeClass_Windows_UI_Notifications_ScheduledToastNotification);
+
+    // DateTime counts 100ns ticks since 1601, system_clock since 1970
+    using Ticks = std::chrono::duration<INT64, std::ratio<1, 10000000>>;
+    constexpr INT64 s_unixEpochTicks = 116444736000000000LL;
+
+    HRESULT RemoveOne(IToastNotificationHistory* history, const std::wstring& aumid, const std::wstring& tag, const std::wstring& group)
+    {
+        if (!aumid.empty())
+        {
+            return history->RemoveGroupedTagWithId(HStringReference(tag.c_str()).Get(), HStringReference(group.c_str()).Get(), HStringReference(aumid.c_str()).Get());
+        }
+        else if (group.empty())
+        {
+            return history->Remove(HStringReference(tag.c_str()).Get());
+        }
+        else
+        {
+            return history->RemoveGroupedTag(HStringReference(tag.c_str()).Get(), HStringReference(group.c_str()).Get());
+        }
+    }
+
+    DateTime ToDateTime(std::chrono::system_clock::time_point time)
+    {
+        DateTime dateTime;
+        dateTime.UniversalTime = std::chrono::duration_cast<Ticks>(time.time_since_epoch()).count() + s_unixEpochTicks;
+        return dateTime;
+    }
+
+    std::chrono::system_clock::time_point ToTimePoint(DateTime dateTime)
+    {
+        return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(Ticks(dateTime.UniversalTime - s_unixEpochTicks)));
+    }
+
+    std::wstring ToString(const HString& value)
+    {
+        unsigned int length;
+        const wchar_t* buffer = value.GetRawBuffer(&length);
+        return std::wstring(buffer, length);
+    }
+
+    HRESULT GetXml(IXmlDocument* doc, std::wstring* xml)
+    {
+        ComPtr<IXmlDocument> content(doc);
+        ComPtr<IXmlNodeSerializer> serializer;
+        RETURN_IF_FAILED(content.As(&serializer));
+
+        HString value;
+        RETURN_IF_FAILED(serializer->GetXml(value.GetAddressOf()));
+        *xml = ToString(value);
+        return S_OK;
+    }
+
+    HRESULT ToHistoryEntry(IToastNotification* toast, ToastHistoryEntry* entry)
+    {
+        ComPtr<IToastNotification> notification(toast);
+        ComPtr<IToastNotification2> notification2;
+        RETURN_IF_FAILED(notification.As(&notification2));
+
+        HString tag;
+        HString group;
+        RETURN_IF_FAILED(notification2->get_Tag(tag.GetAddressOf()));
+        RETURN_IF_FAILED(notification2->get_Group(group.GetAddressOf()));
+
+        ComPtr<IXmlDocument> content;
+        ComPtr<IXmlElement> root;
+        HString launch;
+        RETURN_IF_FAILED(notification->get_Content(&content));
+        RETURN_IF_FAILED(content->get_DocumentElement(&root));
+        RETURN_IF_FAILED(root->GetAttribute(HStringReference(L"launch").Get(), launch.GetAddressOf()));
+
+        entry->Tag = ToString(tag);
+        entry->Group = ToString(group);
+        entry->Launch = ToString(launch);
+        return S_OK;
+    }
+
+    HRESULT CreateNotificationData(const ToastData& data, ComPtr<INotificationData>* notificationData)
+    {
+        ComPtr<INotificationData> created;
+        RETURN_IF_FAILED(Windows::Foundation::ActivateInstance(HStringReference(RuntimeClass_Windows_UI_Notifications_NotificationData).Get(), &created));
+
+        ComPtr<IMap<HSTRING, HSTRING>> values;
+        RETURN_IF_FAILED(created->get_Values(&values));
+        for (const ToastDataValue& value : data.Values)
+        {
+            boolean replaced;
+            RETURN_IF_FAILED(values->Insert(HStringReference(value.Key.c_str()).Get(), HStringReference(value.Value.c_str()).Get(), &replaced));
+        }
+        RETURN_IF_FAILED(created->put_SequenceNumber(data.SequenceNumber));
+
+        *notificationData = created;
+        return S_OK;
+    }
+
+    HRESULT ToScheduledToast(IScheduledToastNotification* toast, ScheduledToast* scheduled)
+    {
+        ComPtr<IScheduledToastNotification> notification(toast);
+        ComPtr<IScheduledToastNotification2> notification2;
+        RETURN_IF_FAILED(notification.As(&notification2));
+
+        HString id;
+        HString tag;
+        HString group;
+        DateTime deliveryTime;
+        ComPtr<IXmlDocument> content;
+        RETURN_IF_FAILED(notification->get_Id(id.GetAddressOf()));
+        RETURN_IF_FAILED(notification2->get_Tag(tag.GetAddressOf()));
+        RETURN_IF_FAILED(notification2->get_Group(group.GetAddressOf()));
+        RETURN_IF_FAILED(notification->get_DeliveryTime(&deliveryTime));
+        RETURN_IF_FAILED(notification->get_Content(&content));
+        RETURN_IF_FAILED(GetXml(content.Get(), &scheduled->Payload.Xml));
+
+        scheduled->Id = ToString(id);
+        scheduled->Payload.Tag = ToString(tag);
+        scheduled->Payload.Group = ToString(group);
+        scheduled->DeliveryTime = ToTimePoint(deliveryTime);
+        return S_OK;
+    }
+}
+
+HRESULT WrlNotificationPlatform::GetNotifier(const std::wstring& aumid, ComPtr<IToastNotifier>* notifier)
+{
+    HRESULT hr = S_OK;
+    m_notifierCache.TryGetOrCreate(aumid, *notifier, [this, &aumid, &hr](ComPtr<IToastNotifier>& created)
+    {
+        ComPtr<IToastNotificationManagerStatics> toastStatics;
+        hr = GetToastNotificationManagerStatics(&toastStatics);
+        if (SUCCEEDED(hr))
+        {
+            if (aumid.empty())
+            {
+                hr = toastStatics->CreateToastNotifier(&created);
+            }
+            else
+            {
+                hr = toastStatics->CreateToastNotifierWithId(HStringReference(aumid.c_str()).Get(), &created);
+            }
+        }
+        return SUCCEEDED(hr);
+    });
+    return hr;
+}
+
+HRESULT WrlNotificationPlatform::GetNativeHistory(ComPtr<IToastNotificationHistory>* history)
+{
+    // There's a single history object; the AUMID is passed to each of its calls instead
+    HRESULT hr = S_OK;
+    m_historyCache.TryGetOrCreate(L"", *history, [this, &hr](ComPtr<IToastNotificationHistory>& created)
+    {
+        ComPtr<IToastNotificationManagerStatics> toastStatics;
+        ComPtr<IToastNotificationManagerStatics2> toastStatics2;
+        hr = GetToastNotificationManagerStatics(&toastStatics);
+        if (SUCCEEDED(hr))
+        {
+            hr = toastStatics.As(&toastStatics2);
+        }
+        if (SUCCEEDED(hr))
+        {
+            hr = toastStatics2->get_History(&created);
+        }
+        return SUCCEEDED(hr);
+    });
+    return hr;
+}
+
+HRESULT WrlNotificationPlatform::CreateToastNotification(IXmlDocument* content, IToastNotification** notification)
+{
+    HRESULT hr = S_OK;
+    ComPtr<IToastNotificationFactory> factory;
+    m_notificationFactoryCache.TryGetOrCreate(s_toastNotificationClass, factory, [&hr](ComPtr<IToastNotificationFactory>& created)
+    {
+        hr = Windows::Foundation::GetActivationFactory(
+            HStringReference(RuntimeClass_Windows_UI_Notifications_ToastNotification).Get(),
+            &created);
+        return SUCCEEDED(hr);
+    });
+    RETURN_IF_FAILED(hr);
+
+    return factory->CreateToastNotification(content, notification);
+}
+
+HRESULT WrlNotificationPlatform::CreateXmlDocumentFromString(const wchar_t* xmlString, IXmlDocument** doc)
+{
+    ComPtr<IXmlDocument> answer;
+    RETURN_IF_FAILED(Windows::Foundation::ActivateInstance(HStringReference(RuntimeClass_Windows_Data_Xml_Dom_XmlDocument).Get(), &answer));
+
+    ComPtr<IXmlDocumentIO> docIO;
+    RETURN_IF_FAILED(answer.As(&docIO));
+
+    // Load the XML string
+    RETURN_IF_FAILED(docIO->LoadXml(HStringReference(xmlString).Get()));
+
+    return answer.CopyTo(doc);
+}
+
+ToastResult WrlNotificationPlatform::Show(const std::wstring& aumid, const ToastPayload& payload)
+{
+    ComPtr<IXmlDocument> doc;
+    RETURN_IF_FAILED(CreateXmlDocumentFromString(payload.Xml.c_str(), &doc));
+
+    ComPtr<IToastNotification> toast;
+    RETURN_IF_FAILED(CreateToastNotification(doc.Get(), &toast));
+
+    if (!payload.Tag.empty() || !payload.Group.empty())
+    {
+        ComPtr<IToastNotification2> toast2;
+        RETURN_IF_FAILED(toast.As(&toast2));
+
+        if (!payload.Tag.empty())
+        {
+            RETURN_IF_FAILED(toast2->put_Tag(HStringReference(payload.Tag.c_str()).Get()));
+        }
+        if (!payload.Group.empty())
+        {
+            RETURN_IF_FAILED(toast2->put_Group(HStringReference(payload.Group.c_str()).Get()));
+        }
+    }
+
+    if (!payload.Data.Values.empty())
+    {
+        ComPtr<IToastNotification4> toast4;
+        ComPtr<INotificationData> data;
+        RETURN_IF_FAILED(toast.As(&toast4));
+        RETURN_IF_FAILED(CreateNotificationData(payload.Data, &data));
+        RETURN_IF_FAILED(toast4->put_Data(data.Get()));
+    }
+
+    ComPtr<IToastNotifier> notifier;
+    RETURN_IF_FAILED(GetNotifier(aumid, &notifier));
+
+    return notifier->Show(toast.Get());
+}
+
+ToastResult WrlNotificationPlatform::Update(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group, const ToastData& data)
+{
+    ComPtr<IToastNotifier> notifier;
+    ComPtr<IToastNotifier2> notifier2;
+    RETURN_IF_FAILED(GetNotifier(aumid, &notifier));
+    RETURN_IF_FAILED(notifier.As(&notifier2));
+
+    ComPtr<INotificationData> notificationData;
+    RETURN_IF_FAILED(CreateNotificationData(data, &notificationData));
+
+    NotificationUpdateResult result;
+    if (group.empty())
+    {
+        RETURN_IF_FAILED(notifier2->UpdateWithTag(notificationData.Get(), HStringReference(tag.c_str()).Get(), &result));
+    }
+    else
+    {
+        RETURN_IF_FAILED(notifier2->UpdateWithTagAndGroup(notificationData.Get(), HStringReference(tag.c_str()).Get(), HStringReference(group.c_str()).Get(), &result));
+    }
+
+    switch (result)
+    {
+    case NotificationUpdateResult_NotificationNotFound:
+        return ToastResultNotFound;
+    case NotificationUpdateResult_Failed:
+        return ToastResultFail;
+    default:
+        return ToastResultOk;
+    }
+}
+
+ToastResult WrlNotificationPlatform::GetHistory(const std::wstring& aumid, std::vector<ToastHistoryEntry>& entries)
+{
+    ComPtr<IToastNotificationHistory> history;
+    ComPtr<IToastNotificationHistory2> history2;
+    RETURN_IF_FAILED(GetNativeHistory(&history));
+    RETURN_IF_FAILED(history.As(&history2));
+
+    ComPtr<IVectorView<ToastNotification*>> toasts;
+    if (aumid.empty())
+    {
+        RETURN_IF_FAILED(history2->GetHistory(&toasts));
+    }
+    else
+    {
+        RETURN_IF_FAILED(history2->GetHistoryWithId(HStringReference(aumid.c_str()).Get(), &toasts));
+    }
+
+    unsigned int size;
+    RETURN_IF_FAILED(toasts->get_Size(&size));
+
+    entries.clear();
+    entries.reserve(size);
+    for (unsigned int i = 0; i < size; i++)
+    {
+        ComPtr<IToastNotification> toast;
+        RETURN_IF_FAILED(toasts->GetAt(i, &toast));
+
+        ToastHistoryEntry entry;
+        RETURN_IF_FAILED(ToHistoryEntry(toast.Get(), &entry));
+        entries.push_back(std::move(entry));
+    }
+
+    return S_OK;
+}
+
+ToastResult WrlNotificationPlatform::RemoveFromHistory(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group)
+{
+    ComPtr<IToastNotificationHistory> history;
+    RETURN_IF_FAILED(GetNativeHistory(&history));
+    return RemoveOne(history.Get(), aumid, tag, group);
+}
+
+void WrlNotificationPlatform::RemoveBatchFromHistory(const std::wstring& aumid, const std::vector<ToastHistoryEntry>& toasts, std::vector<ToastResult>& results)
+{
+    // IToastNotificationHistory removes one toast per call, so the batch saves the history lookup each
+    // RemoveFromHistory call would otherwise repeat
+    results.clear();
+    ComPtr<IToastNotificationHistory> history;
+    HRESULT hr = GetNativeHistory(&history);
+    if (FAILED(hr))
+    {
+        results.assign(toasts.size(), hr);
+        return;
+    }
+
+    results.reserve(toasts.size());
+    for (const ToastHistoryEntry& toast : toasts)
+    {
+        results.push_back(RemoveOne(history.Get(), aumid, toast.Tag, toast.Group));
+    }
+}
+
+ToastResult WrlNotificationPlatform::RemoveGroupFromHistory(const std::wstring& aumid, const std::wstring& group)
+{
+    ComPtr<IToastNotificationHistory> history;
+    RETURN_IF_FAILED(GetNativeHistory(&history));
+
+    if (aumid.empty())
+    {
+        return history->RemoveGroup(HStringReference(group.c_str()).Get());
+    }
+    else
+    {
+        return history->RemoveGroupWithId(HStringReference(group.c_str()).Get(), HStringReference(aumid.c_str()).Get());
+    }
+}
+
+ToastResult WrlNotificationPlatform::ClearHistory(const std::wstring& aumid)
+{
+    ComPtr<IToastNotificationHistory> history;
+    RETURN_IF_FAILED(GetNativeHistory(&history));
+
+    if (aumid.empty())
+    {
+        return history->Clear();
+    }
+    else
+    {
+        return history->ClearWithId(HStringReference(aumid.c_str()).Get());
+    }
+}
+
+ToastResult WrlNotificationPlatform::AddToSchedule(const std::wstring& aumid, const ScheduledToast& toast)
+{
+    ComPtr<IScheduledToastNotification> scheduled;
+    RETURN_IF_FAILED(CreateScheduledToastNotification(toast, &scheduled));
+
+    ComPtr<IToastNotifier> notifier;
+    RETURN_IF_FAILED(GetNotifier(aumid, &notifier));
+
+    return notifier->AddToSchedule(scheduled.Get());
+}
+
+ToastResult WrlNotificationPlatform::GetScheduled(const std::wstring& aumid, std::vector<ScheduledToast>& toasts)
+{
+    ComPtr<IToastNotifier> notifier;
+    ComPtr<IVectorView<ScheduledToastNotification*>> scheduled;
+    RETURN_IF_FAILED(GetScheduledToastNotifications(aumid, &notifier, &scheduled));
+
+    unsigned int size;
+    RETURN_IF_FAILED(scheduled->get_Size(&size));
+
+    toasts.clear();
+    toasts.reserve(size);
+    for (unsigned int i = 0; i < size; i++)
+    {
+        ComPtr<IScheduledToastNotification> toast;
+        RETURN_IF_FAILED(scheduled->GetAt(i, &toast));
+
+        ScheduledToast entry;
+        RETURN_IF_FAILED(ToScheduledToast(toast.Get(), &entry));
+        toasts.push_back(std::move(entry));
+    }
+
+    return S_OK;
+}
+
+ToastResult WrlNotificationPlatform::RemoveFromSchedule(const std::wstring& aumid, const std::wstring& id)
+{
+    ComPtr<IToastNotifier> notifier;
+    ComPtr<IVectorView<ScheduledToastNotification*>> scheduled;
+    RETURN_IF_FAILED(GetScheduledToastNotifications(aumid, &notifier, &scheduled));
+
+    unsigned int size;
+    RETURN_IF_FAILED(scheduled->get_Size(&size));
+
+    bool found = false;
+    for (unsigned int i = 0; i < size; i++)
+    {
+        ComPtr<IScheduledToastNotification> toast;
+        HString toastId;
+        RETURN_IF_FAILED(scheduled->GetAt(i, &toast));
+        RETURN_IF_FAILED(toast->get_Id(toastId.GetAddressOf()));
+
+        if (ToString(toastId) == id)
+        {
+            RETURN_IF_FAILED(notifier->RemoveFromSchedule(toast.Get()));
+            found = true;
+        }
+    }
+
+    return found ? S_OK : ToastResultNotFound;
+}
+
+ToastResult WrlNotificationPlatform::ClearSchedule(const std::wstring& aumid)
+{
+    ComPtr<IToastNotifier> notifier;
+    ComPtr<IVectorView<ScheduledToastNotification*>> scheduled;
+    RETURN_IF_FAILED(GetScheduledToastNotifications(aumid, &notifier, &scheduled));
+
+    unsigned int size;
+    RETURN_IF_FAILED(scheduled->get_Size(&size));
+
+    // Keep going past toasts that can't be removed, and report the first failure
+    HRESULT result = S_OK;
+    for (unsigned int i = 0; i < size; i++)
+    {
+        ComPtr<IScheduledToastNotification> toast;
+        HRESULT hr = scheduled->GetAt(i, &toast);
+        if (SUCCEEDED(hr))
+        {
+            hr = notifier->RemoveFromSchedule(toast.Get());
+        }
+        if (FAILED(hr) && SUCCEEDED(result))
+        {
+            result = hr;
+        }
+    }
+
+    return result;
+}
+
+ToastResult WrlNotificationPlatform::ReadRegistryValue(const std::wstring& subKey, const std::wstring& valueName, std::wstring& value)
+{
+    const wchar_t* name = valueName.empty() ? nullptr : valueName.c_str();
+
+    DWORD size = 0;
+    LSTATUS status = ::RegGetValueW(HKEY_CURRENT_USER, subKey.c_str(), name, RRF_RT_REG_SZ, nullptr, nullptr, &size);
+    while (status == ERROR_SUCCESS || status == ERROR_MORE_DATA)
+    {
+        std::wstring buffer(size / sizeof(wchar_t), L'\0');
+        status = ::RegGetValueW(HKEY_CURRENT_USER, subKey.c_str(), name, RRF_RT_REG_SZ, nullptr, &buffer[0], &size);
+        if (status == ERROR_SUCCESS)
+        {
+            // The size includes the terminating null
+            buffer.resize(size / sizeof(wchar_t) > 0 ? size / sizeof(wchar_t) - 1 : 0);
+            value = std::move(buffer);
+            return S_OK;
+        }
+    }
+
+    return HRESULT_FROM_WIN32(status);
+}
+
+ToastResult WrlNotificationPlatform::WriteRegistryValues(const std::wstring& subKey, const std::vector<RegistryValue>& values)
+{
+    HKEY key;
+    LSTATUS status = ::RegCreateKeyExW(HKEY_CURRENT_USER, subKey.c_str(), 0, nullptr, REG_OPTION_NON_VOLATILE, KEY_SET_VALUE, nullptr, &key, nullptr);
+    RETURN_IF_FAILED(HRESULT_FROM_WIN32(status));
+
+    for (const RegistryValue& value : values)
+    {
+        // We don't need to worry about overflow here as registry strings are far shorter than the max of DWORD
+        DWORD dataSize = static_cast<DWORD>((value.Value.length() + 1) * sizeof(WCHAR));
+
+        status = ::RegSetValueExW(
+            key,
+            value.Name.empty() ? nullptr : value.Name.c_str(),
+            0,
+            REG_SZ,
+            reinterpret_cast<const BYTE*>(value.Value.c_str()),
+            dataSize);
+        if (status != ERROR_SUCCESS)
+        {
+            break;
+        }
+    }
+
+    ::RegCloseKey(key);
+    return HRESULT_FROM_WIN32(status);
+}
+
+ToastResult WrlNotificationPlatform::DeleteRegistryValue(const std::wstring& subKey, const std::wstring& valueName)
+{
+    return HRESULT_FROM_WIN32(::RegDeleteKeyValueW(HKEY_CURRENT_USER, subKey.c_str(), valueName.c_str()));
+}
+
+ToastResult WrlNotificationPlatform::DeleteRegistryValues(const std::wstring& subKey, const std::vector<std::wstring>& valueNames)
+{
+    HKEY key;
+    LSTATUS status = ::RegOpenKeyExW(HKEY_CURRENT_USER, subKey.c_str(), 0, KEY_SET_VALUE, &key);
+    if (status == ERROR_FILE_NOT_FOUND)
+    {
+        return S_OK;
+    }
+    RETURN_IF_FAILED(HRESULT_FROM_WIN32(status));
+
+    for (const std::wstring& valueName : valueNames)
+    {
+        status = ::RegDeleteValueW(key, valueName.empty() ? nullptr : valueName.c_str());
+        if (status == ERROR_FILE_NOT_FOUND)
+        {
+            status = ERROR_SUCCESS;
+        }
+        else if (status != ERROR_SUCCESS)
+        {
+            break;
+        }
+    }
+
+    ::RegCloseKey(key);
+    return HRESULT_FROM_WIN32(status);
+}
+
+ToastResult WrlNotificationPlatform::DeleteRegistryKey(const std::wstring& subKey)
+{
+    return HRESULT_FROM_WIN32(::RegDeleteKeyW(HKEY_CURRENT_USER, subKey.c_str()));
+}
+
+ToastResult WrlNotificationPlatform::GetPackageFamilyName(std::wstring& familyName)
+{
+    // https://stackoverflow.com/questions/39609643/determine-if-c-application-is-running-as-a-uwp-app-in-desktop-bridge-project
+    UINT32 length = 0;
+    LONG result = ::GetPackageFamilyName(GetCurrentProcess(), &length, nullptr);
+    if (result == APPMODEL_ERROR_NO_PACKAGE)
+    {
+        return ToastResultNotFound;
+    }
+    if (result != ERROR_INSUFFICIENT_BUFFER)
+    {
+        return HRESULT_FROM_WIN32(result);
+    }
+
+    std::wstring name(length, L'\0');
+    RETURN_IF_FAILED(HRESULT_FROM_WIN32(::GetPackageFamilyName(GetCurrentProcess(), &length, &name[0])));
+
+    // The length includes the terminating null
+    name.resize(length > 0 ? length - 1 : 0);
+    familyName = std::move(name);
+    return S_OK;
+}
+
+ToastResult WrlNotificationPlatform::GetPackageInstalledLocation(std::wstring& path)
+{
+    UINT32 length = 0;
+    LONG result = ::GetCurrentPackagePath(&length, nullptr);
+    if (result == APPMODEL_ERROR_NO_PACKAGE)
+    {
+        return ToastResultNotFound;
+    }
+    if (result != ERROR_INSUFFICIENT_BUFFER)
+    {
+        return HRESULT_FROM_WIN32(result);
+    }
+
+    std::wstring location(length, L'\0');
+    RETURN_IF_FAILED(HRESULT_FROM_WIN32(::GetCurrentPackagePath(&length, &location[0])));
+
+    // The length includes the terminating null
+    location.resize(length > 0 ? length - 1 : 0);
+    path = std::move(location);
+    return S_OK;
+}
+
+ToastResult WrlNotificationPlatform::GetModulePath(std::wstring& path)
+{
+    std::wstring buffer(MAX_PATH, L'\0');
+    while (true)
+    {
+        DWORD charWritten = ::GetModuleFileName(nullptr, &buffer[0], static_cast<DWORD>(buffer.size()));
+        RETURN_IF_FAILED(charWritten > 0 ? S_OK : HRESULT_FROM_WIN32(::GetLastError()));
+
+        // A full buffer means the path was truncated
+        if (charWritten < buffer.size())
+        {
+            buffer.resize(charWritten);
+            path = std::move(buffer);
+            return S_OK;
+        }
+
+        buffer.resize(buffer.size() * 2);
+    }
+}
+
+void WrlNotificationPlatform::ClearCaches()
+{
+    // The activation factories aren't tied to a registration, so they're kept
+    m_notifierCache.Clear();
+    m_historyCache.Clear();
+}
+
+HRESULT WrlNotificationPlatform::GetToastNotificationManagerStatics(ComPtr<IToastNotificationManagerStatics>* toastStatics)
+{
+    HRESULT hr = S_OK;
+    m_managerStaticsCache.TryGetOrCreate(s_toastNotificationManagerClass, *toastStatics, [&hr](ComPtr<IToastNotificationManagerStatics>& created)
+    {
+        hr = Windows::Foundation::GetActivationFactory(
+            HStringReference(RuntimeClass_Windows_UI_Notifications_ToastNotificationManager).Get(),
+            &created);
+        return SUCCEEDED(hr);
+    });
+    return hr;
+}
+
+HRESULT WrlNotificationPlatform::CreateScheduledToastNotification(const ScheduledToast& toast, ComPtr<IScheduledToastNotification>* scheduled)
+{
+    HRESULT hr = S_OK;
+    ComPtr<IScheduledToastNotificationFactory> factory;
+    m_scheduledFactoryCache.TryGetOrCreate(s_scheduledToastNotificationClass, factory, [&hr](ComPtr<IScheduledToastNotificationFactory>& created)
+    {
+        hr = Windows::Foundation::GetActivationFactory(
+            HStringReference(RuntimeClass_Windows_UI_Notifications_ScheduledToastNotification).Get(),
+            &created);
+        return SUCCEEDED(hr);
+    });
+    RETURN_IF_FAILED(hr);
+
+    ComPtr<IXmlDocument> doc;
+    RETURN_IF_FAILED(CreateXmlDocumentFromString(toast.Payload.Xml.c_str(), &doc));
+    RETURN_IF_FAILED(factory->CreateScheduledToastNotification(doc.Get(), ToDateTime(toast.DeliveryTime), scheduled->ReleaseAndGetAddressOf()));
+
+    if (!toast.Id.empty())
+    {
+        RETURN_IF_FAILED((*scheduled)->put_Id(HStringReference(toast.Id.c_str()).Get()));
+    }
+
+    if (!toast.Payload.Tag.empty() || !toast.Payload.Group.empty())
+    {
+        ComPtr<IScheduledToastNotification2> scheduled2;
+        RETURN_IF_FAILED(scheduled->As(&scheduled2));
+
+        if (!toast.Payload.Tag.empty())
+        {
+            RETURN_IF_FAILED(scheduled2->put_Tag(HStringReference(toast.Payload.Tag.c_str()).Get()));
+        }
+        if (!toast.Payload.Group.empty())
+        {
+            RETURN_IF_FAILED(scheduled2->put_Group(HStringReference(toast.Payload.Group.c_str()).Get()));
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT WrlNotificationPlatform::GetScheduledToastNotifications(const std::wstring& aumid, ComPtr<IToastNotifier>* notifier, ComPtr<IVectorView<ScheduledToastNotification*>>* scheduled)
+{
+    RETURN_IF_FAILED(GetNotifier(aumid, notifier));
+    return (*notifier)->GetScheduledToastNotifications(scheduled->ReleaseAndGetAddressOf());
+}
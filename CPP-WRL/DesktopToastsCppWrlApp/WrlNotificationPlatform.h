@@ -0,0 +1,89 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+#include <string>
+#include <Windows.h>
+#include <windows.ui.notifications.h>
+#include <wrl.h>
+#include "INotificationPlatform.h"
+#include "ToastObjectCache.h"
+
+/// <summary>
+/// INotificationPlatform on top of the ToastNotificationManager ABI and the Win32 registry and package APIs.
+/// Failures are returned as the HRESULT the platform reported.
+/// </summary>
+class WrlNotificationPlatform : public INotificationPlatform
+{
+public:
+    /// <summary>
+    /// Gets the notifier for the AUMID (empty for apps with identity), creating and caching it on first use.
+    /// </summary>
+    HRESULT GetNotifier(const std::wstring& aumid, Microsoft::WRL::ComPtr<ABI::Windows::UI::Notifications::IToastNotifier>* notifier);
+
+    /// <summary>
+    /// Gets the platform's ToastNotificationHistory object, creating and caching it on first use.
+    /// </summary>
+    HRESULT GetNativeHistory(Microsoft::WRL::ComPtr<ABI::Windows::UI::Notifications::IToastNotificationHistory>* history);
+
+    /// <summary>
+    /// Creates a toast notification through the cached ToastNotification activation factory.
+    /// </summary>
+    HRESULT CreateToastNotification(ABI::Windows::Data::Xml::Dom::IXmlDocument* content, ABI::Windows::UI::Notifications::IToastNotification** notification);
+
+    /// <summary>
+    /// Creates an XmlDocument initialized with the specified string.
+    /// </summary>
+    static HRESULT CreateXmlDocumentFromString(const wchar_t* xmlString, ABI::Windows::Data::Xml::Dom::IXmlDocument** doc);
+
+    ToastResult Show(const std::wstring& aumid, const ToastPayload& payload) override;
+    ToastResult Update(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group, const ToastData& data) override;
+
+    ToastResult GetHistory(const std::wstring& aumid, std::vector<ToastHistoryEntry>& entries) override;
+    ToastResult RemoveFromHistory(const std::wstring& aumid, const std::wstring& tag, const std::wstring& group) override;
+    ToastResult RemoveGroupFromHistory(const std::wstring& aumid, const std::wstring& group) override;
+    void RemoveBatchFromHistory(const std::wstring& aumid, const std::vector<ToastHistoryEntry>& toasts, std::vector<ToastResult>& results) override;
+    ToastResult ClearHistory(const std::wstring& aumid) override;
+
+    ToastResult AddToSchedule(const std::wstring& aumid, const ScheduledToast& toast) override;
+    ToastResult GetScheduled(const std::wstring& aumid, std::vector<ScheduledToast>& toasts) override;
+    ToastResult RemoveFromSchedule(const std::wstring& aumid, const std::wstring& id) override;
+    ToastResult ClearSchedule(const std::wstring& aumid) override;
+
+    ToastResult ReadRegistryValue(const std::wstring& subKey, const std::wstring& valueName, std::wstring& value) override;
+    ToastResult WriteRegistryValues(const std::wstring& subKey, const std::vector<RegistryValue>& values) override;
+    ToastResult DeleteRegistryValue(const std::wstring& subKey, const std::wstring& valueName) override;
+    ToastResult DeleteRegistryValues(const std::wstring& subKey, const std::vector<std::wstring>& valueNames) override;
+    ToastResult DeleteRegistryKey(const std::wstring& subKey) override;
+
+    ToastResult GetPackageFamilyName(std::wstring& familyName) override;
+    ToastResult GetPackageInstalledLocation(std::wstring& path) override;
+    ToastResult GetModulePath(std::wstring& path) override;
+
+    void ClearCaches() override;
+
+private:
+    HRESULT GetToastNotificationManagerStatics(Microsoft::WRL::ComPtr<ABI::Windows::UI::Notifications::IToastNotificationManagerStatics>* toastStatics);
+    HRESULT CreateScheduledToastNotification(const ScheduledToast& toast, Microsoft::WRL::ComPtr<ABI::Windows::UI::Notifications::IScheduledToastNotification>* scheduled);
+    HRESULT GetScheduledToastNotifications(
+        const std::wstring& aumid,
+        Microsoft::WRL::ComPtr<ABI::Windows::UI::Notifications::IToastNotifier>* notifier,
+        Microsoft::WRL::ComPtr<ABI::Windows::Foundation::Collections::IVectorView<ABI::Windows::UI::Notifications::ScheduledToastNotification*>>* scheduled);
+
+    // Activation factories are cached by class name, notifiers and history objects by AUMID,
+    // so sending a toast doesn't go back to the platform for each of them every time
+    ToastObjectCache<Microsoft::WRL::ComPtr<ABI::Windows::UI::Notifications::IToastNotificationManagerStatics>> m_managerStaticsCache;
+    ToastObjectCache<Microsoft::WRL::ComPtr<ABI::Windows::UI::Notifications::IToastNotificationFactory>> m_notificationFactoryCache;
+    ToastObjectCache<Microsoft::WRL::ComPtr<ABI::Windows::UI::Notifications::IScheduledToastNotificationFactory>> m_scheduledFactoryCache;
+    ToastObjectCache<Microsoft::WRL::ComPtr<ABI::Windows::UI::Notifications::IToastNotifier>> m_notifierCache;
+    ToastObjectCache<Microsoft::WRL::ComPtr<ABI::Windows::UI::Notifications::IToastNotificationHistory>> m_historyCache;
+};